@@ -10,9 +10,36 @@ ClientStub::~ClientStub() {
     }
 }
 
-bool ClientStub::Init(const std::string& ip, int port) {
+bool ClientStub::Init(const std::string& ip, int port, int connect_timeout_ms) {
     socket = new Socket();
-    return socket->Connect(ip, port);
+    return socket->Connect(ip, port, connect_timeout_ms);
+}
+
+bool ClientStub::NegotiateCompression(int codecs) {
+    int chosen;
+    if (!SendOpType(OpType::COMPRESSION_HELLO) || !SendInt(codecs) || !ReceiveInt(chosen)) {
+        return false;
+    }
+    if (chosen & COMPRESSION_LZ) {
+        socket->EnableCompression();
+    }
+    return true;
+}
+
+bool ClientStub::NegotiateWireVersion(int version) {
+    int chosen;
+    if (!SendOpType(OpType::WIRE_HELLO) || !SendInt(version) || !ReceiveInt(chosen)) {
+        return false;
+    }
+    if (chosen < WIRE_V1 || chosen > version) {
+        return false;
+    }
+    socket->SetWireVersion(chosen);
+    return true;
+}
+
+bool ClientStub::SetTimeouts(int timeout_ms) {
+    return socket && socket->SetTimeouts(timeout_ms, timeout_ms);
 }
 
 bool ClientStub::SendOpType(OpType op_type) {
@@ -21,40 +48,23 @@ bool ClientStub::SendOpType(OpType op_type) {
     return socket->Send(&net_op_type, sizeof(int));
 }
 
+bool ClientStub::SendInt(int value) {
+    int net_value = htonl(value);
+    return socket->Send(&net_value, sizeof(int));
+}
+
+// Size, then the marshalled task, encoded in one pass and sent together
 bool ClientStub::SendTask(const Task& task) {
-    int size = task.Size();
-    char* buffer = new char[size];
-    task.Marshal(buffer);
-    
-    // Send size first
-    int net_size = htonl(size);
-    if (!socket->Send(&net_size, sizeof(int))) {
-        delete[] buffer;
-        return false;
-    }
-    
-    // Send data
-    bool result = socket->Send(buffer, size);
-    delete[] buffer;
-    return result;
+    std::vector<char> buffer;
+    AppendSizePrefixed(buffer, task, socket->GetWireVersion());
+    return socket->Send(buffer.data(), buffer.size());
 }
 
+// Size, then the marshalled entry, encoded in one pass and sent together
 bool ClientStub::SendLogEntry(const LogEntry& entry) {
-    int size = entry.Size();
-    char* buffer = new char[size];
-    entry.Marshal(buffer);
-    
-    // Send size first
-    int net_size = htonl(size);
-    if (!socket->Send(&net_size, sizeof(int))) {
-        delete[] buffer;
-        return false;
-    }
-    
-    // Send data
-    bool result = socket->Send(buffer, size);
-    delete[] buffer;
-    return result;
+    std::vector<char> buffer;
+    AppendSizePrefixed(buffer, entry, socket->GetWireVersion());
+    return socket->Send(buffer.data(), buffer.size());
 }
 
 Task ClientStub::ReceiveTask() {
@@ -74,37 +84,115 @@ Task ClientStub::ReceiveTask() {
         return task;
     }
     
-    task.Unmarshal(buffer);
+    if (!task.Unmarshal(buffer, size, socket->GetWireVersion())) {
+        task = Task();
+    }
     delete[] buffer;
     return task;
 }
 
-bool ClientStub::ReceiveSuccess() {
-    int result;
-    if (!socket->Receive(&result, sizeof(int))) {
+bool ClientStub::SendLogEntryList(const std::vector<LogEntry>& entries) {
+    if (!SendInt(static_cast<int>(entries.size()))) {
         return false;
     }
-    return ntohl(result) == 1;
+    
+    for (const LogEntry& entry : entries) {
+        if (!SendLogEntry(entry)) {
+            return false;
+        }
+    }
+    
+    return true;
 }
 
-void ClientStub::Close() {
-    if (socket) {
-        socket->Close();
-        delete socket;
-        socket = nullptr;
+// Count, then size-prefixed tasks, marshalled into one buffer so a large import is one send
+bool ClientStub::SendTaskList(const std::vector<Task>& tasks) {
+    std::vector<char> buffer(sizeof(int));
+    int net_count = htonl(static_cast<int>(tasks.size()));
+    memcpy(buffer.data(), &net_count, sizeof(int));
+    for (const Task& task : tasks) {
+        AppendSizePrefixed(buffer, task, socket->GetWireVersion());
     }
+    
+    return socket->Send(buffer.data(), buffer.size());
 }
 
+bool ClientStub::SendBatch(const std::vector<BatchOperation>& ops) {
+    if (!SendOpType(OpType::BATCH) || !SendInt(static_cast<int>(ops.size()))) {
+        return false;
+    }
+    
+    for (const BatchOperation& op : ops) {
+        if (!SendInt(static_cast<int>(op.op_type)) || !SendTask(op.task)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
 
-bool ClientStub::SendHeartbeat() {
-    // Send HEARTBEAT_PING opcode
-    int op_type_int = static_cast<int>(OpType::HEARTBEAT_PING);
-    int net_op_type = htonl(op_type_int);
-    return socket->Send(&net_op_type, sizeof(int));
+bool ClientStub::ReceiveOperationResponses(std::vector<OperationResponse>& responses) {
+    int net_count;
+    if (!socket->Receive(&net_count, sizeof(int))) {
+        return false;
+    }
+    int count = ntohl(net_count);
+    
+    responses.clear();
+    for (int i = 0; i < count; i++) {
+        OperationResponse response;
+        if (!ReceiveOperationResponse(response)) {
+            return false;
+        }
+        responses.push_back(response);
+    }
+    
+    return true;
 }
 
-bool ClientStub::ReceiveHeartbeatAck() {
-    // Receive simple success response (1 = ack received)
+// 7 integers: success, conflict, rejected, task_id, entry_id, busy/unconfirmed, retry_after_ms.
+// WIRE_V2: flags, task_id, entry_id, retry_after_ms
+bool ClientStub::ReceiveOperationResponse(OperationResponse& response) {
+    if (socket->GetWireVersion() == WIRE_V2) {
+        char compact[COMPACT_RESPONSE_SIZE];
+        if (!socket->Receive(compact, sizeof(compact))) {
+            return false;
+        }
+        uint8_t flags = static_cast<uint8_t>(compact[0]);
+        int net_ints[3];
+        memcpy(net_ints, compact + 1, sizeof(net_ints));
+        response.success = (flags & RESPONSE_SUCCESS) != 0;
+        response.conflict = (flags & RESPONSE_CONFLICT) != 0;
+        response.rejected = (flags & RESPONSE_REJECTED) != 0;
+        response.busy = (flags & RESPONSE_BUSY) != 0;
+        response.unconfirmed = (flags & RESPONSE_UNCONFIRMED) != 0;
+        response.updated_task_id = ntohl(net_ints[0]);
+        response.entry_id = ntohl(net_ints[1]);
+        response.retry_after_ms = ntohl(net_ints[2]);
+        return true;
+    }
+    
+    int buffer[7];
+    if (!socket->Receive(buffer, sizeof(buffer))) {
+        return false;
+    }
+    response.success = ntohl(buffer[0]) == 1;
+    response.conflict = ntohl(buffer[1]) == 1;
+    response.rejected = ntohl(buffer[2]) == 1;
+    response.updated_task_id = ntohl(buffer[3]);
+    response.entry_id = ntohl(buffer[4]);
+    response.busy = static_cast<int>(ntohl(buffer[5])) == RESPONSE_STATUS_BUSY;
+    response.unconfirmed = static_cast<int>(ntohl(buffer[5])) == RESPONSE_STATUS_UNCONFIRMED;
+    response.retry_after_ms = ntohl(buffer[6]);
+    return true;
+}
+
+bool ClientStub::ReceiveSuccess() {
+    if (socket->GetWireVersion() == WIRE_V2) {
+        char flag;
+        return socket->Receive(&flag, 1) && flag == 1;
+    }
+    
     int result;
     if (!socket->Receive(&result, sizeof(int))) {
         return false;
@@ -112,99 +200,299 @@ bool ClientStub::ReceiveHeartbeatAck() {
     return ntohl(result) == 1;
 }
 
-// State transfer methods for master rejoin
-bool ClientStub::SendStateTransferRequest() {
-    return SendOpType(OpType::STATE_TRANSFER_REQUEST);
+LogEntry ClientStub::ReceiveLogEntry() {
+    // Error entry with -1 id to indicate failure
+    LogEntry entry(-1, OpType::CREATE_TASK, VectorClock(0), -1, "", "", "", Column::TODO, 0);
+    
+    int size;
+    if (!socket->Receive(&size, sizeof(int))) {
+        return entry;
+    }
+    size = ntohl(size);
+    
+    char* buffer = new char[size];
+    if (!socket->Receive(buffer, size)) {
+        delete[] buffer;
+        return entry;
+    }
+    
+    if (!entry.Unmarshal(buffer, size, socket->GetWireVersion())) {
+        entry = LogEntry(-1, OpType::CREATE_TASK, VectorClock(0), -1, "", "", "", Column::TODO, 0);
+    }
+    delete[] buffer;
+    return entry;
+}
+
+bool ClientStub::SendSubscribe(int after_entry_id) {
+    return SendOpType(OpType::SUBSCRIBE) && SendInt(after_entry_id);
 }
 
-bool ClientStub::ReceiveStateTransfer(std::vector<Task>& tasks, std::vector<LogEntry>& log, int& id_counter) {
-    // Receive id_counter
-    int net_id_counter;
-    if (!socket->Receive(&net_id_counter, sizeof(int))) {
+// Blocks until the server pushes the next batch, an empty batch is a keepalive
+bool ClientStub::ReceiveChangeEvents(std::vector<ChangeEvent>& events) {
+    int net_count;
+    if (!socket->Receive(&net_count, sizeof(int))) {
         return false;
     }
-    id_counter = ntohl(net_id_counter);
+    int count = ntohl(net_count);
+    
+    events.clear();
+    for (int i = 0; i < count; i++) {
+        LogEntry entry = ReceiveLogEntry();
+        if (entry.get_entry_id() < 0) {
+            return false;
+        }
+        ChangeEvent event(entry);
+        
+        int net_has_task;
+        if (!socket->Receive(&net_has_task, sizeof(int))) {
+            return false;
+        }
+        event.has_task = ntohl(net_has_task) == 1;
+        if (event.has_task) {
+            event.task = ReceiveTask();
+            if (event.task.get_task_id() < 0) {
+                return false;
+            }
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+bool ClientStub::SendBoardSinceRequest(int origin, int since_version) {
+    return SendOpType(OpType::GET_BOARD_SINCE) && SendInt(origin) && SendInt(since_version);
+}
+
+// task_id -1 reads the whole board. min_entry_id -1 accepts any staleness
+bool ClientStub::SendFollowerReadRequest(int task_id, int min_entry_id) {
+    return SendOpType(OpType::FOLLOWER_READ) && SendInt(task_id) && SendInt(min_entry_id);
+}
+
+bool ClientStub::ReceiveFollowerRead(FollowerReadResponse& response) {
+    int header[2];
+    if (!socket->Receive(header, sizeof(header))) {
+        return false;
+    }
+    response.applied_entry_id = ntohl(header[0]);
+    response.fresh = ntohl(header[1]) == 1;
     
-    // Receive task count
     int net_task_count;
     if (!socket->Receive(&net_task_count, sizeof(int))) {
         return false;
     }
     int task_count = ntohl(net_task_count);
     
-    tasks.clear();
+    response.tasks.clear();
+    for (int i = 0; i < task_count; i++) {
+        Task task = ReceiveTask();
+        if (task.get_task_id() < 0) {
+            return false;
+        }
+        response.tasks.push_back(task);
+    }
+    return true;
+}
+
+bool ClientStub::QueryLeader(LeaderInfo& info) {
+    int buffer[3];
+    if (!SendOpType(OpType::LEADER_QUERY) || !socket->Receive(buffer, sizeof(buffer))) {
+        return false;
+    }
+    info.role = static_cast<NodeRole>(ntohl(buffer[0]));
+    info.epoch = ntohl(buffer[1]);
+    info.last_entry_id = ntohl(buffer[2]);
+    return true;
+}
+
+// Size-prefixed like a task
+bool ClientStub::SendQuery(const TaskQuery& query) {
+    std::vector<char> buffer(query.Size());
+    query.Marshal(buffer.data());
+    int net_size = htonl(static_cast<int>(buffer.size()));
+    return SendOpType(OpType::QUERY) && socket->Send(&net_size, sizeof(int)) &&
+           socket->Send(buffer.data(), buffer.size());
+}
+
+bool ClientStub::ReceiveTaskPage(TaskPage& page) {
+    int net_task_count;
+    if (!socket->Receive(&net_task_count, sizeof(int))) {
+        return false;
+    }
+    int task_count = ntohl(net_task_count);
     
-    // Receive each task
+    page.tasks.clear();
     for (int i = 0; i < task_count; i++) {
         Task task = ReceiveTask();
-        tasks.push_back(task);
+        if (task.get_task_id() < 0) {
+            return false;
+        }
+        page.tasks.push_back(task);
+    }
+    
+    char trailer[sizeof(int) + QueryCursor::SIZE];
+    if (!socket->Receive(trailer, sizeof(trailer))) {
+        return false;
+    }
+    int net_has_more;
+    memcpy(&net_has_more, trailer, sizeof(int));
+    page.has_more = ntohl(net_has_more) == 1;
+    page.next.Unmarshal(trailer + sizeof(int));
+    return true;
+}
+
+// Query text length, text, limit
+bool ClientStub::SendSearch(const std::string& query, int limit) {
+    int net_length = htonl(static_cast<int>(query.size()));
+    return SendOpType(OpType::SEARCH) && socket->Send(&net_length, sizeof(int)) &&
+           (query.empty() || socket->Send(query.data(), query.size())) && SendInt(limit);
+}
+
+bool ClientStub::ReceiveSearchResults(SearchResults& results) {
+    int header[2];
+    if (!socket->Receive(header, sizeof(header))) {
+        return false;
+    }
+    results.total_matches = ntohl(header[0]);
+    int count = ntohl(header[1]);
+    if (count < 0 || count > MAX_SEARCH_RESULTS) {
+        return false;
     }
     
-    // Receive log count
-    int net_log_count;
-    if (!socket->Receive(&net_log_count, sizeof(int))) {
+    std::vector<int> pairs(count * 2);
+    if (count > 0 && !socket->Receive(pairs.data(), pairs.size() * sizeof(int))) {
+        return false;
+    }
+    results.hits.clear();
+    for (int i = 0; i < count; i++) {
+        results.hits.push_back(SearchHit(ntohl(pairs[i * 2]), ntohl(pairs[i * 2 + 1])));
+    }
+    return true;
+}
+
+bool ClientStub::ReceiveBoardDelta(BoardDelta& delta) {
+    int header[3];
+    if (!socket->Receive(header, sizeof(header))) {
         return false;
     }
-    int log_count = ntohl(net_log_count);
+    delta.origin = ntohl(header[0]);
+    delta.version = ntohl(header[1]);
+    delta.full_sync = ntohl(header[2]) == 1;
     
-    log.clear();
+    // Changed tasks
+    int net_task_count;
+    if (!socket->Receive(&net_task_count, sizeof(int))) {
+        return false;
+    }
+    int task_count = ntohl(net_task_count);
     
-    // Receive each log entry
-    for (int i = 0; i < log_count; i++) {
-        // Receive size
-        int net_size;
-        if (!socket->Receive(&net_size, sizeof(int))) {
-            return false;
-        }
-        int size = ntohl(net_size);
-        
-        // Receive data
-        char* buffer = new char[size];
-        if (!socket->Receive(buffer, size)) {
-            delete[] buffer;
+    delta.tasks.clear();
+    for (int i = 0; i < task_count; i++) {
+        Task task = ReceiveTask();
+        if (task.get_task_id() < 0) {
             return false;
         }
-        
-        LogEntry entry(-1, OpType::CREATE_TASK, VectorClock(0), -1, "", "", "", Column::TODO, 0);
-        entry.Unmarshal(buffer);
-        delete[] buffer;
-        log.push_back(entry);
+        delta.tasks.push_back(task);
+    }
+    
+    // Deleted ids
+    int net_deleted_count;
+    if (!socket->Receive(&net_deleted_count, sizeof(int))) {
+        return false;
     }
+    int deleted_count = ntohl(net_deleted_count);
     
+    delta.deleted_task_ids.assign(deleted_count, 0);
+    if (deleted_count > 0 && !socket->Receive(delta.deleted_task_ids.data(), deleted_count * sizeof(int))) {
+        return false;
+    }
+    for (int& id : delta.deleted_task_ids) {
+        id = ntohl(id);
+    }
     return true;
 }
 
-bool ClientStub::SendStateTransfer(const std::vector<Task>& tasks, const std::vector<LogEntry>& log, int id_counter) {
-    // Send id_counter
-    int net_id_counter = htonl(id_counter);
-    if (!socket->Send(&net_id_counter, sizeof(int))) {
+void ClientStub::Shutdown() {
+    if (socket) {
+        socket->Shutdown();
+    }
+}
+
+void ClientStub::Close() {
+    if (socket) {
+        socket->Close();
+        delete socket;
+        socket = nullptr;
+    }
+}
+
+
+bool ClientStub::SendHeartbeat() {
+    // Send HEARTBEAT_PING opcode
+    int op_type_int = static_cast<int>(OpType::HEARTBEAT_PING);
+    int net_op_type = htonl(op_type_int);
+    return socket->Send(&net_op_type, sizeof(int));
+}
+
+bool ClientStub::ReceiveHeartbeatAck() {
+    // Receive simple success response (1 = ack received)
+    int result;
+    if (!socket->Receive(&result, sizeof(int))) {
         return false;
     }
-    
-    // Send task count and tasks
-    int task_count = tasks.size();
-    int net_task_count = htonl(task_count);
-    if (!socket->Send(&net_task_count, sizeof(int))) {
+    return ntohl(result) == 1;
+}
+
+// State transfer methods for master rejoin
+bool ClientStub::SendStateTransferRequest() {
+    return SendOpType(OpType::STATE_TRANSFER_REQUEST);
+}
+
+bool ClientStub::ReceiveInt(int& value) {
+    int net_value;
+    if (!socket->Receive(&net_value, sizeof(int))) {
+        return false;
+    }
+    value = ntohl(net_value);
+    return true;
+}
+
+bool ClientStub::ReceiveTaskChunk(std::vector<Task>& tasks, std::vector<int>& applied_ids) {
+    int count;
+    if (!ReceiveInt(count) || count < 0 || count > STATE_TRANSFER_CHUNK_SIZE) {
         return false;
     }
     
-    for (const Task& task : tasks) {
-        if (!SendTask(task)) {
+    tasks.clear();
+    applied_ids.clear();
+    for (int i = 0; i < count; i++) {
+        int applied_id;
+        if (!ReceiveInt(applied_id)) {
+            return false;
+        }
+        Task task = ReceiveTask();
+        if (task.get_task_id() < 0) {
             return false;
         }
+        tasks.push_back(task);
+        applied_ids.push_back(applied_id);
     }
     
-    // Send log count and entries
-    int log_count = log.size();
-    int net_log_count = htonl(log_count);
-    if (!socket->Send(&net_log_count, sizeof(int))) {
+    return true;
+}
+
+bool ClientStub::ReceiveLogEntryList(std::vector<LogEntry>& entries) {
+    int count;
+    if (!ReceiveInt(count) || count < 0 || count > STATE_TRANSFER_CHUNK_SIZE) {
         return false;
     }
     
-    for (const LogEntry& entry : log) {
-        if (!SendLogEntry(entry)) {
+    entries.clear();
+    for (int i = 0; i < count; i++) {
+        LogEntry entry = ReceiveLogEntry();
+        if (entry.get_entry_id() < 0) {
             return false;
         }
+        entries.push_back(entry);
     }
     
     return true;
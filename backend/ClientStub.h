@@ -6,6 +6,13 @@
 #include "Socket.h"
 #include "messages.h"
 
+// Deadline on each send/receive of a state transfer, a peer that stops mid-transfer
+// must not hold startup forever
+const int STATE_TRANSFER_TIMEOUT_MS = 5000;
+
+// LEADER_QUERY is a few bytes each way, a slower answer means the node is no use as a leader
+const int LEADER_QUERY_TIMEOUT_MS = 1000;
+
 // Client stub for sending task operations
 class ClientStub {
 private:
@@ -15,14 +22,30 @@ public:
     ClientStub();
     ~ClientStub();
     
-    bool Init(const std::string& ip, int port);
+    bool Init(const std::string& ip, int port, int connect_timeout_ms = DEFAULT_CONNECT_TIMEOUT_MS);
+    bool SetTimeouts(int timeout_ms);  // Send and receive deadline per call, 0 for none
+    
+    // COMPRESSION_HELLO as the connection's first message. False only if the exchange
+    // fails, a peer may still answer that it won't compress
+    bool NegotiateCompression(int codecs = SUPPORTED_COMPRESSION);
+    
+    // WIRE_HELLO, offering encodings up to version. The connection uses the peer's pick
+    // from then on, WIRE_V1 if the exchange fails
+    bool NegotiateWireVersion(int version = SUPPORTED_WIRE_VERSION);
     
     // Send operation type
     bool SendOpType(OpType op_type);
+    bool SendInt(int value);
     
     // Send task operation data
     bool SendTask(const Task& task);
     bool SendLogEntry(const LogEntry& entry);
+    bool SendLogEntryList(const std::vector<LogEntry>& entries);
+    bool SendTaskList(const std::vector<Task>& tasks);
+    
+    // BATCH request and its per-operation responses
+    bool SendBatch(const std::vector<BatchOperation>& ops);
+    bool ReceiveOperationResponses(std::vector<OperationResponse>& responses);
     
     // Heartbeat operations
     bool SendHeartbeat();
@@ -31,12 +54,38 @@ public:
     // Receive responses
     Task ReceiveTask();
     bool ReceiveSuccess();
+    bool ReceiveOperationResponse(OperationResponse& response);
+    
+    LogEntry ReceiveLogEntry();
+    
+    // Change feed, SUBSCRIBE request and pushed batches
+    bool SendSubscribe(int after_entry_id);
+    bool ReceiveChangeEvents(std::vector<ChangeEvent>& events);
+    
+    // Delta sync, GET_BOARD_SINCE request and response
+    bool SendBoardSinceRequest(int origin, int since_version);
+    bool ReceiveBoardDelta(BoardDelta& delta);
+    
+    // Follower reads, served by a standby backup once it has applied min_entry_id
+    bool SendFollowerReadRequest(int task_id, int min_entry_id);
+    bool ReceiveFollowerRead(FollowerReadResponse& response);
+    bool QueryLeader(LeaderInfo& info);  // Sends LEADER_QUERY and reads the answer
+    
+    // QUERY request and the page it returns
+    bool SendQuery(const TaskQuery& query);
+    bool ReceiveTaskPage(TaskPage& page);
+    
+    // SEARCH request and its ranked hits
+    bool SendSearch(const std::string& query, int limit);
+    bool ReceiveSearchResults(SearchResults& results);
     
-    // State transfer methods for master rejoin
+    // State transfer methods for master rejoin (streamed by ReceiveState in state_transfer.h)
     bool SendStateTransferRequest();
-    bool ReceiveStateTransfer(std::vector<Task>& tasks, std::vector<LogEntry>& log, int& id_counter);
-    bool SendStateTransfer(const std::vector<Task>& tasks, const std::vector<LogEntry>& log, int id_counter);
+    bool ReceiveInt(int& value);
+    bool ReceiveTaskChunk(std::vector<Task>& tasks, std::vector<int>& applied_ids);
+    bool ReceiveLogEntryList(std::vector<LogEntry>& entries);
     
+    void Shutdown();  // Fail a blocked call in another thread, Close still frees the socket
     void Close();
 };
 
@@ -38,7 +38,9 @@ Task ServerStub::ReceiveTask() {
         return task;
     }
     
-    task.Unmarshal(buffer);
+    if (!task.Unmarshal(buffer, size, socket->GetWireVersion())) {
+        task = Task();
+    }
     delete[] buffer;
     return task;
 }
@@ -61,27 +63,143 @@ LogEntry ServerStub::ReceiveLogEntry() {
         return entry; // Returns entry with id=-1
     }
     
-    entry.Unmarshal(buffer);
+    if (!entry.Unmarshal(buffer, size, socket->GetWireVersion())) {
+        entry = LogEntry(-1, OpType::CREATE_TASK, VectorClock(0), -1, "", "", "", Column::TODO, 0);
+    }
     delete[] buffer;
     return entry;
 }
 
-bool ServerStub::SendTask(const Task& task) {
-    int size = task.Size();
-    char* buffer = new char[size];
-    task.Marshal(buffer);
+bool ServerStub::AcceptCompression() {
+    int offered;
+    if (!ReceiveInt(offered)) {
+        return false;
+    }
+    int chosen = (offered & SUPPORTED_COMPRESSION & COMPRESSION_LZ) ? COMPRESSION_LZ : COMPRESSION_NONE;
+    if (!SendInt(chosen)) {
+        return false;
+    }
+    if (chosen != COMPRESSION_NONE) {
+        socket->EnableCompression();
+    }
+    return true;
+}
+
+bool ServerStub::AcceptWireVersion() {
+    int offered;
+    if (!ReceiveInt(offered) || offered < WIRE_V1) {
+        return false;
+    }
+    int chosen = offered < SUPPORTED_WIRE_VERSION ? offered : SUPPORTED_WIRE_VERSION;
+    if (!SendInt(chosen)) {
+        return false;
+    }
+    socket->SetWireVersion(chosen);
+    return true;
+}
+
+bool ServerStub::ReceiveInt(int& value) {
+    int net_value;
+    if (!socket->Receive(&net_value, sizeof(int))) {
+        return false;
+    }
+    value = ntohl(net_value);
+    return true;
+}
+
+// BATCH request: count, then per operation its op type and task
+bool ServerStub::ReceiveBatch(std::vector<BatchOperation>& ops) {
+    int count;
+    if (!ReceiveInt(count) || count < 0 || count > MAX_BATCH_OPERATIONS) {
+        return false;
+    }
     
-    // Send size first
-    int net_size = htonl(size);
-    if (!socket->Send(&net_size, sizeof(int))) {
-        delete[] buffer;
+    ops.clear();
+    ops.reserve(count);
+    for (int i = 0; i < count; i++) {
+        int op_type;
+        if (!ReceiveInt(op_type)) {
+            return false;
+        }
+        ops.emplace_back(static_cast<OpType>(op_type), ReceiveTask());
+    }
+    
+    return true;
+}
+
+// QUERY request: size, then the marshalled query. Anything past the fixed fields is the
+// created_by filter, no name needs more than this
+static const int MAX_QUERY_SIZE = 4096;
+
+bool ServerStub::ReceiveQuery(TaskQuery& query) {
+    int size;
+    if (!ReceiveInt(size) || size < 0 || size > MAX_QUERY_SIZE) {
+        return false;
+    }
+    std::vector<char> buffer(size);
+    if (size > 0 && !socket->Receive(buffer.data(), size)) {
+        return false;
+    }
+    return query.Unmarshal(buffer.data(), size);
+}
+
+// SEARCH request: text length, text, limit
+bool ServerStub::ReceiveSearch(std::string& query, int& limit) {
+    int length;
+    if (!ReceiveInt(length) || length < 0 || length > MAX_SEARCH_QUERY_LENGTH) {
+        return false;
+    }
+    query.assign(length, '\0');
+    if (length > 0 && !socket->Receive(&query[0], length)) {
+        return false;
+    }
+    return ReceiveInt(limit);
+}
+
+// GET_BOARD_JSON request: board id length, then the id
+bool ServerStub::ReceiveBoardId(std::string& board_id) {
+    int length;
+    if (!ReceiveInt(length) || length < 0 || length > MAX_BOARD_ID_LENGTH) {
+        return false;
+    }
+    board_id.assign(length, '\0');
+    return length == 0 || socket->Receive(&board_id[0], length);
+}
+
+// IMPORT_TASKS request: count, then size-prefixed tasks
+bool ServerStub::ReceiveTaskList(std::vector<Task>& tasks) {
+    int count;
+    if (!ReceiveInt(count) || count < 0 || count > MAX_IMPORT_TASKS) {
         return false;
     }
     
-    // Send data
-    bool result = socket->Send(buffer, size);
-    delete[] buffer;
-    return result;
+    tasks.clear();
+    tasks.reserve(count);
+    std::vector<char> buffer;
+    for (int i = 0; i < count; i++) {
+        int size;
+        if (!ReceiveInt(size) || size <= 0) {
+            return false;
+        }
+        buffer.resize(size);
+        if (!socket->Receive(buffer.data(), size)) {
+            return false;
+        }
+        Task task;
+        if (!task.Unmarshal(buffer.data(), size, socket->GetWireVersion())) {
+            return false;
+        }
+        tasks.push_back(task);
+    }
+    
+    return true;
+}
+
+// Size, then the marshalled task, encoded in one pass and sent together
+bool ServerStub::SendTask(const Task& task) {
+    std::vector<char> buffer;
+    AppendSizePrefixed(buffer, task, socket->GetWireVersion());
+    return socket->Send(buffer.data(), buffer.size());
 }
 
 bool ServerStub::SendTaskList(const std::vector<Task>& tasks) {
@@ -103,6 +221,10 @@ bool ServerStub::SendTaskList(const std::vector<Task>& tasks) {
 }
 
 bool ServerStub::SendSuccess(bool success) {
+    if (socket->GetWireVersion() == WIRE_V2) {
+        char flag = success ? 1 : 0;
+        return socket->Send(&flag, 1);
+    }
     int result = success ? 1 : 0;
     int net_result = htonl(result);
     return socket->Send(&net_result, sizeof(int));
@@ -115,18 +237,164 @@ void ServerStub::Close() {
 }
 
 
+// WIRE_V2: flags, task_id, entry_id, retry_after_ms
+static void PackResponse(const OperationResponse& response, char* out) {
+    out[0] = static_cast<char>((response.success ? RESPONSE_SUCCESS : 0) |
+                               (response.conflict ? RESPONSE_CONFLICT : 0) |
+                               (response.rejected ? RESPONSE_REJECTED : 0) |
+                               (response.busy ? RESPONSE_BUSY : 0) |
+                               (response.unconfirmed ? RESPONSE_UNCONFIRMED : 0));
+    int net_ints[3] = { static_cast<int>(htonl(response.updated_task_id)), static_cast<int>(htonl(response.entry_id)),
+                        static_cast<int>(htonl(response.retry_after_ms)) };
+    memcpy(out + 1, net_ints, sizeof(net_ints));
+}
+
+// WIRE_V1's busy slot: busy, or applied but unconfirmed, or neither
+static int ResponseStatus(const OperationResponse& response) {
+    if (response.busy) {
+        return RESPONSE_STATUS_BUSY;
+    }
+    return response.unconfirmed ? RESPONSE_STATUS_UNCONFIRMED : 0;
+}
+
 bool ServerStub::SendOperationResponse(const OperationResponse& response) {
-    // Send 4 integers: success, conflict, rejected, task_id
-    int buffer[4];
+    if (socket->GetWireVersion() == WIRE_V2) {
+        char compact[COMPACT_RESPONSE_SIZE];
+        PackResponse(response, compact);
+        return socket->Send(compact, sizeof(compact));
+    }
+    
+    // Send 7 integers: success, conflict, rejected, task_id, entry_id, busy/unconfirmed, retry_after_ms
+    int buffer[7];
     buffer[0] = htonl(response.success ? 1 : 0);
     buffer[1] = htonl(response.conflict ? 1 : 0);
     buffer[2] = htonl(response.rejected ? 1 : 0);
     buffer[3] = htonl(response.updated_task_id);
+    buffer[4] = htonl(response.entry_id);
+    buffer[5] = htonl(ResponseStatus(response));
+    buffer[6] = htonl(response.retry_after_ms);
+    
+    return socket->Send(buffer, sizeof(buffer));
+}
+
+// BATCH response: count, then the same 7 integers per operation (in WIRE_V2 the compact form)
+bool ServerStub::SendOperationResponses(const std::vector<OperationResponse>& responses) {
+    if (socket->GetWireVersion() == WIRE_V2) {
+        std::vector<char> compact(sizeof(int) + responses.size() * COMPACT_RESPONSE_SIZE);
+        int net_count = htonl(static_cast<int>(responses.size()));
+        memcpy(compact.data(), &net_count, sizeof(int));
+        for (size_t i = 0; i < responses.size(); i++) {
+            PackResponse(responses[i], compact.data() + sizeof(int) + i * COMPACT_RESPONSE_SIZE);
+        }
+        return socket->Send(compact.data(), compact.size());
+    }
     
+    std::vector<int> buffer(1 + responses.size() * 7);
+    buffer[0] = htonl(static_cast<int>(responses.size()));
+    for (size_t i = 0; i < responses.size(); i++) {
+        buffer[1 + i * 7] = htonl(responses[i].success ? 1 : 0);
+        buffer[2 + i * 7] = htonl(responses[i].conflict ? 1 : 0);
+        buffer[3 + i * 7] = htonl(responses[i].rejected ? 1 : 0);
+        buffer[4 + i * 7] = htonl(responses[i].updated_task_id);
+        buffer[5 + i * 7] = htonl(responses[i].entry_id);
+        buffer[6 + i * 7] = htonl(ResponseStatus(responses[i]));
+        buffer[7 + i * 7] = htonl(responses[i].retry_after_ms);
+    }
+    
+    return socket->Send(buffer.data(), buffer.size() * sizeof(int));
+}
+
+// Follower read response: applied entry_id, fresh, then the task list
+bool ServerStub::SendFollowerRead(const FollowerReadResponse& response) {
+    int header[2];
+    header[0] = htonl(response.applied_entry_id);
+    header[1] = htonl(response.fresh ? 1 : 0);
+    return socket->Send(header, sizeof(header)) && SendTaskList(response.tasks);
+}
+
+// Leader query response: role, epoch, last entry_id
+bool ServerStub::SendLeaderInfo(const LeaderInfo& info) {
+    int buffer[3];
+    buffer[0] = htonl(static_cast<int>(info.role));
+    buffer[1] = htonl(info.epoch);
+    buffer[2] = htonl(info.last_entry_id);
     return socket->Send(buffer, sizeof(buffer));
 }
 
+// Query response: task list, has_more, next cursor
+bool ServerStub::SendTaskPage(const TaskPage& page) {
+    if (!SendTaskList(page.tasks)) {
+        return false;
+    }
+    char trailer[sizeof(int) + QueryCursor::SIZE];
+    int net_has_more = htonl(page.has_more ? 1 : 0);
+    memcpy(trailer, &net_has_more, sizeof(int));
+    page.next.Marshal(trailer + sizeof(int));
+    return socket->Send(trailer, sizeof(trailer));
+}
+
+// Search response: total matches, hit count, then (task_id, score) per hit
+bool ServerStub::SendSearchResults(const SearchResults& results) {
+    std::vector<int> buffer(2 + results.hits.size() * 2);
+    buffer[0] = htonl(results.total_matches);
+    buffer[1] = htonl(static_cast<int>(results.hits.size()));
+    for (size_t i = 0; i < results.hits.size(); i++) {
+        buffer[2 + i * 2] = htonl(results.hits[i].task_id);
+        buffer[3 + i * 2] = htonl(results.hits[i].score);
+    }
+    return socket->Send(buffer.data(), buffer.size() * sizeof(int));
+}
+
+// Board JSON response: byte length, then the UTF-8 text as rendered
+bool ServerStub::SendBoardJson(const std::string& json) {
+    int net_length = htonl(static_cast<int>(json.size()));
+    return socket->Send(&net_length, sizeof(int)) && socket->Send(json.data(), json.size());
+}
+
+// Delta response: origin, version, full_sync, changed task list, deleted id count + ids
+bool ServerStub::SendBoardDelta(const BoardDelta& delta) {
+    int header[3];
+    header[0] = htonl(delta.origin);
+    header[1] = htonl(delta.version);
+    header[2] = htonl(delta.full_sync ? 1 : 0);
+    if (!socket->Send(header, sizeof(header))) {
+        return false;
+    }
+    
+    if (!SendTaskList(delta.tasks)) {
+        return false;
+    }
+    
+    std::vector<int> ids(delta.deleted_task_ids.size() + 1);
+    ids[0] = htonl(static_cast<int>(delta.deleted_task_ids.size()));
+    for (size_t i = 0; i < delta.deleted_task_ids.size(); i++) {
+        ids[i + 1] = htonl(delta.deleted_task_ids[i]);
+    }
+    return socket->Send(ids.data(), ids.size() * sizeof(int));
+}
+
 // State transfer methods for master rejoin
+bool ServerStub::SendInt(int value) {
+    int net_value = htonl(value);
+    return socket->Send(&net_value, sizeof(int));
+}
+
+// State transfer chunk: count, then per task its applied entry_id and the size-prefixed task.
+// An empty chunk ends a run of them
+bool ServerStub::SendTaskChunk(const std::vector<Task>& tasks, const std::vector<int>& applied_ids) {
+    if (!SendInt(static_cast<int>(tasks.size()))) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (!SendInt(applied_ids[i]) || !SendTask(tasks[i])) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 bool ServerStub::SendLogEntryList(const std::vector<LogEntry>& log) {
     // Send count first
     int count = log.size();
@@ -137,23 +405,40 @@ bool ServerStub::SendLogEntryList(const std::vector<LogEntry>& log) {
     
     // Send each log entry
     for (const LogEntry& entry : log) {
-        int size = entry.Size();
-        char* buffer = new char[size];
-        entry.Marshal(buffer);
-        
-        // Send size first
-        int net_size = htonl(size);
-        if (!socket->Send(&net_size, sizeof(int))) {
-            delete[] buffer;
+        if (!SendLogEntry(entry)) {
             return false;
         }
-        
-        // Send data
-        if (!socket->Send(buffer, size)) {
-            delete[] buffer;
+    }
+    
+    return true;
+}
+
+// Size, then the marshalled entry, encoded in one pass and sent together
+bool ServerStub::SendLogEntry(const LogEntry& entry) {
+    std::vector<char> buffer;
+    AppendSizePrefixed(buffer, entry, socket->GetWireVersion());
+    return socket->Send(buffer.data(), buffer.size());
+}
+
+// Change feed batch: count, then per event the log entry, a has_task flag and the task.
+// An empty batch is a keepalive
+bool ServerStub::SendChangeEvents(const std::vector<ChangeEvent>& events) {
+    int net_count = htonl(static_cast<int>(events.size()));
+    if (!socket->Send(&net_count, sizeof(int))) {
+        return false;
+    }
+    
+    for (const ChangeEvent& event : events) {
+        if (!SendLogEntry(event.entry)) {
+            return false;
+        }
+        int net_has_task = htonl(event.has_task ? 1 : 0);
+        if (!socket->Send(&net_has_task, sizeof(int))) {
+            return false;
+        }
+        if (event.has_task && !SendTask(event.task)) {
             return false;
         }
-        delete[] buffer;
     }
     
     return true;
@@ -181,58 +466,3 @@ bool ServerStub::ReceiveLogEntryList(std::vector<LogEntry>& log) {
     
     return true;
 }
-
-bool ServerStub::SendStateTransfer(const std::vector<Task>& tasks, const std::vector<LogEntry>& log, int id_counter) {
-    // Send id_counter first
-    int net_id_counter = htonl(id_counter);
-    if (!socket->Send(&net_id_counter, sizeof(int))) {
-        return false;
-    }
-    
-    // Send task list
-    if (!SendTaskList(tasks)) {
-        return false;
-    }
-    
-    // Send log entry list
-    if (!SendLogEntryList(log)) {
-        return false;
-    }
-    
-    return true;
-}
-
-bool ServerStub::ReceiveStateTransfer(std::vector<Task>& tasks, std::vector<LogEntry>& log, int& id_counter) {
-    // Receive id_counter
-    int net_id_counter;
-    if (!socket->Receive(&net_id_counter, sizeof(int))) {
-        return false;
-    }
-    id_counter = ntohl(net_id_counter);
-    
-    // Receive task list count
-    int net_task_count;
-    if (!socket->Receive(&net_task_count, sizeof(int))) {
-        return false;
-    }
-    int task_count = ntohl(net_task_count);
-    
-    tasks.clear();
-    
-    // Receive each task
-    for (int i = 0; i < task_count; i++) {
-        Task task = ReceiveTask();
-        if (task.get_task_id() < 0) {
-            // Error receiving task (task_id=-1 indicates receive failure)
-            return false;
-        }
-        tasks.push_back(task);
-    }
-    
-    // Receive log entry list
-    if (!ReceiveLogEntryList(log)) {
-        return false;
-    }
-    
-    return true;
-}
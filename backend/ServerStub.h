@@ -16,22 +16,43 @@ public:
     
     bool Init(Socket* client_socket);
     
+    // Answer a COMPRESSION_HELLO (its op already read) and switch the connection over
+    bool AcceptCompression();
+    
+    // Answer a WIRE_HELLO (its op already read) with the newest encoding both ends speak
+    bool AcceptWireVersion();
+    
     // Receive operation type
     OpType ReceiveOpType();
     
     // Receive task operation data
     Task ReceiveTask();
     LogEntry ReceiveLogEntry();
+    bool ReceiveInt(int& value);
+    bool ReceiveBatch(std::vector<BatchOperation>& ops);
+    bool ReceiveTaskList(std::vector<Task>& tasks);
+    bool ReceiveQuery(TaskQuery& query);
+    bool ReceiveSearch(std::string& query, int& limit);
+    bool ReceiveBoardId(std::string& board_id);
     
     // Send responses
     bool SendTask(const Task& task);
     bool SendTaskList(const std::vector<Task>& tasks);
     bool SendSuccess(bool success);
     bool SendOperationResponse(const OperationResponse& response);
+    bool SendOperationResponses(const std::vector<OperationResponse>& responses);
+    bool SendBoardDelta(const BoardDelta& delta);
+    bool SendFollowerRead(const FollowerReadResponse& response);
+    bool SendLeaderInfo(const LeaderInfo& info);
+    bool SendTaskPage(const TaskPage& page);
+    bool SendSearchResults(const SearchResults& results);
+    bool SendBoardJson(const std::string& json);
+    bool SendLogEntry(const LogEntry& entry);
+    bool SendChangeEvents(const std::vector<ChangeEvent>& events);
     
-    // State transfer methods for master rejoin
-    bool SendStateTransfer(const std::vector<Task>& tasks, const std::vector<LogEntry>& log, int id_counter);
-    bool ReceiveStateTransfer(std::vector<Task>& tasks, std::vector<LogEntry>& log, int& id_counter);
+    // State transfer methods for master rejoin (streamed by SendState in state_transfer.h)
+    bool SendInt(int value);
+    bool SendTaskChunk(const std::vector<Task>& tasks, const std::vector<int>& applied_ids);
     bool SendLogEntryList(const std::vector<LogEntry>& log);
     bool ReceiveLogEntryList(std::vector<LogEntry>& log);
     
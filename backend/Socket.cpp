@@ -2,18 +2,24 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
 #include <cstring>
+#include <algorithm>
 #include <iostream>
 
-Socket::Socket() : sock_fd(-1) {}
+Socket::Socket() : sock_fd(-1), recv_pos(0), wire_version(WIRE_V1) {}
 
 Socket::~Socket() {
     if (sock_fd >= 0) {
+        // A response buffered into a frame still reaches a peer the caller is done with
+        Flush();
         close(sock_fd);
     }
 }
 
-bool Socket::Connect(const std::string& ip, int port) {
+bool Socket::Connect(const std::string& ip, int port, int timeout_ms) {
     sock_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (sock_fd < 0) return false;
     
@@ -22,16 +28,61 @@ bool Socket::Connect(const std::string& ip, int port) {
     server_addr.sin_port = htons(port);
     
     if (inet_pton(AF_INET, ip.c_str(), &server_addr.sin_addr) <= 0) {
+        Close();
+        return false;
+    }
+    
+    // Connect non-blocking and wait for it with a deadline, an unreachable host
+    // would otherwise hold the caller for the kernel's TCP timeout
+    int flags = fcntl(sock_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        Close();
         return false;
     }
     
     if (connect(sock_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        if (errno != EINPROGRESS) {
+            Close();
+            return false;
+        }
+        
+        struct pollfd pfd;
+        pfd.fd = sock_fd;
+        pfd.events = POLLOUT;
+        int ready;
+        do {
+            ready = poll(&pfd, 1, timeout_ms);
+        } while (ready < 0 && errno == EINTR);
+        
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        if (ready <= 0 || getsockopt(sock_fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 || error != 0) {
+            Close();
+            return false;
+        }
+    }
+    
+    // Back to blocking, Send/Receive rely on SetTimeouts for deadlines
+    if (fcntl(sock_fd, F_SETFL, flags) < 0) {
+        Close();
         return false;
     }
     
     return true;
 }
 
+bool Socket::SetTimeouts(int send_timeout_ms, int recv_timeout_ms) {
+    struct timeval send_tv;
+    send_tv.tv_sec = send_timeout_ms / 1000;
+    send_tv.tv_usec = (send_timeout_ms % 1000) * 1000;
+    struct timeval recv_tv;
+    recv_tv.tv_sec = recv_timeout_ms / 1000;
+    recv_tv.tv_usec = (recv_timeout_ms % 1000) * 1000;
+    
+    return setsockopt(sock_fd, SOL_SOCKET, SO_SNDTIMEO, &send_tv, sizeof(send_tv)) == 0 &&
+           setsockopt(sock_fd, SOL_SOCKET, SO_RCVTIMEO, &recv_tv, sizeof(recv_tv)) == 0;
+}
+
 bool Socket::Bind(int port) {
     sock_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (sock_fd < 0) return false;
@@ -54,8 +105,10 @@ bool Socket::Bind(int port) {
     return true;
 }
 
+// As deep a backlog as the kernel allows: a server at its connection limit leaves new
+// connections queued here rather than dropping their SYNs
 bool Socket::Listen() {
-    return listen(sock_fd, 10) >= 0;
+    return listen(sock_fd, SOMAXCONN) >= 0;
 }
 
 Socket* Socket::Accept() {
@@ -70,34 +123,132 @@ Socket* Socket::Accept() {
     return client_socket;
 }
 
-bool Socket::Send(const void* buffer, size_t size) {
+bool Socket::SendRaw(const void* buffer, size_t size) {
     size_t total_sent = 0;
     const char* data = (const char*)buffer;
     
     while (total_sent < size) {
-        ssize_t sent = send(sock_fd, data + total_sent, size - total_sent, 0);
-        if (sent <= 0) return false;
+        // A peer that closed the connection fails the send instead of raising SIGPIPE: the
+        // master closes a suspected backup's data connection while it may still be acking
+        ssize_t sent = send(sock_fd, data + total_sent, size - total_sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;  // Also a send timeout (EAGAIN)
         total_sent += sent;
     }
     
     return true;
 }
 
-bool Socket::Receive(void* buffer, size_t size) {
+bool Socket::ReceiveRaw(void* buffer, size_t size) {
     size_t total_received = 0;
     char* data = (char*)buffer;
     
     while (total_received < size) {
         ssize_t received = recv(sock_fd, data + total_received, size - total_received, 0);
-        if (received <= 0) return false;
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;  // Also a receive timeout (EAGAIN)
         total_received += received;
     }
     
     return true;
 }
 
+bool Socket::Send(const void* buffer, size_t size) {
+    if (!compressor) {
+        return SendRaw(buffer, size);
+    }
+    const char* data = static_cast<const char*>(buffer);
+    send_buffer.insert(send_buffer.end(), data, data + size);
+    return send_buffer.size() < COMPRESSION_BLOCK_SIZE || Flush();
+}
+
+bool Socket::Receive(void* buffer, size_t size) {
+    if (!compressor) {
+        return ReceiveRaw(buffer, size);
+    }
+    // A request has to be out before its answer can come back
+    if (!Flush()) {
+        return false;
+    }
+    
+    char* data = static_cast<char*>(buffer);
+    while (size > 0) {
+        if (recv_pos == recv_buffer.size() && !ReceiveFrame()) {
+            return false;
+        }
+        size_t take = std::min(size, recv_buffer.size() - recv_pos);
+        memcpy(data, recv_buffer.data() + recv_pos, take);
+        recv_pos += take;
+        data += take;
+        size -= take;
+    }
+    return true;
+}
+
+void Socket::EnableCompression() {
+    compressor.reset(new StreamCompressor());
+    decompressor.reset(new StreamDecompressor());
+}
+
+// Frame: raw size, compressed size (0 when sent raw), payload
+bool Socket::Flush() {
+    if (!compressor || sock_fd < 0) {
+        return true;
+    }
+    
+    std::vector<char> compressed;
+    std::vector<char> frame;
+    for (size_t offset = 0; offset < send_buffer.size(); offset += COMPRESSION_BLOCK_SIZE) {
+        size_t raw_size = std::min(COMPRESSION_BLOCK_SIZE, send_buffer.size() - offset);
+        const char* raw = send_buffer.data() + offset;
+        bool shrunk = compressor->Compress(raw, raw_size, compressed);
+        
+        uint32_t header[2];
+        header[0] = htonl(static_cast<uint32_t>(raw_size));
+        header[1] = htonl(shrunk ? static_cast<uint32_t>(compressed.size()) : 0);
+        frame.assign(reinterpret_cast<const char*>(header), reinterpret_cast<const char*>(header) + sizeof(header));
+        if (shrunk) {
+            frame.insert(frame.end(), compressed.begin(), compressed.end());
+        } else {
+            frame.insert(frame.end(), raw, raw + raw_size);
+        }
+        if (!SendRaw(frame.data(), frame.size())) {
+            send_buffer.clear();
+            return false;
+        }
+    }
+    send_buffer.clear();
+    return true;
+}
+
+bool Socket::ReceiveFrame() {
+    uint32_t header[2];
+    if (!ReceiveRaw(header, sizeof(header))) {
+        return false;
+    }
+    size_t raw_size = ntohl(header[0]);
+    size_t compressed_size = ntohl(header[1]);
+    if (raw_size == 0 || raw_size > COMPRESSION_BLOCK_SIZE || compressed_size > raw_size) {
+        return false;
+    }
+    
+    std::vector<char> payload(compressed_size ? compressed_size : raw_size);
+    if (!ReceiveRaw(payload.data(), payload.size())) {
+        return false;
+    }
+    recv_pos = 0;
+    return decompressor->Decompress(payload.data(), payload.size(), raw_size, compressed_size != 0, recv_buffer);
+}
+
+void Socket::Shutdown() {
+    if (sock_fd >= 0) {
+        shutdown(sock_fd, SHUT_RDWR);
+    }
+}
+
 void Socket::Close() {
     if (sock_fd >= 0) {
+        Flush();
         close(sock_fd);
         sock_fd = -1;
     }
@@ -2,18 +2,38 @@
 #define SOCKET_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include "compression.h"
+#include "wire_schema.h"
+
+// Connect attempts give up after this long instead of the kernel's TCP timeout
+const int DEFAULT_CONNECT_TIMEOUT_MS = 1000;
 
 // Wrapper for TCP socket operations
 class Socket {
 private:
     int sock_fd;
     
+    // Compressed framing, once both ends have agreed on it
+    std::unique_ptr<StreamCompressor> compressor;
+    std::unique_ptr<StreamDecompressor> decompressor;
+    std::vector<char> send_buffer;  // Sends not yet framed
+    std::vector<char> recv_buffer;  // Decoded frame being read from
+    size_t recv_pos;
+    
+    int wire_version;  // Encoding of records on this connection, set by a WIRE_HELLO exchange
+    
+    bool SendRaw(const void* buffer, size_t size);
+    bool ReceiveRaw(void* buffer, size_t size);
+    bool ReceiveFrame();
+    
 public:
     Socket();
     ~Socket();
     
-    // Client functions
-    bool Connect(const std::string& ip, int port);
+    // Client functions. Non-blocking connect, fails once timeout_ms passes
+    bool Connect(const std::string& ip, int port, int timeout_ms = DEFAULT_CONNECT_TIMEOUT_MS);
     
     // Server functions  
     bool Bind(int port);
@@ -21,9 +41,22 @@ public:
     Socket* Accept();
     
     // Common functions
+    bool SetTimeouts(int send_timeout_ms, int recv_timeout_ms);  // 0 blocks forever, a timeout fails the call
     bool Send(const void* buffer, size_t size);
     bool Receive(void* buffer, size_t size);
     void Close();
+    void Shutdown();  // Unblock a Send/Receive in another thread, the fd stays open until Close
+    
+    // After a COMPRESSION_HELLO exchange, both directions travel as compressed frames of up
+    // to COMPRESSION_BLOCK_SIZE bytes. Sends are buffered into a frame, which goes out when
+    // full, before the next Receive, on Flush and on Close
+    void EnableCompression();
+    bool IsCompressed() const { return compressor != nullptr; }
+    bool Flush();
+    
+    // Stubs read this, so every stub made over the connection encodes alike
+    void SetWireVersion(int version) { wire_version = version; }
+    int GetWireVersion() const { return wire_version; }
     
     int GetFD() const { return sock_fd; }
     bool IsValid() const { return sock_fd >= 0; }
@@ -0,0 +1,77 @@
+#include "admission.h"
+#include <algorithm>
+#include <chrono>
+
+// Weight of the newest latency in the moving average
+static const double LATENCY_SMOOTHING = 0.2;
+
+AdmissionController::AdmissionController(int max_in_flight, int max_connections)
+    : max_in_flight(std::max(1, max_in_flight)), max_connections(std::max(1, max_connections)),
+      in_flight(0), connections(0), latency_ms(0), admitted(0), shed(0) {}
+
+int AdmissionController::retry_after_locked(int cost) const {
+    double drain_ms = latency_ms * (in_flight + cost) / max_in_flight;
+    return std::min(MAX_RETRY_AFTER_MS, std::max(MIN_RETRY_AFTER_MS, static_cast<int>(drain_ms)));
+}
+
+bool AdmissionController::try_admit(int client_id, int cost, int& retry_after_ms) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto held = client_in_flight.find(client_id);
+    int client_held = held != client_in_flight.end() ? held->second : 0;
+    int clients = static_cast<int>(client_in_flight.size()) + (client_held == 0 ? 1 : 0);
+    int share = std::max(MIN_CLIENT_SHARE, max_in_flight / clients);
+    
+    bool budget_ok = in_flight == 0 || in_flight + cost <= max_in_flight;
+    bool share_ok = client_held == 0 || client_held + cost <= share;
+    if (!budget_ok || !share_ok) {
+        retry_after_ms = retry_after_locked(cost);
+        shed++;
+        return false;
+    }
+    
+    in_flight += cost;
+    client_in_flight[client_id] = client_held + cost;
+    admitted++;
+    return true;
+}
+
+void AdmissionController::release(int client_id, int cost, double write_latency_ms) {
+    std::lock_guard<std::mutex> guard(lock);
+    in_flight -= cost;
+    auto held = client_in_flight.find(client_id);
+    if (held != client_in_flight.end() && (held->second -= cost) <= 0) {
+        client_in_flight.erase(held);
+    }
+    latency_ms += LATENCY_SMOOTHING * (write_latency_ms - latency_ms);
+}
+
+bool AdmissionController::open_connection(int wait_ms) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!connection_cv.wait_for(guard, std::chrono::milliseconds(wait_ms),
+                                [this]() { return connections < max_connections; })) {
+        return false;
+    }
+    connections++;
+    return true;
+}
+
+void AdmissionController::close_connection() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        connections--;
+    }
+    connection_cv.notify_one();
+}
+
+int AdmissionController::in_flight_count() {
+    std::lock_guard<std::mutex> guard(lock);
+    return in_flight;
+}
+
+size_t AdmissionController::admitted_count() const {
+    return admitted;
+}
+
+size_t AdmissionController::shed_count() const {
+    return shed;
+}
@@ -0,0 +1,70 @@
+#ifndef __ADMISSION_H__
+#define __ADMISSION_H__
+
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Writes admitted and not yet completed by the sequencer, beyond this new ones are BUSY
+const int DEFAULT_MAX_IN_FLIGHT_WRITES = 256;
+
+// Client connections served at once, each has a thread. Beyond this new connections wait
+// in the listen backlog until one closes
+const int DEFAULT_MAX_CONNECTIONS = 512;
+
+// How long the accept loop waits for a free connection slot before checking for shutdown
+const int CONNECTION_SLOT_WAIT_MS = 100;
+
+// Smallest share of the budget a client gets however many others are writing
+const int MIN_CLIENT_SHARE = 4;
+
+// Bounds of the RETRY_AFTER a BUSY answer carries
+const int MIN_RETRY_AFTER_MS = 10;
+const int MAX_RETRY_AFTER_MS = 2000;
+
+// Admission control for the master. A write holds cost units of the in-flight budget from
+// admission until the sequencer completes it, so the budget bounds the sequencer's queue
+// and with it how long an admitted write waits. A write is admitted when
+//   the budget has room for it (or nothing is in flight, so no write is too big to ever run)
+//   its client stays within its fair share: the budget split over the clients holding
+//   some of it, at least MIN_CLIENT_SHARE
+// Otherwise it is shed before touching the board and answered BUSY, with a RETRY_AFTER of
+// about how long the queue ahead of it takes to drain: recent write latency scaled by how
+// full the budget is
+class AdmissionController {
+private:
+    std::mutex lock;
+    std::condition_variable connection_cv;
+    int max_in_flight;
+    int max_connections;
+    int in_flight;
+    int connections;
+    std::unordered_map<int, int> client_in_flight;  // Clients holding budget only
+    double latency_ms;                              // Moving average of admitted writes
+
+    std::atomic<size_t> admitted;
+    std::atomic<size_t> shed;
+
+    int retry_after_locked(int cost) const;
+
+public:
+    AdmissionController(int max_in_flight = DEFAULT_MAX_IN_FLIGHT_WRITES,
+                        int max_connections = DEFAULT_MAX_CONNECTIONS);
+
+    // True if client_id may write now, and cost units are held until release. Otherwise
+    // retry_after_ms says when to try again
+    bool try_admit(int client_id, int cost, int& retry_after_ms);
+    // An admitted write completed, write_latency_ms after it was admitted
+    void release(int client_id, int cost, double write_latency_ms);
+
+    // Take a connection slot, waiting up to wait_ms for one. False if none freed up
+    bool open_connection(int wait_ms);
+    void close_connection();
+
+    int in_flight_count();
+    size_t admitted_count() const;
+    size_t shed_count() const;
+};
+
+#endif
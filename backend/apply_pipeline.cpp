@@ -0,0 +1,143 @@
+#include "apply_pipeline.h"
+#include <iostream>
+#include <algorithm>
+
+ApplyPipeline::ApplyPipeline(TaskManager& task_manager, StateMachine& state_machine)
+    : tm(task_manager), sm(state_machine), received_entry_id(-1), applying(false), accepting(true), running(false) {}
+
+ApplyPipeline::~ApplyPipeline() {
+    stop();
+}
+
+void ApplyPipeline::start() {
+    std::lock_guard<std::mutex> lock(pipeline_mutex);
+    if (running) {
+        return;
+    }
+    running = true;
+    apply_thread = std::thread(&ApplyPipeline::apply_worker, this);
+}
+
+// Entries still queued are applied before the thread exits
+void ApplyPipeline::stop() {
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    pipeline_cv.notify_all();
+    if (apply_thread.joinable()) {
+        apply_thread.join();
+    }
+}
+
+void ApplyPipeline::mark_received(int entry_id) {
+    int current = received_entry_id.load();
+    while (entry_id > current && !received_entry_id.compare_exchange_weak(current, entry_id)) {
+    }
+}
+
+bool ApplyPipeline::submit(const std::vector<LogEntry>& entries, const std::vector<Task>& imported) {
+    if (entries.empty()) {
+        return true;
+    }
+    
+    std::unique_lock<std::mutex> lock(pipeline_mutex);
+    pipeline_cv.wait(lock, [this]() {
+        return !accepting || pending.size() < MAX_APPLY_BACKLOG;
+    });
+    if (!accepting) {
+        return false;
+    }
+    
+    // Only the replication thread appends on a standby, so the log can't move under this check
+    std::vector<LogEntry> fresh;
+    int next_entry_id = sm.get_next_entry_id();
+    for (const LogEntry& entry : entries) {
+        if (entry.get_entry_id() >= next_entry_id) {
+            fresh.push_back(entry);
+        }
+    }
+    sm.append_batch_to_log(fresh);
+    
+    for (const LogEntry& entry : entries) {
+        pending.push_back(PendingEntry(entry));
+        if (entry.get_op_type() == OpType::IMPORT_TASKS) {
+            pending.back().imported = imported;
+        }
+    }
+    lock.unlock();
+    pipeline_cv.notify_all();
+    return true;
+}
+
+void ApplyPipeline::apply_worker() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(pipeline_mutex);
+        pipeline_cv.wait(lock, [this]() { return !running || !pending.empty(); });
+        if (pending.empty()) {
+            return;  // Stopped and drained
+        }
+        PendingEntry pending_entry = pending.front();
+        pending.pop_front();
+        applying = true;
+        lock.unlock();
+        // A full backlog is waiting for room
+        pipeline_cv.notify_all();
+        
+        apply(pending_entry);
+        
+        lock.lock();
+        applying = false;
+        lock.unlock();
+        pipeline_cv.notify_all();
+    }
+}
+
+void ApplyPipeline::apply(const PendingEntry& pending_entry) {
+    const LogEntry& entry = pending_entry.entry;
+    if (entry.get_op_type() == OpType::IMPORT_TASKS) {
+        // Tasks keep the ids the master gave them, a re-delivered import overwrites nothing
+        tm.add_tasks_direct(pending_entry.imported);
+        std::cout << "Replicated import of " << pending_entry.imported.size() << " tasks (entry "
+                  << entry.get_entry_id() << ")\n";
+    } else if (StateMachine::apply_entry(tm, entry)) {
+        // Applied by the entry's explicit task_id, duplicates are skipped inside apply_entry
+        std::cout << "Replicated entry " << entry.get_entry_id() << " (op " << static_cast<int>(entry.get_op_type())
+                  << ", task " << entry.get_task_id() << ")\n";
+    }
+    sm.mark_applied(entry.get_entry_id());
+}
+
+void ApplyPipeline::close() {
+    std::unique_lock<std::mutex> lock(pipeline_mutex);
+    accepting = false;
+    pipeline_cv.notify_all();
+    // Without the apply thread nothing would drain
+    pipeline_cv.wait(lock, [this]() { return (pending.empty() && !applying) || !running; });
+}
+
+void ApplyPipeline::reopen() {
+    std::lock_guard<std::mutex> lock(pipeline_mutex);
+    accepting = true;
+}
+
+// Entries recovered from a snapshot or state transfer were never received through the pipeline
+int ApplyPipeline::received() const {
+    return std::max(received_entry_id.load(), durable());
+}
+
+int ApplyPipeline::durable() const {
+    return sm.get_next_entry_id() - 1;
+}
+
+int ApplyPipeline::applied() const {
+    return sm.get_applied_entry_id();
+}
+
+size_t ApplyPipeline::backlog() const {
+    std::lock_guard<std::mutex> lock(pipeline_mutex);
+    return pending.size();
+}
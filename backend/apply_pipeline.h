@@ -0,0 +1,76 @@
+#ifndef __APPLY_PIPELINE_H__
+#define __APPLY_PIPELINE_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "state_machine.h"
+#include "task_manager.h"
+#include "messages.h"
+
+// Entries a standby may have logged but not yet applied before the replication
+// thread stops acking and waits for the apply thread to catch up
+const size_t MAX_APPLY_BACKLOG = 65536;
+
+// Staged replication on a standby: the replication thread receives entries and submits
+// them, which appends them to the log, and acks as soon as submit returns. One apply
+// thread applies them to the TaskManager in log order. Each stage has its own watermark:
+//   received  highest entry_id read off the replication connection
+//   durable   highest entry_id in the log (what a state transfer or snapshot carries),
+//             every entry up to it may be acked
+//   applied   highest entry_id applied to the TaskManager (StateMachine::mark_applied)
+class ApplyPipeline {
+private:
+    struct PendingEntry {
+        LogEntry entry;
+        std::vector<Task> imported;  // IMPORT_TASKS payload
+
+        PendingEntry(const LogEntry& e) : entry(e) {}
+    };
+
+    TaskManager& tm;
+    StateMachine& sm;
+    std::atomic<int> received_entry_id;
+
+    std::deque<PendingEntry> pending;
+    bool applying;     // The apply thread holds an entry taken off pending
+    bool accepting;    // Cleared by close(), before a promoted node takes writes
+    bool running;
+    mutable std::mutex pipeline_mutex;
+    std::condition_variable pipeline_cv;
+    std::thread apply_thread;
+
+    void apply_worker();
+    void apply(const PendingEntry& pending_entry);
+
+public:
+    ApplyPipeline(TaskManager& task_manager, StateMachine& state_machine);
+    ~ApplyPipeline();
+
+    void start();
+    void stop();
+
+    // Record entries read off the wire
+    void mark_received(int entry_id);
+
+    // Append entries the log doesn't have yet and queue all of them for apply (a
+    // re-delivered entry is a no-op when applied). Once this returns the entries
+    // may be acked. Blocks while the backlog is full, false if the pipeline is closed
+    bool submit(const std::vector<LogEntry>& entries, const std::vector<Task>& imported);
+
+    // Refuse further entries and wait until everything queued is applied
+    void close();
+
+    // Accept entries again, for a demoted node taking replication from a rejoined master
+    void reopen();
+
+    int received() const;
+    int durable() const;
+    int applied() const;
+    size_t backlog() const;
+};
+
+#endif
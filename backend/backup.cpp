@@ -1,25 +1,41 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <atomic>
 #include <csignal>
 #include "Socket.h"
 #include "ServerStub.h"
 #include "ClientStub.h"
 #include "task_manager.h"
 #include "state_machine.h"
+#include "clock_registry.h"
+#include "change_feed.h"
+#include "apply_pipeline.h"
+#include "state_transfer.h"
+#include "snapshot.h"
+#include "failure_detector.h"
 #include "messages.h"
 
 // Global variables
 TaskManager task_manager;
 StateMachine state_machine;
+ApplyPipeline apply_pipeline(task_manager, state_machine);  // Standby receive/log/ack -> apply stages
 bool server_running = true;
 bool is_promoted = false;
 int backup_port = 12346;
+std::string primary_ip;  // Where a state transfer is pulled from, set from the command line
+int primary_port = 0;
+bool primary_compress = false;
 int next_entry_id = 0; // Track next entry ID for log
 Socket* global_server_socket = nullptr;
-std::map<int, VectorClock> client_clocks; // Track vector clock per client after promotion
-std::mutex clock_mutex;
+ClockRegistry client_clocks;  // Vector clock per client after promotion, bounded and sharded
 std::mutex promotion_mutex;  // Protect is_promoted flag
+Socket* replication_socket = nullptr;  // Current primary's replication connection, under promotion_mutex
+FailureDetector master_detector;  // Fed by control pings and replication traffic from the primary
+std::atomic<int> leader_epoch(0);  // Leadership changes seen, bumped on promotion and demotion
+
+// How long a standby holds a FOLLOWER_READ waiting for replication to reach the requested entry
+const int FOLLOWER_READ_WAIT_MS = 200;
 
 void SignalHandler(int) {
     std::cout << "\nShutting down backup...\n";
@@ -30,16 +46,102 @@ void SignalHandler(int) {
     }
 }
 
+// Log a write served while promoted, so the log (and change feed subscribers) see it too.
+// Returns the entry_id, reported to the client for read-your-writes
+int LogPromotedWrite(OpType op, const VectorClock& vc, int task_id, const Task& task) {
+    // Writes that place a task log where it landed, so a rejoining master replays it there
+    std::string rank;
+    Task applied;
+    if ((op == OpType::CREATE_TASK || op == OpType::MOVE_TASK || op == OpType::REORDER_TASK) &&
+        task_manager.try_get_task(task_id, applied)) {
+        rank = applied.get_rank();
+    }
+    LogEntry entry(next_entry_id++, op, vc, task_id,
+                   task.get_title(), task.get_description(), task.get_created_by(),
+                   task.get_column(), task.get_client_id(), rank);
+    state_machine.append_to_log(entry);
+    task_manager.mark_entry_applied(task_id, entry.get_entry_id());
+    state_machine.mark_applied(entry.get_entry_id());
+    return entry.get_entry_id();
+}
+
+// Role as of now, last entry as far as the log goes (applied or not)
+void ServeLeaderQuery(ServerStub& stub) {
+    LeaderInfo info;
+    {
+        std::lock_guard<std::mutex> lock(promotion_mutex);
+        info.role = is_promoted ? NodeRole::PRIMARY : NodeRole::STANDBY;
+    }
+    info.epoch = leader_epoch;
+    info.last_entry_id = state_machine.get_next_entry_id() - 1;
+    stub.SendLeaderInfo(info);
+}
+
+// FOLLOWER_READ: answer a GET_BOARD (task_id -1) or GET_TASK from local state once
+// min_entry_id is applied. Still behind after the wait, answer fresh = false and let
+// the client go to the master
+void ServeFollowerRead(ServerStub& stub) {
+    int task_id, min_entry_id;
+    if (!stub.ReceiveInt(task_id) || !stub.ReceiveInt(min_entry_id)) {
+        return;
+    }
+    
+    FollowerReadResponse response;
+    response.applied_entry_id = state_machine.wait_for_applied(min_entry_id, FOLLOWER_READ_WAIT_MS);
+    response.fresh = response.applied_entry_id >= min_entry_id;
+    if (response.fresh) {
+        Task task;
+        if (task_id < 0) {
+            response.tasks = task_manager.get_all_tasks();
+        } else if (task_manager.try_get_task(task_id, task)) {
+            response.tasks.push_back(task);
+        }
+    }
+    stub.SendFollowerRead(response);
+}
+
+// Restore the state written by the last clean shutdown. Tasks stay in the mapped file
+// until first touched, so this is fast even for a large board
+bool LoadSnapshot(const std::string& path) {
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    if (!snapshot->Open(path)) {
+        return false;
+    }
+    
+    std::vector<LogEntry> log;
+    if (!snapshot->ReadLog(log)) {
+        std::cerr << "[SNAPSHOT] " << path << " has a corrupt log, ignoring it\n";
+        return false;
+    }
+    
+    task_manager.load_snapshot(snapshot);
+    state_machine.set_log(log);
+    next_entry_id = state_machine.get_next_entry_id();
+    
+    std::cout << "[SNAPSHOT] Loaded " << snapshot->TaskCount() << " tasks, " << log.size()
+              << " log entries from " << path << "\n";
+    return true;
+}
+
 // Try to rejoin after restart and connect to master and request current state
 // Returns true if state was received from master
-bool TryRejoinFromMaster(const std::string& master_ip, int master_port) {
+bool TryRejoinFromMaster(const std::string& master_ip, int master_port, bool compress) {
     ClientStub client;
-    if (!client.Init(master_ip, master_port)) {
+    if (!client.Init(master_ip, master_port) || !client.SetTimeouts(STATE_TRANSFER_TIMEOUT_MS) ||
+        (compress && !client.NegotiateCompression()) || !client.NegotiateWireVersion()) {
         // Master not reachable, expected behaviour on first start
         return false;
     }
     
-    std::cout << "[REJOIN] Connected to master, requesting state sync\n";
+    // The master's epoch is the latest one, it has taken over from this node if anything
+    LeaderInfo master_info;
+    if (!client.QueryLeader(master_info)) {
+        client.Close();
+        return false;
+    }
+    leader_epoch = master_info.epoch;
+    
+    std::cout << "[REJOIN] Connected to master (epoch " << leader_epoch << "), requesting state sync\n";
     
     // Send STATE_TRANSFER_REQUEST
     if (!client.SendOpType(OpType::STATE_TRANSFER_REQUEST)) {
@@ -48,154 +150,23 @@ bool TryRejoinFromMaster(const std::string& master_ip, int master_port) {
         return false;
     }
     
-    // Receive state transfer
-    std::vector<Task> tasks;
-    std::vector<LogEntry> log;
-    int id_counter;
-    
-    if (!client.ReceiveStateTransfer(tasks, log, id_counter)) {
+    // Receive state transfer, streamed in chunks straight into the TaskManager and log
+    StateTransferStats stats;
+    if (!ReceiveState(client, task_manager, state_machine, stats)) {
         std::cerr << "[REJOIN] Failed to receive state from master\n";
         client.Close();
         return false;
     }
-    
-    std::cout << "[REJOIN] Received: " << tasks.size() << " tasks, " 
-              << log.size() << " log entries, ID counter: " << id_counter << "\n";
-    
-    // Apply state
-    task_manager.clear_all_tasks();
-    for (const Task& task : tasks) {
-        task_manager.add_task_direct(task);
-    }
-    task_manager.set_id_counter(id_counter);
-    
-    // Apply log
-    state_machine.set_log(log);
     next_entry_id = state_machine.get_next_entry_id();
     
+    std::cout << "[REJOIN] Received: " << stats.tasks << " tasks, " << stats.log_entries
+              << " log entries (cut at entry " << stats.cut_entry_id << "), ID counter: " << stats.id_counter << "\n";
     std::cout << "[REJOIN] State applied successfully, next entry ID: " << next_entry_id << "\n";
     
     client.Close();
     return true;
 }
 
-// Handle client requests after promotion (same as master but no replication)
-void HandleClient(Socket* client_socket, int client_id) {
-    ServerStub stub;
-    if (!stub.Init(client_socket)) {
-        delete client_socket;
-        return;
-    }
-    
-    std::cout << "Client " << client_id << " connected to promoted backup\n";
-    
-    while (true) {
-        OpType op_type = stub.ReceiveOpType();
-        
-        if (static_cast<int>(op_type) == -1) {
-            break;
-        }
-        
-        Task task = stub.ReceiveTask();
-        bool success = false;
-        OperationResponse op_response;
-        
-        switch (op_type) {
-            case OpType::CREATE_TASK:
-                success = task_manager.create_task(
-                    task.get_title(),
-                    task.get_description(),
-                    task.get_board_id(),
-                    task.get_created_by(),
-                    task.get_column(),
-                    task.get_client_id()
-                );
-                
-                // Send OperationResponse with task ID (use id_counter, not task_count)
-                op_response.success = success;
-                op_response.conflict = false;
-                op_response.rejected = false;
-                op_response.updated_task_id = success ? (task_manager.get_id_counter() - 1) : -1;
-                
-                if (success) std::cout << "Created task " << op_response.updated_task_id << " (promoted backup)\n";
-                
-                stub.SendOperationResponse(op_response);
-                continue; // Skip default SendSuccess
-                
-            case OpType::UPDATE_TASK:
-                {
-                    VectorClock vc(client_id);
-                    std::lock_guard<std::mutex> lock(clock_mutex);
-                    auto it = client_clocks.find(client_id);
-                    if (it != client_clocks.end()) {
-                        vc = it->second;
-                        vc.increment();
-                        it->second = vc;
-                    } else {
-                        client_clocks.insert({client_id, vc});
-                    }
-                    op_response = task_manager.update_task_with_conflict_detection(
-                        task.get_task_id(), task.get_title(), task.get_description(), vc);
-                }
-                if (op_response.success) std::cout << "Updated task " << task.get_task_id() << "\n";
-                
-                stub.SendOperationResponse(op_response);
-                continue; // Skip default SendSuccess
-                
-            case OpType::MOVE_TASK:
-                {
-                    VectorClock vc(client_id);
-                    std::lock_guard<std::mutex> lock(clock_mutex);
-                    auto it = client_clocks.find(client_id);
-                    if (it != client_clocks.end()) {
-                        vc = it->second;
-                        vc.increment();
-                        it->second = vc;
-                    } else {
-                        client_clocks.insert({client_id, vc});
-                    }
-                    op_response = task_manager.move_task_with_conflict_detection(
-                        task.get_task_id(), task.get_column(), vc);
-                }
-                if (op_response.success) std::cout << "Moved task " << task.get_task_id() << "\n";
-                
-                stub.SendOperationResponse(op_response);
-                continue; // Skip default SendSuccess
-                
-            case OpType::DELETE_TASK:
-                success = task_manager.delete_task(task.get_task_id());
-                if (success) std::cout << "Deleted task " << task.get_task_id() << "\n";
-                break;
-                
-            case OpType::GET_BOARD: {
-                std::vector<Task> all_tasks = task_manager.get_all_tasks();
-                std::cout << "GET_BOARD request - returning " << all_tasks.size() << " tasks\n";
-                stub.SendTaskList(all_tasks);
-                continue; // Skip SendSuccess
-            }
-            
-            case OpType::HEARTBEAT_PING:
-            case OpType::HEARTBEAT_ACK:
-            case OpType::MASTER_REJOIN:
-            case OpType::STATE_TRANSFER_REQUEST:
-            case OpType::STATE_TRANSFER_RESPONSE:
-            case OpType::DEMOTE_ACK:
-            case OpType::REPLICATION_INIT:
-                // These shouldn't come through HandleClient
-                std::cerr << "Unexpected control message in HandleClient\n";
-                break;
-                
-            default:
-                break;
-        }
-        
-        stub.SendSuccess(success);
-    }
-    
-    std::cout << "Client " << client_id << " disconnected\n";
-    delete client_socket;
-}
-
 // Handle master rejoin - send state and demote
 bool HandleMasterRejoin(Socket* client_socket) {
     ServerStub stub;
@@ -206,21 +177,16 @@ bool HandleMasterRejoin(Socket* client_socket) {
     
     std::cout << "[MASTER REJOIN] Master is rejoining\n";
     
-    // Get current state
-    std::vector<Task> tasks = task_manager.get_all_tasks();
-    std::vector<LogEntry> log = state_machine.get_log();
-    int id_counter = task_manager.get_id_counter();
-    
-    std::cout << "[STATE TRANSFER] Sending to master: " << tasks.size() << " tasks, "
-              << log.size() << " log entries, ID counter: " << id_counter << "\n";
-    
     // Send state transfer
-    if (!stub.SendStateTransfer(tasks, log, id_counter)) {
+    StateTransferStats stats;
+    if (!SendState(stub, task_manager, state_machine, stats)) {
         std::cerr << "[STATE TRANSFER] Failed to send state to master\n";
         delete client_socket;
         return false;
     }
     
+    std::cout << "[STATE TRANSFER] Sent to master: " << stats.tasks << " tasks, " << stats.log_entries
+              << " log entries (cut at entry " << stats.cut_entry_id << "), ID counter: " << stats.id_counter << "\n";
     std::cout << "[STATE TRANSFER] State sent successfully\n";
     
     // Wait for DEMOTE_ACK from master
@@ -233,10 +199,11 @@ bool HandleMasterRejoin(Socket* client_socket) {
     
     std::cout << "[DEMOTE] Received DEMOTE_ACK from master\n";
     
-    // Demote back to backup mode
+    // Demote back to backup mode, leadership moved to the master
     {
         std::lock_guard<std::mutex> lock(promotion_mutex);
         is_promoted = false;
+        leader_epoch++;
     }
     
     std::cout << "[DEMOTE] Backup demoted, returning to backup mode\n";
@@ -245,6 +212,73 @@ bool HandleMasterRejoin(Socket* client_socket) {
     return true;
 }
 
+// Take over as master once MonitorPrimary suspects the primary
+void PromoteToMaster() {
+    {
+        std::lock_guard<std::mutex> lock(promotion_mutex);
+        if (is_promoted) {
+            return;
+        }
+        
+        // A primary that was only slow must not keep replicating into a promoted node
+        if (replication_socket) {
+            replication_socket->Shutdown();
+        }
+    }
+    
+    // Entries acked to the old primary are applied before this node answers for them
+    apply_pipeline.close();
+    // and the clocks they carry, the old primary's clients continue from above them
+    for (const LogEntry& entry : state_machine.get_log()) {
+        client_clocks.observe(entry.get_timestamp());
+    }
+    {
+        std::lock_guard<std::mutex> lock(promotion_mutex);
+        if (is_promoted) {
+            return;
+        }
+        is_promoted = true;
+        leader_epoch++;
+    }
+    // Its history belongs to the old primary, a rejoining master starts a new one
+    master_detector.reset();
+    
+    std::cout << "PROMOTING TO MASTER (epoch " << leader_epoch << ")" << std::endl;
+    std::cout << "Backup promoted! Now accepting client connections on port " << backup_port << std::endl;
+    std::cout << "Total tasks replicated: " << task_manager.get_task_count() << std::endl;
+    std::cout << "State machine log size: " << state_machine.get_log_size() << std::endl;
+    std::cout.flush();
+}
+
+// Promote once the primary's phi crosses the threshold. The only path to promotion: a
+// closed replication connection may just be the primary dropping a backup it suspected
+void MonitorPrimary() {
+    while (server_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        
+        bool currently_promoted;
+        {
+            std::lock_guard<std::mutex> lock(promotion_mutex);
+            currently_promoted = is_promoted;
+        }
+        if (!currently_promoted && master_detector.has_samples() && !master_detector.is_available()) {
+            std::cout << "[HEARTBEAT] Primary suspected (phi " << master_detector.phi() << ")" << std::endl;
+            PromoteToMaster();
+        }
+    }
+}
+
+// Control connection: answer the primary's pings, nothing else travels on it
+void HandleControl(ServerStub& stub) {
+    stub.SendSuccess(true);
+    while (stub.ReceiveOpType() == OpType::HEARTBEAT_PING) {
+        master_detector.heartbeat();
+        if (!stub.SendSuccess(true)) {
+            break;
+        }
+    }
+}
+
 // Handle replication from primary
 void HandleReplication(Socket* client_socket) {
     ServerStub stub;
@@ -253,10 +287,48 @@ void HandleReplication(Socket* client_socket) {
         return;
     }
     
+    // First message should be REPLICATION_INIT handshake, possibly after compression and wire offers
+    OpType first_op = stub.ReceiveOpType();
+    while (first_op == OpType::COMPRESSION_HELLO || first_op == OpType::WIRE_HELLO) {
+        bool accepted = first_op == OpType::COMPRESSION_HELLO ? stub.AcceptCompression() : stub.AcceptWireVersion();
+        if (!accepted) {
+            delete client_socket;
+            return;
+        }
+        first_op = stub.ReceiveOpType();
+    }
+    
+    // Change feed subscribers can attach to a standby backup, its log mirrors the master's
+    if (first_op == OpType::SUBSCRIBE) {
+        int after_entry_id;
+        if (stub.ReceiveInt(after_entry_id)) {
+            ServeChangeFeed(stub, state_machine, task_manager, after_entry_id, server_running, true);
+        }
+        delete client_socket;
+        return;
+    }
+    
+    if (first_op == OpType::CONTROL_INIT) {
+        HandleControl(stub);
+        delete client_socket;
+        return;
+    }
+    
+    if (first_op == OpType::LEADER_QUERY) {
+        ServeLeaderQuery(stub);
+        delete client_socket;
+        return;
+    }
+    
+    // Read-only requests are served while in standby, bounded by the entry they ask for
+    if (first_op == OpType::FOLLOWER_READ) {
+        ServeFollowerRead(stub);
+        delete client_socket;
+        return;
+    }
+    
     std::cout << "Primary connected for replication\n";
     
-    // First message should be REPLICATION_INIT handshake
-    OpType first_op = stub.ReceiveOpType();
     if (first_op != OpType::REPLICATION_INIT) {
         std::cout << "[BACKUP MODE] Expected REPLICATION_INIT but got optype " 
                   << static_cast<int>(first_op) << " - rejecting connection\n";
@@ -265,28 +337,32 @@ void HandleReplication(Socket* client_socket) {
         return;
     }
     
-    // Acknowledge the handshake
+    // Acknowledge the handshake with the last entry logged here, the primary catches us up from it
     std::cout << "[BACKUP MODE] Received REPLICATION_INIT - acknowledged\n";
     stub.SendSuccess(true);
+    stub.SendInt(state_machine.get_next_entry_id() - 1);
+    {
+        std::lock_guard<std::mutex> lock(promotion_mutex);
+        replication_socket = client_socket;
+    }
+    master_detector.reset();
+    master_detector.heartbeat();
+    apply_pipeline.reopen();
     
     while (true) {
         // Receive operation type
         OpType op_type = stub.ReceiveOpType();
         
+        // A dropped replication connection alone doesn't mean the primary is gone: it closes
+        // one it suspected to be slow, and reconnects. MonitorPrimary decides on promotion
         if (static_cast<int>(op_type) == -1) {
-            std::cout << "ReceiveOpType failed - Primary disconnected" << std::endl;
-            std::cout << "PROMOTING TO MASTER" << std::endl;
-            {
-                std::lock_guard<std::mutex> lock(promotion_mutex);
-                is_promoted = true;
-            }
-            std::cout << "Backup promoted! Now accepting client connections on port " << backup_port << std::endl;
-            std::cout << "Total tasks replicated: " << task_manager.get_task_count() << std::endl;
-            std::cout << "State machine log size: " << state_machine.get_log_size() << std::endl;
-            std::cout.flush();
+            std::cout << "ReceiveOpType failed - replication connection closed" << std::endl;
             break;
         }
         
+        // Replication traffic proves the primary alive as well as a ping does
+        master_detector.heartbeat();
+        
         // Handle heartbeat separately
         if (op_type == OpType::HEARTBEAT_PING) {
             // Respond with HEARTBEAT_ACK
@@ -308,115 +384,93 @@ void HandleReplication(Socket* client_socket) {
             break;  // Exit HandleReplication WITHOUT setting is_promoted = true
         }
         
-        // For task operations from master, receive the log entry
-        LogEntry entry = stub.ReceiveLogEntry();
-        
-        // Check for disconnect (entry_id == -1 indicates error)
-        if (entry.get_entry_id() < 0) {
-            std::cout << "ReceiveLogEntry failed - Primary disconnected" << std::endl;
-            std::cout << "PROMOTING TO MASTER" << std::endl;
+        // The primary's log tail can't bring this node level: pull its state, applying
+        // nothing meanwhile, and report where the log ends up
+        if (op_type == OpType::STATE_TRANSFER_REQUEST) {
+            apply_pipeline.close();
+            bool resynced = TryRejoinFromMaster(primary_ip, primary_port, primary_compress);
             {
                 std::lock_guard<std::mutex> lock(promotion_mutex);
-                is_promoted = true;
+                if (!is_promoted) {
+                    apply_pipeline.reopen();
+                }
             }
-            std::cout << "Backup promoted! Now accepting client connections on port " << backup_port << std::endl;
-            std::cout << "Total tasks replicated: " << task_manager.get_task_count() << std::endl;
-            std::cout << "State machine log size: " << state_machine.get_log_size() << std::endl;
-            std::cout.flush();
-            break;
+            if (!stub.SendSuccess(resynced) || !stub.SendInt(state_machine.get_next_entry_id() - 1)) {
+                break;
+            }
+            continue;
         }
         
-        // Append to state machine log
-        state_machine.append_to_log(entry);
-        next_entry_id = entry.get_entry_id() + 1;
+        // For task operations from master, receive the log entry (a BATCH sends a list of them)
+        std::vector<LogEntry> entries;
+        std::vector<Task> imported;  // IMPORT_TASKS follows its marker entry with the task list
+        bool received;
+        if (op_type == OpType::BATCH) {
+            received = stub.ReceiveLogEntryList(entries);
+        } else {
+            LogEntry entry = stub.ReceiveLogEntry();
+            // entry_id == -1 indicates error
+            received = entry.get_entry_id() >= 0 &&
+                       (op_type != OpType::IMPORT_TASKS || stub.ReceiveTaskList(imported));
+            entries.push_back(entry);
+        }
         
-        // Apply operation to task manager with vector clock
-        OpType op = entry.get_op_type();
-        const VectorClock& vc = entry.get_timestamp();
+        // Check for disconnect
+        if (!received) {
+            std::cout << "ReceiveLogEntry failed - replication connection closed" << std::endl;
+            break;
+        }
         
-        switch (op) {
-            case OpType::CREATE_TASK:
-                // Debug: Log the column value from the entry
-                std::cout << "[DEBUG] CREATE_TASK replication - title: " << entry.get_title()
-                          << ", created_by: " << entry.get_created_by()
-                          << ", column: " << static_cast<int>(entry.get_column()) << "\n";
-                // Use full create_task with all fields from log entry
-                task_manager.create_task(entry.get_title(), entry.get_description(), "board-1", entry.get_created_by(),
-                                        entry.get_column(), entry.get_client_id());
-                std::cout << "Replicated CREATE_TASK (title: " << entry.get_title() 
-                          << ", created_by: " << entry.get_created_by()
-                          << ", column: " << static_cast<int>(entry.get_column()) << ")\n";
-                break;
-                
-            case OpType::UPDATE_TASK:
-                task_manager.update_task(entry.get_task_id(), entry.get_title(), entry.get_description(), vc);
-                std::cout << "Replicated UPDATE_TASK\n";
-                break;
-                
-            case OpType::MOVE_TASK:
-                task_manager.move_task(entry.get_task_id(), entry.get_column(), vc);
-                std::cout << "Replicated MOVE_TASK\n";
-                break;
-                
-            case OpType::DELETE_TASK:
-                task_manager.delete_task(entry.get_task_id());
-                std::cout << "Replicated DELETE_TASK\n";
-                break;
-                
-            case OpType::GET_BOARD:
-                // GET_BOARD is not a state-changing operation, skip in replication
-                break;
-                
-            case OpType::HEARTBEAT_PING:
-            case OpType::HEARTBEAT_ACK:
-            case OpType::MASTER_REJOIN:
-            case OpType::STATE_TRANSFER_REQUEST:
-            case OpType::STATE_TRANSFER_RESPONSE:
-            case OpType::DEMOTE_ACK:
-            case OpType::REPLICATION_INIT:
-                // Control messages handled separately, not logged
-                break;
+        apply_pipeline.mark_received(entries.back().get_entry_id());
+        
+        // Logged but not yet applied, the ack doesn't wait for the TaskManager
+        if (!apply_pipeline.submit(entries, imported)) {
+            // Promoted meanwhile, the old primary gets no ack for what this node won't apply
+            break;
         }
+        next_entry_id = state_machine.get_next_entry_id();
         
-        // Send acknowledgment
+        // Send acknowledgment, once per entry or batch
         if (!stub.SendSuccess(true)) {
-            std::cout << "Failed to send ack to primary" << std::endl;
-            std::cout << "Primary disconnected - PROMOTING TO MASTER" << std::endl;
-            {
-                std::lock_guard<std::mutex> lock(promotion_mutex);
-                is_promoted = true;
-            }
-            std::cout << "Backup promoted! Now accepting client connections on port " << backup_port << std::endl;
-            std::cout << "Total tasks replicated: " << task_manager.get_task_count() << std::endl;
-            std::cout << "State machine log size: " << state_machine.get_log_size() << std::endl;
-            std::cout.flush();
+            std::cout << "Failed to send ack to primary - replication connection closed" << std::endl;
             break;
         }
     }
     
+    {
+        std::lock_guard<std::mutex> lock(promotion_mutex);
+        if (replication_socket == client_socket) {
+            replication_socket = nullptr;
+        }
+    }
     delete client_socket;
 }
 
 
 int main(int argc, char* argv[]) {
-    if (argc != 5) {
-        std::cerr << "Usage: ./backup [port] [node_id] [primary_ip] [primary_port]\n";
+    bool compress = argc == 6 && std::string(argv[5]) == "--compress";
+    if (argc != 5 && !compress) {
+        std::cerr << "Usage: ./backup [port] [node_id] [primary_ip] [primary_port] [--compress]\n";
         return 1;
     }
     
     int port = std::stoi(argv[1]);
     backup_port = port;  // Sync global for promotion messages
     int node_id = std::stoi(argv[2]);
-    std::string primary_ip = argv[3];
-    int primary_port = std::stoi(argv[4]);
+    primary_ip = argv[3];
+    primary_port = std::stoi(argv[4]);
+    primary_compress = compress;
     
     std::cout << "Starting backup node " << node_id << " on port " << port << "\n";
     std::cout << "Primary: " << primary_ip << ":" << primary_port << "\n";
     
     // Try to rejoin from master (in case we crashed and master has newer state)
-    bool rejoined = TryRejoinFromMaster(primary_ip, primary_port);
+    bool rejoined = TryRejoinFromMaster(primary_ip, primary_port, compress);
+    std::string snapshot_path = "backup_" + std::to_string(port) + ".snap";
     if (rejoined) {
         std::cout << "Recovered state from master\n";
+    } else if (LoadSnapshot(snapshot_path)) {
+        std::cout << "Recovered state from local snapshot\n";
     } else {
         std::cout << "Starting fresh (master not reachable or no state to sync)\n";
     }
@@ -440,6 +494,9 @@ int main(int argc, char* argv[]) {
     std::cout << "Backup listening on port " << port << "...\n";
     std::cout << "Waiting for primary connection or ready to promote...\n";
     
+    apply_pipeline.start();
+    std::thread(MonitorPrimary).detach();
+    
     // Accept connections (from primary for replication OR from clients after promotion)
     while (server_running) {
         bool currently_promoted;
@@ -474,6 +531,18 @@ int main(int argc, char* argv[]) {
                 }
                 
                 OpType first_op = peek_stub.ReceiveOpType();
+                bool handshake_ok = true;
+                while (handshake_ok && (first_op == OpType::COMPRESSION_HELLO || first_op == OpType::WIRE_HELLO)) {
+                    handshake_ok = first_op == OpType::COMPRESSION_HELLO ? peek_stub.AcceptCompression()
+                                                                         : peek_stub.AcceptWireVersion();
+                    if (handshake_ok) {
+                        first_op = peek_stub.ReceiveOpType();
+                    }
+                }
+                if (!handshake_ok) {
+                    delete socket;
+                    continue;
+                }
                 
                 if (first_op == OpType::MASTER_REJOIN) {
                     // Master is rejoining, handle state transfer and demote
@@ -492,6 +561,11 @@ int main(int argc, char* argv[]) {
                     peek_stub.SendSuccess(false);  // Reject the handshake
                     delete socket;
                     continue;  // Go back to Accept()
+                } else if (first_op == OpType::CONTROL_INIT) {
+                    // The old master's liveness probe, it has to rejoin first
+                    peek_stub.SendSuccess(false);
+                    delete socket;
+                    continue;
                 } else if (static_cast<int>(first_op) == -1) {
                     // Connection closed immediately
                     delete socket;
@@ -501,65 +575,180 @@ int main(int argc, char* argv[]) {
                     // We need to handle this request inline
                     std::cout << "[PROMOTED MODE] Client connection (first op: " << static_cast<int>(first_op) << ")" << std::endl;
                     
+                    if (first_op == OpType::SUBSCRIBE) {
+                        // Long-lived, so serve it off the accept loop
+                        int after_entry_id;
+                        if (!peek_stub.ReceiveInt(after_entry_id)) {
+                            delete socket;
+                            continue;
+                        }
+                        std::thread([socket, after_entry_id]() {
+                            ServerStub feed_stub;
+                            feed_stub.Init(socket);
+                            ServeChangeFeed(feed_stub, state_machine, task_manager, after_entry_id, server_running, true);
+                            delete socket;
+                        }).detach();
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::LEADER_QUERY) {
+                        ServeLeaderQuery(peek_stub);
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::FOLLOWER_READ) {
+                        ServeFollowerRead(peek_stub);
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::GET_BOARD_SINCE) {
+                        int origin, since_version;
+                        if (peek_stub.ReceiveInt(origin) && peek_stub.ReceiveInt(since_version)) {
+                            peek_stub.SendBoardDelta(task_manager.get_changes_since(origin, since_version));
+                        }
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::GET_BOARD_JSON) {
+                        std::string board_id;
+                        if (peek_stub.ReceiveBoardId(board_id)) {
+                            peek_stub.SendBoardJson(*task_manager.get_board_json(board_id));
+                        }
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::QUERY) {
+                        TaskQuery query;
+                        if (peek_stub.ReceiveQuery(query)) {
+                            peek_stub.SendTaskPage(task_manager.query_tasks(query));
+                        }
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::SEARCH) {
+                        std::string query;
+                        int limit;
+                        if (peek_stub.ReceiveSearch(query, limit)) {
+                            peek_stub.SendSearchResults(task_manager.search_tasks(query, limit));
+                        }
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::IMPORT_TASKS) {
+                        std::vector<Task> tasks;
+                        if (peek_stub.ReceiveTaskList(tasks)) {
+                            OperationResponse import_response;
+                            import_response.success = true;
+                            import_response.updated_task_id = task_manager.import_tasks(tasks);
+                            if (!tasks.empty()) {
+                                import_response.entry_id = next_entry_id++;
+                                state_machine.append_to_log(LogEntry(import_response.entry_id, first_op, VectorClock(1),
+                                                                     import_response.updated_task_id, "", "", "", Column::TODO, 1));
+                                state_machine.mark_applied(import_response.entry_id);
+                            }
+                            std::cout << "Imported " << tasks.size() << " tasks (promoted backup)\n";
+                            peek_stub.SendOperationResponse(import_response);
+                        }
+                        delete socket;
+                        continue;
+                    }
+                    
+                    if (first_op == OpType::BATCH) {
+                        std::vector<BatchOperation> ops;
+                        if (peek_stub.ReceiveBatch(ops)) {
+                            // Gateway connections share client_id 1, one clock tick per operation
+                            std::vector<VectorClock> clocks;
+                            for (size_t i = 0; i < ops.size(); i++) {
+                                clocks.push_back(client_clocks.tick(ClockOwner(ops[i].task, 1)));
+                            }
+                            std::vector<OperationResponse> responses = task_manager.apply_batch(ops, clocks);
+                            for (size_t i = 0; i < responses.size(); i++) {
+                                if (responses[i].success && !responses[i].rejected) {
+                                    responses[i].entry_id = LogPromotedWrite(ops[i].op_type, clocks[i],
+                                                                             responses[i].updated_task_id, ops[i].task);
+                                }
+                            }
+                            peek_stub.SendOperationResponses(responses);
+                        }
+                        delete socket;
+                        continue;
+                    }
+                    
                     Task task = peek_stub.ReceiveTask();
                     bool success = false;
                     OperationResponse op_response;
                     
                     switch (first_op) {
                         case OpType::CREATE_TASK:
-                            success = task_manager.create_task(
+                            op_response.updated_task_id = task_manager.create_task(
                                 task.get_title(), task.get_description(),
                                 task.get_board_id(), task.get_created_by(),
                                 task.get_column(), task.get_client_id()
                             );
+                            success = op_response.updated_task_id >= 0;
                             op_response.success = success;
-                            op_response.updated_task_id = success ? (task_manager.get_id_counter() - 1) : -1;
+                            if (success) {
+                                op_response.entry_id = LogPromotedWrite(first_op, VectorClock(task.get_client_id()),
+                                                                        op_response.updated_task_id, task);
+                            }
                             peek_stub.SendOperationResponse(op_response);
                             break;
                             
                         case OpType::UPDATE_TASK: {
-                            // Using proper vector clock tracking
-                            VectorClock vc(1);  // Use client_id 1 for gateway connections
-                            {
-                                std::lock_guard<std::mutex> lock(clock_mutex);
-                                auto it = client_clocks.find(1);
-                                if (it != client_clocks.end()) {
-                                    vc = it->second;
-                                    vc.increment();
-                                    it->second = vc;
-                                } else {
-                                    client_clocks.insert({1, vc});
-                                }
-                            }
+                            // Gateway connections carry client_id 1
+                            VectorClock vc = client_clocks.tick(ClockOwner(task, 1));
                             op_response = task_manager.update_task_with_conflict_detection(
                                 task.get_task_id(), task.get_title(), task.get_description(), vc);
+                            if (op_response.success) {
+                                op_response.entry_id = LogPromotedWrite(first_op, vc, task.get_task_id(), task);
+                            }
                             peek_stub.SendOperationResponse(op_response);
                             break;
                         }
                             
                         case OpType::MOVE_TASK: {
-                            // Using proper vector clock tracking
-                            VectorClock vc(1);  // Use client_id 1 for gateway connections
-                            {
-                                std::lock_guard<std::mutex> lock(clock_mutex);
-                                auto it = client_clocks.find(1);
-                                if (it != client_clocks.end()) {
-                                    vc = it->second;
-                                    vc.increment();
-                                    it->second = vc;
-                                } else {
-                                    client_clocks.insert({1, vc});
-                                }
-                            }
+                            // Gateway connections carry client_id 1
+                            VectorClock vc = client_clocks.tick(ClockOwner(task, 1));
                             op_response = task_manager.move_task_with_conflict_detection(
                                 task.get_task_id(), task.get_column(), vc);
+                            if (op_response.success) {
+                                op_response.entry_id = LogPromotedWrite(first_op, vc, task.get_task_id(), task);
+                            }
+                            peek_stub.SendOperationResponse(op_response);
+                            break;
+                        }
+                            
+                        case OpType::REORDER_TASK: {
+                            int after_task_id;
+                            if (!peek_stub.ReceiveInt(after_task_id)) {
+                                break;
+                            }
+                            // Gateway connections carry client_id 1
+                            VectorClock vc = client_clocks.tick(ClockOwner(task, 1));
+                            op_response = task_manager.reorder_task_with_conflict_detection(
+                                task.get_task_id(), task.get_column(), after_task_id, vc);
+                            if (op_response.success) {
+                                op_response.entry_id = LogPromotedWrite(first_op, vc, task.get_task_id(), task);
+                            }
                             peek_stub.SendOperationResponse(op_response);
                             break;
                         }
                             
                         case OpType::DELETE_TASK:
                             success = task_manager.delete_task(task.get_task_id());
-                            peek_stub.SendSuccess(success);
+                            op_response.success = success;
+                            op_response.updated_task_id = task.get_task_id();
+                            if (success) {
+                                op_response.entry_id = LogPromotedWrite(first_op, VectorClock(task.get_client_id()),
+                                                                        task.get_task_id(), task);
+                            }
+                            peek_stub.SendOperationResponse(op_response);
                             break;
                             
                         case OpType::GET_BOARD: {
@@ -584,6 +773,14 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Snapshot for a fast restart, once every logged entry is applied
+    apply_pipeline.stop();
+    if (task_manager.save_snapshot(snapshot_path, state_machine.get_log())) {
+        std::cout << "[SNAPSHOT] Wrote " << task_manager.get_task_count() << " tasks to " << snapshot_path << "\n";
+    } else {
+        std::cerr << "[SNAPSHOT] Failed to write " << snapshot_path << "\n";
+    }
+    
     std::cout << "Backup shutdown complete\n";
     return 0;
 }
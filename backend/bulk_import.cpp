@@ -0,0 +1,103 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include "ClientStub.h"
+#include "task_import.h"
+#include "messages.h"
+
+// Send one parsed chunk as an IMPORT_TASKS request. A connection per chunk, so the import
+// also works against a promoted backup (which serves one request per connection). A BUSY
+// answer from a loaded master is waited out and the chunk sent again
+bool SendChunk(const std::string& host, int port, const std::vector<Task>& tasks, int& first_id) {
+    while (true) {
+        ClientStub client;
+        if (!client.Init(host, port)) {
+            std::cerr << "Failed to connect to " << host << ":" << port << "\n";
+            return false;
+        }
+
+        OperationResponse response;
+        bool sent = client.SendOpType(OpType::IMPORT_TASKS) &&
+                    client.SendTaskList(tasks) &&
+                    client.ReceiveOperationResponse(response);
+        client.Close();
+
+        if (sent && response.busy) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(response.retry_after_ms));
+            continue;
+        }
+        first_id = response.updated_task_id;
+        return sent && response.success;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        std::cerr << "Usage: ./bulk_import [host] [port] [file.jsonl|file.csv]\n";
+        return 1;
+    }
+
+    std::string host = argv[1];
+    int port = std::stoi(argv[2]);
+    std::string path = argv[3];
+
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+
+    ImportFormat format = DetectImportFormat(path);
+    std::cout << "Importing " << path << " (" << (format == ImportFormat::CSV ? "CSV" : "JSONL")
+              << ") into " << host << ":" << port << "\n";
+
+    auto start = std::chrono::steady_clock::now();
+    size_t imported = 0;
+    size_t skipped = 0;
+    bool first_line = true;
+
+    // Stream the file a chunk at a time, each chunk parsed in parallel and sent as one request
+    std::vector<std::string> lines;
+    lines.reserve(MAX_IMPORT_TASKS);
+    std::string line;
+    while (true) {
+        bool more = static_cast<bool>(std::getline(in, line));
+        if (more) {
+            // Skip a CSV header row
+            if (first_line && format == ImportFormat::CSV && line.compare(0, 5, "title") == 0) {
+                first_line = false;
+                continue;
+            }
+            first_line = false;
+            lines.push_back(line);
+        }
+
+        if (lines.size() == static_cast<size_t>(MAX_IMPORT_TASKS) || (!more && !lines.empty())) {
+            std::vector<Task> tasks = ParseTaskLines(lines, format, skipped);
+            lines.clear();
+
+            int first_id = -1;
+            if (!tasks.empty() && !SendChunk(host, port, tasks, first_id)) {
+                std::cerr << "Import stopped after " << imported << " tasks\n";
+                return 1;
+            }
+            imported += tasks.size();
+            std::cout << "  " << imported << " tasks imported (last chunk from id " << first_id << ")\n";
+        }
+
+        if (!more) {
+            break;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Imported " << imported << " tasks in " << seconds << "s";
+    if (skipped > 0) {
+        std::cout << " (" << skipped << " malformed records skipped)";
+    }
+    std::cout << "\n";
+    return 0;
+}
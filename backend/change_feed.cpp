@@ -0,0 +1,33 @@
+#include "change_feed.h"
+#include <iostream>
+
+void ServeChangeFeed(ServerStub& stub, StateMachine& sm, TaskManager& tm, int after_entry_id, const bool& running,
+                     bool wait_for_apply) {
+    int position = after_entry_id;
+    std::cout << "[SUBSCRIBE] Subscriber attached after entry " << position << "\n";
+    
+    while (running) {
+        std::vector<LogEntry> entries = sm.wait_for_entries_after(position, CHANGE_FEED_BATCH_SIZE,
+                                                                  CHANGE_FEED_KEEPALIVE_MS);
+        if (wait_for_apply && !entries.empty()) {
+            sm.wait_for_applied(entries.back().get_entry_id(), CHANGE_FEED_KEEPALIVE_MS);
+        }
+        
+        std::vector<ChangeEvent> events;
+        events.reserve(entries.size());
+        for (const LogEntry& entry : entries) {
+            ChangeEvent event(entry);
+            event.has_task = tm.try_get_task(entry.get_task_id(), event.task);
+            events.push_back(event);
+        }
+        
+        if (!stub.SendChangeEvents(events)) {
+            break;
+        }
+        if (!entries.empty()) {
+            position = entries.back().get_entry_id();
+        }
+    }
+    
+    std::cout << "[SUBSCRIBE] Subscriber detached at entry " << position << "\n";
+}
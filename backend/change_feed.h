@@ -0,0 +1,21 @@
+#ifndef __CHANGE_FEED_H__
+#define __CHANGE_FEED_H__
+
+#include "ServerStub.h"
+#include "state_machine.h"
+#include "task_manager.h"
+
+// Max log entries pushed to a subscriber in one batch
+const size_t CHANGE_FEED_BATCH_SIZE = 256;
+
+// Idle time after which an empty keepalive batch is sent (also detects dead subscribers)
+const int CHANGE_FEED_KEEPALIVE_MS = 1000;
+
+// Stream committed log entries after after_entry_id to a SUBSCRIBE client, each with the
+// task's resolved state. Returns when the subscriber disconnects or running turns false.
+// A standby logs entries before applying them, so it passes wait_for_apply to resolve
+// tasks only once their entries are applied
+void ServeChangeFeed(ServerStub& stub, StateMachine& sm, TaskManager& tm, int after_entry_id, const bool& running,
+                     bool wait_for_apply = false);
+
+#endif
@@ -0,0 +1,115 @@
+#include "clock_registry.h"
+
+// Rough heap cost of one remembered clock: its LRU node, its hash node and the nodes of
+// the clock's own map
+static size_t EntryBytes(const VectorClock& clock) {
+    return (sizeof(int) + 2 * sizeof(void*)) +
+           (sizeof(std::pair<const int, VectorClock>) + 2 * sizeof(void*)) +
+           clock.get_clock().size() * (sizeof(std::pair<const int, int>) + 4 * sizeof(void*));
+}
+
+ClockRegistry::ClockRegistry(size_t max_clients, int idle_ms)
+    : max_per_shard(max_clients / SHARDS > 0 ? max_clients / SHARDS : 1),
+      idle_timeout(idle_ms), floor(0), bytes(0), evictions(0) {}
+
+ClockRegistry::Shard& ClockRegistry::shard_for(int client_id) {
+    return shards[static_cast<unsigned int>(client_id) % SHARDS];
+}
+
+// A task's clock can run one past the count that last updated it (the update bumps the
+// task's own entry), two past keeps a fresh clock strictly ahead of it
+void ClockRegistry::raise_floor(int count) {
+    int wanted = count + 2;
+    int current = floor.load();
+    while (current < wanted && !floor.compare_exchange_weak(current, wanted)) {
+    }
+}
+
+void ClockRegistry::evict_locked(Shard& shard, std::unordered_map<int, Entry>::iterator it) {
+    bytes -= EntryBytes(it->second.clock);
+    shard.lru.erase(it->second.lru_pos);
+    shard.clocks.erase(it);
+    evictions++;
+}
+
+VectorClock& ClockRegistry::tick_locked(Shard& shard, int client_id) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    
+    // The shard's oldest clock goes once it has sat idle long enough, one check per tick
+    // keeps idle clients from piling up without a sweeper thread
+    if (!shard.lru.empty() && shard.lru.front() != client_id) {
+        auto oldest = shard.clocks.find(shard.lru.front());
+        if (now - oldest->second.last_used > idle_timeout) {
+            evict_locked(shard, oldest);
+        }
+    }
+    
+    auto it = shard.clocks.find(client_id);
+    if (it != shard.clocks.end()) {
+        it->second.clock.increment();
+        shard.lru.splice(shard.lru.end(), shard.lru, it->second.lru_pos);
+    } else {
+        if (shard.clocks.size() >= max_per_shard) {
+            evict_locked(shard, shard.clocks.find(shard.lru.front()));
+        }
+        it = shard.clocks.emplace(client_id, Entry()).first;
+        it->second.clock = VectorClock(client_id);
+        it->second.clock.set(client_id, floor.load());
+        it->second.lru_pos = shard.lru.insert(shard.lru.end(), client_id);
+        bytes += EntryBytes(it->second.clock);
+    }
+    it->second.last_used = now;
+    raise_floor(it->second.clock.get(client_id));
+    return it->second.clock;
+}
+
+VectorClock ClockRegistry::tick(int client_id) {
+    Shard& shard = shard_for(client_id);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return tick_locked(shard, client_id);
+}
+
+void ClockRegistry::observe(const VectorClock& vc) {
+    for (const auto& pair : vc.get_clock()) {
+        raise_floor(pair.second);
+    }
+}
+
+size_t ClockRegistry::evict_idle() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    size_t evicted = 0;
+    for (size_t i = 0; i < SHARDS; i++) {
+        Shard& shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.lock);
+        while (!shard.lru.empty()) {
+            auto oldest = shard.clocks.find(shard.lru.front());
+            if (now - oldest->second.last_used <= idle_timeout) {
+                break;
+            }
+            evict_locked(shard, oldest);
+            evicted++;
+        }
+    }
+    return evicted;
+}
+
+size_t ClockRegistry::size() {
+    size_t total = 0;
+    for (size_t i = 0; i < SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].lock);
+        total += shards[i].clocks.size();
+    }
+    return total;
+}
+
+size_t ClockRegistry::memory_bytes() const {
+    return bytes;
+}
+
+size_t ClockRegistry::eviction_count() const {
+    return evictions;
+}
+
+int ClockOwner(const Task& request, int connection_id) {
+    return request.get_client_id() >= 0 ? request.get_client_id() : connection_id;
+}
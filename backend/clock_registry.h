@@ -0,0 +1,75 @@
+#ifndef __CLOCK_REGISTRY_H__
+#define __CLOCK_REGISTRY_H__
+
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "messages.h"
+
+// Clocks remembered at once, least recently used ones go first beyond this
+const size_t DEFAULT_MAX_CLIENT_CLOCKS = 4096;
+
+// A client silent for this long loses its clock
+const int DEFAULT_CLOCK_IDLE_MS = 10 * 60 * 1000;
+
+// Vector clock per client, keyed by the client_id the request carries. Sharded by id so
+// writers from different clients don't share a lock, and bounded: a shard over its share
+// of max_clients drops its least recently used clock, and each tick also drops the
+// shard's oldest clock once it has been idle for idle_ms.
+// A forgotten client starts again from a floor above every count handed out (or seen
+// in the log, see observe), never below a clock a task may already carry from it
+class ClockRegistry {
+private:
+    static const size_t SHARDS = 16;
+
+    struct Entry {
+        VectorClock clock;
+        std::list<int>::iterator lru_pos;
+        std::chrono::steady_clock::time_point last_used;
+
+        Entry() : clock(0) {}
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<int, Entry> clocks;
+        std::list<int> lru;  // Least recently used first
+    };
+
+    Shard shards[SHARDS];
+    size_t max_per_shard;
+    std::chrono::milliseconds idle_timeout;
+    std::atomic<int> floor;        // Count a new clock starts at
+    std::atomic<size_t> bytes;     // Estimated memory held by the entries
+    std::atomic<size_t> evictions;
+
+    Shard& shard_for(int client_id);
+    void raise_floor(int count);
+    void evict_locked(Shard& shard, std::unordered_map<int, Entry>::iterator it);
+    VectorClock& tick_locked(Shard& shard, int client_id);
+
+public:
+    ClockRegistry(size_t max_clients = DEFAULT_MAX_CLIENT_CLOCKS, int idle_ms = DEFAULT_CLOCK_IDLE_MS);
+
+    // Clock for the client's next write: its last one incremented, or a fresh one
+    VectorClock tick(int client_id);
+
+    // Raise the floor past a clock written before this registry existed (log replay,
+    // state received on promotion or rejoin)
+    void observe(const VectorClock& vc);
+
+    // Drop every clock idle for longer than idle_ms, returns how many went
+    size_t evict_idle();
+
+    size_t size();
+    size_t memory_bytes() const;
+    size_t eviction_count() const;
+};
+
+// Whose clock a request ticks: the client_id it carries outlives the connection (the
+// gateway opens one per request), requests without one fall back to the connection
+int ClockOwner(const Task& request, int connection_id);
+
+#endif
@@ -0,0 +1,163 @@
+#include "compression.h"
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+static const int HASH_BITS = 14;
+
+static uint32_t Read32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static size_t Hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void WriteLength(std::vector<char>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+// One sequence: literal_count literals then, unless match_length is 0, a match offset bytes back
+static void EmitSequence(std::vector<char>& out, const char* literals, size_t literal_count,
+                         size_t offset, size_t match_length) {
+    size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    out.push_back(static_cast<char>(((literal_count < 15 ? literal_count : 15) << 4) |
+                                    (match_code < 15 ? match_code : 15)));
+    if (literal_count >= 15) {
+        WriteLength(out, literal_count - 15);
+    }
+    out.insert(out.end(), literals, literals + literal_count);
+    if (match_length == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_code >= 15) {
+        WriteLength(out, match_code - 15);
+    }
+}
+
+StreamCompressor::StreamCompressor() : window_base(0), table(static_cast<size_t>(1) << HASH_BITS, -1) {}
+
+bool StreamCompressor::Compress(const char* data, size_t size, std::vector<char>& out) {
+    out.clear();
+    size_t start = window.size();
+    window.insert(window.end(), data, data + size);
+    const char* base = window.data();
+    size_t end = window.size();
+    size_t anchor = start;
+    size_t pos = start;
+    
+    while (pos + MIN_MATCH <= end) {
+        uint32_t sequence = Read32(base + pos);
+        size_t slot = Hash(sequence);
+        int64_t candidate = table[slot];
+        uint64_t stream_pos = window_base + pos;
+        table[slot] = static_cast<int64_t>(stream_pos);
+        
+        if (candidate >= static_cast<int64_t>(window_base) && stream_pos - candidate <= COMPRESSION_WINDOW) {
+            size_t match_pos = static_cast<size_t>(candidate - window_base);
+            if (Read32(base + match_pos) == sequence) {
+                size_t length = MIN_MATCH;
+                while (pos + length < end && base[match_pos + length] == base[pos + length]) {
+                    length++;
+                }
+                EmitSequence(out, base + anchor, pos - anchor, pos - match_pos, length);
+                pos += length;
+                anchor = pos;
+                continue;
+            }
+        }
+        pos++;
+    }
+    EmitSequence(out, base + anchor, end - anchor, 0, 0);
+    
+    // Keep only what the next frame can still reach
+    if (window.size() > COMPRESSION_WINDOW) {
+        size_t drop = window.size() - COMPRESSION_WINDOW;
+        window.erase(window.begin(), window.begin() + drop);
+        window_base += drop;
+    }
+    return out.size() < size;
+}
+
+static bool ReadLength(const unsigned char*& in, const unsigned char* end, size_t& length) {
+    unsigned char byte;
+    do {
+        if (in == end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool StreamDecompressor::Decompress(const char* data, size_t size, size_t raw_size, bool compressed,
+                                    std::vector<char>& out) {
+    size_t start = window.size();
+    if (!compressed) {
+        if (size != raw_size) {
+            return false;
+        }
+        window.insert(window.end(), data, data + size);
+    } else {
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* in_end = in + size;
+        window.reserve(start + raw_size);
+        
+        while (true) {
+            if (in == in_end) {
+                return false;
+            }
+            unsigned char token = *in++;
+            size_t literal_count = token >> 4;
+            if (literal_count == 15 && !ReadLength(in, in_end, literal_count)) {
+                return false;
+            }
+            if (static_cast<size_t>(in_end - in) < literal_count ||
+                window.size() - start + literal_count > raw_size) {
+                return false;
+            }
+            window.insert(window.end(), in, in + literal_count);
+            in += literal_count;
+            if (in == in_end) {
+                break;  // Final sequence
+            }
+            
+            if (in_end - in < 2) {
+                return false;
+            }
+            size_t offset = in[0] | (in[1] << 8);
+            in += 2;
+            size_t match_length = token & 15;
+            if (match_length == 15 && !ReadLength(in, in_end, match_length)) {
+                return false;
+            }
+            match_length += MIN_MATCH;
+            if (offset == 0 || offset > window.size() || window.size() - start + match_length > raw_size) {
+                return false;
+            }
+            // Byte by byte, a match may overlap the bytes it produces
+            size_t from = window.size() - offset;
+            for (size_t i = 0; i < match_length; i++) {
+                char byte = window[from + i];
+                window.push_back(byte);
+            }
+        }
+        if (window.size() - start != raw_size) {
+            return false;
+        }
+    }
+    
+    out.assign(window.begin() + start, window.end());
+    if (window.size() > COMPRESSION_WINDOW) {
+        window.erase(window.begin(), window.begin() + (window.size() - COMPRESSION_WINDOW));
+    }
+    return true;
+}
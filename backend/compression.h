@@ -0,0 +1,54 @@
+#ifndef __COMPRESSION_H__
+#define __COMPRESSION_H__
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Codecs offered in COMPRESSION_HELLO, as a bit mask
+const int COMPRESSION_NONE = 0;
+const int COMPRESSION_LZ = 1;
+const int SUPPORTED_COMPRESSION = COMPRESSION_LZ;
+
+// Largest frame, in uncompressed bytes
+const size_t COMPRESSION_BLOCK_SIZE = 65536;
+
+// How far back a match may reach, into earlier frames of the same stream
+const size_t COMPRESSION_WINDOW = 65535;
+
+// LZ77 over a byte stream cut into frames. Encoder and decoder both keep the last
+// COMPRESSION_WINDOW bytes of the stream, so a frame can refer to what earlier frames
+// carried: a small log entry mostly repeats the titles, users and clocks of the ones
+// before it and still compresses well.
+// Frame encoding, a run of sequences:
+//   token        high nibble literal count, low nibble match length - 4 (15 = extended)
+//   [extended]   literal count - 15 as 255-valued bytes and a final byte below 255
+//   literals
+//   offset       2 bytes little endian, distance back from the current position
+//   [extended]   match length - 19, same scheme
+// The final sequence is literals only and ends the frame
+class StreamCompressor {
+private:
+    std::vector<char> window;    // History followed by the frame being compressed
+    uint64_t window_base;        // Stream offset of window[0]
+    std::vector<int64_t> table;  // Hash of 4 bytes -> stream offset where they last started
+
+public:
+    StreamCompressor();
+
+    // Compress one frame into out. False if it didn't shrink, the frame is then sent
+    // raw. Either way it becomes history for the next frames
+    bool Compress(const char* data, size_t size, std::vector<char>& out);
+};
+
+class StreamDecompressor {
+private:
+    std::vector<char> window;    // History followed by the frame being decoded
+
+public:
+    // Decode one frame of raw_size bytes into out, or take it as is when it was sent
+    // raw. False on a malformed frame
+    bool Decompress(const char* data, size_t size, size_t raw_size, bool compressed, std::vector<char>& out);
+};
+
+#endif
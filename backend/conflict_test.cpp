@@ -10,6 +10,7 @@
 #include <vector>
 #include <atomic>
 #include "task_manager.h"
+#include "clock_registry.h"
 #include "messages.h"
 
 int tests_passed = 0;
@@ -433,6 +434,98 @@ TEST(test_rapid_sequential_updates) {
     ASSERT_TRUE(task.get_clock().get(1) >= 100);
 }
 
+/* ============ Clock Registry Tests ============ */
+
+TEST(test_registry_ticks_per_client) {
+    ClockRegistry registry;
+    
+    VectorClock first = registry.tick(5);
+    VectorClock second = registry.tick(5);
+    ASSERT_EQ(first.get(5), 0);
+    ASSERT_EQ(second.get(5), 1);
+    ASSERT_EQ(first.compare_to(second), -1);
+    
+    // Another client starts above every count handed out so far
+    VectorClock other = registry.tick(6);
+    ASSERT_TRUE(other.get(6) > second.get(5));
+    ASSERT_EQ(registry.size(), 2u);
+}
+
+TEST(test_registry_evicted_client_not_rejected) {
+    TaskManager tm;
+    ClockRegistry registry(16);  // One clock per shard
+    tm.create_task("Task", "Original", "board", "user", Column::TODO, 1);
+    
+    for (int i = 0; i < 5; i++) {
+        OperationResponse response = tm.update_task_with_conflict_detection(0, "Update", "Desc", registry.tick(1));
+        ASSERT_FALSE(response.rejected);
+    }
+    
+    // Client 17 shares client 1's shard and pushes it out
+    registry.tick(17);
+    ASSERT_EQ(registry.eviction_count(), 1u);
+    
+    // Back with a fresh clock, which must still be ahead of what the task carries
+    OperationResponse response = tm.update_task_with_conflict_detection(0, "After eviction", "Desc", registry.tick(1));
+    ASSERT_TRUE(response.success);
+    ASSERT_FALSE(response.rejected);
+    ASSERT_EQ(tm.get_task(0).get_title(), std::string("After eviction"));
+}
+
+TEST(test_registry_observe_raises_floor) {
+    // A promoted backup's registry starts empty, the replicated log holds the old counts
+    VectorClock logged(1);
+    logged.set(1, 500);
+    ClockRegistry registry;
+    registry.observe(logged);
+    ASSERT_TRUE(registry.tick(1).get(1) > 500);
+}
+
+TEST(test_registry_bounded_and_idle) {
+    ClockRegistry registry(256);
+    for (int client = 0; client < 10000; client++) {
+        registry.tick(client);
+    }
+    ASSERT_TRUE(registry.size() <= 256);
+    ASSERT_EQ(registry.eviction_count(), 10000 - registry.size());
+    size_t full_bytes = registry.memory_bytes();
+    ASSERT_TRUE(full_bytes > 0);
+    
+    ClockRegistry idle(4096, 1);
+    for (int client = 0; client < 100; client++) {
+        idle.tick(client);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(idle.evict_idle(), 100u);
+    ASSERT_EQ(idle.size(), 0u);
+    ASSERT_EQ(idle.memory_bytes(), 0u);
+}
+
+TEST(test_registry_threaded_ticks) {
+    ClockRegistry registry;
+    std::atomic<int> out_of_order(0);
+    std::vector<std::thread> threads;
+    
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&registry, &out_of_order, t]() {
+            int last = -1;
+            for (int i = 0; i < 1000; i++) {
+                int count = registry.tick(t).get(t);
+                if (count <= last) {
+                    out_of_order++;
+                }
+                last = count;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    ASSERT_EQ(out_of_order.load(), 0);
+    ASSERT_EQ(registry.size(), 8u);
+}
+
 /* ============ Main ============ */
 
 int main() {
@@ -470,6 +563,13 @@ int main() {
     RUN_TEST(test_move_nonexistent_task);
     RUN_TEST(test_rapid_sequential_updates);
     
+    std::cout << "\n--- Clock Registry Tests ---\n";
+    RUN_TEST(test_registry_ticks_per_client);
+    RUN_TEST(test_registry_evicted_client_not_rejected);
+    RUN_TEST(test_registry_observe_raises_floor);
+    RUN_TEST(test_registry_bounded_and_idle);
+    RUN_TEST(test_registry_threaded_ticks);
+    
     std::cout << "\n==========================================\n";
     std::cout << "Results: " << tests_passed << " passed, " << tests_failed << " failed\n";
     std::cout << "==========================================\n";
@@ -0,0 +1,65 @@
+#include "failure_detector.h"
+#include <algorithm>
+#include <cmath>
+
+FailureDetector::FailureDetector(double threshold)
+    : interval_sum(0), interval_square_sum(0), has_arrival(false), threshold(threshold) {}
+
+void FailureDetector::heartbeat() {
+    std::lock_guard<std::mutex> lock(detector_mutex);
+    Clock::time_point now = Clock::now();
+    
+    if (has_arrival) {
+        double interval = std::chrono::duration<double, std::milli>(now - last_arrival).count();
+        intervals.push_back(interval);
+        interval_sum += interval;
+        interval_square_sum += interval * interval;
+        
+        if (intervals.size() > FAILURE_DETECTOR_WINDOW) {
+            double oldest = intervals.front();
+            intervals.pop_front();
+            interval_sum -= oldest;
+            interval_square_sum -= oldest * oldest;
+        }
+    }
+    last_arrival = now;
+    has_arrival = true;
+}
+
+double FailureDetector::phi() const {
+    std::lock_guard<std::mutex> lock(detector_mutex);
+    if (intervals.empty()) {
+        return 0.0;
+    }
+    
+    double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - last_arrival).count();
+    double mean = interval_sum / intervals.size();
+    double variance = std::max(0.0, interval_square_sum / intervals.size() - mean * mean);
+    double std_dev = std::max(std::sqrt(variance), static_cast<double>(FAILURE_DETECTOR_MIN_STD_DEV_MS));
+    
+    // -log10 of the probability that a live peer's next arrival is still this far off,
+    // with the normal CDF replaced by its logistic approximation
+    double y = (elapsed - mean) / std_dev;
+    double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+    if (elapsed > mean) {
+        return -std::log10(e / (1.0 + e));
+    }
+    return -std::log10(1.0 - 1.0 / (1.0 + e));
+}
+
+bool FailureDetector::is_available() const {
+    return phi() < threshold;
+}
+
+bool FailureDetector::has_samples() const {
+    std::lock_guard<std::mutex> lock(detector_mutex);
+    return !intervals.empty();
+}
+
+void FailureDetector::reset() {
+    std::lock_guard<std::mutex> lock(detector_mutex);
+    intervals.clear();
+    interval_sum = 0;
+    interval_square_sum = 0;
+    has_arrival = false;
+}
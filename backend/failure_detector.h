@@ -0,0 +1,51 @@
+#ifndef __FAILURE_DETECTOR_H__
+#define __FAILURE_DETECTOR_H__
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+
+// Suspicion level above which a peer is treated as failed. phi = 8 means a
+// 1 in 10^8 chance that a live peer would have been this late
+const double PHI_THRESHOLD = 8.0;
+
+// Floor on the interval deviation, so very regular heartbeats don't make every
+// small scheduling delay look like a failure
+const int FAILURE_DETECTOR_MIN_STD_DEV_MS = 75;
+
+// Inter-arrival intervals remembered
+const size_t FAILURE_DETECTOR_WINDOW = 100;
+
+// Phi-accrual failure detector. Heartbeats (and anything else that proves the peer
+// alive) are recorded as arrivals, phi grows with the time since the last one,
+// scaled by the mean and deviation of recent intervals
+class FailureDetector {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    mutable std::mutex detector_mutex;
+    std::deque<double> intervals;  // ms between arrivals, oldest first
+    double interval_sum;
+    double interval_square_sum;
+    Clock::time_point last_arrival;
+    bool has_arrival;
+    double threshold;
+
+public:
+    FailureDetector(double threshold = PHI_THRESHOLD);
+
+    // Record an arrival now
+    void heartbeat();
+
+    // Suspicion level now, 0 until two arrivals have been seen
+    double phi() const;
+
+    // False once phi crosses the threshold. A peer never heard from is not suspected
+    bool is_available() const;
+    bool has_samples() const;
+
+    // Forget the history (new peer connection)
+    void reset();
+};
+
+#endif
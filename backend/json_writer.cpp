@@ -0,0 +1,104 @@
+#include "json_writer.h"
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+JsonWriter::JsonWriter(std::string& buffer) : out(buffer), need_comma(false) {}
+
+void JsonWriter::separate() {
+    if (need_comma) {
+        out += ',';
+    }
+    need_comma = true;
+}
+
+// Digits into a stack buffer, std::to_string would allocate per number
+void JsonWriter::append_int(long long value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* pos = end;
+    unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value)
+                                             : static_cast<unsigned long long>(value);
+    do {
+        *--pos = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *--pos = '-';
+    }
+    out.append(pos, end - pos);
+}
+
+void JsonWriter::begin_object() {
+    separate();
+    out += '{';
+    need_comma = false;
+}
+
+void JsonWriter::end_object() {
+    out += '}';
+    need_comma = true;
+}
+
+void JsonWriter::begin_array() {
+    separate();
+    out += '[';
+    need_comma = false;
+}
+
+void JsonWriter::end_array() {
+    out += ']';
+    need_comma = true;
+}
+
+void JsonWriter::key(const char* name) {
+    separate();
+    out += '"';
+    out += name;
+    out += "\":";
+    need_comma = false;
+}
+
+void JsonWriter::key(int name) {
+    separate();
+    out += '"';
+    append_int(name);
+    out += "\":";
+    need_comma = false;
+}
+
+// Runs of bytes that need no escaping are copied in one append
+void JsonWriter::string(const std::string& value) {
+    separate();
+    out += '"';
+    const char* run = value.data();
+    const char* end = run + value.size();
+    for (const char* p = run; p < end; p++) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out.append(run, p - run);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += HEX_DIGITS[c >> 4];
+                out += HEX_DIGITS[c & 0xf];
+                break;
+        }
+        run = p + 1;
+    }
+    out.append(run, end - run);
+    out += '"';
+}
+
+void JsonWriter::number(long long value) {
+    separate();
+    append_int(value);
+}
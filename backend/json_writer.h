@@ -0,0 +1,35 @@
+#ifndef __JSON_WRITER_H__
+#define __JSON_WRITER_H__
+
+#include <string>
+
+// Appends JSON text to a string the caller owns and nothing else, so rendering a whole
+// board grows one buffer. Separators between members and elements are tracked here:
+// callers only open and close containers, name keys and write values
+class JsonWriter {
+private:
+    std::string& out;
+    bool need_comma;   // A value was written at this level, the next one needs a ','
+
+    void separate();
+    void append_int(long long value);
+
+public:
+    explicit JsonWriter(std::string& buffer);
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+
+    // Object keys. name must not need escaping, a number key is written as its digits
+    void key(const char* name);
+    void key(int name);
+
+    // Quotes, backslashes and control characters are escaped, other bytes pass through
+    // (titles are UTF-8 already)
+    void string(const std::string& value);
+    void number(long long value);
+};
+
+#endif
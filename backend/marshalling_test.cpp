@@ -7,6 +7,8 @@
 #include <cassert>
 #include <cstring>
 #include <vector>
+#include <algorithm>
+#include <arpa/inet.h>
 #include "messages.h"
 
 int tests_passed = 0;
@@ -32,7 +34,7 @@ TEST(test_task_marshal_unmarshal_basic) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_task_id(), 1);
@@ -52,7 +54,7 @@ TEST(test_task_marshal_unmarshal_in_progress) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_column(), Column::IN_PROGRESS);
@@ -66,7 +68,7 @@ TEST(test_task_marshal_unmarshal_done) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_column(), Column::DONE);
@@ -80,7 +82,7 @@ TEST(test_task_marshal_empty_strings) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_title(), "");
@@ -102,7 +104,7 @@ TEST(test_task_marshal_long_strings) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_title(), long_title);
@@ -120,7 +122,7 @@ TEST(test_task_marshal_special_characters) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_title(), "Title with spaces & symbols!");
@@ -136,7 +138,7 @@ TEST(test_task_marshal_unicode) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_title(), "タスク");
@@ -151,7 +153,7 @@ TEST(test_task_marshal_negative_ids) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_task_id(), -1);
@@ -166,7 +168,7 @@ TEST(test_task_marshal_max_int_ids) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_task_id(), 2147483647);
@@ -184,7 +186,7 @@ TEST(test_task_marshal_with_vector_clock) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_clock().get(100), 3);
@@ -208,7 +210,7 @@ TEST(test_task_marshal_complex_vector_clock) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     // Check all clock entries preserved
@@ -230,7 +232,7 @@ TEST(test_task_timestamps_preserved) {
     original.Marshal(buffer);
     
     Task restored;
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_created_at(), created);
@@ -250,7 +252,7 @@ TEST(test_logentry_marshal_create_task) {
     original.Marshal(buffer);
     
     LogEntry restored(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_entry_id(), 0);
@@ -275,7 +277,7 @@ TEST(test_logentry_marshal_update_task) {
     original.Marshal(buffer);
     
     LogEntry restored(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_entry_id(), 10);
@@ -295,7 +297,7 @@ TEST(test_logentry_marshal_move_task) {
     original.Marshal(buffer);
     
     LogEntry restored(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_op_type(), OpType::MOVE_TASK);
@@ -313,7 +315,7 @@ TEST(test_logentry_marshal_delete_task) {
     original.Marshal(buffer);
     
     LogEntry restored(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     ASSERT_EQ(restored.get_op_type(), OpType::DELETE_TASK);
@@ -330,7 +332,7 @@ TEST(test_logentry_marshal_all_columns) {
     char* buf1 = new char[size1];
     e1.Marshal(buf1);
     LogEntry r1(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    r1.Unmarshal(buf1);
+    ASSERT_TRUE(r1.Unmarshal(buf1, size1));
     delete[] buf1;
     ASSERT_EQ(r1.get_column(), Column::TODO);
     
@@ -340,7 +342,7 @@ TEST(test_logentry_marshal_all_columns) {
     char* buf2 = new char[size2];
     e2.Marshal(buf2);
     LogEntry r2(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    r2.Unmarshal(buf2);
+    ASSERT_TRUE(r2.Unmarshal(buf2, size2));
     delete[] buf2;
     ASSERT_EQ(r2.get_column(), Column::IN_PROGRESS);
     
@@ -350,7 +352,7 @@ TEST(test_logentry_marshal_all_columns) {
     char* buf3 = new char[size3];
     e3.Marshal(buf3);
     LogEntry r3(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    r3.Unmarshal(buf3);
+    ASSERT_TRUE(r3.Unmarshal(buf3, size3));
     delete[] buf3;
     ASSERT_EQ(r3.get_column(), Column::DONE);
 }
@@ -371,7 +373,7 @@ TEST(test_logentry_vector_clock_preserved) {
     original.Marshal(buffer);
     
     LogEntry restored(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
-    restored.Unmarshal(buffer);
+    ASSERT_TRUE(restored.Unmarshal(buffer, size));
     delete[] buffer;
     
     const VectorClock& restored_vc = restored.get_timestamp();
@@ -379,6 +381,33 @@ TEST(test_logentry_vector_clock_preserved) {
     ASSERT_TRUE(restored_vc.get(2) >= 1);
 }
 
+TEST(test_task_and_logentry_rank_preserved) {
+    Task task(3, "T", "D", "board-1", "U", Column::DONE, 1);
+    task.set_rank("V01k");
+    
+    std::vector<char> task_buffer(task.Size());
+    task.Marshal(task_buffer.data());
+    Task restored_task;
+    ASSERT_TRUE(restored_task.Unmarshal(task_buffer.data(), static_cast<int>(task_buffer.size())));
+    ASSERT_EQ(restored_task.get_rank(), "V01k");
+    ASSERT_EQ(restored_task.get_column(), Column::DONE);
+    
+    LogEntry entry(7, OpType::REORDER_TASK, VectorClock(1), 3, "", "", "", Column::DONE, 1, "V01k");
+    std::vector<char> entry_buffer(entry.Size());
+    entry.Marshal(entry_buffer.data());
+    LogEntry restored_entry(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
+    ASSERT_TRUE(restored_entry.Unmarshal(entry_buffer.data(), static_cast<int>(entry_buffer.size())));
+    ASSERT_EQ(restored_entry.get_op_type(), OpType::REORDER_TASK);
+    ASSERT_EQ(restored_entry.get_rank(), "V01k");
+    
+    // Entries that place nothing carry an empty rank
+    LogEntry update(8, OpType::UPDATE_TASK, VectorClock(1), 3, "T2", "", "", Column::TODO, 1);
+    std::vector<char> update_buffer(update.Size());
+    update.Marshal(update_buffer.data());
+    ASSERT_TRUE(restored_entry.Unmarshal(update_buffer.data(), static_cast<int>(update_buffer.size())));
+    ASSERT_EQ(restored_entry.get_rank(), "");
+}
+
 /* ============ Size Calculation Tests ============ */
 
 TEST(test_task_size_calculation) {
@@ -404,6 +433,159 @@ TEST(test_logentry_size_calculation) {
     ASSERT_TRUE(size2 > size1);
 }
 
+/* ============ Decode Bounds Tests ============ */
+
+// Overwrite the 4 byte field at offset with value in network order
+static void Patch(std::vector<char>& buffer, size_t offset, int value) {
+    int net_value = htonl(value);
+    memcpy(buffer.data() + offset, &net_value, sizeof(int));
+}
+
+TEST(test_unmarshal_rejects_wrong_size) {
+    Task task(4, "Title", "Desc", "board-1", "alice", Column::IN_PROGRESS, 2);
+    task.get_clock().increment();
+    task.set_rank("V");
+    std::vector<char> buffer(task.Size() + 1);
+    task.Marshal(buffer.data());
+    
+    Task restored;
+    for (int size = 0; size < task.Size(); size++) {
+        ASSERT_TRUE(!restored.Unmarshal(buffer.data(), size));
+    }
+    ASSERT_TRUE(!restored.Unmarshal(buffer.data(), task.Size() + 1));  // Trailing byte
+    ASSERT_TRUE(restored.Unmarshal(buffer.data(), task.Size()));
+    ASSERT_EQ(restored.get_rank(), "V");
+    
+    LogEntry entry(5, OpType::UPDATE_TASK, VectorClock(1), 4, "Title", "Desc", "", Column::TODO, 1);
+    std::vector<char> entry_buffer(entry.Size());
+    entry.Marshal(entry_buffer.data());
+    LogEntry restored_entry(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
+    for (int size = 0; size < entry.Size(); size++) {
+        ASSERT_TRUE(!restored_entry.Unmarshal(entry_buffer.data(), size));
+    }
+}
+
+TEST(test_unmarshal_rejects_corrupt_fields) {
+    Task task(4, "T", "D", "B", "U", Column::TODO, 2);
+    std::vector<char> good(task.Size());
+    task.Marshal(good.data());
+    const size_t title_len_at = sizeof(int);
+    const size_t column_at = sizeof(int) + 4 * (sizeof(int) + 1);
+    const size_t clock_size_at = column_at + sizeof(int) * 2 + sizeof(long long) * 2;
+    Task restored;
+    
+    std::vector<char> bad = good;
+    Patch(bad, title_len_at, 1 << 30);
+    ASSERT_TRUE(!restored.Unmarshal(bad.data(), static_cast<int>(bad.size())));
+    Patch(bad, title_len_at, -1);
+    ASSERT_TRUE(!restored.Unmarshal(bad.data(), static_cast<int>(bad.size())));
+    
+    // A length that fits the buffer but eats the fields after it
+    bad = good;
+    Patch(bad, title_len_at, static_cast<int>(bad.size()) - 8);
+    ASSERT_TRUE(!restored.Unmarshal(bad.data(), static_cast<int>(bad.size())));
+    
+    bad = good;
+    Patch(bad, column_at, 3);
+    ASSERT_TRUE(!restored.Unmarshal(bad.data(), static_cast<int>(bad.size())));
+    
+    bad = good;
+    Patch(bad, clock_size_at, 1 << 29);
+    ASSERT_TRUE(!restored.Unmarshal(bad.data(), static_cast<int>(bad.size())));
+    
+    LogEntry entry(5, OpType::DELETE_TASK, VectorClock(1), 4, "", "", "", Column::TODO, 1);
+    std::vector<char> entry_buffer(entry.Size());
+    entry.Marshal(entry_buffer.data());
+    Patch(entry_buffer, sizeof(int), 999);
+    LogEntry restored_entry(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
+    ASSERT_TRUE(!restored_entry.Unmarshal(entry_buffer.data(), static_cast<int>(entry_buffer.size())));
+    
+    ASSERT_TRUE(restored.Unmarshal(good.data(), static_cast<int>(good.size())));
+    ASSERT_EQ(restored.get_title(), "T");
+}
+
+/* ============ Compact Encoding Tests ============ */
+
+TEST(test_compact_roundtrip_and_size) {
+    Task task(-1, "Title", "Description", "board-1", "alice", Column::DONE, 7);
+    task.get_clock().set(3, 1);
+    task.get_clock().set(900, 123456);
+    task.get_clock().set(-2, 5);
+    task.set_rank("Vz");
+    
+    std::vector<char> buffer(task.Size(WIRE_V2));
+    task.Marshal(buffer.data(), WIRE_V2);
+    Task restored;
+    ASSERT_TRUE(restored.Unmarshal(buffer.data(), static_cast<int>(buffer.size()), WIRE_V2));
+    ASSERT_EQ(restored.get_task_id(), -1);
+    ASSERT_EQ(restored.get_description(), "Description");
+    ASSERT_EQ(restored.get_column(), Column::DONE);
+    ASSERT_EQ(restored.get_created_at(), task.get_created_at());
+    ASSERT_EQ(restored.get_clock().get(900), 123456);
+    ASSERT_EQ(restored.get_clock().get(-2), 5);
+    ASSERT_TRUE(restored.get_clock().get_clock() == task.get_clock().get_clock());
+    ASSERT_EQ(restored.get_rank(), "Vz");
+    ASSERT_TRUE(task.Size(WIRE_V2) < task.Size(WIRE_V1) * 2 / 3);
+    
+    // Each encoding only reads its own bytes
+    ASSERT_TRUE(!restored.Unmarshal(buffer.data(), static_cast<int>(buffer.size()), WIRE_V1));
+    for (size_t size = 0; size < buffer.size(); size++) {
+        ASSERT_TRUE(!restored.Unmarshal(buffer.data(), static_cast<int>(size), WIRE_V2));
+    }
+    
+    VectorClock vc(1);
+    vc.set(1, 40);
+    vc.set(2, 3);
+    LogEntry entry(123456, OpType::MOVE_TASK, vc, 99, "", "", "", Column::IN_PROGRESS, 1, "V001");
+    std::vector<char> entry_buffer(entry.Size(WIRE_V2));
+    entry.Marshal(entry_buffer.data(), WIRE_V2);
+    LogEntry restored_entry(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
+    ASSERT_TRUE(restored_entry.Unmarshal(entry_buffer.data(), static_cast<int>(entry_buffer.size()), WIRE_V2));
+    ASSERT_EQ(restored_entry.get_entry_id(), 123456);
+    ASSERT_EQ(restored_entry.get_op_type(), OpType::MOVE_TASK);
+    ASSERT_EQ(restored_entry.get_timestamp().get(1), 40);
+    ASSERT_EQ(restored_entry.get_rank(), "V001");
+    ASSERT_EQ(entry.Size(WIRE_V2), 21);
+    ASSERT_EQ(entry.Size(WIRE_V1), 60);
+}
+
+TEST(test_marshal_appends_in_one_pass) {
+    Task task(5, "Title", "Description", "board-1", "alice", Column::IN_PROGRESS, 2);
+    task.get_clock().set(2, 7);
+    task.set_rank("V");
+    VectorClock vc(1);
+    vc.set(1, 3);
+    LogEntry entry(8, OpType::UPDATE_TASK, vc, 5, "Title", "", "", Column::IN_PROGRESS, 1, "V");
+    
+    for (int version : {WIRE_V1, WIRE_V2}) {
+        // Appended after what the buffer already holds, reporting what Size would
+        std::vector<char> out(3, 'x');
+        size_t task_size = task.Marshal(out, version);
+        size_t entry_size = entry.Marshal(out, version);
+        ASSERT_EQ(task_size, static_cast<size_t>(task.Size(version)));
+        ASSERT_EQ(entry_size, static_cast<size_t>(entry.Size(version)));
+        ASSERT_EQ(out.size(), 3 + task_size + entry_size);
+        ASSERT_TRUE(out[0] == 'x' && out[2] == 'x');
+        
+        Task restored;
+        ASSERT_TRUE(restored.Unmarshal(out.data() + 3, static_cast<int>(task_size), version));
+        ASSERT_EQ(restored.get_description(), "Description");
+        ASSERT_EQ(restored.get_clock().get(2), 7);
+        LogEntry restored_entry(0, OpType::CREATE_TASK, VectorClock(0), 0, "", "", "", Column::TODO, 0);
+        ASSERT_TRUE(restored_entry.Unmarshal(out.data() + 3 + task_size, static_cast<int>(entry_size), version));
+        ASSERT_EQ(restored_entry.get_entry_id(), 8);
+        ASSERT_EQ(restored_entry.get_timestamp().get(1), 3);
+        
+        // Size-prefixed as the stubs send it
+        std::vector<char> framed;
+        AppendSizePrefixed(framed, task, version);
+        int net_size;
+        memcpy(&net_size, framed.data(), sizeof(int));
+        ASSERT_EQ(static_cast<size_t>(ntohl(net_size)), task_size);
+        ASSERT_TRUE(std::equal(framed.begin() + sizeof(int), framed.end(), out.begin() + 3));
+    }
+}
+
 /* ============ Multiple Marshal/Unmarshal Cycles ============ */
 
 TEST(test_task_multiple_cycles) {
@@ -414,7 +596,7 @@ TEST(test_task_multiple_cycles) {
     char* buf1 = new char[size1];
     original.Marshal(buf1);
     Task t1;
-    t1.Unmarshal(buf1);
+    ASSERT_TRUE(t1.Unmarshal(buf1, size1));
     delete[] buf1;
     
     // Cycle 2
@@ -422,7 +604,7 @@ TEST(test_task_multiple_cycles) {
     char* buf2 = new char[size2];
     t1.Marshal(buf2);
     Task t2;
-    t2.Unmarshal(buf2);
+    ASSERT_TRUE(t2.Unmarshal(buf2, size2));
     delete[] buf2;
     
     // Cycle 3
@@ -430,7 +612,7 @@ TEST(test_task_multiple_cycles) {
     char* buf3 = new char[size3];
     t2.Marshal(buf3);
     Task t3;
-    t3.Unmarshal(buf3);
+    ASSERT_TRUE(t3.Unmarshal(buf3, size3));
     delete[] buf3;
     
     // Final result should match original
@@ -471,11 +653,20 @@ int main() {
     RUN_TEST(test_logentry_marshal_delete_task);
     RUN_TEST(test_logentry_marshal_all_columns);
     RUN_TEST(test_logentry_vector_clock_preserved);
+    RUN_TEST(test_task_and_logentry_rank_preserved);
     
     std::cout << "\n--- Size Calculation Tests ---\n";
     RUN_TEST(test_task_size_calculation);
     RUN_TEST(test_logentry_size_calculation);
     
+    std::cout << "\n--- Decode Bounds Tests ---\n";
+    RUN_TEST(test_unmarshal_rejects_wrong_size);
+    RUN_TEST(test_unmarshal_rejects_corrupt_fields);
+    
+    std::cout << "\n--- Compact Encoding Tests ---\n";
+    RUN_TEST(test_compact_roundtrip_and_size);
+    RUN_TEST(test_marshal_appends_in_one_pass);
+    
     std::cout << "\n--- Multiple Cycle Tests ---\n";
     RUN_TEST(test_task_multiple_cycles);
     
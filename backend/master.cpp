@@ -1,13 +1,22 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <atomic>
+#include <algorithm>
 #include <csignal>
+#include <chrono>
 #include "Socket.h"
 #include "ServerStub.h"
 #include "ClientStub.h"
 #include "task_manager.h"
 #include "state_machine.h"
+#include "clock_registry.h"
 #include "replication.h"
+#include "sequencer.h"
+#include "admission.h"
+#include "change_feed.h"
+#include "snapshot.h"
+#include "state_transfer.h"
 #include "messages.h"
 
 // Global variables
@@ -15,10 +24,11 @@ TaskManager task_manager;
 StateMachine state_machine;
 ReplicationManager* replication_manager = nullptr;
 bool server_running = true;
-int next_entry_id = 0;
+Sequencer* sequencer = nullptr;  // Single writer for the task board, log and replication
 Socket* global_server_socket = nullptr;
-std::map<int, VectorClock> client_clocks;  // Track vector clock per client
-std::mutex clock_mutex;
+ClockRegistry client_clocks;  // Vector clock per client, bounded and sharded
+AdmissionController admission;  // In-flight write budget and connection limit
+std::atomic<int> leader_epoch(0);  // Answered to LEADER_QUERY, above any epoch a backup has seen
 
 void SignalHandler(int) {
     std::cout << "\nShutting down server...\n";
@@ -29,11 +39,46 @@ void SignalHandler(int) {
     }
 }
 
+// Restore the state written by the last clean shutdown. Tasks stay in the mapped file
+// until first touched, so this is fast even for a large board
+bool LoadSnapshot(const std::string& path) {
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    if (!snapshot->Open(path)) {
+        return false;
+    }
+    
+    std::vector<LogEntry> log;
+    if (!snapshot->ReadLog(log)) {
+        std::cerr << "[SNAPSHOT] " << path << " has a corrupt log, ignoring it\n";
+        return false;
+    }
+    
+    task_manager.load_snapshot(snapshot);
+    state_machine.set_log(log);
+    
+    std::cout << "[SNAPSHOT] Loaded " << snapshot->TaskCount() << " tasks, " << log.size()
+              << " log entries from " << path << "\n";
+    return true;
+}
+
+// Epoch of a backup's view of leadership, one more if it is acting as primary since this
+// master will take over from it. -1 if it can't be reached
+int PeerLeaderEpoch(const std::string& backup_ip, int backup_port) {
+    ClientStub client;
+    LeaderInfo info;
+    if (!client.Init(backup_ip, backup_port) || !client.SetTimeouts(LEADER_QUERY_TIMEOUT_MS) || !client.QueryLeader(info)) {
+        return -1;
+    }
+    client.Close();
+    return info.role == NodeRole::PRIMARY ? info.epoch + 1 : info.epoch;
+}
+
 // Try to rejoin after crash which is connect to backup, get state if it's promoted
 // Returns true if state was received from promoted backup
-bool TryRejoinFromBackup(const std::string& backup_ip, int backup_port) {
+bool TryRejoinFromBackup(const std::string& backup_ip, int backup_port, bool compress) {
     ClientStub client;
-    if (!client.Init(backup_ip, backup_port)) {
+    if (!client.Init(backup_ip, backup_port) || !client.SetTimeouts(STATE_TRANSFER_TIMEOUT_MS) ||
+        (compress && !client.NegotiateCompression()) || !client.NegotiateWireVersion()) {
         // Backup not reachable - this is normal on first start
         return false;
     }
@@ -45,33 +90,18 @@ bool TryRejoinFromBackup(const std::string& backup_ip, int backup_port) {
     }
     
     // Try to receive state transfer
-    std::vector<Task> tasks;
-    std::vector<LogEntry> log;
-    int id_counter;
-    
-    if (!client.ReceiveStateTransfer(tasks, log, id_counter)) {
+    StateTransferStats stats;
+    if (!ReceiveState(client, task_manager, state_machine, stats)) {
         // Backup is not promoted and this is expected behaviour on first start
         client.Close();
         return false;
     }
     
     // Backup WAS promoted and we are actually rejoining!
-    std::cout << "[REJOIN] Backup was promoted, receiving state transfer\n";
-    std::cout << "[REJOIN] Received: " << tasks.size() << " tasks, " 
-              << log.size() << " log entries, ID counter: " << id_counter << "\n";
-    
-    // Apply state
-    task_manager.clear_all_tasks();
-    for (const Task& task : tasks) {
-        task_manager.add_task_direct(task);
-    }
-    task_manager.set_id_counter(id_counter);
-    
-    // Apply log
-    state_machine.set_log(log);
-    next_entry_id = state_machine.get_next_entry_id();
-    
-    std::cout << "[REJOIN] State applied, next entry ID: " << next_entry_id << "\n";
+    std::cout << "[REJOIN] Backup was promoted, received state transfer\n";
+    std::cout << "[REJOIN] Received: " << stats.tasks << " tasks, " << stats.log_entries
+              << " log entries (cut at entry " << stats.cut_entry_id << "), ID counter: " << stats.id_counter << "\n";
+    std::cout << "[REJOIN] State applied, next entry ID: " << state_machine.get_next_entry_id() << "\n";
     
     // Send DEMOTE_ACK to backup
     if (!client.SendOpType(OpType::DEMOTE_ACK)) {
@@ -86,11 +116,60 @@ bool TryRejoinFromBackup(const std::string& backup_ip, int backup_port) {
     return true;
 }
 
+// Rank a write left the task at, logged so replicas place it the same way. Writes run on
+// the sequencer thread, so nothing has moved the task since
+std::string AppliedRank(int task_id) {
+    Task applied;
+    return task_manager.try_get_task(task_id, applied) ? applied.get_rank() : "";
+}
+
+// Log entry for a write, carrying the same fields the single-op handlers log for it
+LogEntry MakeLogEntry(int entry_id, OpType op_type, const VectorClock& vc, int task_id, const Task& task) {
+    switch (op_type) {
+        case OpType::CREATE_TASK:
+            return LogEntry(entry_id, op_type, vc, task_id, task.get_title(), task.get_description(),
+                            task.get_created_by(), task.get_column(), task.get_client_id(), AppliedRank(task_id));
+        case OpType::UPDATE_TASK:
+            return LogEntry(entry_id, op_type, vc, task_id, task.get_title(), task.get_description(),
+                            "", Column::TODO, task.get_client_id());
+        case OpType::MOVE_TASK:
+            return LogEntry(entry_id, op_type, vc, task_id, "", "", "", task.get_column(), task.get_client_id(),
+                            AppliedRank(task_id));
+        default:
+            return LogEntry(entry_id, op_type, vc, task_id, "", "", "", Column::TODO, task.get_client_id());
+    }
+}
+
+// Submit a write to the sequencer if admission control lets owner's write in now. False if
+// it never ran, with response filled in to send back instead (a shed write is answered
+// BUSY). A write that ran but missed the backup quorum is answered as unconfirmed, catch-up
+// takes it to the backups later
+bool SubmitAdmitted(int owner, int cost, const Sequencer::WriteFn& write, OperationResponse& response,
+                    const std::vector<Task>* imported = nullptr) {
+    int retry_after_ms;
+    if (!admission.try_admit(owner, cost, retry_after_ms)) {
+        response.busy = true;
+        response.retry_after_ms = retry_after_ms;
+        return false;
+    }
+    std::chrono::steady_clock::time_point admitted_at = std::chrono::steady_clock::now();
+    WriteOutcome outcome = sequencer->submit(write, imported);
+    admission.release(owner, cost, std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - admitted_at).count());
+    if (outcome == WriteOutcome::STOPPED) {
+        std::cerr << "[SEQUENCER] Write not run: shutting down\n";
+    } else if (outcome == WriteOutcome::NOT_REPLICATED) {
+        std::cerr << "[SEQUENCER] Write applied but unconfirmed: backup quorum not reached\n";
+    }
+    return ReportWriteOutcome(outcome, response);
+}
+
 // Handle client requests in separate thread
 void HandleClient(Socket* client_socket, int client_id) {
     ServerStub stub;
     if (!stub.Init(client_socket)) {
         delete client_socket;
+        admission.close_connection();
         return;
     }
     
@@ -105,19 +184,216 @@ void HandleClient(Socket* client_socket, int client_id) {
             break;
         }
         
+        // Compressed framing for the rest of this connection, a rejoining backup's state transfer
+        // or a client expecting large boards
+        if (op_type == OpType::COMPRESSION_HELLO) {
+            if (!stub.AcceptCompression()) {
+                break;
+            }
+            continue;
+        }
+        
+        // Compact records and responses, offered by the other nodes (the gateway stays on WIRE_V1)
+        if (op_type == OpType::WIRE_HELLO) {
+            if (!stub.AcceptWireVersion()) {
+                break;
+            }
+            continue;
+        }
+        
         // Handle STATE_TRANSFER_REQUEST before receiving task (backup rejoin doesn't send task)
         if (op_type == OpType::STATE_TRANSFER_REQUEST) {
             std::cout << "[STATE_TRANSFER] Backup requesting state sync\n";
-            std::vector<Task> all_tasks = task_manager.get_all_tasks();
-            std::vector<LogEntry> log = state_machine.get_log();
-            int id_counter = task_manager.get_id_counter();
-            
-            std::cout << "[STATE_TRANSFER] Sending " << all_tasks.size() << " tasks, "
-                      << log.size() << " log entries, ID counter: " << id_counter << "\n";
             
-            if (!stub.SendStateTransfer(all_tasks, log, id_counter)) {
+            // Streamed in chunks while other clients keep writing
+            StateTransferStats stats;
+            if (!SendState(stub, task_manager, state_machine, stats)) {
                 std::cerr << "[STATE_TRANSFER] Failed to send state to backup\n";
+                break;
+            }
+            std::cout << "[STATE_TRANSFER] Sent " << stats.tasks << " tasks, " << stats.log_entries
+                      << " log entries (cut at entry " << stats.cut_entry_id << "), ID counter: " << stats.id_counter << "\n";
+            continue;
+        }
+        
+        // GET_BOARD_SINCE carries a version instead of a task
+        if (op_type == OpType::GET_BOARD_SINCE) {
+            int origin, since_version;
+            if (!stub.ReceiveInt(origin) || !stub.ReceiveInt(since_version)) {
+                break;
+            }
+            BoardDelta delta = task_manager.get_changes_since(origin, since_version);
+            std::cout << "GET_BOARD_SINCE " << since_version << " - returning " << delta.tasks.size()
+                      << " tasks, " << delta.deleted_task_ids.size() << " deletes"
+                      << (delta.full_sync ? " (full sync)" : "") << "\n";
+            
+            if (!stub.SendBoardDelta(delta)) {
+                std::cerr << "Failed to send board delta\n";
+            }
+            continue;
+        }
+        
+        // GET_BOARD_JSON carries a board id, the answer is the board ready to serve
+        if (op_type == OpType::GET_BOARD_JSON) {
+            std::string board_id;
+            if (!stub.ReceiveBoardId(board_id)) {
+                break;
+            }
+            if (!stub.SendBoardJson(*task_manager.get_board_json(board_id))) {
+                std::cerr << "Failed to send board JSON\n";
+            }
+            continue;
+        }
+        
+        // LEADER_QUERY lets the gateway route by role instead of by failed connections
+        if (op_type == OpType::LEADER_QUERY) {
+            LeaderInfo info;
+            info.role = NodeRole::PRIMARY;
+            info.epoch = leader_epoch;
+            info.last_entry_id = state_machine.get_next_entry_id() - 1;
+            if (!stub.SendLeaderInfo(info)) {
+                break;
+            }
+            continue;
+        }
+        
+        // FOLLOWER_READ is mostly for standbys, the master has applied everything it acked
+        // so it answers at once
+        if (op_type == OpType::FOLLOWER_READ) {
+            int task_id, min_entry_id;
+            if (!stub.ReceiveInt(task_id) || !stub.ReceiveInt(min_entry_id)) {
+                break;
             }
+            FollowerReadResponse response;
+            response.applied_entry_id = state_machine.get_next_entry_id() - 1;
+            response.fresh = response.applied_entry_id >= min_entry_id;
+            Task read_task;
+            if (task_id < 0) {
+                response.tasks = task_manager.get_all_tasks();
+            } else if (task_manager.try_get_task(task_id, read_task)) {
+                response.tasks.push_back(read_task);
+            }
+            stub.SendFollowerRead(response);
+            continue;
+        }
+        
+        // QUERY carries its filters instead of a task
+        if (op_type == OpType::QUERY) {
+            TaskQuery query;
+            if (!stub.ReceiveQuery(query)) {
+                break;
+            }
+            TaskPage page = task_manager.query_tasks(query);
+            std::cout << "QUERY - returning " << page.tasks.size() << " tasks" << (page.has_more ? " (more)" : "") << "\n";
+            if (!stub.SendTaskPage(page)) {
+                std::cerr << "Failed to send query page\n";
+            }
+            continue;
+        }
+        
+        // SEARCH carries query text and a limit
+        if (op_type == OpType::SEARCH) {
+            std::string query;
+            int limit;
+            if (!stub.ReceiveSearch(query, limit)) {
+                break;
+            }
+            SearchResults results = task_manager.search_tasks(query, limit);
+            std::cout << "SEARCH \"" << query << "\" - " << results.total_matches << " matches\n";
+            if (!stub.SendSearchResults(results)) {
+                std::cerr << "Failed to send search results\n";
+            }
+            continue;
+        }
+        
+        // SUBSCRIBE turns this connection into a change feed until the subscriber leaves
+        if (op_type == OpType::SUBSCRIBE) {
+            int after_entry_id;
+            if (stub.ReceiveInt(after_entry_id)) {
+                ServeChangeFeed(stub, state_machine, task_manager, after_entry_id, server_running);
+            }
+            break;
+        }
+        
+        // BATCH carries a list of operations: one lock, one contiguous log run, one replication round trip
+        if (op_type == OpType::BATCH) {
+            std::vector<BatchOperation> ops;
+            if (!stub.ReceiveBatch(ops)) {
+                break;
+            }
+            
+            std::vector<OperationResponse> responses(ops.size());
+            size_t applied = 0;
+            Sequencer::WriteFn write = [&](int first_entry_id) {
+                // One clock tick per operation, as if they had arrived one by one
+                std::vector<VectorClock> clocks;
+                clocks.reserve(ops.size());
+                for (size_t i = 0; i < ops.size(); i++) {
+                    clocks.push_back(client_clocks.tick(ClockOwner(ops[i].task, client_id)));
+                }
+                
+                responses = task_manager.apply_batch(ops, clocks);
+                
+                std::vector<LogEntry> entries;
+                for (size_t op = 0; op < responses.size(); op++) {
+                    if (responses[op].success && !responses[op].rejected) {
+                        responses[op].entry_id = first_entry_id + static_cast<int>(entries.size());
+                        entries.push_back(MakeLogEntry(responses[op].entry_id, ops[op].op_type,
+                                                       clocks[op], responses[op].updated_task_id, ops[op].task));
+                    }
+                }
+                applied = entries.size();
+                return entries;
+            };
+            // Counts against the budget per operation, and against the client of the first
+            OperationResponse outcome;
+            int owner = ops.empty() ? client_id : ClockOwner(ops[0].task, client_id);
+            if (!SubmitAdmitted(owner, std::max<int>(1, ops.size()), write, outcome)) {
+                // Shed whole or never run: no operation is reported done
+                std::fill(responses.begin(), responses.end(), outcome);
+                stub.SendOperationResponses(responses);
+                continue;
+            }
+            if (outcome.unconfirmed) {
+                // The operations that were applied are unconfirmed with the rest of the batch
+                for (OperationResponse& response : responses) {
+                    response.unconfirmed = response.success && !response.rejected;
+                }
+            }
+            
+            std::cout << "BATCH of " << ops.size() << " operations - " << applied << " applied\n";
+            stub.SendOperationResponses(responses);
+            continue;
+        }
+        
+        // IMPORT_TASKS carries a task list: installed under one lock, logged as one marker
+        // entry and replicated as one message instead of a create per task
+        if (op_type == OpType::IMPORT_TASKS) {
+            std::vector<Task> tasks;
+            if (!stub.ReceiveTaskList(tasks)) {
+                break;
+            }
+            
+            OperationResponse import_response;
+            Sequencer::WriteFn write = [&](int entry_id) {
+                std::vector<LogEntry> entries;
+                import_response.success = true;
+                import_response.updated_task_id = task_manager.import_tasks(tasks);
+                
+                if (!tasks.empty()) {
+                    entries.push_back(LogEntry(entry_id, op_type, VectorClock(client_id),
+                                               import_response.updated_task_id, "", "", "", Column::TODO, client_id));
+                    import_response.entry_id = entry_id;
+                }
+                return entries;
+            };
+            if (!SubmitAdmitted(client_id, 1, write, import_response, &tasks)) {
+                stub.SendOperationResponse(import_response);
+                continue;
+            }
+            
+            std::cout << "Imported " << tasks.size() << " tasks starting at id " << import_response.updated_task_id << "\n";
+            stub.SendOperationResponse(import_response);
             continue;
         }
         
@@ -125,59 +401,61 @@ void HandleClient(Socket* client_socket, int client_id) {
         Task task = stub.ReceiveTask();
         bool success = false;
         OperationResponse op_response;
+        int owner = ClockOwner(task, client_id);
+        
+        // REORDER_TASK follows the task with the id of the task it goes below, -1 for the top
+        int after_task_id = -1;
+        if (op_type == OpType::REORDER_TASK && !stub.ReceiveInt(after_task_id)) {
+            break;
+        }
         
         // Process based on operation type
         switch (op_type) {
             case OpType::CREATE_TASK: {
-                // Get or create vector clock for this client
-                VectorClock vc(client_id);
-                {
-                    std::lock_guard<std::mutex> clock_lock(clock_mutex);
-                    auto clock_it = client_clocks.find(client_id);
-                    if (clock_it != client_clocks.end()) {
-                        vc = clock_it->second;
-                        vc.increment();
-                        clock_it->second = vc;
-                    } else {
-                        client_clocks.insert({client_id, vc});
+                Sequencer::WriteFn write = [&](int entry_id) {
+                    std::vector<LogEntry> entries;
+                    // Next tick of the requesting client's clock
+                    VectorClock vc = client_clocks.tick(ClockOwner(task, client_id));
+                    
+                    int task_id = task_manager.create_task(
+                        task.get_title(),
+                        task.get_description(),
+                        task.get_board_id(),
+                        task.get_created_by(),
+                        task.get_column(),
+                        task.get_client_id()
+                    );
+                    success = task_id >= 0;
+                    
+                    // Prepare response with the id create_task assigned
+                    op_response.success = success;
+                    op_response.conflict = false;
+                    op_response.rejected = false;
+                    op_response.updated_task_id = task_id;
+                    
+                    if (success) {
+                        // Create log entry with proper vector clock and title
+                        entries.push_back(LogEntry(entry_id, op_type, vc,
+                                                   op_response.updated_task_id,
+                                                   task.get_title(),
+                                                   task.get_description(),
+                                                   task.get_created_by(),
+                                                   task.get_column(),
+                                                   task.get_client_id(),
+                                                   AppliedRank(op_response.updated_task_id)));
+                        op_response.entry_id = entry_id;
                     }
+                    return entries;
+                };
+                if (!SubmitAdmitted(owner, 1, write, op_response)) {
+                    stub.SendOperationResponse(op_response);
+                    continue;
                 }
                 
-                success = task_manager.create_task(
-                    task.get_title(),
-                    task.get_description(),
-                    task.get_board_id(),
-                    task.get_created_by(),
-                    task.get_column(),
-                    task.get_client_id()
-                );
-                
-                // Prepare response with created task ID (use id_counter, not task_count)
-                op_response.success = success;
-                op_response.conflict = false;
-                op_response.rejected = false;
-                op_response.updated_task_id = success ? (task_manager.get_id_counter() - 1) : -1;
-                
                 if (success) {
                     // Debug: Log the column being replicated
                     std::cout << "[DEBUG] CREATE_TASK - column from task: " 
                               << static_cast<int>(task.get_column()) << "\n";
-                    
-                    // Create log entry with proper vector clock and title
-                    LogEntry entry(next_entry_id++, op_type, vc, 
-                                 op_response.updated_task_id,
-                                 task.get_title(),
-                                 task.get_description(),
-                                 task.get_created_by(),
-                                 task.get_column(), 
-                                 task.get_client_id());
-                    
-                    state_machine.append_to_log(entry);
-                    
-                    if (replication_manager) {
-                        replication_manager->replicate_entry(entry);
-                    }
-                    
                     std::cout << "Created task " << op_response.updated_task_id << " for client " << client_id << "\n";
                 }
                 
@@ -187,44 +465,37 @@ void HandleClient(Socket* client_socket, int client_id) {
             }
             
             case OpType::UPDATE_TASK: {
-                // Get or increment vector clock for this client
-                VectorClock vc(client_id);
-                {
-                    std::lock_guard<std::mutex> clock_lock(clock_mutex);
-                    auto clock_it = client_clocks.find(client_id);
-                    if (clock_it != client_clocks.end()) {
-                        vc = clock_it->second;
-                        vc.increment();
-                        clock_it->second = vc;
-                    } else {
-                        client_clocks.insert({client_id, vc});
-                    }
-                }
-                
-                // Use conflict detection version (now includes title)
-                op_response = task_manager.update_task_with_conflict_detection(
-                    task.get_task_id(),
-                    task.get_title(),
-                    task.get_description(),
-                    vc
-                );
-                success = op_response.success;
-                
-                if (success && !op_response.rejected) {
-                    LogEntry entry(next_entry_id++, op_type, vc,
-                                 task.get_task_id(),
-                                 task.get_title(),  // Include title for updates
-                                 task.get_description(),
-                                 "",  // No created_by for updates
-                                 Column::TODO,
-                                 task.get_client_id());
+                Sequencer::WriteFn write = [&](int entry_id) {
+                    std::vector<LogEntry> entries;
+                    // Next tick of the requesting client's clock
+                    VectorClock vc = client_clocks.tick(ClockOwner(task, client_id));
                     
-                    state_machine.append_to_log(entry);
+                    // Use conflict detection version (now includes title)
+                    op_response = task_manager.update_task_with_conflict_detection(
+                        task.get_task_id(),
+                        task.get_title(),
+                        task.get_description(),
+                        vc
+                    );
                     
-                    if (replication_manager) {
-                        replication_manager->replicate_entry(entry);
+                    if (op_response.success && !op_response.rejected) {
+                        entries.push_back(LogEntry(entry_id, op_type, vc,
+                                                   task.get_task_id(),
+                                                   task.get_title(),  // Include title for updates
+                                                   task.get_description(),
+                                                   "",  // No created_by for updates
+                                                   Column::TODO,
+                                                   task.get_client_id()));
+                        op_response.entry_id = entry_id;
                     }
-                    
+                    return entries;
+                };
+                if (!SubmitAdmitted(owner, 1, write, op_response)) {
+                    stub.SendOperationResponse(op_response);
+                    continue;
+                }
+                
+                if (op_response.success && !op_response.rejected) {
                     if (op_response.conflict) {
                         std::cout << "Updated task " << task.get_task_id() << " (with conflict resolution)\n";
                     } else {
@@ -238,43 +509,37 @@ void HandleClient(Socket* client_socket, int client_id) {
             }
             
             case OpType::MOVE_TASK: {
-                // Get or increment vector clock for this client
-                VectorClock vc(client_id);
-                {
-                    std::lock_guard<std::mutex> clock_lock(clock_mutex);
-                    auto clock_it = client_clocks.find(client_id);
-                    if (clock_it != client_clocks.end()) {
-                        vc = clock_it->second;
-                        vc.increment();
-                        clock_it->second = vc;
-                    } else {
-                        client_clocks.insert({client_id, vc});
-                    }
-                }
-                
-                // Use conflict detection version
-                op_response = task_manager.move_task_with_conflict_detection(
-                    task.get_task_id(),
-                    task.get_column(),
-                    vc
-                );
-                success = op_response.success;
-                
-                if (success && !op_response.rejected) {
-                    LogEntry entry(next_entry_id++, op_type, vc,
-                                 task.get_task_id(),
-                                 "",  // No title for moves
-                                 "",
-                                 "",  // No created_by for moves
-                                 task.get_column(),
-                                 task.get_client_id());
+                Sequencer::WriteFn write = [&](int entry_id) {
+                    std::vector<LogEntry> entries;
+                    // Next tick of the requesting client's clock
+                    VectorClock vc = client_clocks.tick(ClockOwner(task, client_id));
                     
-                    state_machine.append_to_log(entry);
+                    // Use conflict detection version
+                    op_response = task_manager.move_task_with_conflict_detection(
+                        task.get_task_id(),
+                        task.get_column(),
+                        vc
+                    );
                     
-                    if (replication_manager) {
-                        replication_manager->replicate_entry(entry);
+                    if (op_response.success && !op_response.rejected) {
+                        entries.push_back(LogEntry(entry_id, op_type, vc,
+                                                   task.get_task_id(),
+                                                   "",  // No title for moves
+                                                   "",
+                                                   "",  // No created_by for moves
+                                                   task.get_column(),
+                                                   task.get_client_id(),
+                                                   AppliedRank(task.get_task_id())));
+                        op_response.entry_id = entry_id;
                     }
-                    
+                    return entries;
+                };
+                if (!SubmitAdmitted(owner, 1, write, op_response)) {
+                    stub.SendOperationResponse(op_response);
+                    continue;
+                }
+                
+                if (op_response.success && !op_response.rejected) {
                     if (op_response.conflict) {
                         std::cout << "Moved task " << task.get_task_id() 
                                   << " to column " << static_cast<int>(task.get_column()) 
@@ -290,41 +555,81 @@ void HandleClient(Socket* client_socket, int client_id) {
                 continue; // Skip the default SendSuccess
             }
             
-            case OpType::DELETE_TASK: {
-                // Increment vector clock for delete operation
-                VectorClock vc(client_id);
-                {
-                    std::lock_guard<std::mutex> clock_lock(clock_mutex);
-                    auto clock_it = client_clocks.find(client_id);
-                    if (clock_it != client_clocks.end()) {
-                        vc = clock_it->second;
-                        vc.increment();
-                        clock_it->second = vc;
-                    } else {
-                        client_clocks.insert({client_id, vc});
+            case OpType::REORDER_TASK: {
+                Sequencer::WriteFn write = [&](int entry_id) {
+                    std::vector<LogEntry> entries;
+                    // Next tick of the requesting client's clock
+                    VectorClock vc = client_clocks.tick(ClockOwner(task, client_id));
+                    
+                    op_response = task_manager.reorder_task_with_conflict_detection(
+                        task.get_task_id(),
+                        task.get_column(),
+                        after_task_id,
+                        vc
+                    );
+                    
+                    if (op_response.success && !op_response.rejected) {
+                        entries.push_back(LogEntry(entry_id, op_type, vc,
+                                                   task.get_task_id(),
+                                                   "",
+                                                   "",
+                                                   "",
+                                                   task.get_column(),
+                                                   task.get_client_id(),
+                                                   AppliedRank(task.get_task_id())));
+                        op_response.entry_id = entry_id;
                     }
+                    return entries;
+                };
+                if (!SubmitAdmitted(owner, 1, write, op_response)) {
+                    stub.SendOperationResponse(op_response);
+                    continue;
                 }
                 
-                success = task_manager.delete_task(task.get_task_id());
+                if (op_response.success && !op_response.rejected) {
+                    std::cout << "Reordered task " << task.get_task_id() << " below task " << after_task_id
+                              << " in column " << static_cast<int>(task.get_column())
+                              << (op_response.conflict ? " (with conflict resolution)" : "") << "\n";
+                }
                 
-                if (success) {
-                    LogEntry entry(next_entry_id++, op_type, vc,
-                                 task.get_task_id(),
-                                 "",  // No title for deletes
-                                 "",
-                                 "",  // No created_by for deletes
-                                 Column::TODO,
-                                 task.get_client_id());
+                stub.SendOperationResponse(op_response);
+                continue;
+            }
+            
+            case OpType::DELETE_TASK: {
+                Sequencer::WriteFn write = [&](int entry_id) {
+                    std::vector<LogEntry> entries;
+                    // Next tick of the requesting client's clock
+                    VectorClock vc = client_clocks.tick(ClockOwner(task, client_id));
                     
-                    state_machine.append_to_log(entry);
+                    success = task_manager.delete_task(task.get_task_id());
+                    // Answered like the other writes, so a BUSY delete looks like any BUSY write
+                    op_response.success = success;
+                    op_response.updated_task_id = task.get_task_id();
                     
-                    if (replication_manager) {
-                        replication_manager->replicate_entry(entry);
+                    if (success) {
+                        entries.push_back(LogEntry(entry_id, op_type, vc,
+                                                   task.get_task_id(),
+                                                   "",  // No title for deletes
+                                                   "",
+                                                   "",  // No created_by for deletes
+                                                   Column::TODO,
+                                                   task.get_client_id()));
+                        op_response.entry_id = entry_id;
                     }
-                    
+                    return entries;
+                };
+                if (!SubmitAdmitted(owner, 1, write, op_response)) {
+                    stub.SendOperationResponse(op_response);
+                    continue;
+                }
+                
+                if (success) {
                     std::cout << "Deleted task " << task.get_task_id() << "\n";
                 }
-                break;
+                
+                stub.SendOperationResponse(op_response);
+                continue;
             }
             
             case OpType::GET_BOARD: {
@@ -358,13 +663,42 @@ void HandleClient(Socket* client_socket, int client_id) {
     
     std::cout << "Client " << client_id << " disconnected\n";
     delete client_socket;
+    admission.close_connection();
 }
 
 
 int main(int argc, char* argv[]) {
-    if (argc != 3 && argc != 5) {
+    // Backups come as ip/port pairs, options (--quorum N, --heartbeat-ms N, --compress,
+    // --require-backup) follow them
+    int quorum = 1;
+    int heartbeat_ms = DEFAULT_HEARTBEAT_INTERVAL_MS;
+    bool compress = false;
+    bool require_backup = false;
+    std::vector<std::pair<std::string, int>> backups;
+    bool usage_ok = argc >= 3;
+    for (int i = 3; usage_ok && i < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--compress") {
+            compress = true;
+            i--;  // Takes no value
+        } else if (arg == "--require-backup") {
+            require_backup = true;
+            i--;
+        } else if (i + 1 >= argc) {
+            usage_ok = false;
+        } else if (arg == "--quorum") {
+            quorum = std::stoi(argv[i + 1]);
+        } else if (arg == "--heartbeat-ms") {
+            heartbeat_ms = std::stoi(argv[i + 1]);
+        } else if (arg.compare(0, 2, "--") != 0) {
+            backups.push_back({arg, std::stoi(argv[i + 1])});
+        } else {
+            usage_ok = false;
+        }
+    }
+    if (!usage_ok) {
         std::cerr << "Usage: ./master [port] [node_id]\n";
-        std::cerr << "   Or: ./master [port] [node_id] [backup_ip] [backup_port]\n";
+        std::cerr << "   Or: ./master [port] [node_id] [backup_ip] [backup_port] ... [--quorum N] [--heartbeat-ms N] [--compress] [--require-backup]\n";
         return 1;
     }
     
@@ -373,33 +707,56 @@ int main(int argc, char* argv[]) {
     
     std::cout << "Starting master node " << node_id << " on port " << port << "\n";
     
-    // Set up replication if backup specified
-    std::string backup_ip;
-    int backup_port = 0;
+    // Recover from a promoted backup if there is one, the local snapshot otherwise
+    bool rejoined = false;
+    std::string snapshot_path = "master_" + std::to_string(port) + ".snap";
     
-    if (argc == 5) {
-        backup_ip = argv[3];
-        backup_port = std::stoi(argv[4]);
-        
-        // Try to rejoin from backup (in case backup is promoted after our crash)
-        bool rejoined = TryRejoinFromBackup(backup_ip, backup_port);
-        
-        if (rejoined) {
-            std::cout << "Recovered state from promoted backup\n";
+    if (!backups.empty()) {
+        // Asked before rejoining, a promoted backup demotes once it has handed over
+        for (const auto& backup : backups) {
+            leader_epoch = std::max(leader_epoch.load(), PeerLeaderEpoch(backup.first, backup.second));
         }
+        std::cout << "Leader epoch " << leader_epoch << "\n";
         
-        std::cout << "Replication target: " << backup_ip << ":" << backup_port << "\n";
-        
-        // Now set up replication manager to connect to backup
-        replication_manager = new ReplicationManager(node_id);
-        replication_manager->add_backup(backup_ip, backup_port);
-        
-        // Start heartbeat monitoring (5 second interval)
-        replication_manager->start_heartbeat();
+        // Try to rejoin from a backup (in case one was promoted after our crash)
+        for (const auto& backup : backups) {
+            rejoined = TryRejoinFromBackup(backup.first, backup.second, compress);
+            if (rejoined) {
+                std::cout << "Recovered state from promoted backup " << backup.first << ":" << backup.second << "\n";
+                break;
+            }
+        }
     } else {
         std::cout << "Running without replication (no backup specified)\n";
     }
     
+    // A promoted backup's state is newer than anything we wrote at shutdown
+    if (!rejoined && LoadSnapshot(snapshot_path)) {
+        std::cout << "Recovered state from local snapshot\n";
+    }
+    
+    // Set up replication once recovered, each backup is caught up from this log as it connects
+    if (!backups.empty()) {
+        replication_manager = new ReplicationManager(node_id);
+        replication_manager->set_compression(compress);
+        replication_manager->set_require_backup(require_backup);
+        replication_manager->set_log_source(&state_machine);
+        replication_manager->set_quorum(std::min(quorum, static_cast<int>(backups.size())));
+        replication_manager->set_heartbeat_interval(heartbeat_ms);
+        std::cout << "Writes wait for " << replication_manager->get_quorum() << " of "
+                  << backups.size() << " backup acks\n";
+    }
+    
+    // Clients pick up their clocks above whatever the recovered log carries
+    for (const LogEntry& entry : state_machine.get_log()) {
+        client_clocks.observe(entry.get_timestamp());
+    }
+    
+    // Every write from here on goes through the sequencer, numbered after the recovered log
+    Sequencer write_sequencer(state_machine, replication_manager);
+    write_sequencer.start(state_machine.get_next_entry_id());
+    sequencer = &write_sequencer;
+    
     signal(SIGINT, SignalHandler);
     
     // Create server socket
@@ -418,19 +775,58 @@ int main(int argc, char* argv[]) {
     
     std::cout << "Master listening on port " << port << "...\n";
     
+    // Backups connect once this node is listening: one too far behind resyncs by pulling a
+    // state transfer from the client port, and catch-up replays what was written meanwhile
+    std::thread backup_connector;
+    if (replication_manager) {
+        backup_connector = std::thread([&backups]() {
+            for (const auto& backup : backups) {
+                std::cout << "Replication target: " << backup.first << ":" << backup.second << "\n";
+                replication_manager->add_backup(backup.first, backup.second);
+            }
+            
+            // Start heartbeat monitoring on a separate control connection per backup
+            replication_manager->start_heartbeat();
+        });
+    }
+    
     int client_counter = 0;
     
-    // Accept connections
+    // Accept connections, one thread each up to the connection limit. Past it the accept
+    // waits and new connections queue in the listen backlog
     while (server_running) {
+        if (!admission.open_connection(CONNECTION_SLOT_WAIT_MS)) {
+            continue;
+        }
         Socket* client = server_socket.Accept();
         
         if (client && client->IsValid()) {
             int client_id = client_counter++;
             std::thread(HandleClient, client, client_id).detach();
+        } else {
+            delete client;
+            admission.close_connection();
         }
     }
     
+    // Published writes are logged before the snapshot is taken
+    write_sequencer.stop();
+    std::cout << "[SEQUENCER] " << write_sequencer.write_count() << " writes in "
+              << write_sequencer.round_count() << " rounds\n";
+    std::cout << "[ADMISSION] " << admission.admitted_count() << " writes admitted, "
+              << admission.shed_count() << " shed as BUSY\n";
+    
+    // Snapshot for a fast restart
+    if (task_manager.save_snapshot(snapshot_path, state_machine.get_log())) {
+        std::cout << "[SNAPSHOT] Wrote " << task_manager.get_task_count() << " tasks to " << snapshot_path << "\n";
+    } else {
+        std::cerr << "[SNAPSHOT] Failed to write " << snapshot_path << "\n";
+    }
+    
     // Cleanup
+    if (backup_connector.joinable()) {
+        backup_connector.join();
+    }
     if (replication_manager) {
         delete replication_manager;
     }
@@ -1,4 +1,5 @@
 #include "messages.h"
+#include "json_writer.h"
 #include <cstring>
 #include <arpa/inet.h>
 #include <chrono>
@@ -185,6 +186,11 @@ VectorClock &Task::get_clock()
     return vclock;
 }
 
+std::string Task::get_rank() const
+{
+    return rank;
+}
+
 void Task::set_task_id(int id)
 {
     task_id = id;
@@ -225,185 +231,166 @@ void Task::set_updated_at(long long timestamp)
     this->updated_at = timestamp;
 }
 
-// Task marshalling here task_id + description_len + description + column + client_id + vclock_size + vclock_data
-// Task marshalling with all fields
-int Task::Size() const
+void Task::set_rank(std::string rank)
 {
-    int size = sizeof(int) * 3; // task_id, column, client_id
-    size += sizeof(long long) * 2; // created_at, updated_at (8 bytes each)
-    size += sizeof(int) + title.length(); // title_len + title
-    size += sizeof(int) + description.length(); // description_len + description
-    size += sizeof(int) + board_id.length(); // board_id_len + board_id
-    size += sizeof(int) + created_by.length(); // created_by_len + created_by
-    size += sizeof(int); // vclock_size
-    size += vclock.get_clock().size() * sizeof(int) * 2; // each entry: process_id + count
-    return size;
+    this->rank = rank;
 }
 
-void Task::Marshal(char *buffer) const
-{
-    int offset = 0;
-    
-    // task_id
-    int net_task_id = htonl(task_id);
-    memcpy(buffer + offset, &net_task_id, sizeof(int));
-    offset += sizeof(int);
-    
-    // title
-    int title_len = title.length();
-    int net_title_len = htonl(title_len);
-    memcpy(buffer + offset, &net_title_len, sizeof(int));
-    offset += sizeof(int);
-    memcpy(buffer + offset, title.c_str(), title_len);
-    offset += title_len;
-    
-    // description
-    int desc_len = description.length();
-    int net_desc_len = htonl(desc_len);
-    memcpy(buffer + offset, &net_desc_len, sizeof(int));
-    offset += sizeof(int);
-    memcpy(buffer + offset, description.c_str(), desc_len);
-    offset += desc_len;
-    
-    // board_id
-    int board_id_len = board_id.length();
-    int net_board_id_len = htonl(board_id_len);
-    memcpy(buffer + offset, &net_board_id_len, sizeof(int));
-    offset += sizeof(int);
-    memcpy(buffer + offset, board_id.c_str(), board_id_len);
-    offset += board_id_len;
-    
-    // created_by
-    int created_by_len = created_by.length();
-    int net_created_by_len = htonl(created_by_len);
-    memcpy(buffer + offset, &net_created_by_len, sizeof(int));
-    offset += sizeof(int);
-    memcpy(buffer + offset, created_by.c_str(), created_by_len);
-    offset += created_by_len;
-    
-    // column
-    int net_column = htonl(static_cast<int>(column));
-    memcpy(buffer + offset, &net_column, sizeof(int));
-    offset += sizeof(int);
-    
-    // client_id
-    int net_client_id = htonl(client_id);
-    memcpy(buffer + offset, &net_client_id, sizeof(int));
-    offset += sizeof(int);
-    
-    // created_at (8 bytes)
-    long long net_created_at = htonll(created_at);
-    memcpy(buffer + offset, &net_created_at, sizeof(long long));
-    offset += sizeof(long long);
-    
-    // updated_at (8 bytes)
-    long long net_updated_at = htonll(updated_at);
-    memcpy(buffer + offset, &net_updated_at, sizeof(long long));
-    offset += sizeof(long long);
-    
-    // vector clock
-    const auto& clock_map = vclock.get_clock();
-    int clock_size = clock_map.size();
-    int net_clock_size = htonl(clock_size);
-    memcpy(buffer + offset, &net_clock_size, sizeof(int));
-    offset += sizeof(int);
-    
-    for (const auto& pair : clock_map) {
-        int net_pid = htonl(pair.first);
-        int net_count = htonl(pair.second);
-        memcpy(buffer + offset, &net_pid, sizeof(int));
-        offset += sizeof(int);
-        memcpy(buffer + offset, &net_count, sizeof(int));
-        offset += sizeof(int);
+/* Wire Schemas */
+
+template <>
+struct WireEnumLast<Column> {
+    static const Column VALUE = Column::DONE;
+};
+
+template <>
+struct WireEnumLast<OpType> {
+    static const OpType VALUE = OpType::GET_BOARD_JSON;
+};
+
+// Vector clock: entry count, then process_id + count per entry. WIRE_V2 sends each process_id
+// as the gap from the one before (the map keeps them sorted), so small clocks are 1 byte a field
+template <>
+struct WireCodec<VectorClock> {
+    static const size_t FIXED = sizeof(uint32_t);
+    static size_t extra(const VectorClock& value) { return value.get_clock().size() * sizeof(uint32_t) * 2; }
+    static void write(const VectorClock& value, WireWriter& out) {
+        const std::map<int, int>& clock_map = value.get_clock();
+        out.put32(static_cast<uint32_t>(clock_map.size()));
+        for (const auto& pair : clock_map) {
+            out.put32(static_cast<uint32_t>(pair.first));
+            out.put32(static_cast<uint32_t>(pair.second));
+        }
+    }
+    static bool read(VectorClock& value, WireReader& in, size_t reserved) {
+        uint32_t count = in.get32();
+        if (count > (in.remaining() - reserved) / (sizeof(uint32_t) * 2)) {
+            return false;
+        }
+        value.clear();  // Drop stale entries, the wire has the whole clock
+        for (uint32_t i = 0; i < count; i++) {
+            int pid = static_cast<int>(in.get32());
+            value.set(pid, static_cast<int>(in.get32()));
+        }
+        return true;
+    }
+
+    static size_t compact_size(const VectorClock& value) {
+        const std::map<int, int>& clock_map = value.get_clock();
+        size_t size = VarintSize(clock_map.size());
+        int previous = 0;
+        for (const auto& pair : clock_map) {
+            size += VarintSize(ZigZag(static_cast<int64_t>(pair.first) - previous));
+            size += VarintSize(ZigZag(pair.second));
+            previous = pair.first;
+        }
+        return size;
+    }
+    static void write_compact(const VectorClock& value, WireWriter& out) {
+        const std::map<int, int>& clock_map = value.get_clock();
+        out.put_varint(clock_map.size());
+        int previous = 0;
+        for (const auto& pair : clock_map) {
+            out.put_varint(ZigZag(static_cast<int64_t>(pair.first) - previous));
+            out.put_varint(ZigZag(pair.second));
+            previous = pair.first;
+        }
     }
+    static bool read_compact(VectorClock& value, WireReader& in) {
+        uint64_t count;
+        if (!in.get_varint(count) || count > in.remaining() / 2) {
+            return false;
+        }
+        value.clear();
+        int64_t pid = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            int64_t gap;
+            int count_value;
+            if (!in.get_zigzag(gap) || !WireCodec<int>::read_compact(count_value, in)) {
+                return false;
+            }
+            pid += gap;
+            if (pid < INT32_MIN || pid > INT32_MAX) {
+                return false;
+            }
+            value.set(static_cast<int>(pid), count_value);
+        }
+        return true;
+    }
+};
+
+// Task: task_id + title + description + board_id + created_by + column + client_id +
+// created_at + updated_at + vclock + rank
+struct Task::Wire {
+    typedef WireSchema<Task,
+        WIRE_FIELD(Task, task_id),
+        WIRE_FIELD(Task, title),
+        WIRE_FIELD(Task, description),
+        WIRE_FIELD(Task, board_id),
+        WIRE_FIELD(Task, created_by),
+        WIRE_FIELD(Task, column),
+        WIRE_FIELD(Task, client_id),
+        WIRE_FIELD(Task, created_at),
+        WIRE_FIELD(Task, updated_at),
+        WIRE_FIELD(Task, vclock),
+        WIRE_FIELD(Task, rank)> Schema;
+};
+
+int Task::Size(int version) const
+{
+    return static_cast<int>(Wire::Schema::Size(*this, version));
 }
 
-void Task::Unmarshal(const char *buffer)
+size_t Task::Marshal(std::vector<char> &out, int version) const
 {
-    int offset = 0;
-    
-    // task_id
-    int net_task_id;
-    memcpy(&net_task_id, buffer + offset, sizeof(int));
-    task_id = ntohl(net_task_id);
-    offset += sizeof(int);
-    
-    // title
-    int net_title_len;
-    memcpy(&net_title_len, buffer + offset, sizeof(int));
-    int title_len = ntohl(net_title_len);
-    offset += sizeof(int);
-    title.assign(buffer + offset, title_len);
-    offset += title_len;
-    
-    // description
-    int net_desc_len;
-    memcpy(&net_desc_len, buffer + offset, sizeof(int));
-    int desc_len = ntohl(net_desc_len);
-    offset += sizeof(int);
-    description.assign(buffer + offset, desc_len);
-    offset += desc_len;
-    
-    // board_id
-    int net_board_id_len;
-    memcpy(&net_board_id_len, buffer + offset, sizeof(int));
-    int board_id_len = ntohl(net_board_id_len);
-    offset += sizeof(int);
-    board_id.assign(buffer + offset, board_id_len);
-    offset += board_id_len;
-    
-    // created_by
-    int net_created_by_len;
-    memcpy(&net_created_by_len, buffer + offset, sizeof(int));
-    int created_by_len = ntohl(net_created_by_len);
-    offset += sizeof(int);
-    created_by.assign(buffer + offset, created_by_len);
-    offset += created_by_len;
-    
-    // column
-    int net_column;
-    memcpy(&net_column, buffer + offset, sizeof(int));
-    column = static_cast<Column>(ntohl(net_column));
-    offset += sizeof(int);
-    
-    // client_id
-    int net_client_id;
-    memcpy(&net_client_id, buffer + offset, sizeof(int));
-    client_id = ntohl(net_client_id);
-    offset += sizeof(int);
-    
-    // created_at (8 bytes)
-    long long net_created_at;
-    memcpy(&net_created_at, buffer + offset, sizeof(long long));
-    created_at = ntohll(net_created_at);
-    offset += sizeof(long long);
-    
-    // updated_at (8 bytes)
-    long long net_updated_at;
-    memcpy(&net_updated_at, buffer + offset, sizeof(long long));
-    updated_at = ntohll(net_updated_at);
-    offset += sizeof(long long);
-    
-    // vector clock, here we clear stale entries then reconstruct using set() method
-    vclock.clear();
-    int net_clock_size;
-    memcpy(&net_clock_size, buffer + offset, sizeof(int));
-    int clock_size = ntohl(net_clock_size);
-    offset += sizeof(int);
-    
-    for (int i = 0; i < clock_size; i++) {
-        int net_pid, net_count;
-        memcpy(&net_pid, buffer + offset, sizeof(int));
-        int pid = ntohl(net_pid);
-        offset += sizeof(int);
-        memcpy(&net_count, buffer + offset, sizeof(int));
-        int count = ntohl(net_count);
-        offset += sizeof(int);
-        vclock.set(pid, count);  // Actually restore the vector clock entry
+    return Wire::Schema::Encode(*this, out, version);
+}
+
+void Task::Marshal(char *buffer, int version) const
+{
+    std::vector<char> out;
+    Marshal(out, version);
+    memcpy(buffer, out.data(), out.size());
+}
+
+bool Task::Unmarshal(const char *buffer, int size, int version)
+{
+    return size >= 0 && Wire::Schema::Decode(*this, buffer, static_cast<size_t>(size), version);
+}
+
+// Same fields and names as the gateway's own task objects
+void Task::ToJson(JsonWriter &json) const
+{
+    json.begin_object();
+    json.key("task_id");
+    json.number(task_id);
+    json.key("board_id");
+    json.string(board_id);
+    json.key("title");
+    json.string(title);
+    json.key("description");
+    json.string(description);
+    json.key("column");
+    json.number(static_cast<int>(column));
+    json.key("created_by");
+    json.string(created_by);
+    json.key("vector_clock");
+    json.begin_object();
+    for (const auto &pair : vclock.get_clock()) {
+        json.key(pair.first);
+        json.number(pair.second);
     }
+    json.end_object();
+    json.key("created_at");
+    json.number(created_at);
+    json.key("updated_at");
+    json.number(updated_at);
+    json.key("rank");
+    json.string(rank);
+    json.end_object();
 }
 
-LogEntry::LogEntry(int id, OpType type, VectorClock vc, int tid, std::string title, std::string desc, std::string created_by, Column col, int cid) : entry_id(id), op_type(type), timestamp(vc), task_id(tid), title(title), description(desc), created_by(created_by), column(col), client_id(cid)
+LogEntry::LogEntry(int id, OpType type, VectorClock vc, int tid, std::string title, std::string desc, std::string created_by, Column col, int cid, std::string rank) : entry_id(id), op_type(type), timestamp(vc), task_id(tid), title(title), description(desc), created_by(created_by), column(col), client_id(cid), rank(rank)
 {
 }
 
@@ -452,55 +439,86 @@ int LogEntry::get_client_id() const
     return client_id;
 }
 
-// LogEntry marshalling
-int LogEntry::Size() const
+std::string LogEntry::get_rank() const
 {
-    int size = sizeof(int) * 4; // entry_id, op_type, task_id, client_id
-    size += sizeof(int) + title.length(); // title_len + title
-    size += sizeof(int) + description.length(); // description_len + description
-    size += sizeof(int) + created_by.length(); // created_by_len + created_by
-    size += sizeof(int); // column
-    size += sizeof(int); // vclock_size
-    size += timestamp.get_clock().size() * sizeof(int) * 2; // vclock data
-    return size;
+    return rank;
 }
 
-void LogEntry::Marshal(char *buffer) const
+// LogEntry: entry_id + op_type + task_id + title + description + created_by + column +
+// client_id + timestamp + rank
+struct LogEntry::Wire {
+    typedef WireSchema<LogEntry,
+        WIRE_FIELD(LogEntry, entry_id),
+        WIRE_FIELD(LogEntry, op_type),
+        WIRE_FIELD(LogEntry, task_id),
+        WIRE_FIELD(LogEntry, title),
+        WIRE_FIELD(LogEntry, description),
+        WIRE_FIELD(LogEntry, created_by),
+        WIRE_FIELD(LogEntry, column),
+        WIRE_FIELD(LogEntry, client_id),
+        WIRE_FIELD(LogEntry, timestamp),
+        WIRE_FIELD(LogEntry, rank)> Schema;
+};
+
+int LogEntry::Size(int version) const
 {
-    int offset = 0;
-    
-    // entry_id
-    int net_entry_id = htonl(entry_id);
-    memcpy(buffer + offset, &net_entry_id, sizeof(int));
-    offset += sizeof(int);
-    
-    // op_type
-    int net_op_type = htonl(static_cast<int>(op_type));
-    memcpy(buffer + offset, &net_op_type, sizeof(int));
-    offset += sizeof(int);
-    
-    // task_id
+    return static_cast<int>(Wire::Schema::Size(*this, version));
+}
+
+size_t LogEntry::Marshal(std::vector<char> &out, int version) const
+{
+    return Wire::Schema::Encode(*this, out, version);
+}
+
+void LogEntry::Marshal(char *buffer, int version) const
+{
+    std::vector<char> out;
+    Marshal(out, version);
+    memcpy(buffer, out.data(), out.size());
+}
+
+bool LogEntry::Unmarshal(const char *buffer, int size, int version)
+{
+    return size >= 0 && Wire::Schema::Decode(*this, buffer, static_cast<size_t>(size), version);
+}
+
+/* Query Methods */
+
+// Cursor: updated_at (8 bytes) + task_id
+void QueryCursor::Marshal(char *buffer) const
+{
+    long long net_updated_at = htonll(updated_at);
+    memcpy(buffer, &net_updated_at, sizeof(long long));
     int net_task_id = htonl(task_id);
-    memcpy(buffer + offset, &net_task_id, sizeof(int));
-    offset += sizeof(int);
-    
-    // title
-    int title_len = title.length();
-    int net_title_len = htonl(title_len);
-    memcpy(buffer + offset, &net_title_len, sizeof(int));
-    offset += sizeof(int);
-    memcpy(buffer + offset, title.c_str(), title_len);
-    offset += title_len;
+    memcpy(buffer + sizeof(long long), &net_task_id, sizeof(int));
+}
+
+void QueryCursor::Unmarshal(const char *buffer)
+{
+    long long net_updated_at;
+    memcpy(&net_updated_at, buffer, sizeof(long long));
+    updated_at = ntohll(net_updated_at);
+    int net_task_id;
+    memcpy(&net_task_id, buffer + sizeof(long long), sizeof(int));
+    task_id = ntohl(net_task_id);
+}
+
+// Query: column + created_by_len + created_by + updated_since + sort + limit + cursor
+static const int QUERY_FIXED_SIZE = sizeof(int) * 4 + sizeof(long long) + QueryCursor::SIZE;
+
+int TaskQuery::Size() const
+{
+    return QUERY_FIXED_SIZE + created_by.length();
+}
+
+void TaskQuery::Marshal(char *buffer) const
+{
+    int offset = 0;
     
-    // description
-    int desc_len = description.length();
-    int net_desc_len = htonl(desc_len);
-    memcpy(buffer + offset, &net_desc_len, sizeof(int));
+    int net_column = htonl(column);
+    memcpy(buffer + offset, &net_column, sizeof(int));
     offset += sizeof(int);
-    memcpy(buffer + offset, description.c_str(), desc_len);
-    offset += desc_len;
     
-    // created_by
     int created_by_len = created_by.length();
     int net_created_by_len = htonl(created_by_len);
     memcpy(buffer + offset, &net_created_by_len, sizeof(int));
@@ -508,106 +526,64 @@ void LogEntry::Marshal(char *buffer) const
     memcpy(buffer + offset, created_by.c_str(), created_by_len);
     offset += created_by_len;
     
-    // column
-    int net_column = htonl(static_cast<int>(column));
-    memcpy(buffer + offset, &net_column, sizeof(int));
-    offset += sizeof(int);
+    long long net_updated_since = htonll(updated_since);
+    memcpy(buffer + offset, &net_updated_since, sizeof(long long));
+    offset += sizeof(long long);
     
-    // client_id
-    int net_client_id = htonl(client_id);
-    memcpy(buffer + offset, &net_client_id, sizeof(int));
+    int net_sort = htonl(static_cast<int>(sort));
+    memcpy(buffer + offset, &net_sort, sizeof(int));
     offset += sizeof(int);
     
-    // timestamp vector clock
-    const auto& clock_map = timestamp.get_clock();
-    int clock_size = clock_map.size();
-    int net_clock_size = htonl(clock_size);
-    memcpy(buffer + offset, &net_clock_size, sizeof(int));
+    int net_limit = htonl(limit);
+    memcpy(buffer + offset, &net_limit, sizeof(int));
     offset += sizeof(int);
     
-    for (const auto& pair : clock_map) {
-        int net_pid = htonl(pair.first);
-        int net_count = htonl(pair.second);
-        memcpy(buffer + offset, &net_pid, sizeof(int));
-        offset += sizeof(int);
-        memcpy(buffer + offset, &net_count, sizeof(int));
-        offset += sizeof(int);
-    }
+    after.Marshal(buffer + offset);
 }
 
-void LogEntry::Unmarshal(const char *buffer)
+// The request comes straight from a client, so the string length is checked against the
+// bytes actually received
+bool TaskQuery::Unmarshal(const char *buffer, int size)
 {
     int offset = 0;
+    if (size < QUERY_FIXED_SIZE) {
+        return false;
+    }
     
-    // entry_id
-    int net_entry_id;
-    memcpy(&net_entry_id, buffer + offset, sizeof(int));
-    entry_id = ntohl(net_entry_id);
-    offset += sizeof(int);
-    
-    // op_type
-    int net_op_type;
-    memcpy(&net_op_type, buffer + offset, sizeof(int));
-    op_type = static_cast<OpType>(ntohl(net_op_type));
-    offset += sizeof(int);
-    
-    // task_id
-    int net_task_id;
-    memcpy(&net_task_id, buffer + offset, sizeof(int));
-    task_id = ntohl(net_task_id);
-    offset += sizeof(int);
-    
-    // title
-    int net_title_len;
-    memcpy(&net_title_len, buffer + offset, sizeof(int));
-    int title_len = ntohl(net_title_len);
-    offset += sizeof(int);
-    title.assign(buffer + offset, title_len);
-    offset += title_len;
-    
-    // description
-    int net_desc_len;
-    memcpy(&net_desc_len, buffer + offset, sizeof(int));
-    int desc_len = ntohl(net_desc_len);
+    int net_column;
+    memcpy(&net_column, buffer + offset, sizeof(int));
+    column = ntohl(net_column);
     offset += sizeof(int);
-    description.assign(buffer + offset, desc_len);
-    offset += desc_len;
     
-    // created_by
     int net_created_by_len;
     memcpy(&net_created_by_len, buffer + offset, sizeof(int));
     int created_by_len = ntohl(net_created_by_len);
     offset += sizeof(int);
+    if (created_by_len != size - QUERY_FIXED_SIZE) {
+        return false;
+    }
     created_by.assign(buffer + offset, created_by_len);
     offset += created_by_len;
     
-    // column
-    int net_column;
-    memcpy(&net_column, buffer + offset, sizeof(int));
-    column = static_cast<Column>(ntohl(net_column));
-    offset += sizeof(int);
+    long long net_updated_since;
+    memcpy(&net_updated_since, buffer + offset, sizeof(long long));
+    updated_since = ntohll(net_updated_since);
+    offset += sizeof(long long);
     
-    // client_id
-    int net_client_id;
-    memcpy(&net_client_id, buffer + offset, sizeof(int));
-    client_id = ntohl(net_client_id);
+    int net_sort;
+    memcpy(&net_sort, buffer + offset, sizeof(int));
+    int sort_value = ntohl(net_sort);
     offset += sizeof(int);
+    if (sort_value < static_cast<int>(QuerySort::BY_ID) || sort_value > static_cast<int>(QuerySort::UPDATED_DESC)) {
+        return false;
+    }
+    sort = static_cast<QuerySort>(sort_value);
     
-    // Clear stale entries then restore vector clock using set() method
-    timestamp.clear();
-    int net_clock_size;
-    memcpy(&net_clock_size, buffer + offset, sizeof(int));
-    int clock_size = ntohl(net_clock_size);
+    int net_limit;
+    memcpy(&net_limit, buffer + offset, sizeof(int));
+    limit = ntohl(net_limit);
     offset += sizeof(int);
     
-    for (int i = 0; i < clock_size; i++) {
-        int net_pid, net_count;
-        memcpy(&net_pid, buffer + offset, sizeof(int));
-        int pid = ntohl(net_pid);
-        offset += sizeof(int);
-        memcpy(&net_count, buffer + offset, sizeof(int));
-        int count = ntohl(net_count);
-        offset += sizeof(int);
-        timestamp.set(pid, count);
-    }
-}
\ No newline at end of file
+    after.Unmarshal(buffer + offset);
+    return true;
+}
@@ -3,6 +3,10 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include "wire_schema.h"
+
+class JsonWriter;
 
 enum class OpType
 {
@@ -15,10 +19,23 @@ enum class OpType
     HEARTBEAT_ACK,
     // Master rejoin protocol
     MASTER_REJOIN, // Master announces it's rejoining
-    STATE_TRANSFER_REQUEST, // Request full state from promoted backup
+    STATE_TRANSFER_REQUEST, // Request full state from promoted backup, or on replication: pull it from the master
     STATE_TRANSFER_RESPONSE, // Backup sends state to master
     DEMOTE_ACK, // Backup acknowledges demotion
-    REPLICATION_INIT         // Replication Handshake, Master identifies itself when connecting for replication
+    REPLICATION_INIT,        // Replication Handshake, Master identifies itself, the backup answers with its last entry_id
+    GET_BOARD_SINCE,         // Delta sync, only tasks changed (and deleted) after a board version
+    SUBSCRIBE,               // Change feed, streams committed log entries after an entry_id
+    BATCH,                   // Many writes applied, logged and replicated as one unit
+    IMPORT_TASKS,            // Bulk import, a task list installed under one lock and replicated as one unit
+    FOLLOWER_READ,           // Read-only GET_BOARD/GET_TASK a standby backup may serve, bounded by an entry_id
+    CONTROL_INIT,            // Opens the master's heartbeat-only control connection to a backup
+    COMPRESSION_HELLO,       // Offers codecs for the rest of the connection, the answer picks one (or none)
+    LEADER_QUERY,            // Asks a node for its role, epoch and last entry_id, for routing
+    QUERY,                   // One page of the tasks matching filters, in a sort order, from a cursor
+    SEARCH,                  // Task ids whose title or description match a text query, best first
+    REORDER_TASK,            // Places a task in a column right below another task, only its rank changes
+    WIRE_HELLO,              // Offers the newest wire encoding it speaks, the answer picks the one to use
+    GET_BOARD_JSON           // One board rendered as JSON, for the gateway to pass through unparsed
 };
 
 // Response status for operations
@@ -27,10 +44,28 @@ struct OperationResponse {
     bool conflict;           // True if concurrent operation detected
     bool rejected;          // True if operation rejected due to outdated vector clock
     int updated_task_id;    // ID of task that was updated
+    int entry_id;           // Log entry that committed the write, -1 if none (demand it in a FOLLOWER_READ)
+    bool busy;              // Shed by admission control before it was applied, send it again later
+    int retry_after_ms;     // With busy, when the master expects to have room
+    bool unconfirmed;       // Applied, but the backup quorum didn't ack it: it holds unless the master
+                            // fails before a backup catches up. Not a failure, don't send it again
     
-    OperationResponse() : success(false), conflict(false), rejected(false), updated_task_id(-1) {}
+    OperationResponse() : success(false), conflict(false), rejected(false), updated_task_id(-1), entry_id(-1),
+                          busy(false), retry_after_ms(0), unconfirmed(false) {}
 };
 
+// WIRE_V2 sends an OperationResponse as one byte of these flags, then task_id, entry_id
+// and retry_after_ms. WIRE_V1 has no slot of its own for unconfirmed, it sends
+// RESPONSE_STATUS_UNCONFIRMED in the busy slot (an older reader sees "not busy")
+const uint8_t RESPONSE_SUCCESS = 1;
+const uint8_t RESPONSE_CONFLICT = 2;
+const uint8_t RESPONSE_REJECTED = 4;
+const uint8_t RESPONSE_BUSY = 8;
+const uint8_t RESPONSE_UNCONFIRMED = 16;
+const int RESPONSE_STATUS_BUSY = 1;
+const int RESPONSE_STATUS_UNCONFIRMED = 2;
+const int COMPACT_RESPONSE_SIZE = 1 + sizeof(int) * 3;
+
 enum class Column
 {
     TODO,
@@ -68,6 +103,9 @@ private:
     long long created_at;
     long long updated_at;
     VectorClock vclock;
+    std::string rank;        // Position within its column, see RankBetween in task_manager.h
+
+    struct Wire;             // Field schema, messages.cpp
 
 public:
     Task();
@@ -84,6 +122,7 @@ public:
     long long get_created_at() const;
     long long get_updated_at() const;
     VectorClock &get_clock();
+    std::string get_rank() const;
 
     void set_task_id(int id);
     void set_title(std::string title);
@@ -93,13 +132,92 @@ public:
     void set_column(Column column);
     void set_client_id(int id);
     void set_updated_at(long long timestamp);
+    void set_rank(std::string rank);
 
-    // Marshalling
-    int Size() const;
+    // Marshalling, in either wire encoding (wire_schema.h). Marshal(out) appends the record to
+    // out in one pass and returns its size; Size alone is for when only that is needed
+    int Size(int version = WIRE_V1) const;
+    size_t Marshal(std::vector<char> &out, int version = WIRE_V1) const;
+    void Marshal(char *buffer, int version = WIRE_V1) const;  // Size(version) bytes
+    bool Unmarshal(const char *buffer, int size, int version = WIRE_V1);  // False unless the fields fill exactly size bytes
+
+    // The object the gateway serves for a task (GET_BOARD_JSON)
+    void ToJson(JsonWriter &json) const;
+};
+
+// Changes to the board after a given version (GET_BOARD_SINCE response)
+struct BoardDelta {
+    int origin;                 // Identifies the version history, a client holding another origin must resync
+    int version;                // Board version the delta brings the client up to
+    bool full_sync;             // True if tasks is the whole board (history too old or unknown)
+    std::vector<Task> tasks;    // Tasks created or modified after the requested version
+    std::vector<int> deleted_task_ids;
+    
+    BoardDelta() : origin(0), version(0), full_sync(false) {}
+};
+
+// QUERY sort orders. Pages are keyed by the last task returned, so a task that changes
+// between pages is seen at its new position (or not again) rather than shifting the rest
+enum class QuerySort
+{
+    BY_ID,
+    UPDATED_ASC,
+    UPDATED_DESC
+};
+
+// Where the next page starts: after this task in the query's sort order
+struct QueryCursor {
+    long long updated_at;       // Only used by the UPDATED sorts
+    int task_id;                // -1 starts from the beginning
+    
+    QueryCursor() : updated_at(0), task_id(-1) {}
+    QueryCursor(long long updated, int id) : updated_at(updated), task_id(id) {}
+    
+    static const int SIZE = sizeof(long long) + sizeof(int);
     void Marshal(char *buffer) const;
     void Unmarshal(const char *buffer);
 };
 
+// QUERY request. Filters left at their defaults match every task
+struct TaskQuery {
+    int column;                 // Column value, -1 for any
+    std::string created_by;     // Empty for any
+    long long updated_since;    // Tasks last changed at or after this time (ms), 0 for any
+    QuerySort sort;
+    int limit;                  // Tasks per page, clamped to MAX_QUERY_LIMIT
+    QueryCursor after;
+    
+    TaskQuery() : column(-1), updated_since(0), sort(QuerySort::BY_ID), limit(0) {}
+    
+    int Size() const;
+    void Marshal(char *buffer) const;
+    bool Unmarshal(const char *buffer, int size);  // False if the fields don't fit in size
+};
+
+// QUERY response. next is the cursor to pass for the following page
+struct TaskPage {
+    std::vector<Task> tasks;
+    bool has_more;
+    QueryCursor next;
+    
+    TaskPage() : has_more(false) {}
+};
+
+// SEARCH response: the best hits and how many tasks matched in all
+struct SearchHit {
+    int task_id;
+    int score;
+    
+    SearchHit(int id, int s) : task_id(id), score(s) {}
+};
+
+struct SearchResults {
+    int total_matches;
+    std::vector<SearchHit> hits;
+    
+    SearchResults() : total_matches(0) {}
+};
+
 class LogEntry
 {
 private:
@@ -112,12 +230,16 @@ private:
     std::string title;       // For create
     std::string description; // For create/update
     std::string created_by;  // For create
-    Column column;           // For move/create
+    Column column;           // For move/create/reorder
     int client_id;           // For create
+    std::string rank;        // For move/create/reorder, where the task was placed in its column
+
+    struct Wire;             // Field schema, messages.cpp
 
 public:
     LogEntry(int id, OpType type, VectorClock vc,
-             int tid, std::string title, std::string desc, std::string created_by, Column col, int cid);
+             int tid, std::string title, std::string desc, std::string created_by, Column col, int cid,
+             std::string rank = "");
 
     // Getters
     int get_entry_id() const;
@@ -130,11 +252,89 @@ public:
     std::string get_created_by() const;
     Column get_column() const;
     int get_client_id() const;
+    std::string get_rank() const;
 
-    // Marshalling
-    int Size() const;
-    void Marshal(char *buffer) const;
-    void Unmarshal(const char *buffer);
+    // Marshalling, in either wire encoding (wire_schema.h). Marshal(out) appends the record to
+    // out in one pass and returns its size; Size alone is for when only that is needed
+    int Size(int version = WIRE_V1) const;
+    size_t Marshal(std::vector<char> &out, int version = WIRE_V1) const;
+    void Marshal(char *buffer, int version = WIRE_V1) const;  // Size(version) bytes
+    bool Unmarshal(const char *buffer, int size, int version = WIRE_V1);  // False unless the fields fill exactly size bytes
+};
+
+// FOLLOWER_READ response. A node behind the requested entry_id answers fresh = false
+// and no tasks, the client then reads from the master instead
+struct FollowerReadResponse {
+    int applied_entry_id;       // Last log entry applied by the node that answered
+    bool fresh;                 // applied_entry_id reached the requested minimum
+    std::vector<Task> tasks;    // Whole board, or the one task asked for (empty if it doesn't exist)
+    
+    FollowerReadResponse() : applied_entry_id(-1), fresh(false) {}
+};
+
+// LEADER_QUERY response. A node bumps its epoch each time leadership moves (a backup
+// promotes, a rejoining master takes over), so of two nodes answering PRIMARY the one
+// with the higher epoch is the current leader
+enum class NodeRole
+{
+    STANDBY,
+    PRIMARY
+};
+
+struct LeaderInfo {
+    NodeRole role;
+    int epoch;
+    int last_entry_id;          // Last entry in the node's log
+    
+    LeaderInfo() : role(NodeRole::STANDBY), epoch(0), last_entry_id(-1) {}
+};
+
+// One committed change pushed to SUBSCRIBE clients: the log entry plus the task as it
+// stands after conflict resolution (absent once the task is deleted)
+struct ChangeEvent {
+    LogEntry entry;
+    bool has_task;
+    Task task;
+    
+    ChangeEvent(const LogEntry& e) : entry(e), has_task(false) {}
+};
+
+// Largest number of operations accepted in one BATCH request
+const int MAX_BATCH_OPERATIONS = 4096;
+
+// Largest task list accepted in one IMPORT_TASKS request
+const int MAX_IMPORT_TASKS = 65536;
+
+// Largest page a QUERY returns, and the page size when none is asked for
+const int MAX_QUERY_LIMIT = 1000;
+
+// Most hits a SEARCH returns, and the longest query text it accepts
+const int MAX_SEARCH_RESULTS = 100;
+const int MAX_SEARCH_QUERY_LENGTH = 1024;
+
+// Longest board id a GET_BOARD_JSON request may name
+const int MAX_BOARD_ID_LENGTH = 256;
+
+// Tasks or log entries per state transfer chunk
+const int STATE_TRANSFER_CHUNK_SIZE = 1024;
+
+// Appends record behind its size (an int, network order), as the stubs send it
+template <typename Record>
+void AppendSizePrefixed(std::vector<char> &out, const Record &record, int version)
+{
+    size_t at = out.size();
+    out.resize(at + sizeof(int));
+    int net_size = htonl(static_cast<int>(record.Marshal(out, version)));
+    memcpy(out.data() + at, &net_size, sizeof(int));
+}
+
+// One write inside a BATCH, the task carries the fields the single-op request would
+struct BatchOperation {
+    OpType op_type;
+    Task task;
+    
+    BatchOperation() : op_type(OpType::CREATE_TASK) {}
+    BatchOperation(OpType op, const Task& t) : op_type(op), task(t) {}
 };
 
-#endif
\ No newline at end of file
+#endif
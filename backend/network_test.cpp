@@ -8,10 +8,18 @@
 #include <chrono>
 #include <atomic>
 #include <cstring>
+#include <algorithm>
 #include <arpa/inet.h>
 #include "Socket.h"
+#include "compression.h"
 #include "ClientStub.h"
 #include "ServerStub.h"
+#include "change_feed.h"
+#include "state_transfer.h"
+#include "replication.h"
+#include "sequencer.h"
+#include "failure_detector.h"
+#include "task_manager.h"
 #include "messages.h"
 
 int tests_passed = 0;
@@ -201,8 +209,121 @@ TEST(test_socket_large_transfer) {
     ASSERT_EQ(received_data, large_data);
 }
 
+TEST(test_socket_timeouts) {
+    int port = get_test_port();
+    std::atomic<bool> done(false);
+    
+    // Nothing listening: refused at once, not after the kernel's TCP timeout
+    Socket refused;
+    ASSERT_TRUE(!refused.Connect("127.0.0.1", port, 500));
+    ASSERT_TRUE(!refused.IsValid());
+    
+    // A peer that accepts but never answers
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client = server.Accept();
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (client) {
+            client->Close();
+            delete client;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    Socket client;
+    ASSERT_TRUE(client.Connect("127.0.0.1", port, 500));
+    ASSERT_TRUE(client.SetTimeouts(100, 100));
+    
+    auto start = std::chrono::steady_clock::now();
+    int value;
+    bool received = client.Receive(&value, sizeof(value));
+    auto waited = std::chrono::steady_clock::now() - start;
+    
+    done = true;
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_TRUE(!received);
+    ASSERT_TRUE(waited < std::chrono::seconds(2));
+}
+
+TEST(test_reconnect_backoff) {
+    ReconnectBackoff backoff;
+    ASSERT_TRUE(backoff.due());
+    
+    // Doubles per failure up to the cap, and is not due while an attempt runs
+    backoff.in_flight = true;
+    ASSERT_TRUE(!backoff.due());
+    backoff.failed();
+    ASSERT_EQ(backoff.delay_ms, RECONNECT_MIN_DELAY_MS * 2);
+    ASSERT_TRUE(!backoff.due());
+    for (int i = 0; i < 20; i++) {
+        backoff.failed();
+    }
+    ASSERT_EQ(backoff.delay_ms, RECONNECT_MAX_DELAY_MS);
+    
+    // Success starts over
+    backoff.succeeded();
+    ASSERT_EQ(backoff.delay_ms, RECONNECT_MIN_DELAY_MS);
+}
+
 /* ============ Stub Communication Tests ============ */
 
+TEST(test_compression_codec) {
+    StreamCompressor compressor;
+    StreamDecompressor decompressor;
+    std::vector<char> frame;
+    std::vector<char> decoded;
+    size_t raw_total = 0;
+    size_t wire_total = 0;
+    
+    // Many small frames that repeat each other, as a stream of log entries does
+    VectorClock vc(1);
+    for (int i = 0; i < 200; i++) {
+        vc.increment();
+        LogEntry entry(i, OpType::UPDATE_TASK, vc, i % 7, "Quarterly report", "Collect numbers from every team",
+                       "alice", Column::IN_PROGRESS, 1);
+        std::vector<char> raw(entry.Size());
+        entry.Marshal(raw.data());
+        
+        bool compressed = compressor.Compress(raw.data(), raw.size(), frame);
+        const std::vector<char>& wire = compressed ? frame : raw;
+        ASSERT_TRUE(decompressor.Decompress(wire.data(), wire.size(), raw.size(), compressed, decoded));
+        ASSERT_TRUE(decoded == raw);
+        raw_total += raw.size();
+        wire_total += wire.size();
+    }
+    ASSERT_TRUE(wire_total * 3 < raw_total);
+    
+    // Incompressible frames go raw and still leave both histories in step
+    std::string noise;
+    unsigned int seed = 12345;
+    for (int i = 0; i < 5000; i++) {
+        seed = seed * 1103515245 + 12345;
+        noise.push_back(static_cast<char>(seed >> 16));
+    }
+    ASSERT_TRUE(!compressor.Compress(noise.data(), noise.size(), frame));
+    ASSERT_TRUE(decompressor.Decompress(noise.data(), noise.size(), noise.size(), false, decoded));
+    ASSERT_TRUE(std::string(decoded.begin(), decoded.end()) == noise);
+    
+    // A frame that repeats the noise reaches back across the frame boundary
+    ASSERT_TRUE(compressor.Compress(noise.data(), noise.size(), frame));
+    ASSERT_TRUE(frame.size() < 100);
+    ASSERT_TRUE(decompressor.Decompress(frame.data(), frame.size(), noise.size(), true, decoded));
+    ASSERT_TRUE(std::string(decoded.begin(), decoded.end()) == noise);
+    
+    // Malformed input is rejected, not read past
+    std::vector<char> bad(frame.begin(), frame.begin() + frame.size() / 2);
+    StreamDecompressor fresh;
+    ASSERT_TRUE(!fresh.Decompress(bad.data(), bad.size(), noise.size(), true, decoded));
+}
+
 TEST(test_stub_send_receive_task) {
     int port = get_test_port();
     Task received_task;
@@ -410,7 +531,7 @@ TEST(test_stub_success_response) {
 
 TEST(test_stub_operation_response) {
     int port = get_test_port();
-    int response_buffer[4];
+    int response_buffer[5];
     
     std::thread server_thread([&]() {
         Socket server;
@@ -427,6 +548,7 @@ TEST(test_stub_operation_response) {
             response.conflict = true;
             response.rejected = false;
             response.updated_task_id = 42;
+            response.entry_id = 7;
             
             stub.SendOperationResponse(response);
             stub.Close();
@@ -448,6 +570,998 @@ TEST(test_stub_operation_response) {
     ASSERT_EQ(ntohl(response_buffer[1]), 1);   // conflict
     ASSERT_EQ(ntohl(response_buffer[2]), 0);   // rejected
     ASSERT_EQ(ntohl(response_buffer[3]), 42);  // task_id
+    ASSERT_EQ(ntohl(response_buffer[4]), 7);   // entry_id
+}
+
+TEST(test_stub_board_delta) {
+    int port = get_test_port();
+    int received_origin = 0;
+    int received_since = 0;
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            
+            if (stub.ReceiveOpType() == OpType::GET_BOARD_SINCE) {
+                stub.ReceiveInt(received_origin);
+                stub.ReceiveInt(received_since);
+                
+                BoardDelta delta;
+                delta.origin = 77;
+                delta.version = 12;
+                delta.tasks.push_back(Task(4, "Changed", "Desc", "board", "user", Column::DONE, 1));
+                delta.deleted_task_ids.push_back(2);
+                delta.deleted_task_ids.push_back(9);
+                stub.SendBoardDelta(delta);
+            }
+            
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    ASSERT_TRUE(client.SendBoardSinceRequest(77, 10));
+    
+    BoardDelta delta;
+    ASSERT_TRUE(client.ReceiveBoardDelta(delta));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_EQ(received_origin, 77);
+    ASSERT_EQ(received_since, 10);
+    ASSERT_EQ(delta.version, 12);
+    ASSERT_TRUE(!delta.full_sync);
+    ASSERT_EQ(delta.tasks.size(), 1u);
+    ASSERT_EQ(delta.tasks[0].get_title(), "Changed");
+    ASSERT_EQ(delta.deleted_task_ids.size(), 2u);
+    ASSERT_EQ(delta.deleted_task_ids[1], 9);
+}
+
+TEST(test_stub_follower_read) {
+    int port = get_test_port();
+    int received_task_id = 0;
+    int received_min_entry = 0;
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            
+            if (stub.ReceiveOpType() == OpType::FOLLOWER_READ) {
+                stub.ReceiveInt(received_task_id);
+                stub.ReceiveInt(received_min_entry);
+                
+                FollowerReadResponse response;
+                response.applied_entry_id = 15;
+                response.fresh = true;
+                response.tasks.push_back(Task(6, "Read", "Desc", "board", "user", Column::IN_PROGRESS, 1));
+                stub.SendFollowerRead(response);
+            }
+            
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    ASSERT_TRUE(client.SendFollowerReadRequest(6, 12));
+    
+    FollowerReadResponse response;
+    ASSERT_TRUE(client.ReceiveFollowerRead(response));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_EQ(received_task_id, 6);
+    ASSERT_EQ(received_min_entry, 12);
+    ASSERT_EQ(response.applied_entry_id, 15);
+    ASSERT_TRUE(response.fresh);
+    ASSERT_EQ(response.tasks.size(), 1u);
+    ASSERT_EQ(response.tasks[0].get_title(), "Read");
+}
+
+TEST(test_stub_leader_query) {
+    int port = get_test_port();
+    OpType received_op = OpType::GET_BOARD;
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            received_op = stub.ReceiveOpType();
+            LeaderInfo info;
+            info.role = NodeRole::PRIMARY;
+            info.epoch = 3;
+            info.last_entry_id = 41;
+            stub.SendLeaderInfo(info);
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    LeaderInfo info;
+    ASSERT_TRUE(client.QueryLeader(info));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_TRUE(received_op == OpType::LEADER_QUERY);
+    ASSERT_TRUE(info.role == NodeRole::PRIMARY);
+    ASSERT_EQ(info.epoch, 3);
+    ASSERT_EQ(info.last_entry_id, 41);
+}
+
+TEST(test_stub_query) {
+    int port = get_test_port();
+    TaskQuery received;
+    bool parsed = false;
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            if (stub.ReceiveOpType() == OpType::QUERY) {
+                parsed = stub.ReceiveQuery(received);
+            }
+            TaskPage page;
+            page.tasks.push_back(Task(12, "Found", "", "board-1", "bob", Column::IN_PROGRESS, 1));
+            page.has_more = true;
+            page.next = QueryCursor(1700000000123LL, 12);
+            stub.SendTaskPage(page);
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    TaskQuery query;
+    query.column = static_cast<int>(Column::IN_PROGRESS);
+    query.created_by = "bob";
+    query.updated_since = 1600000000000LL;
+    query.sort = QuerySort::UPDATED_DESC;
+    query.limit = 25;
+    query.after = QueryCursor(1700000000999LL, 40);
+    ASSERT_TRUE(client.SendQuery(query));
+    TaskPage page;
+    ASSERT_TRUE(client.ReceiveTaskPage(page));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_TRUE(parsed);
+    ASSERT_EQ(received.column, static_cast<int>(Column::IN_PROGRESS));
+    ASSERT_EQ(received.created_by, std::string("bob"));
+    ASSERT_EQ(received.updated_since, 1600000000000LL);
+    ASSERT_TRUE(received.sort == QuerySort::UPDATED_DESC);
+    ASSERT_EQ(received.limit, 25);
+    ASSERT_EQ(received.after.updated_at, 1700000000999LL);
+    ASSERT_EQ(received.after.task_id, 40);
+    
+    ASSERT_EQ(page.tasks.size(), static_cast<size_t>(1));
+    ASSERT_EQ(page.tasks[0].get_title(), std::string("Found"));
+    ASSERT_TRUE(page.has_more);
+    ASSERT_EQ(page.next.updated_at, 1700000000123LL);
+    ASSERT_EQ(page.next.task_id, 12);
+    
+    // A created_by length that disagrees with the bytes sent is refused
+    std::vector<char> buffer(query.Size());
+    query.Marshal(buffer.data());
+    TaskQuery truncated;
+    ASSERT_TRUE(!truncated.Unmarshal(buffer.data(), static_cast<int>(buffer.size()) - 1));
+}
+
+TEST(test_stub_search) {
+    int port = get_test_port();
+    std::string received_query;
+    int received_limit = 0;
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            if (stub.ReceiveOpType() == OpType::SEARCH && stub.ReceiveSearch(received_query, received_limit)) {
+                SearchResults results;
+                results.total_matches = 7;
+                results.hits.push_back(SearchHit(4, 9));
+                results.hits.push_back(SearchHit(2, 3));
+                stub.SendSearchResults(results);
+            }
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    ASSERT_TRUE(client.SendSearch("deploy log", 2));
+    SearchResults results;
+    ASSERT_TRUE(client.ReceiveSearchResults(results));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_EQ(received_query, std::string("deploy log"));
+    ASSERT_EQ(received_limit, 2);
+    ASSERT_EQ(results.total_matches, 7);
+    ASSERT_EQ(results.hits.size(), static_cast<size_t>(2));
+    ASSERT_EQ(results.hits[0].task_id, 4);
+    ASSERT_EQ(results.hits[0].score, 9);
+    ASSERT_EQ(results.hits[1].task_id, 2);
+}
+
+TEST(test_stub_batch) {
+    int port = get_test_port();
+    std::vector<BatchOperation> received_ops;
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            
+            if (stub.ReceiveOpType() == OpType::BATCH && stub.ReceiveBatch(received_ops)) {
+                std::vector<OperationResponse> responses(received_ops.size());
+                for (size_t i = 0; i < responses.size(); i++) {
+                    responses[i].success = true;
+                    responses[i].updated_task_id = received_ops[i].task.get_task_id();
+                    responses[i].entry_id = 20 + static_cast<int>(i);
+                }
+                responses[1].conflict = true;
+                stub.SendOperationResponses(responses);
+            }
+            
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    std::vector<BatchOperation> ops;
+    ops.push_back(BatchOperation(OpType::MOVE_TASK, Task(3, "", "", "board", "user", Column::DONE, 1)));
+    ops.push_back(BatchOperation(OpType::UPDATE_TASK, Task(5, "Title", "Desc", "board", "user", Column::TODO, 1)));
+    ops.push_back(BatchOperation(OpType::DELETE_TASK, Task(8, "", "", "board", "user", Column::TODO, 1)));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    ASSERT_TRUE(client.SendBatch(ops));
+    
+    std::vector<OperationResponse> responses;
+    ASSERT_TRUE(client.ReceiveOperationResponses(responses));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_EQ(received_ops.size(), 3u);
+    ASSERT_EQ(received_ops[1].op_type, OpType::UPDATE_TASK);
+    ASSERT_EQ(received_ops[1].task.get_title(), "Title");
+    ASSERT_EQ(received_ops[2].task.get_task_id(), 8);
+    ASSERT_EQ(responses.size(), 3u);
+    ASSERT_TRUE(responses[0].success);
+    ASSERT_TRUE(responses[1].conflict);
+    ASSERT_EQ(responses[2].updated_task_id, 8);
+    ASSERT_EQ(responses[2].entry_id, 22);
+}
+
+TEST(test_change_feed_subscription) {
+    int port = get_test_port();
+    StateMachine sm;
+    TaskManager tm;
+    bool running = true;
+    VectorClock vc(1);
+    
+    // One entry committed before the subscriber attaches
+    tm.create_task_with_id(0, "Existing", "Desc", "board-1", "user", Column::TODO, 1);
+    sm.append_to_log(LogEntry(0, OpType::CREATE_TASK, vc, 0, "Existing", "Desc", "user", Column::TODO, 1));
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            int after_entry_id;
+            if (stub.ReceiveOpType() == OpType::SUBSCRIBE && stub.ReceiveInt(after_entry_id)) {
+                ServeChangeFeed(stub, sm, tm, after_entry_id, running);
+            }
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    ASSERT_TRUE(client.SendSubscribe(-1));
+    
+    // Backlog first
+    std::vector<ChangeEvent> events;
+    ASSERT_TRUE(client.ReceiveChangeEvents(events));
+    ASSERT_EQ(events.size(), 1u);
+    ASSERT_EQ(events[0].entry.get_entry_id(), 0);
+    ASSERT_TRUE(events[0].has_task);
+    ASSERT_EQ(events[0].task.get_title(), "Existing");
+    
+    // Then live changes, delivered with the task's resolved state
+    tm.delete_task(0);
+    sm.append_to_log(LogEntry(1, OpType::DELETE_TASK, vc, 0, "", "", "", Column::TODO, 1));
+    
+    do {
+        ASSERT_TRUE(client.ReceiveChangeEvents(events));
+    } while (events.empty());
+    ASSERT_EQ(events.size(), 1u);
+    ASSERT_EQ(events[0].entry.get_op_type(), OpType::DELETE_TASK);
+    ASSERT_TRUE(!events[0].has_task);
+    
+    running = false;
+    server_thread.join();
+    client.Close();
+}
+
+TEST(test_state_transfer_chunked) {
+    int port = get_test_port();
+    TaskManager source;
+    StateMachine source_log;
+    VectorClock vc(1);
+    
+    // Several chunks of tasks, each created and logged the way the master does
+    const int task_count = STATE_TRANSFER_CHUNK_SIZE * 2 + 100;
+    for (int i = 0; i < task_count; i++) {
+        source.create_task_with_id(i, "Task " + std::to_string(i), "", "board-1", "user", Column::TODO, 1);
+        source_log.append_to_log(LogEntry(i, OpType::CREATE_TASK, vc, i, "Task " + std::to_string(i), "", "user",
+                                          Column::TODO, 1));
+    }
+    
+    // Writes keep landing while the state streams out, applied then logged as the
+    // master's sequencer does, so every entry up to the cut is already in the tasks
+    std::atomic<bool> transferring(true);
+    std::atomic<int> writes(0);
+    std::thread writer([&]() {
+        int entry_id = task_count;
+        VectorClock clock(1);
+        while (transferring && writes < 20000) {
+            clock.increment();
+            int task_id = (writes * 7919) % task_count;
+            std::string title = "Edit " + std::to_string(writes);
+            source.update_task(task_id, title, "", clock);
+            source_log.append_to_log(LogEntry(entry_id++, OpType::UPDATE_TASK, clock, task_id, title, "", "",
+                                              Column::TODO, 1));
+            writes++;
+        }
+    });
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            StateTransferStats sent;
+            SendState(stub, source, source_log, sent);
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    TaskManager target;
+    StateMachine target_log;
+    StateTransferStats stats;
+    bool received = ReceiveState(client, target, target_log, stats);
+    transferring = false;
+    client.Close();
+    server_thread.join();
+    writer.join();
+    
+    ASSERT_TRUE(received);
+    ASSERT_EQ(target.get_task_count(), static_cast<size_t>(task_count));
+    ASSERT_EQ(target.get_id_counter(), task_count);
+    ASSERT_EQ(target_log.get_next_entry_id(), static_cast<int>(target_log.get_log_size()));
+    
+    // Whatever point the transfer ended at, replicating the entries after it brings the
+    // tasks level with the whole log (a task may already hold a write logged after the
+    // tail was read, reapplying it is rejected as old)
+    std::vector<LogEntry> rest = source_log.get_log_after(target_log.get_next_entry_id() - 1);
+    for (const LogEntry& entry : rest) {
+        StateMachine::apply_entry(target, entry);
+    }
+    target_log.append_batch_to_log(rest);
+    TaskManager replayed;
+    target_log.replay_log(replayed, target_log.get_log());
+    std::vector<Task> expected = replayed.get_all_tasks();
+    std::vector<Task> actual = target.get_all_tasks();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++) {
+        ASSERT_EQ(actual[i].get_task_id(), expected[i].get_task_id());
+        ASSERT_EQ(actual[i].get_title(), expected[i].get_title());
+    }
+}
+
+// Stand-in backup: accepts the wire and replication handshakes, reporting last_entry_id as
+// the end of its log, then acks each of entries messages after delay_ms. received counts
+// the log entries they carried
+static void FakeBackup(int port, int delay_ms, int entries, std::atomic<int>& received, int last_entry_id) {
+    Socket server;
+    server.Bind(port);
+    server.Listen();
+    Socket* client_socket = server.Accept();
+    
+    if (client_socket) {
+        ServerStub stub;
+        stub.Init(client_socket);
+        OpType first_op = stub.ReceiveOpType();
+        if (first_op == OpType::WIRE_HELLO && stub.AcceptWireVersion()) {
+            first_op = stub.ReceiveOpType();
+        }
+        if (first_op == OpType::REPLICATION_INIT) {
+            stub.SendSuccess(true);
+            stub.SendInt(last_entry_id);
+            for (int i = 0; i < entries; i++) {
+                OpType op = stub.ReceiveOpType();
+                std::vector<LogEntry> batch;
+                if (op == OpType::BATCH) {
+                    if (!stub.ReceiveLogEntryList(batch)) {
+                        break;
+                    }
+                } else if (static_cast<int>(op) == -1) {
+                    break;
+                } else {
+                    batch.push_back(stub.ReceiveLogEntry());
+                    if (batch.back().get_entry_id() < 0) {
+                        break;
+                    }
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+                received += static_cast<int>(batch.size());
+                stub.SendSuccess(true);
+            }
+        }
+        delete client_socket;
+    }
+    server.Close();
+}
+
+TEST(test_stub_compressed_exchange) {
+    int port = get_test_port();
+    std::vector<LogEntry> received;
+    bool server_compressed = false;
+    VectorClock vc(1);
+    std::vector<LogEntry> entries;
+    for (int i = 0; i < 3000; i++) {
+        vc.increment();
+        entries.push_back(LogEntry(i, OpType::MOVE_TASK, vc, i, "", "", "", Column::DONE, 1));
+    }
+    
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            if (stub.ReceiveOpType() == OpType::COMPRESSION_HELLO && stub.AcceptCompression()) {
+                server_compressed = client_socket->IsCompressed();
+                std::vector<LogEntry> chunk;
+                while (stub.ReceiveLogEntryList(chunk) && !chunk.empty()) {
+                    received.insert(received.end(), chunk.begin(), chunk.end());
+                }
+                stub.SendInt(static_cast<int>(received.size()));
+            }
+            stub.Close();
+            delete client_socket;
+        }
+        server.Close();
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    ClientStub client;
+    ASSERT_TRUE(client.Init("127.0.0.1", port));
+    ASSERT_TRUE(client.NegotiateCompression());
+    for (size_t i = 0; i < entries.size(); i += STATE_TRANSFER_CHUNK_SIZE) {
+        size_t end = std::min(entries.size(), i + STATE_TRANSFER_CHUNK_SIZE);
+        ASSERT_TRUE(client.SendLogEntryList(std::vector<LogEntry>(entries.begin() + i, entries.begin() + end)));
+    }
+    ASSERT_TRUE(client.SendLogEntryList(std::vector<LogEntry>()));
+    int count = -1;
+    ASSERT_TRUE(client.ReceiveInt(count));
+    client.Close();
+    server_thread.join();
+    
+    ASSERT_TRUE(server_compressed);
+    ASSERT_EQ(count, 3000);
+    ASSERT_EQ(received.size(), entries.size());
+    ASSERT_EQ(received.back().get_entry_id(), 2999);
+    ASSERT_TRUE(received.back().get_column() == Column::DONE);
+}
+
+TEST(test_stub_wire_version_exchange) {
+    int port = get_test_port();
+    int versions[2] = {0, 0};
+    std::vector<Task> received;
+    
+    // Echoes one task per connection, answering with an OperationResponse and a success flag
+    std::thread server_thread([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        for (int i = 0; i < 2; i++) {
+            Socket* client_socket = server.Accept();
+            if (!client_socket) {
+                break;
+            }
+            ServerStub stub;
+            stub.Init(client_socket);
+            OpType op = stub.ReceiveOpType();
+            if (op == OpType::WIRE_HELLO && stub.AcceptWireVersion()) {
+                op = stub.ReceiveOpType();
+            }
+            versions[i] = client_socket->GetWireVersion();
+            Task task = stub.ReceiveTask();
+            received.push_back(task);
+            OperationResponse response;
+            response.success = true;
+            response.rejected = true;
+            response.updated_task_id = task.get_task_id();
+            response.entry_id = 1 << 20;
+            response.busy = true;
+            response.retry_after_ms = 250;
+            stub.SendOperationResponse(response);
+            OperationResponse unconfirmed;
+            unconfirmed.success = true;
+            unconfirmed.unconfirmed = true;
+            stub.SendOperationResponse(unconfirmed);
+            stub.SendSuccess(true);
+            stub.SendTask(task);
+            delete client_socket;
+        }
+        server.Close();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    Task task(42, "Compact", "Desc", "board-1", "alice", Column::IN_PROGRESS, 3);
+    task.get_clock().increment();
+    task.set_rank("V");
+    for (int i = 0; i < 2; i++) {
+        ClientStub client;
+        ASSERT_TRUE(client.Init("127.0.0.1", port));
+        if (i == 0) {
+            ASSERT_TRUE(client.NegotiateWireVersion());
+        }
+        ASSERT_TRUE(client.SendOpType(OpType::UPDATE_TASK));
+        ASSERT_TRUE(client.SendTask(task));
+        OperationResponse response;
+        ASSERT_TRUE(client.ReceiveOperationResponse(response));
+        ASSERT_TRUE(response.success && response.rejected && !response.conflict);
+        ASSERT_EQ(response.updated_task_id, 42);
+        ASSERT_EQ(response.entry_id, 1 << 20);
+        ASSERT_TRUE(response.busy);
+        ASSERT_EQ(response.retry_after_ms, 250);
+        ASSERT_TRUE(!response.unconfirmed);
+        OperationResponse unconfirmed;
+        ASSERT_TRUE(client.ReceiveOperationResponse(unconfirmed));
+        ASSERT_TRUE(unconfirmed.success && unconfirmed.unconfirmed && !unconfirmed.busy);
+        ASSERT_TRUE(client.ReceiveSuccess());
+        Task echoed = client.ReceiveTask();
+        ASSERT_EQ(echoed.get_task_id(), 42);
+        ASSERT_EQ(echoed.get_rank(), "V");
+        ASSERT_EQ(echoed.get_clock().get(3), 1);
+        client.Close();
+    }
+    server_thread.join();
+    
+    // The client that didn't say hello stays on the old encoding
+    ASSERT_EQ(versions[0], WIRE_V2);
+    ASSERT_EQ(versions[1], WIRE_V1);
+    ASSERT_EQ(received.size(), 2u);
+    ASSERT_EQ(received[0].get_title(), "Compact");
+    ASSERT_TRUE(received[1].get_column() == Column::IN_PROGRESS);
+}
+
+TEST(test_replication_quorum_fan_out) {
+    int fast_port = get_test_port();
+    int slow_port = get_test_port();
+    std::atomic<int> fast_received(0);
+    std::atomic<int> slow_received(0);
+    
+    std::thread fast_backup(FakeBackup, fast_port, 0, 2, std::ref(fast_received), -1);
+    std::thread slow_backup(FakeBackup, slow_port, 300, 2, std::ref(slow_received), -1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    {
+        ReplicationManager manager(0);
+        manager.add_backup("127.0.0.1", fast_port);
+        manager.add_backup("127.0.0.1", slow_port);
+        ASSERT_TRUE(manager.has_backups());
+        
+        VectorClock vc(1);
+        
+        // Quorum of one returns on the fast backup's ack, the slow one is still working
+        manager.set_quorum(1);
+        ASSERT_TRUE(manager.replicate_entry(LogEntry(0, OpType::CREATE_TASK, vc, 0, "A", "", "user", Column::TODO, 1)));
+        ASSERT_EQ(fast_received.load(), 1);
+        ASSERT_EQ(slow_received.load(), 0);
+        
+        // Quorum of two waits for both, the slow backup still sees entries in order
+        manager.set_quorum(2);
+        ASSERT_TRUE(manager.replicate_entry(LogEntry(1, OpType::CREATE_TASK, vc, 1, "B", "", "user", Column::TODO, 1)));
+        ASSERT_EQ(fast_received.load(), 2);
+        ASSERT_EQ(slow_received.load(), 2);
+    }
+    
+    fast_backup.join();
+    slow_backup.join();
+}
+
+TEST(test_replication_catch_up_on_handshake) {
+    int port = get_test_port();
+    std::atomic<int> received(0);
+    
+    // The backup stopped at entry 1 of a log that has reached entry 4
+    StateMachine log;
+    VectorClock vc(1);
+    for (int i = 0; i < 5; i++) {
+        vc.increment();
+        log.append_to_log(LogEntry(i, OpType::CREATE_TASK, vc, i, "T", "", "user", Column::TODO, 1));
+    }
+    std::thread backup(FakeBackup, port, 0, 2, std::ref(received), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    {
+        ReplicationManager manager(0);
+        manager.set_log_source(&log);
+        manager.add_backup("127.0.0.1", port);
+        
+        // Entries 2 to 4 arrive in one BATCH before the backup takes writes again
+        ASSERT_TRUE(manager.has_backups());
+        ASSERT_EQ(received.load(), 3);
+        
+        vc.increment();
+        LogEntry next(5, OpType::CREATE_TASK, vc, 5, "T", "", "user", Column::TODO, 1);
+        log.append_to_log(next);
+        ASSERT_TRUE(manager.replicate_entry(next));
+        ASSERT_EQ(received.load(), 4);
+    }
+    
+    backup.join();
+}
+
+TEST(test_feed_waits_for_replication) {
+    int port = get_test_port();
+    std::atomic<int> received(0);
+    std::thread backup(FakeBackup, port, 300, 1, std::ref(received), -1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    StateMachine log;
+    size_t logged_early;
+    std::vector<LogEntry> published_early, published;
+    WriteOutcome outcome;
+    {
+        ReplicationManager manager(0);
+        manager.set_log_source(&log);
+        manager.add_backup("127.0.0.1", port);
+        Sequencer sequencer(log, &manager);
+        sequencer.start(0);
+        
+        Sequencer::WriteFn write = [](int entry_id) {
+            VectorClock vc(1);
+            return std::vector<LogEntry>(1, LogEntry(entry_id, OpType::CREATE_TASK, vc, 0, "A", "", "user",
+                                                     Column::TODO, 1));
+        };
+        std::thread writer([&]() {
+            outcome = sequencer.submit(write);
+        });
+        
+        // Logged while the backup takes its time to ack, but not yet published
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        logged_early = log.get_log_size();
+        published_early = log.wait_for_entries_after(-1, 10, 50);
+        writer.join();
+        
+        // Published once the backup holds it
+        published = log.wait_for_entries_after(-1, 10, 50);
+        sequencer.stop();
+    }
+    backup.join();
+    
+    ASSERT_EQ(logged_early, 1u);
+    ASSERT_TRUE(published_early.empty());
+    ASSERT_TRUE(outcome == WriteOutcome::COMMITTED);
+    ASSERT_EQ(received.load(), 1);
+    ASSERT_EQ(published.size(), 1u);
+}
+
+TEST(test_suspected_backup_does_not_promote) {
+    int port = get_test_port();
+    std::atomic<bool> done(false);
+    std::atomic<bool> stalled(false);
+    std::atomic<bool> stall_used(false);
+    std::atomic<bool> cut_while_stalled(false);
+    std::atomic<bool> promoted(false);
+    std::atomic<int> data_connections(0);
+    FailureDetector primary_detector;  // The backup's view of the primary, fed by pings
+    
+    // Stand-in backup serving both connections. Its control side stalls once, long enough
+    // for the master to suspect it but not to give up on the ping it has waiting
+    std::vector<std::thread> handlers;
+    Socket server;
+    server.Bind(port);
+    server.Listen();
+    std::thread acceptor([&]() {
+        while (true) {
+            Socket* client_socket = server.Accept();
+            if (done || !client_socket) {
+                delete client_socket;
+                break;
+            }
+            handlers.emplace_back([&, client_socket]() {
+                ServerStub stub;
+                stub.Init(client_socket);
+                OpType op = stub.ReceiveOpType();
+                if (op == OpType::WIRE_HELLO && stub.AcceptWireVersion()) {
+                    op = stub.ReceiveOpType();
+                }
+                if (op == OpType::CONTROL_INIT) {
+                    stub.SendSuccess(true);
+                    int pings = 0;
+                    while (stub.ReceiveOpType() == OpType::HEARTBEAT_PING) {
+                        primary_detector.heartbeat();
+                        stalled = false;
+                        if (!stub.SendSuccess(true)) {
+                            break;
+                        }
+                        if (++pings == 10 && !stall_used.exchange(true)) {
+                            // Paused with the next ping waiting, as a stopped process would be
+                            stalled = true;
+                            std::this_thread::sleep_for(std::chrono::milliseconds(800));
+                        }
+                    }
+                } else if (op == OpType::REPLICATION_INIT) {
+                    data_connections++;
+                    stub.SendSuccess(true);
+                    stub.SendInt(-1);
+                    while (true) {
+                        OpType entry_op = stub.ReceiveOpType();
+                        std::vector<LogEntry> batch;
+                        bool received = static_cast<int>(entry_op) != -1 &&
+                                        (entry_op == OpType::BATCH ? stub.ReceiveLogEntryList(batch)
+                                                                   : stub.ReceiveLogEntry().get_entry_id() >= 0);
+                        if (!received) {
+                            cut_while_stalled = cut_while_stalled || stalled;
+                            break;
+                        }
+                        stub.SendSuccess(true);
+                    }
+                }
+                delete client_socket;
+            });
+        }
+    });
+    
+    // What MonitorPrimary does on a real backup
+    std::thread monitor([&]() {
+        while (!done) {
+            if (!stalled && primary_detector.has_samples() && !primary_detector.is_available()) {
+                promoted = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    });
+    
+    StateMachine log;
+    VectorClock vc(1);
+    bool connected, suspected = false, refused, reconnected = false, accepted;
+    {
+        ReplicationManager manager(0);
+        manager.set_log_source(&log);
+        manager.set_require_backup(true);  // So a write with no backup to ack it is refused
+        manager.set_heartbeat_interval(50);
+        manager.add_backup("127.0.0.1", port);
+        connected = manager.has_backups();
+        manager.start_heartbeat();
+        
+        // Suspected during the stall: off the write path, and writes no longer acked
+        for (int i = 0; i < 300 && !suspected; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            suspected = !manager.has_backups();
+        }
+        refused = !manager.replicate_entry(LogEntry(0, OpType::CREATE_TASK, vc, 0, "A", "", "user", Column::TODO, 1));
+        
+        // Back on a new data connection once the pings are answered again
+        for (int i = 0; i < 300 && !reconnected; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            reconnected = manager.has_backups();
+        }
+        accepted = manager.replicate_entry(LogEntry(1, OpType::CREATE_TASK, vc, 1, "B", "", "user", Column::TODO, 1));
+        
+        done = true;
+        monitor.join();
+    }
+    
+    ClientStub wake;
+    wake.Init("127.0.0.1", port);
+    acceptor.join();
+    wake.Close();
+    for (std::thread& handler : handlers) {
+        handler.join();
+    }
+    server.Close();
+    
+    ASSERT_TRUE(connected);
+    ASSERT_TRUE(suspected);
+    ASSERT_TRUE(refused);
+    ASSERT_TRUE(reconnected);
+    ASSERT_EQ(data_connections.load(), 2);
+    ASSERT_TRUE(accepted);
+    
+    // The backup never lost its data connection to the suspicion, nor its primary
+    ASSERT_TRUE(!cut_while_stalled);
+    ASSERT_TRUE(!promoted);
+}
+
+TEST(test_write_missing_quorum_is_unconfirmed) {
+    int port = get_test_port();
+    std::atomic<bool> got_entry(false);
+    
+    // A backup that dies holding the round's entry, before it acks
+    std::thread backup([&]() {
+        Socket server;
+        server.Bind(port);
+        server.Listen();
+        Socket* client_socket = server.Accept();
+        if (client_socket) {
+            ServerStub stub;
+            stub.Init(client_socket);
+            OpType op = stub.ReceiveOpType();
+            if (op == OpType::WIRE_HELLO && stub.AcceptWireVersion()) {
+                op = stub.ReceiveOpType();
+            }
+            if (op == OpType::REPLICATION_INIT) {
+                stub.SendSuccess(true);
+                stub.SendInt(-1);
+                std::vector<LogEntry> batch;
+                op = stub.ReceiveOpType();
+                got_entry = op == OpType::BATCH ? stub.ReceiveLogEntryList(batch)
+                                                : stub.ReceiveLogEntry().get_entry_id() >= 0;
+            }
+            delete client_socket;
+        }
+        server.Close();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    StateMachine log;
+    TaskManager task_manager;
+    OperationResponse response;
+    WriteOutcome outcome;
+    bool ran;
+    std::vector<LogEntry> published;
+    {
+        ReplicationManager manager(0);
+        manager.set_log_source(&log);
+        manager.add_backup("127.0.0.1", port);
+        Sequencer sequencer(log, &manager);
+        sequencer.start(0);
+        
+        // As master.cpp's CREATE_TASK does
+        Sequencer::WriteFn write = [&](int entry_id) {
+            std::vector<LogEntry> entries;
+            response.updated_task_id = task_manager.create_task("A", "", "board-1", "user", Column::TODO, 1);
+            response.success = response.updated_task_id >= 0;
+            response.entry_id = entry_id;
+            VectorClock vc(1);
+            entries.push_back(LogEntry(entry_id, OpType::CREATE_TASK, vc, response.updated_task_id, "A", "",
+                                       "user", Column::TODO, 1));
+            return entries;
+        };
+        outcome = sequencer.submit(write);
+        ran = ReportWriteOutcome(outcome, response);
+        published = log.wait_for_entries_after(-1, 10, 50);
+        sequencer.stop();
+    }
+    backup.join();
+    
+    ASSERT_TRUE(got_entry);
+    ASSERT_TRUE(outcome == WriteOutcome::NOT_REPLICATED);
+    
+    // On the board and in the log, but not published as committed
+    ASSERT_EQ(task_manager.get_all_tasks().size(), 1u);
+    ASSERT_EQ(log.get_log_size(), 1u);
+    ASSERT_TRUE(published.empty());
+    
+    // Answered as done but unconfirmed, so a client doesn't create it again
+    ASSERT_TRUE(ran);
+    ASSERT_TRUE(response.success && response.unconfirmed && !response.busy);
+    ASSERT_EQ(response.updated_task_id, task_manager.get_all_tasks()[0].get_task_id());
+}
+
+/* ============ Failure Detector Tests ============ */
+
+TEST(test_failure_detector_phi) {
+    FailureDetector detector;
+    
+    // Never heard from, never suspected
+    ASSERT_TRUE(!detector.has_samples());
+    ASSERT_TRUE(detector.is_available());
+    
+    for (int i = 0; i < 10; i++) {
+        detector.heartbeat();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    ASSERT_TRUE(detector.has_samples());
+    ASSERT_TRUE(detector.is_available());
+    
+    // Suspicion grows with silence, well past the usual interval it crosses the threshold
+    double early = detector.phi();
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+    ASSERT_TRUE(detector.phi() > early);
+    ASSERT_TRUE(!detector.is_available());
+    
+    // One arrival clears it, a reset forgets the history
+    detector.heartbeat();
+    ASSERT_TRUE(detector.is_available());
+    detector.reset();
+    ASSERT_TRUE(!detector.has_samples());
 }
 
 /* ============ Multiple Message Tests ============ */
@@ -624,6 +1738,9 @@ int main() {
     RUN_TEST(test_socket_send_receive_int);
     RUN_TEST(test_socket_send_receive_string);
     RUN_TEST(test_socket_large_transfer);
+    RUN_TEST(test_socket_timeouts);
+    RUN_TEST(test_reconnect_backoff);
+    RUN_TEST(test_compression_codec);
     
     std::cout << "\n--- Stub Communication Tests ---\n";
     RUN_TEST(test_stub_send_receive_task);
@@ -632,6 +1749,24 @@ int main() {
     RUN_TEST(test_stub_send_receive_task_list);
     RUN_TEST(test_stub_success_response);
     RUN_TEST(test_stub_operation_response);
+    RUN_TEST(test_stub_board_delta);
+    RUN_TEST(test_stub_follower_read);
+    RUN_TEST(test_stub_leader_query);
+    RUN_TEST(test_stub_query);
+    RUN_TEST(test_stub_search);
+    RUN_TEST(test_stub_batch);
+    RUN_TEST(test_change_feed_subscription);
+    RUN_TEST(test_state_transfer_chunked);
+    RUN_TEST(test_stub_compressed_exchange);
+    RUN_TEST(test_stub_wire_version_exchange);
+    RUN_TEST(test_replication_quorum_fan_out);
+    RUN_TEST(test_replication_catch_up_on_handshake);
+    RUN_TEST(test_feed_waits_for_replication);
+    RUN_TEST(test_suspected_backup_does_not_promote);
+    RUN_TEST(test_write_missing_quorum_is_unconfirmed);
+    
+    std::cout << "\n--- Failure Detector Tests ---\n";
+    RUN_TEST(test_failure_detector_phi);
     
     std::cout << "\n--- Multiple Message Tests ---\n";
     RUN_TEST(test_multiple_operations_same_connection);
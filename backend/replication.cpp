@@ -1,7 +1,11 @@
 #include "replication.h"
 #include <iostream>
+#include <algorithm>
+#include <climits>
 
-ReplicationManager::ReplicationManager(int id) : factory_id(id), heartbeat_running(false) {
+ReplicationManager::ReplicationManager(int id) : factory_id(id), heartbeat_running(false), quorum(1), require_backup(false),
+                                                    compression(false),
+                                                    log_source(nullptr), heartbeat_interval_ms(DEFAULT_HEARTBEAT_INTERVAL_MS), workers_running(true) {
     // Suppress unused warning, factory_id reserved for future use
     (void)factory_id;
 }
@@ -9,6 +13,18 @@ ReplicationManager::ReplicationManager(int id) : factory_id(id), heartbeat_runni
 ReplicationManager::~ReplicationManager() {
     stop_heartbeat();
     
+    // Workers finish what is queued, then exit
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        workers_running = false;
+    }
+    peer_cv.notify_all();
+    for (std::thread& worker : backup_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    
     std::cout << "Closing replication connections..." << std::endl;
     for (ClientStub* stub : backup_stubs) {
         if (stub) {
@@ -20,46 +36,65 @@ ReplicationManager::~ReplicationManager() {
 }
 
 void ReplicationManager::add_backup(const std::string& ip, int port) {
-    // Store IP and port for reconnection
-    backup_ips.push_back(ip);
-    backup_ports.push_back(port);
-    
-    ClientStub* stub = new ClientStub();
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        index = backup_stubs.size();
+        backup_ips.push_back(ip);  // Kept for reconnection
+        backup_ports.push_back(port);
+        backup_stubs.push_back(nullptr);
+        backup_connected.push_back(false);
+        backup_queues.emplace_back();
+        backup_in_flight.push_back(nullptr);
+        control_stubs.push_back(nullptr);
+        detectors.emplace_back(new FailureDetector());
+        reconnect_backoff.push_back(ReconnectBackoff());
+    }
     
-    // Try to connect
-    if (stub->Init(ip, port)) {
-        std::cout << "Connected to backup at " << ip << ":" << port << "\n";
-        
-        // Send REPLICATION_INIT handshake to identify as master
-        if (!stub->SendOpType(OpType::REPLICATION_INIT)) {
-            std::cerr << "Failed to send REPLICATION_INIT to backup\n";
-            delete stub;
-            backup_stubs.push_back(nullptr);
-            backup_connected.push_back(false);
-            return;
-        }
-        
-        // Wait for acknowledgment
-        if (!stub->ReceiveSuccess()) {
-            std::cerr << "Backup rejected REPLICATION_INIT (may be promoted)\n";
-            delete stub;
-            backup_stubs.push_back(nullptr);
-            backup_connected.push_back(false);
-            return;
-        }
-        
-        std::cout << "Replication handshake successful with backup\n";
-        backup_stubs.push_back(stub);
-        backup_connected.push_back(true);
+    // Handshake and catch up now, a backup that isn't reachable yet is retried by the heartbeat
+    if (try_reconnect(index)) {
+        std::cout << "Replication handshake successful with backup at " << ip << ":" << port << "\n";
     } else {
         std::cerr << "Failed to connect to backup at " << ip << ":" << port << " (will retry)\n";
-        delete stub;
-        backup_stubs.push_back(nullptr);
-        backup_connected.push_back(false);
     }
+    backup_workers.emplace_back(&ReplicationManager::backup_worker, this, index);
+}
+
+void ReplicationManager::set_quorum(int acks) {
+    quorum = std::max(1, acks);
+}
+
+int ReplicationManager::get_quorum() const {
+    return quorum;
+}
+
+void ReplicationManager::set_require_backup(bool required) {
+    require_backup = required;
+}
+
+bool ReplicationManager::requires_backup() const {
+    return require_backup;
+}
+
+void ReplicationManager::set_compression(bool enabled) {
+    compression = enabled;
+}
+
+void ReplicationManager::set_log_source(const StateMachine* sm) {
+    log_source = sm;
+}
+
+void ReplicationManager::set_heartbeat_interval(int interval_ms) {
+    heartbeat_interval_ms = std::max(10, interval_ms);
+}
+
+FailureDetector* ReplicationManager::detector(size_t index) {
+    std::lock_guard<std::mutex> lock(peer_mutex);
+    return detectors[index].get();
 }
 
 void ReplicationManager::connect_to_backups() {
+    std::lock_guard<std::mutex> lock(peer_mutex);
     for (size_t i = 0; i < backup_stubs.size(); i++) {
         if (backup_stubs[i] && !backup_connected[i]) {
             // Try to reconnect
@@ -68,46 +103,181 @@ void ReplicationManager::connect_to_backups() {
     }
 }
 
-bool ReplicationManager::replicate_entry(const LogEntry& entry) {
-    bool any_success = false;
-    
-    for (size_t i = 0; i < backup_stubs.size(); i++) {
-        if (!backup_connected[i] || !backup_stubs[i]) {
-            continue;
-        }
-        
-        try {
-            // Send operation type first (so backup can distinguish from heartbeat)
-            if (!backup_stubs[i]->SendOpType(entry.get_op_type())) {
-                std::cerr << "Failed to send optype to backup " << i << "\n";
-                backup_connected[i] = false;
+void ReplicationManager::set_connected(size_t index, bool connected) {
+    std::lock_guard<std::mutex> lock(peer_mutex);
+    backup_connected[index] = connected;
+}
+
+bool ReplicationManager::submit(const std::shared_ptr<ReplicationJob>& job, int needed) {
+    bool heartbeat = job->op_type == OpType::HEARTBEAT_PING;
+    int targets = 0;
+    bool no_backups;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        no_backups = backup_queues.empty();
+        for (size_t i = 0; i < backup_queues.size(); i++) {
+            if (!backup_connected[i] && !heartbeat) {
                 continue;
             }
-            
-            // Send log entry to backup
-            if (!backup_stubs[i]->SendLogEntry(entry)) {
-                std::cerr << "Failed to send to backup " << i << "\n";
+            if (backup_queues[i].size() >= MAX_PENDING_PER_BACKUP) {
+                // Too far behind to keep on the write path, the heartbeat reconnects it later
+                std::cerr << "Backup " << i << " fell " << backup_queues[i].size() << " jobs behind - dropping it\n";
                 backup_connected[i] = false;
                 continue;
             }
-            
-            // Wait for acknowledgment
-            if (!backup_stubs[i]->ReceiveSuccess()) {
-                std::cerr << "Backup " << i << " failed to ack\n";
-                backup_connected[i] = false;
-                continue;
+            backup_queues[i].push_back(job);
+            targets++;
+        }
+    }
+    peer_cv.notify_all();
+    
+    if (targets == 0) {
+        return no_backups || !require_backup;
+    }
+    needed = std::min(needed, targets);
+    
+    std::unique_lock<std::mutex> lock(ack_mutex);
+    ack_cv.wait(lock, [&job, needed, targets]() {
+        return job->acks >= needed || job->acks + job->failures >= targets;
+    });
+    return job->acks >= needed;
+}
+
+void ReplicationManager::backup_worker(size_t index) {
+    while (true) {
+        std::shared_ptr<ReplicationJob> job;
+        {
+            std::unique_lock<std::mutex> lock(peer_mutex);
+            peer_cv.wait(lock, [this, index]() {
+                return !workers_running || !backup_queues[index].empty();
+            });
+            if (backup_queues[index].empty()) {
+                return;  // Shutting down with nothing left to send
             }
-            
-            any_success = true;
-        } catch (...) {
-            backup_connected[i] = false;
+            job = backup_queues[index].front();
+            backup_queues[index].pop_front();
+            backup_in_flight[index] = job;
         }
+        
+        bool acked = deliver(index, *job);
+        {
+            std::lock_guard<std::mutex> lock(peer_mutex);
+            if (backup_in_flight[index] != job) {
+                continue;  // Counted as failed when the backup was suspected
+            }
+            backup_in_flight[index] = nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ack_mutex);
+            if (acked) {
+                job->acks++;
+            } else {
+                job->failures++;
+            }
+        }
+        ack_cv.notify_all();
+    }
+}
+
+bool ReplicationManager::deliver(size_t index, const ReplicationJob& job) {
+    bool connected;
+    ClientStub* stub;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        stub = backup_stubs[index];
+        connected = backup_connected[index] && stub;
     }
     
-    return any_success || backup_stubs.empty();
+    if (job.op_type == OpType::HEARTBEAT_PING) {
+        // Try to reconnect disconnected backups
+        if (!connected) {
+            bool reconnected = try_reconnect(index);
+            {
+                std::lock_guard<std::mutex> lock(peer_mutex);
+                if (reconnected) {
+                    reconnect_backoff[index].succeeded();
+                } else {
+                    reconnect_backoff[index].failed();
+                }
+            }
+            if (reconnected) {
+                std::cout << "[HEARTBEAT] Backup " << index << " reconnected\n";
+            }
+            return reconnected;
+        }
+        
+        // Send HEARTBEAT_PING, receive HEARTBEAT_ACK
+        if (!stub->SendHeartbeat()) {
+            std::cout << "[HEARTBEAT] Failed to send ping to backup " << index << " - disconnected\n";
+            set_connected(index, false);
+            return false;
+        }
+        if (!stub->ReceiveHeartbeatAck()) {
+            std::cout << "[HEARTBEAT] No ack from backup " << index << " - disconnected\n";
+            set_connected(index, false);
+            return false;
+        }
+        return true;
+    }
+    
+    if (!connected) {
+        return false;
+    }
+    
+    // Operation type first (so backup can distinguish from heartbeat), then the payload
+    bool sent;
+    switch (job.op_type) {
+        case OpType::BATCH:
+            // One op type, the whole entry list, one ack
+            sent = stub->SendOpType(OpType::BATCH) && stub->SendLogEntryList(job.entries);
+            break;
+        case OpType::IMPORT_TASKS:
+            sent = stub->SendOpType(OpType::IMPORT_TASKS) && stub->SendLogEntry(job.entries[0]) &&
+                   stub->SendTaskList(job.tasks);
+            break;
+        default:
+            sent = stub->SendOpType(job.op_type) && stub->SendLogEntry(job.entries[0]);
+            break;
+    }
+    if (!sent) {
+        std::cerr << "Failed to send to backup " << index << "\n";
+        set_connected(index, false);
+        return false;
+    }
+    
+    // Wait for acknowledgment
+    if (!stub->ReceiveSuccess()) {
+        std::cerr << "Backup " << index << " failed to ack\n";
+        set_connected(index, false);
+        return false;
+    }
+    
+    // An ack proves the backup alive as well as a ping does
+    detector(index)->heartbeat();
+    return true;
+}
+
+bool ReplicationManager::replicate_entry(const LogEntry& entry) {
+    std::shared_ptr<ReplicationJob> job = std::make_shared<ReplicationJob>(entry.get_op_type());
+    job->entries.push_back(entry);
+    return submit(job, quorum);
+}
+
+bool ReplicationManager::replicate_batch(const std::vector<LogEntry>& entries) {
+    std::shared_ptr<ReplicationJob> job = std::make_shared<ReplicationJob>(OpType::BATCH);
+    job->entries = entries;
+    return submit(job, quorum);
+}
+
+bool ReplicationManager::replicate_import(const LogEntry& marker, const std::vector<Task>& tasks) {
+    std::shared_ptr<ReplicationJob> job = std::make_shared<ReplicationJob>(OpType::IMPORT_TASKS);
+    job->entries.push_back(marker);
+    job->tasks = tasks;
+    return submit(job, quorum);
 }
 
 bool ReplicationManager::has_backups() const {
+    std::lock_guard<std::mutex> lock(peer_mutex);
     for (bool connected : backup_connected) {
         if (connected) return true;
     }
@@ -116,105 +286,286 @@ bool ReplicationManager::has_backups() const {
 
 // Try to reconnect to a disconnected backup
 bool ReplicationManager::try_reconnect(size_t index) {
-    if (index >= backup_ips.size()) return false;
-    
-    const std::string& ip = backup_ips[index];
-    int port = backup_ports[index];
+    std::string ip;
+    int port;
+    ClientStub* old_stub;
+    {
+        // add_backup may still be growing the vectors
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        if (index >= backup_ips.size()) return false;
+        ip = backup_ips[index];
+        port = backup_ports[index];
+        old_stub = backup_stubs[index];
+        backup_stubs[index] = nullptr;
+    }
     
     // Clean up old stub if exists
-    if (backup_stubs[index]) {
-        backup_stubs[index]->Close();
-        delete backup_stubs[index];
-        backup_stubs[index] = nullptr;
+    if (old_stub) {
+        old_stub->Close();
+        delete old_stub;
     }
     
     ClientStub* stub = new ClientStub();
     
-    if (!stub->Init(ip, port)) {
+    if (!stub->Init(ip, port) || !stub->SetTimeouts(REPLICATION_IO_TIMEOUT_MS) ||
+        (compression && !stub->NegotiateCompression()) || !stub->NegotiateWireVersion()) {
         delete stub;
         return false;
     }
     
-    // Send REPLICATION_INIT handshake
-    if (!stub->SendOpType(OpType::REPLICATION_INIT)) {
+    // REPLICATION_INIT handshake, the backup acks with the last entry in its log
+    int last_entry_id;
+    if (!stub->SendOpType(OpType::REPLICATION_INIT) || !stub->ReceiveSuccess() ||
+        !stub->ReceiveInt(last_entry_id)) {
+        stub->Close();
         delete stub;
         return false;
     }
     
-    // Wait for acknowledgment
-    if (!stub->ReceiveSuccess()) {
+    if (!catch_up(index, stub, last_entry_id)) {
+        std::cerr << "[RECONNECT] Backup at " << ip << ":" << port << " failed to catch up from entry "
+                  << last_entry_id << "\n";
+        stub->Close();
         delete stub;
         return false;
     }
+    return true;
+}
+
+// Replay the log in BATCH chunks until the backup holds all of it. The last check is made
+// under peer_mutex, which submit queues under: an entry logged before it is replayed, one
+// logged after it is queued for the backup (and an entry sent both ways is applied once).
+// A tail with a gap or a bulk import in it, or a backup ahead of this log, takes a state
+// transfer the backup pulls from this node
+bool ReplicationManager::catch_up(size_t index, ClientStub* stub, int last_entry_id) {
+    bool resynced = false;
+    while (log_source) {
+        std::vector<LogEntry> tail = log_source->get_log_after(last_entry_id, CATCH_UP_CHUNK_SIZE);
+        if (tail.empty()) {
+            std::lock_guard<std::mutex> lock(peer_mutex);
+            if (last_entry_id == log_source->get_next_entry_id() - 1) {
+                backup_stubs[index] = stub;
+                backup_connected[index] = true;
+                detectors[index]->reset();  // Judge the new connection on its own history
+                return true;
+            }
+            if (!log_source->get_log_after(last_entry_id, 1).empty()) {
+                continue;  // Logged since the tail was read
+            }
+        } else {
+            bool replayable = tail.front().get_entry_id() == last_entry_id + 1;
+            for (const LogEntry& entry : tail) {
+                replayable = replayable && entry.get_op_type() != OpType::IMPORT_TASKS;
+            }
+            if (replayable) {
+                if (!stub->SendOpType(OpType::BATCH) || !stub->SendLogEntryList(tail) || !stub->ReceiveSuccess()) {
+                    return false;
+                }
+                last_entry_id = tail.back().get_entry_id();
+                continue;
+            }
+        }
+        
+        // Once is enough, the transfer leaves the backup with this log up to its cut
+        if (resynced || !resync(stub, last_entry_id)) {
+            return false;
+        }
+        resynced = true;
+    }
     
+    std::lock_guard<std::mutex> lock(peer_mutex);
     backup_stubs[index] = stub;
     backup_connected[index] = true;
-    std::cout << "[RECONNECT] Successfully reconnected to backup at " << ip << ":" << port << "\n";
+    detectors[index]->reset();
     return true;
 }
 
-// Send heartbeat to all backups (active probing)
+bool ReplicationManager::resync(ClientStub* stub, int& last_entry_id) {
+    std::cout << "[RECONNECT] Backup at entry " << last_entry_id << " can't catch up from the log, "
+              << "having it pull a state transfer\n";
+    return stub->SetTimeouts(RESYNC_TIMEOUT_MS) && stub->SendOpType(OpType::STATE_TRANSFER_REQUEST) &&
+           stub->ReceiveSuccess() && stub->ReceiveInt(last_entry_id) &&
+           stub->SetTimeouts(REPLICATION_IO_TIMEOUT_MS);
+}
+
+void ReplicationManager::schedule_reconnects() {
+    std::shared_ptr<ReplicationJob> job = std::make_shared<ReplicationJob>(OpType::HEARTBEAT_PING);
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        for (size_t i = 0; i < backup_connected.size(); i++) {
+            bool suspected = detectors[i]->has_samples() && !detectors[i]->is_available();
+            if (!backup_connected[i] && !suspected && reconnect_backoff[i].due()) {
+                reconnect_backoff[i].in_flight = true;
+                backup_queues[i].push_back(job);
+                queued = true;
+            }
+        }
+    }
+    if (queued) {
+        peer_cv.notify_all();
+    }
+}
+
+// Retry disconnected backups and log status. Liveness of connected backups comes
+// from the control channel
 void ReplicationManager::send_heartbeat() {
-    for (size_t i = 0; i < backup_stubs.size(); i++) {
-        // Try to reconnect disconnected backups
-        if (!backup_connected[i] || !backup_stubs[i]) {
-            if (try_reconnect(i)) {
-                std::cout << "[HEARTBEAT] Backup " << i << " reconnected\n";
+    schedule_reconnects();
+    
+    int connected_count = 0;
+    size_t backup_count;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        backup_count = backup_connected.size();
+        for (size_t i = 0; i < backup_connected.size(); i++) {
+            if (backup_connected[i]) {
+                connected_count++;
             }
-            continue;
         }
+    }
+    
+    if (connected_count > 0) {
+        std::cout << "[HEARTBEAT] " << connected_count << "/" 
+                  << backup_count << " backups alive\n";
+    } else if (backup_count > 0) {
+        std::cout << "[HEARTBEAT] WARNING: All backups disconnected!\n";
+    }
+}
+
+void ReplicationManager::suspect(size_t index) {
+    std::vector<std::shared_ptr<ReplicationJob>> failed;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        if (!backup_connected[index]) {
+            return;
+        }
+        backup_connected[index] = false;
         
-        try {
-            // Send HEARTBEAT_PING
-            if (!backup_stubs[i]->SendHeartbeat()) {
-                std::cout << "[HEARTBEAT] Failed to send ping to backup " << i << " - disconnected\n";
-                backup_connected[i] = false;
+        // Queued reconnects stay, everything else is dropped and counted as failed
+        std::deque<std::shared_ptr<ReplicationJob>> kept;
+        for (const std::shared_ptr<ReplicationJob>& job : backup_queues[index]) {
+            if (job->op_type == OpType::HEARTBEAT_PING) {
+                kept.push_back(job);
+            } else {
+                failed.push_back(job);
+            }
+        }
+        backup_queues[index].swap(kept);
+        if (backup_in_flight[index]) {
+            failed.push_back(backup_in_flight[index]);
+            backup_in_flight[index] = nullptr;
+        }
+        std::cout << "[HEARTBEAT] Backup " << index << " suspected (phi " << detectors[index]->phi()
+                  << ") - taken off the write path\n";
+    }
+    
+    if (!failed.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(ack_mutex);
+            for (const std::shared_ptr<ReplicationJob>& job : failed) {
+                job->failures++;
+            }
+        }
+        ack_cv.notify_all();
+    }
+}
+
+ClientStub* ReplicationManager::connect_control(size_t index) {
+    std::string ip;
+    int port;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        ip = backup_ips[index];
+        port = backup_ports[index];
+    }
+    
+    ClientStub* stub = new ClientStub();
+    if (!stub->Init(ip, port) || !stub->SetTimeouts(CONTROL_IO_TIMEOUT_MS) ||
+        !stub->SendOpType(OpType::CONTROL_INIT) || !stub->ReceiveSuccess()) {
+        delete stub;
+        return nullptr;
+    }
+    return stub;
+}
+
+void ReplicationManager::control_worker(size_t index) {
+    ClientStub* control = nullptr;
+    ReconnectBackoff backoff;
+    
+    while (heartbeat_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(heartbeat_interval_ms));
+        
+        if (!control) {
+            if (!backoff.due()) {
                 continue;
             }
-            
-            // Receive HEARTBEAT_ACK
-            if (!backup_stubs[i]->ReceiveHeartbeatAck()) {
-                std::cout << "[HEARTBEAT] No ack from backup " << i << " - disconnected\n";
-                backup_connected[i] = false;
+            control = connect_control(index);
+            if (!control) {
+                backoff.failed();
                 continue;
             }
+            backoff.succeeded();
             
-            // Heartbeat successful
-        } catch (...) {
-            std::cout << "[HEARTBEAT] Exception for backup " << i << " - disconnected\n";
-            backup_connected[i] = false;
+            // A new connection starts a new interval history
+            detector(index)->reset();
+            std::lock_guard<std::mutex> lock(peer_mutex);
+            control_stubs[index] = control;
+            continue;
         }
-    }
-    
-    // Log status
-    int connected_count = 0;
-    for (size_t i = 0; i < backup_connected.size(); i++) {
-        if (backup_connected[i]) {
-            connected_count++;
+        
+        if (control->SendHeartbeat() && control->ReceiveHeartbeatAck()) {
+            detector(index)->heartbeat();
+        } else {
+            // The detector notices the silence, just drop the connection
+            {
+                std::lock_guard<std::mutex> lock(peer_mutex);
+                control_stubs[index] = nullptr;
+            }
+            control->Close();
+            delete control;
+            control = nullptr;
         }
     }
     
-    if (connected_count > 0) {
-        std::cout << "[HEARTBEAT] " << connected_count << "/" 
-                  << backup_connected.size() << " backups alive\n";
-    } else if (backup_connected.size() > 0) {
-        std::cout << "[HEARTBEAT] WARNING: All backups disconnected!\n";
+    if (control) {
+        {
+            std::lock_guard<std::mutex> lock(peer_mutex);
+            control_stubs[index] = nullptr;
+        }
+        control->Close();
+        delete control;
     }
 }
 
-// Heartbeat worker thread, monitors every 5 seconds
+// Heartbeat worker thread: every ping interval, suspects silent backups and queues
+// due reconnects. Logs status every STATUS_LOG_INTERVAL_MS
 void ReplicationManager::heartbeat_worker() {
-    std::cout << "[HEARTBEAT] Monitoring started (interval: 5 seconds)\n";
+    std::cout << "[HEARTBEAT] Monitoring started (interval: " << heartbeat_interval_ms << " ms)\n";
     
+    std::chrono::steady_clock::time_point last_status = std::chrono::steady_clock::now();
     while (heartbeat_running) {
-        // Sleep for 5 seconds in small chunks to allow quick shutdown
-        for (int i = 0; i < 50 && heartbeat_running; i++) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-        
+        std::this_thread::sleep_for(std::chrono::milliseconds(heartbeat_interval_ms));
         if (!heartbeat_running) break;
         
-        send_heartbeat();
+        size_t backup_count;
+        {
+            std::lock_guard<std::mutex> lock(peer_mutex);
+            backup_count = backup_connected.size();
+        }
+        for (size_t i = 0; i < backup_count; i++) {
+            FailureDetector* fd = detector(i);
+            if (fd->has_samples() && !fd->is_available()) {
+                suspect(i);
+            }
+        }
+        
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - last_status >= std::chrono::milliseconds(STATUS_LOG_INTERVAL_MS)) {
+            last_status = now;
+            send_heartbeat();
+        } else {
+            schedule_reconnects();
+        }
     }
     
     std::cout << "[HEARTBEAT] Monitoring stopped\n";
@@ -225,6 +576,9 @@ void ReplicationManager::start_heartbeat() {
     if (!heartbeat_running) {
         heartbeat_running = true;
         heartbeat_thread = std::thread(&ReplicationManager::heartbeat_worker, this);
+        for (size_t i = 0; i < backup_ips.size(); i++) {
+            control_workers.emplace_back(&ReplicationManager::control_worker, this, i);
+        }
         std::cout << "Heartbeat monitoring started\n";
     }
 }
@@ -233,9 +587,24 @@ void ReplicationManager::start_heartbeat() {
 void ReplicationManager::stop_heartbeat() {
     if (heartbeat_running) {
         heartbeat_running = false;
+        {
+            // Unblock control workers waiting on an ack
+            std::lock_guard<std::mutex> lock(peer_mutex);
+            for (ClientStub* control : control_stubs) {
+                if (control) {
+                    control->Shutdown();
+                }
+            }
+        }
         if (heartbeat_thread.joinable()) {
             heartbeat_thread.join();
         }
+        for (std::thread& worker : control_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        control_workers.clear();
         std::cout << "Heartbeat monitoring stopped\n";
     }
 }
@@ -2,52 +2,197 @@
 #define __REPLICATION_H__
 
 #include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <chrono>
 #include "Socket.h"
 #include "ClientStub.h"
+#include "failure_detector.h"
+#include "state_machine.h"
 #include "messages.h"
 
-// Manages replication to backup nodes
+// Control channel ping interval unless the master is started with --heartbeat-ms
+const int DEFAULT_HEARTBEAT_INTERVAL_MS = 200;
+
+// Reconnect attempts to a backup back off exponentially between these delays
+const int RECONNECT_MIN_DELAY_MS = 100;
+const int RECONNECT_MAX_DELAY_MS = 5000;
+
+// Send/receive deadlines. Data connections allow for a backup applying a large
+// import, control connections only carry pings
+const int REPLICATION_IO_TIMEOUT_MS = 5000;
+const int CONTROL_IO_TIMEOUT_MS = 1000;
+
+// How often the backup status line is logged
+const int STATUS_LOG_INTERVAL_MS = 5000;
+
+// Log entries replayed per BATCH to a backup catching up on reconnect
+const size_t CATCH_UP_CHUNK_SIZE = 1024;
+
+// A backup the log tail can't bring level pulls a state transfer, the handshake waits this long for it
+const int RESYNC_TIMEOUT_MS = 60000;
+
+// Jobs a backup may fall behind by before it is dropped (and later reconnected by the heartbeat)
+const size_t MAX_PENDING_PER_BACKUP = 4096;
+
+// One message fanned out to every backup, counts the answers as they come in
+struct ReplicationJob {
+    OpType op_type;                 // HEARTBEAT_PING, BATCH, IMPORT_TASKS, or the entry's op
+    std::vector<LogEntry> entries;  // One entry, or a BATCH run, or the IMPORT_TASKS marker
+    std::vector<Task> tasks;        // IMPORT_TASKS payload
+    int acks;
+    int failures;
+
+    ReplicationJob(OpType op) : op_type(op), acks(0), failures(0) {}
+};
+
+// When the next reconnect attempt to one backup is due
+struct ReconnectBackoff {
+    int delay_ms;
+    std::chrono::steady_clock::time_point next_attempt;
+    bool in_flight;  // An attempt is queued or running
+
+    ReconnectBackoff() : delay_ms(RECONNECT_MIN_DELAY_MS), next_attempt(std::chrono::steady_clock::now()), in_flight(false) {}
+
+    bool due() const {
+        return !in_flight && std::chrono::steady_clock::now() >= next_attempt;
+    }
+    void failed() {
+        in_flight = false;
+        next_attempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+        delay_ms = std::min(delay_ms * 2, RECONNECT_MAX_DELAY_MS);
+    }
+    void succeeded() {
+        in_flight = false;
+        delay_ms = RECONNECT_MIN_DELAY_MS;
+    }
+};
+
+// Manages replication to backup nodes. Each backup has its own worker thread and queue,
+// so a write goes to all backups at once and returns when a quorum of them has acked
 class ReplicationManager {
 private:
     int factory_id;
-    std::vector<ClientStub*> backup_stubs;
+    std::vector<ClientStub*> backup_stubs;    // Owned by the backup's worker once it runs
     std::vector<bool> backup_connected;
     std::vector<std::string> backup_ips;
     std::vector<int> backup_ports;
     std::atomic<bool> heartbeat_running;
     std::thread heartbeat_thread;
-    
-    // Heartbeat worker function
+    int quorum;  // Backup acks a write waits for
+    bool require_backup;  // Writes need a backup on the write path, off: served without one
+    bool compression;  // Offer compressed framing on data connections
+    const StateMachine* log_source;  // Replayed to a reconnecting backup, none to connect it as it is
+
+    // Liveness: a heartbeat-only control connection per backup, pinged every
+    // heartbeat_interval_ms. Pings and replication acks both feed the backup's detector
+    int heartbeat_interval_ms;
+    std::vector<ClientStub*> control_stubs;  // Owned by the backup's control worker
+    std::vector<std::unique_ptr<FailureDetector>> detectors;
+    std::vector<std::thread> control_workers;
+    std::vector<ReconnectBackoff> reconnect_backoff;  // Data connections, under peer_mutex
+
+    // Per-backup queues, guarded by peer_mutex together with backup_connected
+    std::vector<std::deque<std::shared_ptr<ReplicationJob>>> backup_queues;
+    std::vector<std::shared_ptr<ReplicationJob>> backup_in_flight;  // Job the worker is delivering, if unsettled
+    std::vector<std::thread> backup_workers;
+    bool workers_running;
+    mutable std::mutex peer_mutex;
+    std::condition_variable peer_cv;
+
+    // Acks and failures on jobs
+    std::mutex ack_mutex;
+    std::condition_variable ack_cv;
+
+    // Heartbeat worker function: suspects backups whose phi crossed the threshold and
+    // retries disconnected ones
     void heartbeat_worker();
-    
-    // Try to reconnect to a disconnected backup
+
+    // Ping one backup over its control connection
+    void control_worker(size_t index);
+    ClientStub* connect_control(size_t index);
+    FailureDetector* detector(size_t index);
+
+    // Take a suspected backup off the write path: its queued and in-flight jobs count as
+    // failed, so no write waits on it. Its connection is left alone, whether the primary
+    // is gone is for the backup's own detector to say
+    void suspect(size_t index);
+
+    // Queue a reconnect on each disconnected backup whose backoff has passed and that
+    // isn't suspected. Its worker makes the attempt, so neither heartbeats nor writes
+    // wait on a connect
+    void schedule_reconnects();
+
+    // Send jobs to one backup in order, reconnecting on heartbeats
+    void backup_worker(size_t index);
+    bool deliver(size_t index, const ReplicationJob& job);
+    void set_connected(size_t index, bool connected);
+
+    // Queue job for every connected backup (every backup for a heartbeat) and wait
+    // for needed acks, or for all of them to answer. With none to queue it on it goes
+    // through unless require_backup is set
+    bool submit(const std::shared_ptr<ReplicationJob>& job, int needed);
+
+    // Try to reconnect to a disconnected backup, it rejoins the write path once caught up
     bool try_reconnect(size_t index);
 
+    // Replay the log after last_entry_id to a backup that just handshook, then connect it
+    bool catch_up(size_t index, ClientStub* stub, int last_entry_id);
+
+    // Have a backup pull a state transfer from this node, last_entry_id is where it ends up
+    bool resync(ClientStub* stub, int& last_entry_id);
+
 public:
     ReplicationManager(int id);
     ~ReplicationManager();
-    
+
     // Add backup peer (id, ip, port)
     void add_backup(const std::string& ip, int port);
-    
+
+    // Backup acks to wait for on each write, clamped to the backups reachable at the time
+    void set_quorum(int acks);
+    int get_quorum() const;
+
+    // Opt in to refusing writes while no backup is on the write path, so nothing is acked
+    // that only this node holds. Off by default: with none connected, writes are served here
+    void set_require_backup(bool required);
+    bool requires_backup() const;
+
+    // Compress replication traffic to backups that agree to it, set before add_backup
+    void set_compression(bool enabled);
+
+    // Log a reconnecting backup catches up from before it takes writes again, set before add_backup
+    void set_log_source(const StateMachine* sm);
+
+    // Control channel ping interval, set before start_heartbeat
+    void set_heartbeat_interval(int interval_ms);
+
     // Connect to all backups
     void connect_to_backups();
-    
+
     // Replicate log entry to all backups
     bool replicate_entry(const LogEntry& entry);
-    
-    // Send heartbeat to all backups
+
+    // Replicate a BATCH's contiguous run of entries in one round trip
+    bool replicate_batch(const std::vector<LogEntry>& entries);
+
+    // Replicate a bulk import: its marker log entry followed by the imported tasks
+    bool replicate_import(const LogEntry& marker, const std::vector<Task>& tasks);
+
+    // Retry disconnected backups that are due and log how many are alive
     void send_heartbeat();
-    
+
     // Start heartbeat monitoring
     void start_heartbeat();
-    
+
     // Stop heartbeat monitoring
     void stop_heartbeat();
-    
+
     // Check if any backups are connected
     bool has_backups() const;
 };
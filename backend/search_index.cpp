@@ -0,0 +1,335 @@
+#include "search_index.h"
+#include <algorithm>
+#include <functional>
+
+static void WriteVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t ReadVarint(const uint8_t*& in) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= static_cast<uint32_t>(*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint32_t>(*in++) << shift;
+    return value;
+}
+
+static bool StartsWith(const std::string& term, const std::string& prefix) {
+    return term.compare(0, prefix.size(), prefix) == 0;
+}
+
+/* PostingList */
+
+PostingList::PostingList() : total(0) {}
+
+void PostingList::encode(const int* ids, size_t count, Block& block) {
+    block.first = ids[0];
+    block.last = ids[count - 1];
+    block.count = static_cast<int>(count);
+    block.gaps.clear();
+    for (size_t i = 1; i < count; i++) {
+        WriteVarint(block.gaps, static_cast<uint32_t>(ids[i] - ids[i - 1]));
+    }
+}
+
+size_t PostingList::decode(const Block& block, int* out) {
+    out[0] = block.first;
+    const uint8_t* in = block.gaps.data();
+    for (int i = 1; i < block.count; i++) {
+        out[i] = out[i - 1] + static_cast<int>(ReadVarint(in));
+    }
+    return block.count;
+}
+
+size_t PostingList::block_for(int id) const {
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), id,
+                               [](const Block& block, int value) { return block.last < value; });
+    return it - blocks.begin();
+}
+
+bool PostingList::insert(int id) {
+    size_t index = block_for(id);
+    
+    // New tasks get the highest ids, so most inserts append a gap to the last block
+    if (index == blocks.size()) {
+        if (!blocks.empty() && blocks.back().count < static_cast<int>(POSTING_BLOCK_SIZE)) {
+            Block& block = blocks.back();
+            WriteVarint(block.gaps, static_cast<uint32_t>(id - block.last));
+            block.last = id;
+            block.count++;
+        } else {
+            blocks.push_back(Block());
+            encode(&id, 1, blocks.back());
+        }
+        total++;
+        return true;
+    }
+    
+    int ids[POSTING_BLOCK_SIZE + 1];
+    size_t count = decode(blocks[index], ids);
+    int* pos = std::lower_bound(ids, ids + count, id);
+    if (pos != ids + count && *pos == id) {
+        return false;
+    }
+    std::copy_backward(pos, ids + count, ids + count + 1);
+    *pos = id;
+    count++;
+    
+    if (count > POSTING_BLOCK_SIZE) {
+        size_t half = count / 2;
+        Block upper;
+        encode(ids + half, count - half, upper);
+        encode(ids, half, blocks[index]);
+        blocks.insert(blocks.begin() + index + 1, upper);
+    } else {
+        encode(ids, count, blocks[index]);
+    }
+    total++;
+    return true;
+}
+
+bool PostingList::erase(int id) {
+    size_t index = block_for(id);
+    if (index == blocks.size() || id < blocks[index].first) {
+        return false;
+    }
+    
+    int ids[POSTING_BLOCK_SIZE];
+    size_t count = decode(blocks[index], ids);
+    int* pos = std::lower_bound(ids, ids + count, id);
+    if (pos == ids + count || *pos != id) {
+        return false;
+    }
+    std::copy(pos + 1, ids + count, pos);
+    count--;
+    
+    if (count == 0) {
+        blocks.erase(blocks.begin() + index);
+    } else {
+        encode(ids, count, blocks[index]);
+    }
+    total--;
+    return true;
+}
+
+// Both sides jump: the next block is found by binary search on block ranges, candidates
+// below a block's first id are skipped by binary search too, and only blocks that may
+// hold a candidate are decoded and merged
+void PostingList::intersect(std::vector<int>& candidates) const {
+    int ids[POSTING_BLOCK_SIZE];
+    size_t kept = 0;
+    size_t c = 0;
+    auto block = blocks.begin();
+    
+    while (c < candidates.size()) {
+        int next = candidates[c];
+        block = std::lower_bound(block, blocks.end(), next,
+                                 [](const Block& b, int value) { return b.last < value; });
+        if (block == blocks.end()) {
+            break;
+        }
+        if (next < block->first) {
+            c = std::lower_bound(candidates.begin() + c, candidates.end(), block->first) - candidates.begin();
+            continue;
+        }
+        
+        size_t count = decode(*block, ids);
+        size_t i = 0;
+        while (i < count && c < candidates.size() && candidates[c] <= block->last) {
+            if (ids[i] < candidates[c]) {
+                i++;
+            } else if (ids[i] > candidates[c]) {
+                c++;
+            } else {
+                candidates[kept++] = candidates[c];
+                i++;
+                c++;
+            }
+        }
+        // Candidates left at or below this block's last id are not in it
+        while (c < candidates.size() && candidates[c] <= block->last) {
+            c++;
+        }
+        ++block;
+    }
+    candidates.resize(kept);
+}
+
+void PostingList::append_to(std::vector<int>& out) const {
+    int ids[POSTING_BLOCK_SIZE];
+    for (const Block& block : blocks) {
+        size_t count = decode(block, ids);
+        out.insert(out.end(), ids, ids + count);
+    }
+}
+
+size_t PostingList::size() const {
+    return total;
+}
+
+size_t PostingList::memory_bytes() const {
+    size_t bytes = blocks.capacity() * sizeof(Block);
+    for (const Block& block : blocks) {
+        bytes += block.gaps.capacity();
+    }
+    return bytes;
+}
+
+/* SearchIndex */
+
+std::vector<std::string> SearchIndex::Tokenize(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::string token;
+    for (size_t i = 0; i <= text.size(); i++) {
+        unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+        bool ascii_word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        if (ascii_word || c >= 0x80) {
+            if (token.size() < MAX_TOKEN_LENGTH) {
+                token.push_back(static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c));
+            }
+        } else if (!token.empty()) {
+            tokens.push_back(token);
+            token.clear();
+        }
+    }
+    return tokens;
+}
+
+void SearchIndex::update(int task_id, const std::string& title, const std::string& description) {
+    size_t text_hash = std::hash<std::string>()(title + '\0' + description);
+    auto existing = docs.find(task_id);
+    if (existing != docs.end() && existing->second.text_hash == text_hash) {
+        return;
+    }
+    remove(task_id);
+    
+    std::map<std::string, std::pair<int, int>> counts;  // term -> (title hits, description hits)
+    for (const std::string& token : Tokenize(title)) {
+        counts[token].first++;
+    }
+    for (const std::string& token : Tokenize(description)) {
+        counts[token].second++;
+    }
+    
+    Doc& doc = docs[task_id];
+    doc.text_hash = text_hash;
+    doc.terms.reserve(counts.size());
+    for (const auto& pair : counts) {
+        DocTerm term;
+        term.term = pair.first;
+        term.title_hits = static_cast<uint16_t>(std::min(pair.second.first, 0xffff));
+        term.description_hits = static_cast<uint16_t>(std::min(pair.second.second, 0xffff));
+        doc.terms.push_back(term);
+        postings[pair.first].insert(task_id);
+    }
+}
+
+void SearchIndex::remove(int task_id) {
+    auto doc = docs.find(task_id);
+    if (doc == docs.end()) {
+        return;
+    }
+    for (const DocTerm& term : doc->second.terms) {
+        auto posting = postings.find(term.term);
+        posting->second.erase(task_id);
+        if (posting->second.size() == 0) {
+            postings.erase(posting);
+        }
+    }
+    docs.erase(doc);
+}
+
+void SearchIndex::clear() {
+    postings.clear();
+    docs.clear();
+}
+
+// Occurrences of the query tokens, the last one counting every term it is a prefix of
+int SearchIndex::score(const Doc& doc, const std::vector<std::string>& tokens) const {
+    int total = 0;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        bool prefix = i + 1 == tokens.size();
+        auto it = std::lower_bound(doc.terms.begin(), doc.terms.end(), tokens[i],
+                                   [](const DocTerm& term, const std::string& value) { return term.term < value; });
+        for (; it != doc.terms.end() && (prefix ? StartsWith(it->term, tokens[i]) : it->term == tokens[i]); ++it) {
+            total += it->title_hits * 3 + it->description_hits;
+        }
+    }
+    return total;
+}
+
+std::vector<SearchHit> SearchIndex::search(const std::string& query, size_t limit, int& total_matches) const {
+    std::vector<SearchHit> hits;
+    total_matches = 0;
+    std::vector<std::string> tokens = Tokenize(query);
+    if (tokens.empty() || limit == 0) {
+        return hits;
+    }
+    const std::string& prefix = tokens.back();
+    
+    // Whole tokens, rarest first so the candidate set starts small
+    std::vector<const PostingList*> lists;
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+        auto posting = postings.find(tokens[i]);
+        if (posting == postings.end()) {
+            return hits;
+        }
+        lists.push_back(&posting->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    
+    std::vector<int> candidates;
+    if (!lists.empty()) {
+        lists[0]->append_to(candidates);
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            lists[i]->intersect(candidates);
+        }
+        // The prefix is checked against each survivor's own terms rather than by merging
+        // the postings of every term it could complete to
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](int task_id) {
+            const std::vector<DocTerm>& terms = docs.at(task_id).terms;
+            auto it = std::lower_bound(terms.begin(), terms.end(), prefix,
+                                       [](const DocTerm& term, const std::string& value) { return term.term < value; });
+            return it == terms.end() || !StartsWith(it->term, prefix);
+        }), candidates.end());
+    } else {
+        for (auto it = postings.lower_bound(prefix); it != postings.end() && StartsWith(it->first, prefix); ++it) {
+            it->second.append_to(candidates);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+    
+    total_matches = static_cast<int>(candidates.size());
+    hits.reserve(candidates.size());
+    for (int task_id : candidates) {
+        hits.push_back(SearchHit(task_id, score(docs.at(task_id), tokens)));
+    }
+    size_t kept = std::min(limit, hits.size());
+    std::partial_sort(hits.begin(), hits.begin() + kept, hits.end(), [](const SearchHit& a, const SearchHit& b) {
+        return a.score != b.score ? a.score > b.score : a.task_id > b.task_id;
+    });
+    hits.erase(hits.begin() + kept, hits.end());
+    return hits;
+}
+
+size_t SearchIndex::term_count() const {
+    return postings.size();
+}
+
+size_t SearchIndex::posting_bytes() const {
+    size_t bytes = 0;
+    for (const auto& pair : postings) {
+        bytes += pair.second.memory_bytes();
+    }
+    return bytes;
+}
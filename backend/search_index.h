@@ -0,0 +1,88 @@
+#ifndef __SEARCH_INDEX_H__
+#define __SEARCH_INDEX_H__
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "messages.h"
+
+// Ids per posting block. A block is decoded whole, so this bounds the work of touching one id
+const size_t POSTING_BLOCK_SIZE = 128;
+
+// Tokens longer than this are cut, nobody types more of a word to find it
+const size_t MAX_TOKEN_LENGTH = 32;
+
+// Sorted task ids, in blocks of up to POSTING_BLOCK_SIZE. A block keeps its first and last
+// id and the gaps between the rest as varints, mostly a byte per id. Intersecting skips
+// every block whose range holds no candidate without decoding it
+class PostingList {
+private:
+    struct Block {
+        int first;
+        int last;
+        int count;
+        std::vector<uint8_t> gaps;  // Varint deltas, each id after first from the one before
+    };
+
+    std::vector<Block> blocks;
+    size_t total;
+
+    static void encode(const int* ids, size_t count, Block& block);
+    static size_t decode(const Block& block, int* out);  // out holds POSTING_BLOCK_SIZE ids
+    size_t block_for(int id) const;  // First block whose last id is >= id
+
+public:
+    PostingList();
+
+    bool insert(int id);  // False if already present
+    bool erase(int id);   // False if absent
+
+    // Keep only the candidates (sorted, no duplicates) that are in this list
+    void intersect(std::vector<int>& candidates) const;
+    void append_to(std::vector<int>& out) const;  // Every id, in order
+
+    size_t size() const;
+    size_t memory_bytes() const;
+};
+
+// Inverted index over task titles and descriptions. Text is cut into lowercase runs of
+// letters and digits (bytes of multi-byte UTF-8 characters count as letters). A query
+// matches tasks holding all of its tokens, the last one as a prefix so results follow
+// typing. Hits are ranked by how often the tokens occur, in the title three times over
+class SearchIndex {
+private:
+    struct DocTerm {
+        std::string term;
+        uint16_t title_hits;
+        uint16_t description_hits;
+    };
+
+    struct Doc {
+        size_t text_hash;             // Skips re-indexing when only the column or clock moved
+        std::vector<DocTerm> terms;   // Sorted by term
+    };
+
+    std::map<std::string, PostingList> postings;   // Ordered, a prefix is a range of terms
+    std::unordered_map<int, Doc> docs;
+
+    int score(const Doc& doc, const std::vector<std::string>& tokens) const;
+
+public:
+    static std::vector<std::string> Tokenize(const std::string& text);
+
+    // Index a task's current text, replacing what was indexed for it before
+    void update(int task_id, const std::string& title, const std::string& description);
+    void remove(int task_id);
+    void clear();
+
+    // Up to limit best hits, best first (ties newest task first). total_matches counts them all
+    std::vector<SearchHit> search(const std::string& query, size_t limit, int& total_matches) const;
+
+    size_t term_count() const;
+    size_t posting_bytes() const;
+};
+
+#endif
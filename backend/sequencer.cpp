@@ -0,0 +1,225 @@
+#include "sequencer.h"
+
+Sequencer::Sequencer(StateMachine& state_machine, ReplicationManager* replication_manager)
+    : sm(state_machine), replication(replication_manager), ring(new Slot[SEQUENCER_RING_SIZE]), tail(0), head(0),
+      next_entry_id(0), running(false), consumer_waiting(false), rounds(0), writes(0) {
+    for (size_t i = 0; i < SEQUENCER_RING_SIZE; i++) {
+        ring[i].sequence.store(i);
+        ring[i].write = nullptr;
+    }
+}
+
+Sequencer::~Sequencer() {
+    stop();
+    delete[] ring;
+}
+
+void Sequencer::start(int first_entry_id) {
+    if (running) {
+        return;
+    }
+    next_entry_id = first_entry_id;
+    running = true;
+    sequencer_thread = std::thread(&Sequencer::sequencer_worker, this);
+}
+
+void Sequencer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+    }
+    wake_cv.notify_all();
+    if (sequencer_thread.joinable()) {
+        sequencer_thread.join();
+    }
+}
+
+// Claim the slot at tail and fill it. A slot is free for position pos when its sequence
+// is pos, and published once it is pos + 1
+bool Sequencer::publish(Write* write) {
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+    while (true) {
+        if (!running) {
+            return false;
+        }
+        Slot& slot = ring[pos & (SEQUENCER_RING_SIZE - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == pos) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.write = write;
+                slot.sequence.store(pos + 1);
+                return true;
+            }
+        } else if (sequence < pos) {
+            // Full, the sequencer hasn't taken this slot's write from the previous lap yet
+            std::this_thread::yield();
+            pos = tail.load(std::memory_order_relaxed);
+        } else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Sequencer::ready() const {
+    return ring[head & (SEQUENCER_RING_SIZE - 1)].sequence.load() == head + 1;
+}
+
+WriteOutcome Sequencer::submit(const WriteFn& apply, const std::vector<Task>* imported) {
+    Write write;
+    write.apply = &apply;
+    write.imported = imported;
+    write.outcome = WriteOutcome::COMMITTED;
+    std::future<void> done = write.done.get_future();
+    if (!publish(&write)) {
+        return WriteOutcome::STOPPED;
+    }
+    
+    // The sequencer sets consumer_waiting before its last look at the ring, so either it
+    // sees this write or this thread sees it waiting
+    if (consumer_waiting) {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_cv.notify_one();
+    }
+    done.wait();
+    return write.outcome;
+}
+
+void Sequencer::sequencer_worker() {
+    std::vector<Write*> round;
+    round.reserve(MAX_SEQUENCER_ROUND);
+    
+    while (true) {
+        while (round.size() < MAX_SEQUENCER_ROUND && ready()) {
+            Slot& slot = ring[head & (SEQUENCER_RING_SIZE - 1)];
+            round.push_back(slot.write);
+            slot.sequence.store(head + SEQUENCER_RING_SIZE, std::memory_order_release);
+            head++;
+        }
+        if (!round.empty()) {
+            run_round(round);
+            round.clear();
+            continue;
+        }
+        if (!running) {
+            break;
+        }
+        
+        consumer_waiting = true;
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_cv.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+                return ready() || !running;
+            });
+        }
+        consumer_waiting = false;
+    }
+}
+
+void Sequencer::run_round(std::vector<Write*>& round) {
+    // Required to have a backup and none could ack, so nothing is applied: the writes are
+    // retried once a backup is back. A backup lost after this point leaves the round
+    // applied here and NOT_REPLICATED
+    if (replication && replication->requires_backup() && !replication->has_backups()) {
+        for (Write* write : round) {
+            write->outcome = WriteOutcome::UNAVAILABLE;
+            write->done.set_value();
+        }
+        return;
+    }
+    
+    std::vector<LogEntry> logged;
+    std::vector<size_t> counts;
+    counts.reserve(round.size());
+    for (Write* write : round) {
+        std::vector<LogEntry> entries = (*write->apply)(next_entry_id);
+        next_entry_id += static_cast<int>(entries.size());
+        counts.push_back(entries.size());
+        logged.insert(logged.end(), entries.begin(), entries.end());
+    }
+    
+    // Logged uncommitted when there are backups, the change feed publishes entries once they hold them
+    sm.append_batch_to_log(logged, !replication);
+    
+    if (replication && !logged.empty()) {
+        // Single-op entries travel as one BATCH, an import is its own message in between.
+        // A write whose entries missed the quorum is reported as such
+        size_t run_start = 0;
+        size_t run_first_write = 0;
+        size_t pos = 0;
+        bool prefix_acked = true;
+        int commit_entry_id = -1;  // Last entry of the round's acked prefix
+        for (size_t i = 0; i <= round.size(); i++) {
+            bool import = i < round.size() && round[i]->imported && counts[i] > 0;
+            if (i == round.size() || import) {
+                bool acked = true;
+                if (pos - run_start == 1) {
+                    acked = replication->replicate_entry(logged[run_start]);
+                } else if (pos > run_start) {
+                    acked = replication->replicate_batch(std::vector<LogEntry>(logged.begin() + run_start, logged.begin() + pos));
+                }
+                for (size_t w = run_first_write; w < i; w++) {
+                    if (!acked && counts[w] > 0) {
+                        round[w]->outcome = WriteOutcome::NOT_REPLICATED;
+                    }
+                }
+                prefix_acked = prefix_acked && acked;
+                if (prefix_acked && pos > run_start) {
+                    commit_entry_id = logged[pos - 1].get_entry_id();
+                }
+                if (import) {
+                    if (!replication->replicate_import(logged[pos], *round[i]->imported)) {
+                        round[i]->outcome = WriteOutcome::NOT_REPLICATED;
+                        prefix_acked = false;
+                    }
+                    if (prefix_acked) {
+                        commit_entry_id = logged[pos + counts[i] - 1].get_entry_id();
+                    }
+                }
+                run_start = pos + (import ? counts[i] : 0);
+                run_first_write = i + 1;
+            }
+            if (i < round.size()) {
+                pos += counts[i];
+            }
+        }
+        
+        // Entries behind one that missed the quorum wait with it: a later round a quorum acks
+        // commits them all, its backups caught up on everything before it when they reconnected
+        if (commit_entry_id >= 0) {
+            sm.mark_committed(commit_entry_id);
+        }
+    }
+    
+    rounds++;
+    writes += round.size();
+    for (Write* write : round) {
+        write->done.set_value();
+    }
+}
+
+bool ReportWriteOutcome(WriteOutcome outcome, OperationResponse& response) {
+    switch (outcome) {
+        case WriteOutcome::UNAVAILABLE:
+            response.busy = true;
+            response.retry_after_ms = NO_BACKUP_RETRY_AFTER_MS;
+            return false;
+        case WriteOutcome::STOPPED:
+            response.success = false;
+            return false;
+        case WriteOutcome::NOT_REPLICATED:
+            response.unconfirmed = true;
+            return true;
+        default:
+            return true;
+    }
+}
+
+size_t Sequencer::round_count() const {
+    return rounds;
+}
+
+size_t Sequencer::write_count() const {
+    return writes;
+}
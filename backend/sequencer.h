@@ -0,0 +1,107 @@
+#ifndef __SEQUENCER_H__
+#define __SEQUENCER_H__
+
+#include <vector>
+#include <functional>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "state_machine.h"
+#include "replication.h"
+#include "messages.h"
+
+// Slots in the ring, a power of two. Writers spin (yielding) while it is full
+const size_t SEQUENCER_RING_SIZE = 4096;
+
+// Writes taken off the ring per round, logged together and replicated in one round trip
+const size_t MAX_SEQUENCER_ROUND = 512;
+
+// How a submitted write ended
+enum class WriteOutcome {
+    COMMITTED,       // Applied, logged and acked by the backup quorum (if there are backups)
+    NOT_REPLICATED,  // Applied and logged here, but its entries didn't reach the backup quorum
+    UNAVAILABLE,     // A backup is required and none was on the write path, the write never ran
+    STOPPED          // The sequencer isn't running, the write never ran
+};
+
+// Retry-after on a write turned away because no backup is on the write path
+const int NO_BACKUP_RETRY_AFTER_MS = 1000;
+
+// What the client is told about a write that ended with outcome. False if it never ran:
+// turned away for want of a backup is BUSY, stopped is failed. True if it ran, and then
+// response keeps the write's own result; a write that missed the backup quorum is marked
+// unconfirmed rather than failed, since it is on the board and retrying would apply it twice
+bool ReportWriteOutcome(WriteOutcome outcome, OperationResponse& response);
+
+// Single writer for the master's log. Client threads publish writes into a lock-free
+// multi-producer ring; one sequencer thread takes them in ring order and, for each round
+// of whatever has been published:
+//   turns the round away (UNAVAILABLE) if it requires a backup but none is on the write path
+//   applies each write (its TaskManager change), numbering its entries from next_entry_id
+//   appends the round's entries to the StateMachine in one call, uncommitted
+//   replicates them to the backups as one BATCH (imports go as IMPORT_TASKS), waiting for quorum
+//   commits what the quorum acked, which the change feed then publishes
+//   completes the writes, whose threads then answer their clients
+// Apply order, entry ids, log order and replication order are therefore one order, and
+// while a round waits for backup acks the next one gathers in the ring (group commit)
+class Sequencer {
+public:
+    // Runs on the sequencer thread: apply the write and return its log entries, numbered
+    // consecutively from first_entry_id (none if it changed nothing)
+    typedef std::function<std::vector<LogEntry>(int first_entry_id)> WriteFn;
+
+private:
+    struct Write {
+        const WriteFn* apply;
+        const std::vector<Task>* imported;  // IMPORT_TASKS payload, replicated after its marker
+        WriteOutcome outcome;
+        std::promise<void> done;
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;  // Position it can be claimed at, or published at + 1
+        Write* write;
+    };
+
+    StateMachine& sm;
+    ReplicationManager* replication;
+    Slot* ring;
+    std::atomic<uint64_t> tail;      // Next position a writer claims
+    uint64_t head;                   // Next position the sequencer takes, its thread only
+    int next_entry_id;               // Sequencer thread only once started
+
+    std::atomic<bool> running;
+    std::atomic<bool> consumer_waiting;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::thread sequencer_thread;
+
+    std::atomic<size_t> rounds;
+    std::atomic<size_t> writes;
+
+    bool publish(Write* write);
+    bool ready() const;
+    void sequencer_worker();
+    void run_round(std::vector<Write*>& round);
+
+public:
+    Sequencer(StateMachine& state_machine, ReplicationManager* replication_manager);
+    ~Sequencer();
+
+    // First entry is numbered first_entry_id
+    void start(int first_entry_id);
+    // Writes already published are completed first
+    void stop();
+
+    // Run apply on the sequencer thread after every write published before it. Returns
+    // once its entries are logged and replicated, with how that went
+    WriteOutcome submit(const WriteFn& apply, const std::vector<Task>* imported = nullptr);
+
+    size_t round_count() const;
+    size_t write_count() const;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Snapshot::Snapshot() : fd(-1), data(nullptr), length(0), header(nullptr), records(nullptr) {}
+
+Snapshot::~Snapshot() {
+    if (data) {
+        munmap(const_cast<char*>(data), length);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+static bool InBounds(uint64_t offset, uint64_t size, size_t length) {
+    return offset <= length && size <= length - offset;
+}
+
+bool Snapshot::Open(const std::string& path) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    length = st.st_size;
+
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const char*>(mapped);
+    header = reinterpret_cast<const SnapshotHeader*>(data);
+
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        !InBounds(header->table_offset, static_cast<uint64_t>(header->task_count) * sizeof(SnapshotRecord), length) ||
+        header->table_offset % alignof(SnapshotRecord) != 0 ||
+        !InBounds(header->pool_offset, header->pool_size, length) ||
+        !InBounds(header->log_offset, header->log_size, length)) {
+        return false;
+    }
+    records = reinterpret_cast<const SnapshotRecord*>(data + header->table_offset);
+    return true;
+}
+
+size_t Snapshot::TaskCount() const {
+    return header ? header->task_count : 0;
+}
+
+int Snapshot::IdCounter() const {
+    return header ? header->id_counter : 0;
+}
+
+int Snapshot::Find(int task_id) const {
+    const SnapshotRecord* end = records + TaskCount();
+    const SnapshotRecord* it = std::lower_bound(records, end, task_id,
+        [](const SnapshotRecord& record, int id) { return record.task_id < id; });
+    if (it == end || it->task_id != task_id) {
+        return -1;
+    }
+    return static_cast<int>(it - records);
+}
+
+size_t Snapshot::FirstAfter(int task_id) const {
+    const SnapshotRecord* end = records + TaskCount();
+    const SnapshotRecord* it = std::upper_bound(records, end, task_id,
+        [](int id, const SnapshotRecord& record) { return id < record.task_id; });
+    return static_cast<size_t>(it - records);
+}
+
+const SnapshotRecord& Snapshot::Record(size_t index) const {
+    return records[index];
+}
+
+bool Snapshot::Materialize(size_t index, Task& task) const {
+    const SnapshotRecord& record = records[index];
+    if (!InBounds(record.offset, record.size, header->pool_size)) {
+        return false;
+    }
+    return task.Unmarshal(data + header->pool_offset + record.offset, static_cast<int>(record.size));
+}
+
+bool Snapshot::ReadLog(std::vector<LogEntry>& log) const {
+    const char* pos = data + header->log_offset;
+    const char* end = pos + header->log_size;
+    log.clear();
+
+    uint32_t count;
+    if (static_cast<size_t>(end - pos) < sizeof(count)) {
+        return header->log_size == 0;
+    }
+    memcpy(&count, pos, sizeof(count));
+    pos += sizeof(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t size;
+        if (static_cast<size_t>(end - pos) < sizeof(size)) {
+            return false;
+        }
+        memcpy(&size, pos, sizeof(size));
+        pos += sizeof(size);
+        if (static_cast<size_t>(end - pos) < size) {
+            return false;
+        }
+        LogEntry entry(-1, OpType::CREATE_TASK, VectorClock(0), -1, "", "", "", Column::TODO, 0);
+        if (!entry.Unmarshal(pos, static_cast<int>(size))) {
+            return false;
+        }
+        log.push_back(entry);
+        pos += size;
+    }
+    return true;
+}
+
+bool WriteSnapshot(const std::string& path, const std::vector<Task>& tasks, const std::vector<int>& applied_entry_ids,
+                   int id_counter, const std::vector<LogEntry>& log) {
+    // Offset table sorted by task_id
+    std::vector<size_t> order(tasks.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&tasks](size_t a, size_t b) {
+        return tasks[a].get_task_id() < tasks[b].get_task_id();
+    });
+
+    std::vector<SnapshotRecord> table(tasks.size());
+    std::vector<char> pool;
+    for (size_t i = 0; i < order.size(); i++) {
+        const Task& task = tasks[order[i]];
+        SnapshotRecord& record = table[i];
+        record.task_id = task.get_task_id();
+        record.applied_entry_id = applied_entry_ids[order[i]];
+        record.offset = pool.size();
+        record.size = static_cast<uint32_t>(task.Marshal(pool));
+        record.reserved = 0;
+    }
+
+    std::vector<char> log_blob(sizeof(uint32_t));
+    uint32_t log_count = log.size();
+    memcpy(log_blob.data(), &log_count, sizeof(log_count));
+    for (const LogEntry& entry : log) {
+        size_t at = log_blob.size();
+        log_blob.resize(at + sizeof(uint32_t));
+        uint32_t size = static_cast<uint32_t>(entry.Marshal(log_blob));
+        memcpy(log_blob.data() + at, &size, sizeof(size));
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.task_count = tasks.size();
+    header.id_counter = id_counter;
+    header.table_offset = sizeof(SnapshotHeader);
+    header.pool_offset = header.table_offset + table.size() * sizeof(SnapshotRecord);
+    header.pool_size = pool.size();
+    header.log_offset = header.pool_offset + pool.size();
+    header.log_size = log_blob.size();
+
+    std::string tmp_path = path + ".tmp";
+    FILE* out = fopen(tmp_path.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              (table.empty() || fwrite(table.data(), sizeof(SnapshotRecord), table.size(), out) == table.size()) &&
+              (pool.empty() || fwrite(pool.data(), 1, pool.size(), out) == pool.size()) &&
+              fwrite(log_blob.data(), 1, log_blob.size(), out) == log_blob.size();
+    ok = (fclose(out) == 0) && ok;
+
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
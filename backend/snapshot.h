@@ -0,0 +1,74 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "messages.h"
+
+// On-disk snapshot of a node's state, written at shutdown and mmap'd at startup.
+// Layout (native byte order, the file never leaves the host that wrote it):
+//   SnapshotHeader
+//   SnapshotRecord[task_count]   offset table, sorted by task_id
+//   task pool                    marshalled Tasks, same encoding as the wire
+//   log                          count, then size-prefixed marshalled LogEntries
+// Tasks are only unmarshalled when first touched, so opening costs page faults, not parsing
+
+const char SNAPSHOT_MAGIC[8] = {'K', 'B', 'S', 'N', 'A', 'P', '0', '2'};  // 02: tasks and entries carry a rank
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t task_count;
+    int32_t id_counter;
+    uint64_t table_offset;
+    uint64_t pool_offset;
+    uint64_t pool_size;
+    uint64_t log_offset;
+    uint64_t log_size;
+};
+
+struct SnapshotRecord {
+    int32_t task_id;
+    int32_t applied_entry_id;  // Last log entry applied to the task, -1 if none
+    uint64_t offset;           // Into the task pool
+    uint32_t size;
+    uint32_t reserved;
+};
+
+class Snapshot {
+private:
+    int fd;
+    const char* data;
+    size_t length;
+    const SnapshotHeader* header;
+    const SnapshotRecord* records;
+
+public:
+    Snapshot();
+    ~Snapshot();
+
+    // Map path and validate the header and section bounds
+    bool Open(const std::string& path);
+
+    size_t TaskCount() const;
+    int IdCounter() const;
+
+    // Index of task_id in the offset table, -1 if the snapshot doesn't hold it
+    int Find(int task_id) const;
+    // Index of the first record with an id above task_id, TaskCount() if there is none
+    size_t FirstAfter(int task_id) const;
+    const SnapshotRecord& Record(size_t index) const;
+
+    // Unmarshal the task at index, false if its record points outside the pool or doesn't decode
+    bool Materialize(size_t index, Task& task) const;
+
+    // Log is small next to the board and read eagerly
+    bool ReadLog(std::vector<LogEntry>& log) const;
+};
+
+// Write a snapshot to path (via a temporary file and rename, so a mapped old snapshot stays valid).
+// applied_entry_ids[i] belongs to tasks[i]
+bool WriteSnapshot(const std::string& path, const std::vector<Task>& tasks, const std::vector<int>& applied_entry_ids,
+                   int id_counter, const std::vector<LogEntry>& log);
+
+#endif
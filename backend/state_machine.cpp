@@ -1,13 +1,66 @@
 #include "state_machine.h"
 #include <algorithm>
+#include <thread>
+#include <chrono>
 
-StateMachine::StateMachine() : next_entry_id(0) {}
+// Below this many entries thread start-up costs more than the replay itself
+static const size_t PARALLEL_REPLAY_MIN_ENTRIES = 4096;
+
+StateMachine::StateMachine() : next_entry_id(0), applied_entry_id(-1), committed_entry_id(-1) {}
+
+static bool EntryIdLess(int entry_id, const LogEntry& entry) {
+    return entry_id < entry.get_entry_id();
+}
+
+// Append operation to log. The log is kept ordered by entry_id, an entry that lost
+// the race to the log behind a later id is slotted in before it
+void StateMachine::insert_locked(const LogEntry& entry) {
+    if (log.empty() || log.back().get_entry_id() <= entry.get_entry_id()) {
+        log.push_back(entry);
+    } else {
+        log.insert(std::upper_bound(log.begin(), log.end(), entry.get_entry_id(), EntryIdLess), entry);
+    }
+    next_entry_id++;
+}
 
-// Append operation to log
 void StateMachine::append_to_log(const LogEntry& entry) {
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        insert_locked(entry);
+        committed_entry_id = std::max(committed_entry_id, entry.get_entry_id());
+    }
+    log_cv.notify_all();
+}
+
+void StateMachine::append_batch_to_log(const std::vector<LogEntry>& entries, bool committed) {
+    if (entries.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        for (const LogEntry& entry : entries) {
+            insert_locked(entry);
+            if (committed) {
+                committed_entry_id = std::max(committed_entry_id, entry.get_entry_id());
+            }
+        }
+    }
+    if (committed) {
+        log_cv.notify_all();
+    }
+}
+
+void StateMachine::mark_committed(int entry_id) {
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        committed_entry_id = std::max(committed_entry_id, entry_id);
+    }
+    log_cv.notify_all();
+}
+
+int StateMachine::get_committed_entry_id() const {
     std::lock_guard<std::mutex> lock(log_mutex);
-    log.push_back(entry);
-    next_entry_id++;
+    return committed_entry_id;
 }
 
 // Get entire log (thread-safe copy)
@@ -19,56 +72,180 @@ std::vector<LogEntry> StateMachine::get_log() const {
 // Get log entries after given entry_id
 std::vector<LogEntry> StateMachine::get_log_after(int entry_id) const {
     std::lock_guard<std::mutex> lock(log_mutex);
-    std::vector<LogEntry> result;
+    auto first = std::upper_bound(log.begin(), log.end(), entry_id, EntryIdLess);
+    return std::vector<LogEntry>(first, log.end());
+}
+
+std::vector<LogEntry> StateMachine::get_log_after(int entry_id, size_t max_entries) const {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    auto first = std::upper_bound(log.begin(), log.end(), entry_id, EntryIdLess);
+    auto last = first + std::min(max_entries, static_cast<size_t>(log.end() - first));
+    return std::vector<LogEntry>(first, last);
+}
+
+// Wait for committed entries after entry_id (change feed). Returns an empty batch on timeout
+std::vector<LogEntry> StateMachine::wait_for_entries_after(int entry_id, size_t max_entries, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(log_mutex);
+    log_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, entry_id]() {
+        return committed_entry_id > entry_id;
+    });
     
-    for (const auto& entry : log) {
-        if (entry.get_entry_id() > entry_id) {
-            result.push_back(entry);
-        }
+    auto first = std::upper_bound(log.begin(), log.end(), entry_id, EntryIdLess);
+    auto end = std::upper_bound(first, log.end(), committed_entry_id, EntryIdLess);
+    auto last = first + std::min(max_entries, static_cast<size_t>(end - first));
+    return std::vector<LogEntry>(first, last);
+}
+
+void StateMachine::mark_applied(int entry_id) {
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        applied_entry_id = std::max(applied_entry_id, entry_id);
     }
+    log_cv.notify_all();
+}
+
+int StateMachine::wait_for_applied(int min_entry_id, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(log_mutex);
+    log_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, min_entry_id]() {
+        return applied_entry_id >= min_entry_id;
+    });
+    return applied_entry_id;
+}
+
+int StateMachine::get_applied_entry_id() const {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    return applied_entry_id;
+}
+
+// Apply one entry keyed by its task_id and entry_id. Re-delivered entries are no-ops
+bool StateMachine::apply_entry(TaskManager& tm, const LogEntry& entry) {
+    OpType op = entry.get_op_type();
+    const VectorClock& vc = entry.get_timestamp();
     
-    return result;
+    switch (op) {
+        case OpType::CREATE_TASK:
+            if (entry.get_task_id() < 0) {
+                // Entries without an explicit id can only be replayed through the local counter
+                return tm.create_task(entry.get_title(), entry.get_description(), "board-1", entry.get_created_by(),
+                                      entry.get_column(), entry.get_client_id()) >= 0;
+            }
+            if (!tm.mark_entry_applied(entry.get_task_id(), entry.get_entry_id())) {
+                return false;
+            }
+            tm.create_task_with_id(entry.get_task_id(), entry.get_title(), entry.get_description(), "board-1",
+                                   entry.get_created_by(), entry.get_column(), entry.get_client_id(), entry.get_rank());
+            return true;
+            
+        case OpType::UPDATE_TASK:
+            if (!tm.mark_entry_applied(entry.get_task_id(), entry.get_entry_id())) {
+                return false;
+            }
+            tm.update_task(entry.get_task_id(), entry.get_title(), entry.get_description(), vc);
+            return true;
+            
+        case OpType::MOVE_TASK:
+            if (!tm.mark_entry_applied(entry.get_task_id(), entry.get_entry_id())) {
+                return false;
+            }
+            tm.move_task(entry.get_task_id(), entry.get_column(), vc, entry.get_rank());
+            return true;
+            
+        case OpType::REORDER_TASK:
+            if (!tm.mark_entry_applied(entry.get_task_id(), entry.get_entry_id())) {
+                return false;
+            }
+            tm.place_task(entry.get_task_id(), entry.get_column(), entry.get_rank(), vc);
+            return true;
+            
+        case OpType::DELETE_TASK:
+            if (!tm.mark_entry_applied(entry.get_task_id(), entry.get_entry_id())) {
+                return false;
+            }
+            tm.delete_task(entry.get_task_id());
+            return true;
+            
+        case OpType::GET_BOARD:
+        case OpType::GET_BOARD_SINCE:
+        case OpType::SUBSCRIBE:
+        case OpType::FOLLOWER_READ:
+        case OpType::QUERY:
+        case OpType::SEARCH:
+        case OpType::GET_BOARD_JSON:
+            // Reads are not state-changing operations, skip in replay
+            break;
+            
+        case OpType::HEARTBEAT_PING:
+        case OpType::HEARTBEAT_ACK:
+        case OpType::MASTER_REJOIN:
+        case OpType::STATE_TRANSFER_REQUEST:
+        case OpType::STATE_TRANSFER_RESPONSE:
+        case OpType::DEMOTE_ACK:
+        case OpType::REPLICATION_INIT:
+        case OpType::CONTROL_INIT:
+        case OpType::COMPRESSION_HELLO:
+        case OpType::LEADER_QUERY:
+        case OpType::WIRE_HELLO:
+        case OpType::BATCH:
+            // Control messages (a BATCH is logged as its individual entries) are not state-changing, skip
+            break;
+            
+        case OpType::IMPORT_TASKS:
+            // Only marks where an import happened, the tasks reach replicas as a task list
+            // and rejoining nodes through state transfer
+            break;
+    }
+    return false;
 }
 
-// Replay log entries on TaskManager with vector clock conflict detection
+// Replay log entries on TaskManager with vector clock conflict detection.
+// Entries are partitioned by task_id so each worker owns a disjoint set of tasks and
+// applies them in log order on a private shard, which is then folded back into tm
 void StateMachine::replay_log(TaskManager& tm, const std::vector<LogEntry>& entries) {
+    unsigned int workers = std::thread::hardware_concurrency();
+    bool parallel = entries.size() >= PARALLEL_REPLAY_MIN_ENTRIES && workers > 1;
+    
     for (const auto& entry : entries) {
-        OpType op = entry.get_op_type();
-        const VectorClock& vc = entry.get_timestamp();
-        
-        switch (op) {
-            case OpType::CREATE_TASK:
-                // Use full create_task with all fields from log entry
-                tm.create_task(entry.get_title(), entry.get_description(), "board-1", entry.get_created_by(),
-                              entry.get_column(), entry.get_client_id());
-                break;
-                
-            case OpType::UPDATE_TASK:
-                tm.update_task(entry.get_task_id(), entry.get_title(), entry.get_description(), vc);
-                break;
-                
-            case OpType::MOVE_TASK:
-                tm.move_task(entry.get_task_id(), entry.get_column(), vc);
-                break;
-                
-            case OpType::DELETE_TASK:
-                tm.delete_task(entry.get_task_id());
-                break;
-                
-            case OpType::GET_BOARD:
-                // GET_BOARD is not a state-changing operation, skip in replay
-                break;
-                
-            case OpType::HEARTBEAT_PING:
-            case OpType::HEARTBEAT_ACK:
-            case OpType::MASTER_REJOIN:
-            case OpType::STATE_TRANSFER_REQUEST:
-            case OpType::STATE_TRANSFER_RESPONSE:
-            case OpType::DEMOTE_ACK:
-            case OpType::REPLICATION_INIT:
-                // Control messages are not state-changing, skip
-                break;
+        if (entry.get_task_id() < 0) {
+            parallel = false; // Counter-assigned creates depend on global order
+            break;
+        }
+    }
+    
+    if (!parallel) {
+        for (const auto& entry : entries) {
+            apply_entry(tm, entry);
         }
+        return;
+    }
+    
+    std::vector<std::vector<const LogEntry*>> partitions(workers);
+    for (const auto& entry : entries) {
+        partitions[static_cast<unsigned int>(entry.get_task_id()) % workers].push_back(&entry);
+    }
+    
+    std::vector<std::thread> threads;
+    for (unsigned int w = 0; w < workers; w++) {
+        if (partitions[w].empty()) continue;
+        
+        threads.emplace_back([&tm, &partitions, w]() {
+            std::vector<int> task_ids;
+            for (const LogEntry* entry : partitions[w]) {
+                task_ids.push_back(entry->get_task_id());
+            }
+            std::sort(task_ids.begin(), task_ids.end());
+            task_ids.erase(std::unique(task_ids.begin(), task_ids.end()), task_ids.end());
+            
+            TaskManager shard;
+            tm.seed_shard(shard, task_ids);
+            for (const LogEntry* entry : partitions[w]) {
+                apply_entry(shard, *entry);
+            }
+            tm.absorb_shard(shard, task_ids);
+        });
+    }
+    
+    for (auto& t : threads) {
+        t.join();
     }
 }
 
@@ -82,17 +259,25 @@ size_t StateMachine::get_log_size() const {
 void StateMachine::set_log(const std::vector<LogEntry>& new_log) {
     std::lock_guard<std::mutex> lock(log_mutex);
     log = new_log;
+    std::stable_sort(log.begin(), log.end(), [](const LogEntry& a, const LogEntry& b) {
+        return a.get_entry_id() < b.get_entry_id();
+    });
     if (!log.empty()) {
         next_entry_id = log.back().get_entry_id() + 1;
     } else {
         next_entry_id = 0;
     }
+    // A replaced log comes with the state it produced
+    applied_entry_id = next_entry_id - 1;
+    committed_entry_id = next_entry_id - 1;
 }
 
 void StateMachine::clear_log() {
     std::lock_guard<std::mutex> lock(log_mutex);
     log.clear();
     next_entry_id = 0;
+    applied_entry_id = -1;
+    committed_entry_id = -1;
 }
 
 int StateMachine::get_next_entry_id() const {
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include "messages.h"
 #include "task_manager.h"
 
@@ -11,23 +12,50 @@ class StateMachine {
 private:
     std::vector<LogEntry> log;
     mutable std::mutex log_mutex;
+    std::condition_variable log_cv;  // Signalled on append and commit, wakes change feed subscribers
     int next_entry_id;
+    int applied_entry_id;  // Highest entry applied to the TaskManager, bounds follower reads
+    int committed_entry_id;  // Highest entry the change feed may publish, everything up to it is committed
+    
+    void insert_locked(const LogEntry& entry);
 
 public:
     StateMachine();
     
-    // Append operation to log
+    // Append operation to log, committed at once
     void append_to_log(const LogEntry& entry);
     
+    // Append a BATCH's run of entries under one lock with a single wake-up. The master's
+    // sequencer appends them uncommitted and commits them once the backups have acked
+    void append_batch_to_log(const std::vector<LogEntry>& entries, bool committed = true);
+    
+    // Let the change feed publish entries up to entry_id
+    void mark_committed(int entry_id);
+    int get_committed_entry_id() const;
+    
     // Get entire log
     std::vector<LogEntry> get_log() const;
     
     // Get log entries after given id
     std::vector<LogEntry> get_log_after(int entry_id) const;
+    std::vector<LogEntry> get_log_after(int entry_id, size_t max_entries) const;  // At most max_entries
     
-    // Replay log entries on TaskManager
+    // Block until committed entries after entry_id exist or timeout_ms passes, returns at
+    // most max_entries of them
+    std::vector<LogEntry> wait_for_entries_after(int entry_id, size_t max_entries, int timeout_ms);
+    
+    // Follower reads: record an applied entry, or block until min_entry_id is applied or
+    // timeout_ms passes. Returns the applied entry_id reached
+    void mark_applied(int entry_id);
+    int wait_for_applied(int min_entry_id, int timeout_ms);
+    int get_applied_entry_id() const;
+    
+    // Replay log entries on TaskManager, disjoint tasks are replayed in parallel
     void replay_log(TaskManager& tm, const std::vector<LogEntry>& entries);
     
+    // Apply a single entry by its explicit task_id, returns false if it was already applied
+    static bool apply_entry(TaskManager& tm, const LogEntry& entry);
+    
     // Get log size
     size_t get_log_size() const;
     
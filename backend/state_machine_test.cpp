@@ -1,6 +1,11 @@
 #include <iostream>
 #include <cassert>
+#include <thread>
+#include <chrono>
 #include "state_machine.h"
+#include "apply_pipeline.h"
+#include "sequencer.h"
+#include "admission.h"
 #include "task_manager.h"
 #include "messages.h"
 
@@ -196,6 +201,412 @@ void test_replay_reconstructs_state() {
     std::cout << " PASSED\n";
 }
 
+void test_replay_uses_explicit_task_ids() {
+    std::cout << "Testing replay uses explicit task ids..." << std::flush;
+    
+    StateMachine sm;
+    TaskManager tm;
+    VectorClock vc(0);
+    
+    // Ids 0 and 1 were created and deleted on the master before these entries
+    LogEntry entry1(5, OpType::CREATE_TASK, vc, 2, "Task 2", "Desc", "user", Column::TODO, 1);
+    LogEntry entry2(6, OpType::CREATE_TASK, vc, 7, "Task 7", "Desc", "user", Column::DONE, 1);
+    sm.append_to_log(entry1);
+    sm.append_to_log(entry2);
+    
+    sm.replay_log(tm, sm.get_log());
+    
+    assert(tm.get_task_count() == 2);
+    assert(tm.get_task(2).get_title() == "Task 2");
+    assert(tm.get_task(7).get_column() == Column::DONE);
+    assert(tm.get_id_counter() == 8);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_replay_is_idempotent() {
+    std::cout << "Testing re-delivered entries are no-ops..." << std::flush;
+    
+    TaskManager tm;
+    VectorClock vc(0);
+    
+    LogEntry create(0, OpType::CREATE_TASK, vc, 0, "Task", "Desc", "user", Column::TODO, 1);
+    LogEntry move(1, OpType::MOVE_TASK, vc, 0, "", "", "", Column::IN_PROGRESS, 1);
+    LogEntry del(2, OpType::DELETE_TASK, vc, 0, "", "", "", Column::TODO, 1);
+    
+    assert(StateMachine::apply_entry(tm, create));
+    assert(!StateMachine::apply_entry(tm, create));
+    assert(tm.get_task_count() == 1);
+    
+    assert(StateMachine::apply_entry(tm, move));
+    assert(StateMachine::apply_entry(tm, del));
+    assert(tm.get_task_count() == 0);
+    
+    // The create arriving again after the delete must not resurrect the task
+    assert(!StateMachine::apply_entry(tm, create));
+    assert(!StateMachine::apply_entry(tm, move));
+    assert(tm.get_task_count() == 0);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_parallel_replay_matches_serial() {
+    std::cout << "Testing parallel replay matches serial replay..." << std::flush;
+    
+    std::vector<LogEntry> log;
+    VectorClock vc(0);
+    int entry_id = 0;
+    
+    // Enough entries to take the parallel path: create, move, update and delete interleaved
+    for (int i = 0; i < 5000; i++) {
+        log.push_back(LogEntry(entry_id++, OpType::CREATE_TASK, vc, i, "Task " + std::to_string(i), "Desc", "user", Column::TODO, 1));
+    }
+    for (int i = 0; i < 5000; i += 2) {
+        log.push_back(LogEntry(entry_id++, OpType::MOVE_TASK, vc, i, "", "", "", Column::DONE, 1));
+    }
+    for (int i = 0; i < 5000; i += 3) {
+        log.push_back(LogEntry(entry_id++, OpType::UPDATE_TASK, vc, i, "Renamed", "", "", Column::TODO, 1));
+    }
+    for (int i = 0; i < 5000; i += 5) {
+        log.push_back(LogEntry(entry_id++, OpType::DELETE_TASK, vc, i, "", "", "", Column::TODO, 1));
+    }
+    
+    TaskManager serial;
+    for (const LogEntry& entry : log) {
+        StateMachine::apply_entry(serial, entry);
+    }
+    
+    StateMachine sm;
+    TaskManager parallel;
+    sm.replay_log(parallel, log);
+    
+    assert(parallel.get_task_count() == serial.get_task_count());
+    assert(parallel.get_task_count() == 4000);
+    assert(parallel.get_id_counter() == serial.get_id_counter());
+    
+    std::vector<Task> expected = serial.get_all_tasks();
+    std::vector<Task> actual = parallel.get_all_tasks();
+    for (size_t i = 0; i < expected.size(); i++) {
+        assert(actual[i].get_task_id() == expected[i].get_task_id());
+        assert(actual[i].get_title() == expected[i].get_title());
+        assert(actual[i].get_column() == expected[i].get_column());
+    }
+    
+    // Replaying the same log again changes nothing
+    sm.replay_log(parallel, log);
+    assert(parallel.get_task_count() == 4000);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_wait_for_entries_after() {
+    std::cout << "Testing wait_for_entries_after..." << std::flush;
+    
+    StateMachine sm;
+    VectorClock vc(0);
+    
+    // Times out with nothing new
+    assert(sm.wait_for_entries_after(-1, 10, 10).empty());
+    
+    // Entries appended out of order are still handed out in entry_id order
+    sm.append_to_log(LogEntry(1, OpType::CREATE_TASK, vc, 1, "Task 1", "", "user", Column::TODO, 1));
+    sm.append_to_log(LogEntry(0, OpType::CREATE_TASK, vc, 0, "Task 0", "", "user", Column::TODO, 1));
+    std::vector<LogEntry> batch = sm.wait_for_entries_after(-1, 10, 10);
+    assert(batch.size() == 2);
+    assert(batch[0].get_entry_id() == 0);
+    assert(batch[1].get_entry_id() == 1);
+    
+    // A waiter is woken by a later append
+    std::thread writer([&sm, &vc]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sm.append_to_log(LogEntry(2, OpType::DELETE_TASK, vc, 0, "", "", "", Column::TODO, 1));
+    });
+    batch = sm.wait_for_entries_after(1, 10, 5000);
+    writer.join();
+    assert(batch.size() == 1);
+    assert(batch[0].get_entry_id() == 2);
+    
+    // max_entries caps the batch
+    assert(sm.wait_for_entries_after(-1, 2, 10).size() == 2);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_commit_watermark_bounds_feed() {
+    std::cout << "Testing commit watermark bounding the change feed..." << std::flush;
+    
+    StateMachine sm;
+    VectorClock vc(0);
+    std::vector<LogEntry> entries;
+    entries.push_back(LogEntry(0, OpType::CREATE_TASK, vc, 0, "Task 0", "", "user", Column::TODO, 1));
+    entries.push_back(LogEntry(1, OpType::CREATE_TASK, vc, 1, "Task 1", "", "user", Column::TODO, 1));
+    
+    // Logged but uncommitted entries are in the log, not in the feed
+    sm.append_batch_to_log(entries, false);
+    assert(sm.get_log_size() == 2);
+    assert(sm.get_committed_entry_id() == -1);
+    assert(sm.wait_for_entries_after(-1, 10, 10).empty());
+    
+    // Only the committed prefix is handed out
+    sm.mark_committed(0);
+    std::vector<LogEntry> batch = sm.wait_for_entries_after(-1, 10, 10);
+    assert(batch.size() == 1);
+    assert(batch[0].get_entry_id() == 0);
+    
+    // A waiter is woken by the commit, not the append
+    std::thread committer([&sm]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sm.mark_committed(1);
+    });
+    batch = sm.wait_for_entries_after(0, 10, 5000);
+    committer.join();
+    assert(batch.size() == 1);
+    assert(batch[0].get_entry_id() == 1);
+    
+    // A plain append commits as it logs
+    sm.append_to_log(LogEntry(2, OpType::DELETE_TASK, vc, 0, "", "", "", Column::TODO, 1));
+    assert(sm.get_committed_entry_id() == 2);
+    assert(sm.wait_for_entries_after(1, 10, 10).size() == 1);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_wait_for_applied() {
+    std::cout << "Testing wait_for_applied..." << std::flush;
+    
+    StateMachine sm;
+    
+    // Nothing applied yet, times out at -1
+    assert(sm.wait_for_applied(0, 10) == -1);
+    
+    // The watermark only moves forward
+    sm.mark_applied(3);
+    sm.mark_applied(1);
+    assert(sm.wait_for_applied(2, 10) == 3);
+    
+    // A waiter is woken once replication applies the entry it asked for
+    std::thread applier([&sm]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sm.mark_applied(5);
+    });
+    assert(sm.wait_for_applied(5, 5000) == 5);
+    applier.join();
+    
+    // A replaced log brings its state with it
+    VectorClock vc(0);
+    std::vector<LogEntry> log;
+    log.push_back(LogEntry(8, OpType::CREATE_TASK, vc, 0, "Task", "", "user", Column::TODO, 1));
+    sm.set_log(log);
+    assert(sm.wait_for_applied(8, 10) == 8);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_apply_pipeline_watermarks() {
+    std::cout << "Testing apply pipeline watermarks..." << std::flush;
+    
+    TaskManager tm;
+    StateMachine sm;
+    ApplyPipeline pipeline(tm, sm);
+    VectorClock vc(0);
+    std::vector<Task> no_tasks;
+    
+    std::vector<LogEntry> entries;
+    for (int i = 0; i < 3; i++) {
+        entries.push_back(LogEntry(i, OpType::CREATE_TASK, vc, i, "Task " + std::to_string(i), "", "user", Column::TODO, 1));
+    }
+    
+    // Without the apply thread entries are logged (and could be acked) but not applied
+    pipeline.mark_received(2);
+    assert(pipeline.submit(entries, no_tasks));
+    assert(pipeline.received() == 2);
+    assert(pipeline.durable() == 2);
+    assert(pipeline.applied() == -1);
+    assert(pipeline.backlog() == 3);
+    assert(sm.get_log_size() == 3);
+    assert(tm.get_task_count() == 0);
+    
+    // The apply thread catches up, in order
+    pipeline.start();
+    assert(sm.wait_for_applied(2, 5000) == 2);
+    assert(tm.get_task_count() == 3);
+    
+    // A re-delivered entry is queued again but neither logged nor applied twice
+    std::vector<LogEntry> again(1, entries[1]);
+    assert(pipeline.submit(again, no_tasks));
+    assert(sm.get_log_size() == 3);
+    
+    // Closed for promotion: everything queued is applied, nothing more is taken
+    pipeline.close();
+    assert(pipeline.backlog() == 0);
+    std::vector<LogEntry> late(1, LogEntry(3, OpType::CREATE_TASK, vc, 3, "Late", "", "user", Column::TODO, 1));
+    assert(!pipeline.submit(late, no_tasks));
+    assert(pipeline.durable() == 2);
+    
+    pipeline.reopen();
+    assert(pipeline.submit(late, no_tasks));
+    pipeline.stop();
+    assert(pipeline.applied() == 3);
+    assert(tm.get_task_count() == 4);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_sequencer_orders_concurrent_writes() {
+    std::cout << "Testing sequencer ordering under concurrent writers..." << std::flush;
+    
+    TaskManager tm;
+    StateMachine sm;
+    sm.set_next_entry_id(5);  // As if five entries had been recovered
+    Sequencer sequencer(sm, nullptr);
+    sequencer.start(sm.get_next_entry_id());
+    
+    // Every writer updates the same task, so its final title is whatever was applied last
+    tm.create_task_with_id(0, "Start", "", "board-1", "user", Column::TODO, 1);
+    std::vector<int> apply_order;  // Only touched on the sequencer thread
+    const int writers = 8;
+    const int writes_each = 200;
+    
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++) {
+        threads.emplace_back([&, w]() {
+            for (int i = 0; i < writes_each; i++) {
+                std::string title = "w" + std::to_string(w) + "-" + std::to_string(i);
+                int logged_id = -1;
+                Sequencer::WriteFn write = [&](int entry_id) {
+                    // Each write has seen the one before it, as a client reading the task would
+                    VectorClock vc = tm.get_task(0).get_clock();
+                    vc.increment();
+                    OperationResponse response = tm.update_task_with_conflict_detection(0, title, "", vc);
+                    assert(response.success && !response.conflict);
+                    apply_order.push_back(entry_id);
+                    logged_id = entry_id;
+                    return std::vector<LogEntry>(1, LogEntry(entry_id, OpType::UPDATE_TASK, vc, 0, title, "", "",
+                                                             Column::TODO, 1));
+                };
+                assert(sequencer.submit(write) == WriteOutcome::COMMITTED);
+                assert(logged_id >= 5);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    sequencer.stop();
+    
+    // Ids are handed out in apply order with no gaps, and the log holds them in that order
+    const int total = writers * writes_each;
+    assert(static_cast<int>(apply_order.size()) == total);
+    for (int i = 0; i < total; i++) {
+        assert(apply_order[i] == 5 + i);
+    }
+    std::vector<LogEntry> log = sm.get_log();
+    assert(static_cast<int>(log.size()) == total);
+    assert(sm.get_next_entry_id() == 5 + total);
+    
+    // The last logged update is the one the task shows
+    assert(tm.get_task(0).get_title() == log.back().get_title());
+    assert(sequencer.write_count() == static_cast<size_t>(total));
+    assert(sequencer.round_count() <= sequencer.write_count());
+    
+    // A stopped sequencer turns writes away
+    Sequencer::WriteFn late = [](int) { return std::vector<LogEntry>(); };
+    assert(sequencer.submit(late) == WriteOutcome::STOPPED);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_sequencer_refuses_writes_without_backups() {
+    std::cout << "Testing sequencer refusing writes with no backup on the write path..." << std::flush;
+    
+    // A backup that never answers the handshake stays off the write path
+    StateMachine sm;
+    ReplicationManager replication(0);
+    replication.add_backup("127.0.0.1", 1);
+    assert(!replication.has_backups());
+    
+    Sequencer sequencer(sm, &replication);
+    sequencer.start(0);
+    int applied = 0;
+    Sequencer::WriteFn write = [&](int entry_id) {
+        applied++;
+        VectorClock vc(1);
+        return std::vector<LogEntry>(1, LogEntry(entry_id, OpType::CREATE_TASK, vc, 0, "T", "", "user",
+                                                 Column::TODO, 1));
+    };
+    
+    // By default the write is served without a backup
+    assert(sequencer.submit(write) == WriteOutcome::COMMITTED);
+    assert(applied == 1);
+    assert(sm.get_log_size() == 1);
+    
+    // Opted in, it is turned away before it ran, so nothing was applied or logged
+    replication.set_require_backup(true);
+    assert(sequencer.submit(write) == WriteOutcome::UNAVAILABLE);
+    sequencer.stop();
+    assert(applied == 1);
+    assert(sm.get_log_size() == 1);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_admission_budget_and_fair_share() {
+    std::cout << "Testing admission budget and per-client fair share..." << std::flush;
+    
+    AdmissionController admission(8, 2);
+    int retry_after_ms = 0;
+    
+    // Alone, a client may use the whole budget
+    for (int i = 0; i < 6; i++) {
+        assert(admission.try_admit(1, 1, retry_after_ms));
+    }
+    
+    // A second client always gets in while it holds nothing, then the first is held to half
+    assert(admission.try_admit(2, 1, retry_after_ms));
+    assert(!admission.try_admit(1, 1, retry_after_ms));
+    assert(retry_after_ms >= MIN_RETRY_AFTER_MS && retry_after_ms <= MAX_RETRY_AFTER_MS);
+    assert(admission.try_admit(2, 1, retry_after_ms));
+    
+    // A full budget sheds everyone, with a retry hint that grows with write latency
+    assert(admission.in_flight_count() == 8);
+    assert(!admission.try_admit(2, 1, retry_after_ms));
+    int short_retry = retry_after_ms;
+    for (int i = 0; i < 3; i++) {
+        admission.release(1, 1, 1000);
+    }
+    assert(admission.try_admit(2, 1, retry_after_ms));
+    assert(admission.try_admit(2, 1, retry_after_ms));
+    assert(!admission.try_admit(2, 1, retry_after_ms));
+    assert(retry_after_ms > short_retry);
+    
+    // Releasing everything leaves room for a write bigger than the budget
+    for (int i = 0; i < 3; i++) {
+        admission.release(1, 1, 1000);
+    }
+    for (int i = 0; i < 4; i++) {
+        admission.release(2, 1, 1000);
+    }
+    assert(admission.in_flight_count() == 0);
+    assert(admission.try_admit(3, 20, retry_after_ms));
+    assert(!admission.try_admit(4, 1, retry_after_ms));
+    admission.release(3, 20, 10);
+    assert(admission.admitted_count() == 11);
+    assert(admission.shed_count() == 4);
+    
+    // Connections beyond the limit wait for one to close
+    assert(admission.open_connection(10));
+    assert(admission.open_connection(10));
+    assert(!admission.open_connection(10));
+    std::thread closer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        admission.close_connection();
+    });
+    assert(admission.open_connection(1000));
+    closer.join();
+    
+    std::cout << " PASSED\n";
+}
+
 int main() {
     std::cout << "==================================\n";
     std::cout << "Running State Machine Test Suite\n";
@@ -210,6 +621,16 @@ int main() {
     test_replay_log_delete();
     test_log_100_operations();
     test_replay_reconstructs_state();
+    test_replay_uses_explicit_task_ids();
+    test_replay_is_idempotent();
+    test_parallel_replay_matches_serial();
+    test_wait_for_entries_after();
+    test_commit_watermark_bounds_feed();
+    test_wait_for_applied();
+    test_apply_pipeline_watermarks();
+    test_sequencer_orders_concurrent_writes();
+    test_sequencer_refuses_writes_without_backups();
+    test_admission_budget_and_fair_share();
     
     std::cout << "\n==================================\n";
     std::cout << "All State Machine Tests Passed!\n";
@@ -0,0 +1,133 @@
+#include "state_transfer.h"
+
+// Send tasks above after_task_id chunk by chunk, then the empty chunk. Leaves after_task_id
+// at the last id sent
+static bool SendTasksAfter(ServerStub& stub, TaskManager& tm, int& after_task_id, size_t& sent) {
+    std::vector<int> applied_ids;
+    while (true) {
+        std::vector<Task> chunk = tm.get_tasks_after(after_task_id, STATE_TRANSFER_CHUNK_SIZE, applied_ids);
+        if (!stub.SendTaskChunk(chunk, applied_ids)) {
+            return false;
+        }
+        if (chunk.empty()) {
+            return true;
+        }
+        after_task_id = chunk.back().get_task_id();
+        sent += chunk.size();
+    }
+}
+
+bool SendState(ServerStub& stub, TaskManager& tm, StateMachine& sm, StateTransferStats& stats) {
+    stats = StateTransferStats();
+    stats.cut_entry_id = sm.get_next_entry_id() - 1;
+    if (!stub.SendInt(stats.cut_entry_id)) {
+        return false;
+    }
+    
+    int last_task_id = -1;
+    if (!SendTasksAfter(stub, tm, last_task_id, stats.tasks)) {
+        return false;
+    }
+    
+    // Log until a short chunk says it has caught up with the writers
+    int position = -1;
+    while (true) {
+        std::vector<LogEntry> chunk = sm.get_log_after(position, STATE_TRANSFER_CHUNK_SIZE);
+        if (!chunk.empty() && !stub.SendLogEntryList(chunk)) {
+            return false;
+        }
+        stats.log_entries += chunk.size();
+        if (chunk.size() < static_cast<size_t>(STATE_TRANSFER_CHUNK_SIZE)) {
+            break;
+        }
+        position = chunk.back().get_entry_id();
+    }
+    if (!stub.SendLogEntryList(std::vector<LogEntry>())) {
+        return false;
+    }
+    
+    // Creates and imports since the first pass, their log entries may not say enough to rebuild them
+    if (!SendTasksAfter(stub, tm, last_task_id, stats.tasks)) {
+        return false;
+    }
+    
+    stats.id_counter = tm.get_id_counter();
+    return stub.SendInt(stats.id_counter);
+}
+
+// Install task chunks until the empty one
+static bool ReceiveTasks(ClientStub& stub, TaskManager& tm, size_t& received) {
+    std::vector<Task> chunk;
+    std::vector<int> applied_ids;
+    while (true) {
+        if (!stub.ReceiveTaskChunk(chunk, applied_ids)) {
+            return false;
+        }
+        if (chunk.empty()) {
+            return true;
+        }
+        tm.add_tasks_direct(chunk, applied_ids);
+        received += chunk.size();
+    }
+}
+
+static bool ReceiveStateInto(ClientStub& stub, TaskManager& tm, StateMachine& sm, StateTransferStats& stats,
+                             bool& replacing) {
+    // A peer with no state to give (a standby asked for MASTER_REJOIN) closes before the
+    // first chunk, local state is only dropped once one arrives
+    std::vector<Task> first_chunk;
+    std::vector<int> first_applied_ids;
+    if (!stub.ReceiveInt(stats.cut_entry_id) || !stub.ReceiveTaskChunk(first_chunk, first_applied_ids)) {
+        return false;
+    }
+    replacing = true;
+    tm.clear_all_tasks();
+    sm.clear_log();
+    tm.add_tasks_direct(first_chunk, first_applied_ids);
+    stats.tasks += first_chunk.size();
+    if (!first_chunk.empty() && !ReceiveTasks(stub, tm, stats.tasks)) {
+        return false;
+    }
+    
+    // Entries up to the cut are history, the tail after it is applied over the tasks
+    int last_entry_id = -1;
+    std::vector<LogEntry> chunk;
+    while (true) {
+        if (!stub.ReceiveLogEntryList(chunk)) {
+            return false;
+        }
+        if (chunk.empty()) {
+            break;
+        }
+        sm.append_batch_to_log(chunk);
+        for (const LogEntry& entry : chunk) {
+            if (entry.get_entry_id() > stats.cut_entry_id) {
+                StateMachine::apply_entry(tm, entry);
+            }
+        }
+        last_entry_id = chunk.back().get_entry_id();
+        stats.log_entries += chunk.size();
+    }
+    
+    if (!ReceiveTasks(stub, tm, stats.tasks) || !stub.ReceiveInt(stats.id_counter)) {
+        return false;
+    }
+    
+    tm.set_id_counter(stats.id_counter);
+    sm.set_next_entry_id(last_entry_id + 1);
+    sm.mark_applied(last_entry_id);
+    return true;
+}
+
+bool ReceiveState(ClientStub& stub, TaskManager& tm, StateMachine& sm, StateTransferStats& stats) {
+    stats = StateTransferStats();
+    bool replacing = false;
+    if (!ReceiveStateInto(stub, tm, sm, stats, replacing)) {
+        if (replacing) {
+            tm.clear_all_tasks();
+            sm.clear_log();
+        }
+        return false;
+    }
+    return true;
+}
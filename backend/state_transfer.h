@@ -0,0 +1,37 @@
+#ifndef __STATE_TRANSFER_H__
+#define __STATE_TRANSFER_H__
+
+#include "ServerStub.h"
+#include "ClientStub.h"
+#include "state_machine.h"
+#include "task_manager.h"
+
+// Streamed state transfer, the answer to STATE_TRANSFER_REQUEST and MASTER_REJOIN:
+//   cut entry_id    last entry in the sender's log when the transfer starts
+//   task chunks     every task, STATE_TRANSFER_CHUNK_SIZE at a time; an empty chunk ends them
+//   log chunks      the log in entry_id order; an empty chunk ends them once caught up
+//   task chunks     tasks created above the last id sent while the log was streaming
+//   id counter
+// Each chunk is copied under the TaskManager or log lock and sent with it released, so
+// writes keep landing during a transfer and neither side holds more than a chunk extra.
+// A task may be read after writes past the cut; those entries are in the log tail, and
+// the receiver applies each one its copy of the task hasn't seen, which brings every
+// task to the state at the end of the tail
+
+struct StateTransferStats {
+    int cut_entry_id;
+    size_t tasks;
+    size_t log_entries;
+    int id_counter;
+
+    StateTransferStats() : cut_entry_id(-1), tasks(0), log_entries(0), id_counter(0) {}
+};
+
+// Stream tm and sm to a rejoining peer
+bool SendState(ServerStub& stub, TaskManager& tm, StateMachine& sm, StateTransferStats& stats);
+
+// Replace tm and sm with a streamed state. They are untouched if the peer sends nothing,
+// and left empty if the transfer fails part way
+bool ReceiveState(ClientStub& stub, TaskManager& tm, StateMachine& sm, StateTransferStats& stats);
+
+#endif
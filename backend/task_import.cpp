@@ -0,0 +1,331 @@
+#include "task_import.h"
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+// Below this many lines per worker a thread costs more than the parsing it saves
+static const size_t MIN_LINES_PER_WORKER = 1024;
+
+// Fields of one record before it becomes a Task
+struct TaskRecord {
+    std::string title;
+    std::string description;
+    std::string board_id;
+    std::string created_by;
+    Column column;
+    int client_id;
+
+    TaskRecord() : board_id("board-1"), created_by("import"), column(Column::TODO), client_id(0) {}
+};
+
+ImportFormat DetectImportFormat(const std::string &path)
+{
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) {
+        return ImportFormat::CSV;
+    }
+    return ImportFormat::JSONL;
+}
+
+static bool IsBlank(const std::string &line)
+{
+    return line.find_first_not_of(" \t\r\n") == std::string::npos;
+}
+
+static bool ParseColumn(const std::string &value, Column &column)
+{
+    if (value == "0" || value == "TODO") {
+        column = Column::TODO;
+    } else if (value == "1" || value == "IN_PROGRESS") {
+        column = Column::IN_PROGRESS;
+    } else if (value == "2" || value == "DONE") {
+        column = Column::DONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Unknown keys are ignored so exports from other tools can be imported as-is
+static bool AssignField(TaskRecord &record, const std::string &key, const std::string &value)
+{
+    if (key == "title") {
+        record.title = value;
+    } else if (key == "description") {
+        record.description = value;
+    } else if (key == "board_id") {
+        record.board_id = value;
+    } else if (key == "created_by") {
+        record.created_by = value;
+    } else if (key == "column") {
+        return ParseColumn(value, record.column);
+    } else if (key == "client_id") {
+        char *end;
+        record.client_id = static_cast<int>(std::strtol(value.c_str(), &end, 10));
+        return !value.empty() && *end == '\0';
+    }
+    return true;
+}
+
+static Task MakeTask(const TaskRecord &record)
+{
+    return Task(0, record.title, record.description, record.board_id, record.created_by,
+                record.column, record.client_id);
+}
+
+static void SkipSpace(const std::string &s, size_t &pos)
+{
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r' || s[pos] == '\n')) {
+        pos++;
+    }
+}
+
+static void AppendUtf8(std::string &out, unsigned int cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+static bool ParseHex4(const std::string &s, size_t pos, unsigned int &value)
+{
+    if (pos + 4 > s.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; i++) {
+        char c = s[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+// Parse a JSON string starting at the opening quote, leaves pos after the closing quote
+static bool ParseJsonString(const std::string &s, size_t &pos, std::string &out)
+{
+    if (pos >= s.size() || s[pos] != '"') {
+        return false;
+    }
+    pos++;
+    out.clear();
+
+    while (pos < s.size()) {
+        char c = s[pos++];
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= s.size()) {
+            return false;
+        }
+        char esc = s[pos++];
+        switch (esc) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned int cp;
+                if (!ParseHex4(s, pos, cp)) {
+                    return false;
+                }
+                pos += 4;
+                // Surrogate pair
+                unsigned int low;
+                if (cp >= 0xD800 && cp <= 0xDBFF && pos + 1 < s.size() && s[pos] == '\\' && s[pos + 1] == 'u' &&
+                    ParseHex4(s, pos + 2, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+// Numbers, true/false/null, taken verbatim
+static bool ParseJsonScalar(const std::string &s, size_t &pos, std::string &out)
+{
+    size_t start = pos;
+    while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ' ' && s[pos] != '\t') {
+        pos++;
+    }
+    out = s.substr(start, pos - start);
+    return !out.empty();
+}
+
+bool ParseJsonlTask(const std::string &line, Task &task)
+{
+    TaskRecord record;
+    size_t pos = 0;
+
+    SkipSpace(line, pos);
+    if (pos >= line.size() || line[pos] != '{') {
+        return false;
+    }
+    pos++;
+    SkipSpace(line, pos);
+
+    bool first = true;
+    while (pos < line.size() && line[pos] != '}') {
+        if (!first) {
+            if (line[pos] != ',') {
+                return false;
+            }
+            pos++;
+            SkipSpace(line, pos);
+        }
+        first = false;
+
+        std::string key, value;
+        if (!ParseJsonString(line, pos, key)) {
+            return false;
+        }
+        SkipSpace(line, pos);
+        if (pos >= line.size() || line[pos] != ':') {
+            return false;
+        }
+        pos++;
+        SkipSpace(line, pos);
+
+        bool parsed = (pos < line.size() && line[pos] == '"') ? ParseJsonString(line, pos, value)
+                                                              : ParseJsonScalar(line, pos, value);
+        if (!parsed || !AssignField(record, key, value)) {
+            return false;
+        }
+        SkipSpace(line, pos);
+    }
+    if (pos >= line.size()) {
+        return false;  // Missing closing brace
+    }
+
+    task = MakeTask(record);
+    return true;
+}
+
+// Split one CSV line. Quoted fields may contain commas and "" for a literal quote
+static bool SplitCsv(const std::string &line, std::vector<std::string> &fields)
+{
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return !quoted;
+}
+
+bool ParseCsvTask(const std::string &line, Task &task)
+{
+    static const char *FIELD_ORDER[] = {"title", "description", "column", "created_by", "board_id"};
+
+    std::vector<std::string> fields;
+    if (!SplitCsv(line, fields) || fields.size() > 5) {
+        return false;
+    }
+
+    TaskRecord record;
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i].empty() && i > 0) {
+            continue;  // Keep the default
+        }
+        if (!AssignField(record, FIELD_ORDER[i], fields[i])) {
+            return false;
+        }
+    }
+
+    task = MakeTask(record);
+    return true;
+}
+
+std::vector<Task> ParseTaskLines(const std::vector<std::string> &lines, ImportFormat format, size_t &skipped)
+{
+    std::vector<Task> parsed(lines.size());
+    std::vector<signed char> ok(lines.size(), 0);  // 1 parsed, -1 malformed, 0 blank
+
+    auto parse_range = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (IsBlank(lines[i])) {
+                continue;
+            }
+            ok[i] = (format == ImportFormat::CSV) ? ParseCsvTask(lines[i], parsed[i])
+                                                  : ParseJsonlTask(lines[i], parsed[i]);
+            if (!ok[i]) {
+                ok[i] = -1;
+            }
+        }
+    };
+
+    size_t workers = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+                                                          lines.size() / MIN_LINES_PER_WORKER));
+    if (workers == 1) {
+        parse_range(0, lines.size());
+    } else {
+        std::vector<std::thread> threads;
+        size_t per_worker = (lines.size() + workers - 1) / workers;
+        for (size_t w = 0; w < workers; w++) {
+            size_t begin = w * per_worker;
+            size_t end = std::min(lines.size(), begin + per_worker);
+            threads.emplace_back(parse_range, begin, end);
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+    }
+
+    std::vector<Task> tasks;
+    tasks.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (ok[i] == 1) {
+            tasks.push_back(parsed[i]);
+        } else if (ok[i] == -1) {
+            skipped++;
+        }
+    }
+    return tasks;
+}
@@ -0,0 +1,27 @@
+#ifndef __TASK_IMPORT_H__
+#define __TASK_IMPORT_H__
+
+#include <string>
+#include <vector>
+#include "messages.h"
+
+// Record formats accepted by bulk_import
+enum class ImportFormat
+{
+    JSONL,  // One flat JSON object per line: {"title": ..., "description": ..., "column": ...}
+    CSV     // title,description,column,created_by,board_id (header line optional)
+};
+
+// .csv files are CSV, anything else is read as JSONL
+ImportFormat DetectImportFormat(const std::string &path);
+
+// Parse one record into task (task_id is left for the server to assign).
+// column accepts 0-2 or TODO / IN_PROGRESS / DONE. Returns false for malformed records
+bool ParseJsonlTask(const std::string &line, Task &task);
+bool ParseCsvTask(const std::string &line, Task &task);
+
+// Parse a chunk of lines in parallel, keeping input order. Blank lines are ignored,
+// malformed ones are counted in skipped
+std::vector<Task> ParseTaskLines(const std::vector<std::string> &lines, ImportFormat format, size_t &skipped);
+
+#endif
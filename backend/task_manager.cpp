@@ -3,132 +3,365 @@
 #include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <random>
 #include "task_manager.h"
+#include "snapshot.h"
+#include "json_writer.h"
+
+static const char RANK_DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+static const int RANK_BASE = 62;
+
+static int RankDigit(char c)
+{
+    if (c >= 'a') return c - 'a' + 36;
+    if (c >= 'A') return c - 'A' + 10;
+    return c - '0';
+}
+
+// Reading ranks as base-62 fractions 0.low and 0.high (an empty high being 1), keep the
+// digits they share and split the first one that differs, adding a digit if they are adjacent
+static std::string RankMidpoint(const std::string &low, const std::string &high)
+{
+    if (!high.empty()) {
+        size_t shared = 0;
+        while (shared < high.size() && (shared < low.size() ? low[shared] : '0') == high[shared]) {
+            shared++;
+        }
+        if (shared > 0) {
+            return high.substr(0, shared) +
+                   RankMidpoint(shared < low.size() ? low.substr(shared) : "", high.substr(shared));
+        }
+    }
+
+    int lo = low.empty() ? 0 : RankDigit(low[0]);
+    int hi = high.empty() ? RANK_BASE : RankDigit(high[0]);
+    if (hi - lo > 1) {
+        return std::string(1, RANK_DIGITS[(lo + hi) / 2]);
+    }
+    if (high.size() > 1) {
+        return high.substr(0, 1);
+    }
+    return std::string(1, RANK_DIGITS[lo]) + RankMidpoint(low.empty() ? "" : low.substr(1), "");
+}
+
+std::string RankBetween(const std::string &low, const std::string &high)
+{
+    if (!high.empty()) {
+        return RankMidpoint(low, high);
+    }
+    if (low.empty()) {
+        return std::string(1, RANK_DIGITS[RANK_BASE / 2]);
+    }
+
+    // Step the leading digits up by one, halving the gap to the end would grow the rank
+    // a digit every few appends
+    std::string step = low.substr(0, RANK_STEP_DIGITS);
+    step.resize(RANK_STEP_DIGITS, '0');
+    for (size_t i = step.size(); i-- > 0;) {
+        int digit = RankDigit(step[i]);
+        if (digit + 1 < RANK_BASE) {
+            step[i] = RANK_DIGITS[digit + 1];
+            step.erase(step.find_last_not_of('0') + 1);
+            return step;
+        }
+        step[i] = '0';
+    }
+    return RankMidpoint(low, "");
+}
 
 TaskManager::TaskManager()
 {
     id_counter = 0;
+    std::random_device rd;
+    version_origin = static_cast<int>(rd() & 0x7fffffff);
+    board_version = 0;
+    tombstone_floor = 0;
+    snapshot_untouched = 0;
+    snapshot_indexed = false;
+    indexed = true;
+    board_json_origin = 0;
+    board_json_version = -1;
 }
 
-// Create a task with all fields, including column and timestamps
-bool TaskManager::create_task(std::string title, std::string description, 
-                               std::string board_id, std::string created_by, 
-                               Column column, int client_id)
+Task* TaskManager::find_locked(int task_id)
 {
-    std::lock_guard<std::mutex> lock(task_lock);
-    
-    // Create task with specified column
-    Task new_task(id_counter, title, description, board_id, created_by, column, client_id);
-    
-    tasks.emplace(id_counter, new_task);
-    clocks.push_back(&tasks[id_counter].get_clock());
+    auto it = tasks.find(task_id);
+    if (it != tasks.end()) {
+        return &it->second;
+    }
+    if (!snapshot) {
+        return nullptr;
+    }
 
-    id_counter++;
-    return true;
+    int index = snapshot->Find(task_id);
+    if (index < 0 || snapshot_taken[index]) {
+        return nullptr;  // Not in the snapshot, or already moved into the map and deleted since
+    }
+    snapshot_taken[index] = 1;
+    snapshot_untouched--;
+
+    Task task;
+    if (!snapshot->Materialize(index, task)) {
+        std::cerr << "[SNAPSHOT] Corrupt record for task " << task_id << ", dropping it\n";
+        return nullptr;
+    }
+    Task* materialized = &tasks.emplace(task_id, task).first->second;
+    index_locked(task_id);
+    return materialized;
 }
 
-// Update task with vector clock conflict detection
-// Returns true if update applied, false if rejected due to causality
-bool TaskManager::update_task(int task_id, const std::string &title, const std::string &description, const VectorClock &new_clock)
+// Copy of task_id for a read, from the map or decoded from its untouched snapshot record
+bool TaskManager::copy_task_locked(int task_id, Task &out)
 {
-    std::lock_guard<std::mutex> lock(task_lock);
     auto it = tasks.find(task_id);
-    if (it == tasks.end())
-    {
-        return false; // Task not found
+    if (it != tasks.end()) {
+        out = it->second;
+        return true;
     }
+    if (!snapshot) {
+        return false;
+    }
+    int index = snapshot->Find(task_id);
+    return index >= 0 && !snapshot_taken[index] && snapshot->Materialize(index, out);
+}
 
-    // Compare vector clocks to detect conflicts
-    int comparison = it->second.get_clock().compare_to(new_clock);
-    
-    if (comparison == 0) {
-        // Concurrent updates - use last-write-wins (already applied)
-        std::cout << "[CONFLICT] Concurrent update detected for task " << task_id 
-                  << " - applying last-write-wins\n";
-        if (!title.empty()) it->second.set_title(title);
-        if (!description.empty()) it->second.set_description(description);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count());
-        return true;
-    } else if (comparison < 0) {
-        // Apply new update as it is causally newer
-        if (!title.empty()) it->second.set_title(title);
-        if (!description.empty()) it->second.set_description(description);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count());
-        return true;
+// Untouched records are decoded into a scratch copy for fn, they stay in the file. A record
+// that doesn't decode is skipped, find_locked drops it if anything touches it
+void TaskManager::for_each_task_locked(int after_task_id, const std::function<bool(const Task &)> &fn)
+{
+    auto it = tasks.upper_bound(after_task_id);
+    size_t record = snapshot ? snapshot->FirstAfter(after_task_id) : 0;
+    size_t records = snapshot_untouched > 0 ? snapshot_taken.size() : 0;
+    Task decoded;
+
+    while (true) {
+        while (record < records && snapshot_taken[record]) {
+            record++;
+        }
+        bool from_map = it != tasks.end() &&
+                        (record == records || it->first < snapshot->Record(record).task_id);
+        if (from_map) {
+            if (!fn(it->second)) {
+                return;
+            }
+            ++it;
+        } else if (record < records) {
+            if (snapshot->Materialize(record++, decoded) && !fn(decoded)) {
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+// QUERY, SEARCH and rank placement need every task filed. Untouched snapshot tasks are
+// filed from a decoded copy the first time one of them runs
+void TaskManager::index_snapshot_locked()
+{
+    if (!indexed || snapshot_indexed || snapshot_untouched == 0) {
+        return;
+    }
+    snapshot_indexed = true;
+    Task decoded;
+    for (size_t i = 0; i < snapshot_taken.size(); i++) {
+        if (!snapshot_taken[i] && snapshot->Materialize(i, decoded)) {
+            file_locked(decoded.get_task_id(), decoded);
+        }
+    }
+}
+
+// Applied entry ids of untouched snapshot tasks are read from their snapshot record
+int TaskManager::applied_entry_locked(int task_id)
+{
+    auto it = applied_entries.find(task_id);
+    if (it != applied_entries.end()) {
+        return it->second;
+    }
+    if (snapshot) {
+        int index = snapshot->Find(task_id);
+        if (index >= 0) {
+            return snapshot->Record(index).applied_entry_id;
+        }
+    }
+    return -1;
+}
+
+// Stamp task_id with a fresh board version, dropping its previous position in the change index
+void TaskManager::touch_locked(int task_id)
+{
+    board_version++;
+    auto it = task_versions.find(task_id);
+    if (it != task_versions.end()) {
+        changes.erase(it->second);
+        it->second = board_version;
     } else {
-        // Old update here so we reject it
-        std::cout << "[CONFLICT] Rejecting old update for task " << task_id 
-                  << " (outdated by vector clock)\n";
-        return false;
+        task_versions.emplace(task_id, board_version);
     }
+    changes.emplace(board_version, task_id);
+    index_locked(task_id);
 }
 
-// Move task with vector clock conflict detection
-bool TaskManager::move_task(int task_id, Column column, const VectorClock &new_clock)
+// Record a delete so delta clients learn about it, evicting the oldest tombstone when full
+void TaskManager::tombstone_locked(int task_id)
 {
-    std::lock_guard<std::mutex> lock(task_lock);
+    board_version++;
+    auto it = task_versions.find(task_id);
+    if (it != task_versions.end()) {
+        changes.erase(it->second);
+        task_versions.erase(it);
+    }
+    tombstones.emplace_back(board_version, task_id);
+    if (tombstones.size() > MAX_TOMBSTONES) {
+        tombstone_floor = tombstones.front().first;
+        tombstones.pop_front();
+    }
+    unindex_locked(task_id);
+    search_index.remove(task_id);
+}
 
+// File task_id under its current column, rank, creator and updated_at, replacing its old
+// keys, and its text in the search index
+void TaskManager::index_locked(int task_id)
+{
+    if (!indexed) {
+        return;
+    }
     auto it = tasks.find(task_id);
-    if (it == tasks.end())
-    {
-        return false; // Task not found
+    if (it == tasks.end()) {
+        unindex_locked(task_id);
+        search_index.remove(task_id);
+        return;
     }
+    file_locked(task_id, it->second);
+}
 
-    if (it->second.get_column() == column)
-    {
-        return true; // Already in target column
+void TaskManager::file_locked(int task_id, const Task &task)
+{
+    unindex_locked(task_id);
+    search_index.update(task_id, task.get_title(), task.get_description());
+
+    IndexKeys keys;
+    keys.column = task.get_column();
+    keys.created_by = task.get_created_by();
+    keys.updated_at = task.get_updated_at();
+    keys.rank = task.get_rank();
+    by_column[keys.column].insert(task_id);
+    by_rank[keys.column].emplace(keys.rank, task_id);
+    by_creator[keys.created_by].insert(task_id);
+    by_updated.emplace(keys.updated_at, task_id);
+    index_keys.emplace(task_id, keys);
+}
+
+void TaskManager::unindex_locked(int task_id)
+{
+    auto it = index_keys.find(task_id);
+    if (it == index_keys.end()) {
+        return;
+    }
+
+    by_column[it->second.column].erase(task_id);
+    by_rank[it->second.column].erase(std::make_pair(it->second.rank, task_id));
+    auto creator = by_creator.find(it->second.created_by);
+    creator->second.erase(task_id);
+    if (creator->second.empty()) {
+        by_creator.erase(creator);
     }
+    by_updated.erase(std::make_pair(it->second.updated_at, task_id));
+    index_keys.erase(it);
+}
 
-    // Compare vector clocks
-    int comparison = it->second.get_clock().compare_to(new_clock);
+// Create a task with all fields, including column and timestamps. Returns its id, which
+// callers report back instead of reading the counter (another create may have moved it)
+int TaskManager::create_task(std::string title, std::string description, 
+                              std::string board_id, std::string created_by, 
+                              Column column, int client_id)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return create_task_locked(title, description, board_id, created_by, column, client_id);
+}
+
+// Returns the id the new task was given
+int TaskManager::create_task_locked(const std::string &title, const std::string &description,
+                                    const std::string &board_id, const std::string &created_by,
+                                    Column column, int client_id)
+{
+    int task_id = id_counter++;
+
+    // Create task with specified column, below the tasks already in it
+    Task new_task(task_id, title, description, board_id, created_by, column, client_id);
+    new_task.set_rank(end_rank_locked(column));
     
-    if (comparison == 0) {
-        // Concurrent moves, here apply last-write-wins
-        std::cout << "[CONFLICT] Concurrent move detected for task " << task_id 
-                  << " - applying move to column " << static_cast<int>(column) << "\n";
-        it->second.set_column(column);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count());
-        return true;
-    } else if (comparison < 0) {
-        // New move is causally newer
-        it->second.set_column(column);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count());
-        return true;
-    } else {
-        std::cout << "[CONFLICT] Rejecting old move for task " << task_id 
-                  << " (outdated by vector clock)\n";
-        return false;
+    tasks.emplace(task_id, new_task);
+    touch_locked(task_id);
+
+    return task_id;
+}
+
+void TaskManager::raise_id_counter(int task_id)
+{
+    int current = id_counter.load();
+    while (current <= task_id && !id_counter.compare_exchange_weak(current, task_id + 1)) {
     }
 }
 
-// Looks for given id in task map. If it doesn't exist return false.
-// If it exists, remove pointer to vectorclock and then erase the task.
-bool TaskManager::delete_task(int task_id)
+// Create a task under the id recorded in the log entry instead of the local counter
+bool TaskManager::create_task_with_id(int task_id, std::string title, std::string description,
+                                      std::string board_id, std::string created_by,
+                                      Column column, int client_id, std::string rank)
 {
     std::lock_guard<std::mutex> lock(task_lock);
 
-    auto task_it = tasks.find(task_id);
-    if (task_it == tasks.end())
+    if (find_locked(task_id))
     {
-        return false;
+        return false; // Already created, replaying the same create is a no-op
     }
 
-    // Find and remove from clocks vector BEFORE erasing task to avoid dangling pointer
-    VectorClock *clock_to_remove = &task_it->second.get_clock();
-    auto it = std::find(clocks.begin(), clocks.end(), clock_to_remove);
-    if (it != clocks.end())
+    Task new_task(task_id, title, description, board_id, created_by, column, client_id);
+    new_task.set_rank(rank.empty() ? end_rank_locked(column) : rank);
+    tasks.emplace(task_id, new_task);
+    touch_locked(task_id);
+
+    raise_id_counter(task_id);
+    return true;
+}
+
+// Update task with vector clock conflict detection
+// Returns true if update applied, false if rejected due to causality
+bool TaskManager::update_task(int task_id, const std::string &title, const std::string &description, const VectorClock &new_clock)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return update_task_locked(task_id, title, description, new_clock).success;
+}
+
+// Move task with vector clock conflict detection
+bool TaskManager::move_task(int task_id, Column column, const VectorClock &new_clock, const std::string &rank)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return move_task_locked(task_id, column, new_clock, rank).success;
+}
+
+bool TaskManager::place_task(int task_id, Column column, const std::string &rank, const VectorClock &new_clock)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return place_task_locked(task_id, column, rank, new_clock).success;
+}
+
+bool TaskManager::delete_task(int task_id)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return delete_task_locked(task_id);
+}
+
+// Looks for given id in task map. If it doesn't exist return false, otherwise erase the task.
+bool TaskManager::delete_task_locked(int task_id)
+{
+    if (!find_locked(task_id))
     {
-        clocks.erase(it);
+        return false;
     }
-    tasks.erase(task_it);
+    tasks.erase(task_id);
+    tombstone_locked(task_id);
 
     return true;
 }
@@ -138,67 +371,320 @@ Task TaskManager::get_task(int id)
 {
     std::lock_guard<std::mutex> lock(task_lock);
 
-    auto it = tasks.find(id);
-    if (it == tasks.end())
+    Task task;
+    if (!copy_task_locked(id, task))
     {
         throw std::runtime_error("Task not found");
     }
 
-    return it->second;
+    return task;
+}
+
+// Same lookup as get_task but reports a miss instead of throwing
+bool TaskManager::try_get_task(int id, Task &out)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+
+    return copy_task_locked(id, out);
 }
 
 size_t TaskManager::get_task_count() const
 {
-    return tasks.size();
+    std::lock_guard<std::mutex> lock(task_lock);
+    return tasks.size() + snapshot_untouched;
+}
+
+size_t TaskManager::get_snapshot_task_count() const
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return snapshot_untouched;
+}
+
+// Record that entry_id touched task_id. Entry ids grow with log order, so anything at or
+// below the recorded id has already been applied and must be skipped
+bool TaskManager::mark_entry_applied(int task_id, int entry_id)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+
+    if (entry_id <= applied_entry_locked(task_id))
+    {
+        return false;
+    }
+    applied_entries[task_id] = entry_id;
+    return true;
+}
+
+int TaskManager::get_applied_entry_id(int task_id)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+
+    return applied_entry_locked(task_id);
+}
+
+// Copy the current state of task_ids (and their applied entry ids) into an empty shard
+void TaskManager::seed_shard(TaskManager &shard, const std::vector<int> &task_ids)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    std::lock_guard<std::mutex> shard_lock(shard.task_lock);
+    shard.indexed = false;
+
+    for (int task_id : task_ids) {
+        Task* task = find_locked(task_id);
+        if (task) {
+            shard.tasks.emplace(task_id, *task);
+        }
+        int applied = applied_entry_locked(task_id);
+        if (applied >= 0) {
+            shard.applied_entries[task_id] = applied;
+        }
+    }
+    shard.id_counter = id_counter.load();
+}
+
+// Replace task_ids with whatever the shard ended up with, tasks missing from the shard were deleted
+void TaskManager::absorb_shard(TaskManager &shard, const std::vector<int> &task_ids)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    std::lock_guard<std::mutex> shard_lock(shard.task_lock);
+
+    for (int task_id : task_ids) {
+        auto shard_it = shard.tasks.find(task_id);
+        if (shard_it != shard.tasks.end()) {
+            tasks[task_id] = shard_it->second;
+            touch_locked(task_id);
+        } else if (tasks.erase(task_id) > 0) {
+            tombstone_locked(task_id);
+        }
+        auto applied_it = shard.applied_entries.find(task_id);
+        if (applied_it != shard.applied_entries.end()) {
+            applied_entries[task_id] = applied_it->second;
+        }
+    }
+    raise_id_counter(shard.id_counter - 1);
 }
 
 std::vector<Task> TaskManager::get_all_tasks()
 {
     std::lock_guard<std::mutex> lock(task_lock);
     std::vector<Task> all_tasks;
+    all_tasks.reserve(tasks.size() + snapshot_untouched);
     
-    for (const auto& pair : tasks) {
-        all_tasks.push_back(pair.second);
-    }
+    for_each_task_locked(-1, [&all_tasks](const Task &task) {
+        all_tasks.push_back(task);
+        return true;
+    });
     
     return all_tasks;
 }
+
+// Tasks changed after since_version plus deletes since then. Falls back to the whole
+// board when the client's version belongs to another history or predates the tombstones
+BoardDelta TaskManager::get_changes_since(int origin, int since_version)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    BoardDelta delta;
+    delta.origin = version_origin;
+    delta.version = board_version;
+
+    if (origin != version_origin || since_version < tombstone_floor || since_version > board_version) {
+        delta.full_sync = true;
+        delta.tasks.reserve(tasks.size() + snapshot_untouched);
+        for_each_task_locked(-1, [&delta](const Task &task) {
+            delta.tasks.push_back(task);
+            return true;
+        });
+        return delta;
+    }
+
+    for (auto it = changes.upper_bound(since_version); it != changes.end(); ++it) {
+        delta.tasks.push_back(tasks.at(it->second));
+    }
+    for (auto it = tombstones.rbegin(); it != tombstones.rend() && it->first > since_version; ++it) {
+        delta.deleted_task_ids.push_back(it->second);
+    }
+    return delta;
+}
+
+// Add task_id to the page if it passes the query's filters. Returns false once the page
+// is full and one more match turned up, which is all has_more needs
+bool TaskManager::collect_locked(int task_id, const TaskQuery &query, size_t limit, TaskPage &page)
+{
+    const IndexKeys& keys = index_keys.at(task_id);
+    if ((query.column >= 0 && static_cast<int>(keys.column) != query.column) ||
+        (!query.created_by.empty() && keys.created_by != query.created_by) ||
+        keys.updated_at < query.updated_since) {
+        return true;
+    }
+    if (page.tasks.size() == limit) {
+        page.has_more = true;
+        return false;
+    }
+    Task task;
+    if (!copy_task_locked(task_id, task)) {
+        return true;
+    }
+    page.tasks.push_back(task);
+    page.next = QueryCursor(keys.updated_at, task_id);
+    return true;
+}
+
+TaskPage TaskManager::query_tasks(const TaskQuery &query)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    index_snapshot_locked();
+    TaskPage page;
+    size_t limit = query.limit > 0 && query.limit < MAX_QUERY_LIMIT ? query.limit : MAX_QUERY_LIMIT;
+    page.next = query.after;
+
+    if (query.sort == QuerySort::BY_ID) {
+        // Walk the smaller of the column and creator sets when filtering, else every id
+        static const std::set<int> none;
+        const std::set<int>* ids = nullptr;
+        if (query.column >= 0) {
+            auto column = by_column.find(static_cast<Column>(query.column));
+            ids = column != by_column.end() ? &column->second : &none;
+        }
+        if (!query.created_by.empty()) {
+            auto creator = by_creator.find(query.created_by);
+            const std::set<int>* created = creator != by_creator.end() ? &creator->second : &none;
+            if (!ids || created->size() < ids->size()) {
+                ids = created;
+            }
+        }
+
+        if (ids) {
+            for (auto it = ids->upper_bound(query.after.task_id); it != ids->end(); ++it) {
+                if (!collect_locked(*it, query, limit, page)) {
+                    break;
+                }
+            }
+        } else {
+            for (auto it = index_keys.upper_bound(query.after.task_id); it != index_keys.end(); ++it) {
+                if (!collect_locked(it->first, query, limit, page)) {
+                    break;
+                }
+            }
+        }
+    } else if (query.sort == QuerySort::UPDATED_ASC) {
+        std::pair<long long, int> from = query.after.task_id >= 0
+            ? std::make_pair(query.after.updated_at, query.after.task_id)
+            : std::make_pair(query.updated_since, -1);
+        for (auto it = by_updated.upper_bound(from); it != by_updated.end(); ++it) {
+            if (!collect_locked(it->second, query, limit, page)) {
+                break;
+            }
+        }
+    } else {
+        auto it = query.after.task_id >= 0
+            ? by_updated.lower_bound(std::make_pair(query.after.updated_at, query.after.task_id))
+            : by_updated.end();
+        while (it != by_updated.begin()) {
+            --it;
+            if (it->first < query.updated_since || !collect_locked(it->second, query, limit, page)) {
+                break;
+            }
+        }
+    }
+    return page;
+}
+
+SearchResults TaskManager::search_tasks(const std::string &query, int limit)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    index_snapshot_locked();  // Hits are ids, nothing is materialized
+    SearchResults results;
+    size_t wanted = limit > 0 && limit < MAX_SEARCH_RESULTS ? limit : MAX_SEARCH_RESULTS;
+    results.hits = search_index.search(query, wanted, results.total_matches);
+    return results;
+}
+
+int TaskManager::get_board_version()
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return board_version;
+}
+
+// Rendered straight from the task map and snapshot under the lock, a miss costs about what
+// copying the board out for GET_BOARD would
+std::shared_ptr<const std::string> TaskManager::get_board_json(const std::string &board_id)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    if (board_json && board_json_id == board_id && board_json_origin == version_origin &&
+        board_json_version == board_version) {
+        return board_json;
+    }
+
+    std::shared_ptr<std::string> rendered = std::make_shared<std::string>();
+    rendered->reserve(board_json ? board_json->size() + 256 : 256 + (tasks.size() + snapshot_untouched) * 256);
+    JsonWriter json(*rendered);
+    json.begin_object();
+    json.key("board_id");
+    json.string(board_id);
+    json.key("origin");
+    json.number(version_origin);
+    json.key("version");
+    json.number(board_version);
+    json.key("tasks");
+    json.begin_array();
+    for_each_task_locked(-1, [&json, &board_id](const Task &task) {
+        if (task.get_board_id() == board_id) {
+            task.ToJson(json);
+        }
+        return true;
+    });
+    json.end_array();
+    json.end_object();
+
+    board_json = rendered;
+    board_json_id = board_id;
+    board_json_origin = version_origin;
+    board_json_version = board_version;
+    return board_json;
+}
+
 // Update task with conflict detection and returns detailed response
 OperationResponse TaskManager::update_task_with_conflict_detection(int task_id, const std::string &title, const std::string &description, const VectorClock &new_clock)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return update_task_locked(task_id, title, description, new_clock);
+}
+
+OperationResponse TaskManager::update_task_locked(int task_id, const std::string &title, const std::string &description, const VectorClock &new_clock)
 {
     OperationResponse response;
     response.updated_task_id = task_id;
     
-    std::lock_guard<std::mutex> lock(task_lock);
-    auto it = tasks.find(task_id);
-    if (it == tasks.end())
+    Task* task = find_locked(task_id);
+    if (!task)
     {
         response.success = false;
         return response;
     }
 
-    int comparison = it->second.get_clock().compare_to(new_clock);
+    int comparison = task->get_clock().compare_to(new_clock);
     
     if (comparison == 0) {
         // Concurrent updates and apply with conflict flag
         std::cout << "[CONFLICT] Concurrent update detected for task " << task_id 
                   << " - applying last-write-wins\n";
-        if (!title.empty()) it->second.set_title(title);
-        if (!description.empty()) it->second.set_description(description);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
+        if (!title.empty()) task->set_title(title);
+        if (!description.empty()) task->set_description(description);
+        task->get_clock().update(new_clock);
+        task->set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count());
+        touch_locked(task_id);
         response.success = true;
         response.conflict = true;
         response.rejected = false;
         return response;
     } else if (comparison < 0) {
         // New update is causally newer so we apply it normally
-        if (!title.empty()) it->second.set_title(title);
-        if (!description.empty()) it->second.set_description(description);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
+        if (!title.empty()) task->set_title(title);
+        if (!description.empty()) task->set_description(description);
+        task->get_clock().update(new_clock);
+        task->set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count());
+        touch_locked(task_id);
         response.success = true;
         response.conflict = false;
         response.rejected = false;
@@ -216,44 +702,56 @@ OperationResponse TaskManager::update_task_with_conflict_detection(int task_id,
 
 // Move task with conflict detection and returns detailed response
 OperationResponse TaskManager::move_task_with_conflict_detection(int task_id, Column column, const VectorClock &new_clock)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return move_task_locked(task_id, column, new_clock);
+}
+
+// A move between columns puts the task at the bottom of the new one, unless the log entry
+// being replayed recorded where it went
+OperationResponse TaskManager::move_task_locked(int task_id, Column column, const VectorClock &new_clock, const std::string &rank)
 {
     OperationResponse response;
     response.updated_task_id = task_id;
     
-    std::lock_guard<std::mutex> lock(task_lock);
-    auto it = tasks.find(task_id);
-    if (it == tasks.end())
+    Task* task = find_locked(task_id);
+    if (!task)
     {
         response.success = false;
         return response;
     }
 
-    if (it->second.get_column() == column)
+    if (task->get_column() == column)
     {
         response.success = true;
         return response;
     }
 
-    int comparison = it->second.get_clock().compare_to(new_clock);
+    std::string placed = rank.empty() ? end_rank_locked(column) : rank;
+    int comparison = task->get_clock().compare_to(new_clock);
     
     if (comparison == 0) {
         // Concurrent moves and apply with conflict flag
         std::cout << "[CONFLICT] Concurrent move detected for task " << task_id 
                   << " - applying move to column " << static_cast<int>(column) << "\n";
-        it->second.set_column(column);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
+        task->set_column(column);
+        task->set_rank(placed);
+        task->get_clock().update(new_clock);
+        task->set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count());
+        touch_locked(task_id);
         response.success = true;
         response.conflict = true;
         response.rejected = false;
         return response;
     } else if (comparison < 0) {
         // New move is causally newer
-        it->second.set_column(column);
-        it->second.get_clock().update(new_clock);
-        it->second.set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
+        task->set_column(column);
+        task->set_rank(placed);
+        task->get_clock().update(new_clock);
+        task->set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count());
+        touch_locked(task_id);
         response.success = true;
         response.conflict = false;
         response.rejected = false;
@@ -269,8 +767,123 @@ OperationResponse TaskManager::move_task_with_conflict_detection(int task_id, Co
     }
 }
 
+OperationResponse TaskManager::reorder_task_with_conflict_detection(int task_id, Column column, int after_task_id, const VectorClock &new_clock)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    return place_task_locked(task_id, column, rank_below_locked(column, after_task_id, task_id), new_clock);
+}
+
+// Put the task at rank in column, same clock rules as a move. Nothing but the task changes,
+// its neighbours keep their ranks
+OperationResponse TaskManager::place_task_locked(int task_id, Column column, const std::string &rank, const VectorClock &new_clock)
+{
+    OperationResponse response;
+    response.updated_task_id = task_id;
+    
+    Task* task = find_locked(task_id);
+    if (!task)
+    {
+        return response;
+    }
+
+    int comparison = task->get_clock().compare_to(new_clock);
+    if (comparison > 0) {
+        std::cout << "[CONFLICT] Rejecting old reorder for task " << task_id 
+                  << " (outdated by vector clock)\n";
+        response.rejected = true;
+        return response;
+    }
+    if (comparison == 0) {
+        std::cout << "[CONFLICT] Concurrent reorder detected for task " << task_id 
+                  << " - applying last-write-wins\n";
+        response.conflict = true;
+    }
+
+    task->set_column(column);
+    task->set_rank(rank);
+    task->get_clock().update(new_clock);
+    task->set_updated_at(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    touch_locked(task_id);
+    response.success = true;
+    return response;
+}
+
+std::string TaskManager::end_rank_locked(Column column)
+{
+    if (!indexed) {
+        return "";  // Replay shards only place tasks at the ranks their entries recorded
+    }
+    index_snapshot_locked();  // A snapshot task may hold the last rank
+    const std::set<std::pair<std::string, int>> &ranks = by_rank[column];
+    return RankBetween(ranks.empty() ? "" : ranks.rbegin()->first, "");
+}
+
+std::string TaskManager::rank_below_locked(Column column, int after_task_id, int task_id)
+{
+    index_snapshot_locked();
+    const std::set<std::pair<std::string, int>> &ranks = by_rank[column];
+    std::string low;
+    auto next = ranks.begin();
+    if (after_task_id >= 0) {
+        auto anchor = index_keys.find(after_task_id);
+        if (anchor == index_keys.end() || anchor->second.column != column) {
+            return end_rank_locked(column);
+        }
+        low = anchor->second.rank;
+        next = ranks.upper_bound(std::make_pair(low, after_task_id));
+    }
+    if (next != ranks.end() && next->second == task_id) {
+        ++next;  // The task is leaving its own slot
+    }
+
+    if (next == ranks.end()) {
+        return RankBetween(low, "");
+    }
+    if (low < next->first) {
+        return RankBetween(low, next->first);
+    }
+    // Equal ranks leave no room between them, only tasks from before ranks existed share one
+    return end_rank_locked(column);
+}
+
+// Apply every operation of a BATCH under one lock acquisition, clocks[i] belongs to ops[i].
+// Operations run in order, so a later one sees the effect of an earlier one
+std::vector<OperationResponse> TaskManager::apply_batch(const std::vector<BatchOperation> &ops,
+                                                        const std::vector<VectorClock> &clocks)
+{
+    std::vector<OperationResponse> responses(ops.size());
+
+    std::lock_guard<std::mutex> lock(task_lock);
+    for (size_t i = 0; i < ops.size(); i++) {
+        const Task &task = ops[i].task;
+        switch (ops[i].op_type) {
+            case OpType::CREATE_TASK:
+                responses[i].success = true;
+                responses[i].updated_task_id = create_task_locked(task.get_title(), task.get_description(),
+                                                                  task.get_board_id(), task.get_created_by(),
+                                                                  task.get_column(), task.get_client_id());
+                break;
+            case OpType::UPDATE_TASK:
+                responses[i] = update_task_locked(task.get_task_id(), task.get_title(), task.get_description(), clocks[i]);
+                break;
+            case OpType::MOVE_TASK:
+                responses[i] = move_task_locked(task.get_task_id(), task.get_column(), clocks[i]);
+                break;
+            case OpType::DELETE_TASK:
+                responses[i].success = delete_task_locked(task.get_task_id());
+                responses[i].updated_task_id = task.get_task_id();
+                break;
+            default:
+                // Only writes can be batched
+                break;
+        }
+    }
+    return responses;
+}
+
 // Backward compatible create_task for tests
-bool TaskManager::create_task(std::string description, int client_id)
+int TaskManager::create_task(std::string description, int client_id)
 {
     return create_task("Task", description, "board-1", "user", Column::TODO, client_id);
 }
@@ -280,8 +893,24 @@ void TaskManager::clear_all_tasks()
 {
     std::lock_guard<std::mutex> lock(task_lock);
     tasks.clear();
-    clocks.clear();
+    applied_entries.clear();
+    index_keys.clear();
+    by_column.clear();
+    by_rank.clear();
+    by_creator.clear();
+    by_updated.clear();
+    search_index.clear();
+    snapshot.reset();
+    snapshot_taken.clear();
+    snapshot_untouched = 0;
+    snapshot_indexed = false;
     id_counter = 0;
+    // Versions stay monotonic, but nothing before this point can be expressed as a delta
+    task_versions.clear();
+    changes.clear();
+    tombstones.clear();
+    tombstone_floor = board_version;
+    board_json.reset();
     std::cout << "[STATE_TRANSFER] All tasks cleared\n";
 }
 
@@ -300,11 +929,113 @@ void TaskManager::add_task_direct(const Task& task)
 {
     std::lock_guard<std::mutex> lock(task_lock);
     int task_id = task.get_task_id();
+    find_locked(task_id);  // A snapshot copy counts as present, same as one in the map
     tasks.emplace(task_id, task);
-    clocks.push_back(&tasks[task_id].get_clock());
+    touch_locked(task_id);
     
-    // Update id_counter if needed
-    if (task_id >= id_counter) {
-        id_counter = task_id + 1;
+    raise_id_counter(task_id);
+}
+
+void TaskManager::add_tasks_direct(const std::vector<Task>& new_tasks)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    for (const Task& task : new_tasks) {
+        int task_id = task.get_task_id();
+        find_locked(task_id);
+        tasks.emplace(task_id, task);
+        touch_locked(task_id);
+        
+        raise_id_counter(task_id);
+    }
+}
+
+std::vector<Task> TaskManager::get_tasks_after(int after_task_id, size_t max_tasks, std::vector<int>& applied_ids)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    std::vector<Task> chunk;
+    applied_ids.clear();
+    
+    for_each_task_locked(after_task_id, [&](const Task &task) {
+        if (chunk.size() == max_tasks) {
+            return false;
+        }
+        chunk.push_back(task);
+        applied_ids.push_back(applied_entry_locked(task.get_task_id()));
+        return true;
+    });
+    
+    return chunk;
+}
+
+void TaskManager::add_tasks_direct(const std::vector<Task>& new_tasks, const std::vector<int>& applied_ids)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    for (size_t i = 0; i < new_tasks.size(); i++) {
+        int task_id = new_tasks[i].get_task_id();
+        find_locked(task_id);
+        tasks[task_id] = new_tasks[i];
+        touch_locked(task_id);
+        if (applied_ids[i] > applied_entry_locked(task_id)) {
+            applied_entries[task_id] = applied_ids[i];
+        }
+        
+        raise_id_counter(task_id);
+    }
+}
+
+int TaskManager::import_tasks(std::vector<Task>& new_tasks)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    // The whole block of ids in one increment
+    int first_id = id_counter.fetch_add(static_cast<int>(new_tasks.size()));
+    int task_id = first_id;
+    for (Task& task : new_tasks) {
+        task.set_task_id(task_id);
+        task.set_rank(end_rank_locked(task.get_column()));  // Written back too, replicas install it as is
+        // Fresh ids are above every existing one, so each insert lands at the end of the map
+        tasks.emplace_hint(tasks.end(), task_id, task);
+        touch_locked(task_id);
+        task_id++;
     }
+    return first_id;
+}
+
+void TaskManager::load_snapshot(const std::shared_ptr<Snapshot>& snap)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    tasks.clear();
+    applied_entries.clear();
+    index_keys.clear();
+    by_column.clear();
+    by_rank.clear();
+    by_creator.clear();
+    by_updated.clear();
+    search_index.clear();
+    task_versions.clear();
+    changes.clear();
+    tombstones.clear();
+    tombstone_floor = board_version;
+    board_json.reset();
+
+    snapshot = snap;
+    snapshot_taken.assign(snap->TaskCount(), 0);
+    snapshot_untouched = snap->TaskCount();
+    snapshot_indexed = false;
+    id_counter = snap->IdCounter();
+}
+
+bool TaskManager::save_snapshot(const std::string& path, const std::vector<LogEntry>& log)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+
+    std::vector<Task> all_tasks;
+    std::vector<int> applied_ids;
+    all_tasks.reserve(tasks.size() + snapshot_untouched);
+    applied_ids.reserve(tasks.size() + snapshot_untouched);
+    for_each_task_locked(-1, [&](const Task &task) {
+        all_tasks.push_back(task);
+        applied_ids.push_back(applied_entry_locked(task.get_task_id()));
+        return true;
+    });
+    return WriteSnapshot(path, all_tasks, applied_ids, id_counter, log);
 }
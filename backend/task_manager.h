@@ -2,33 +2,142 @@
 #define __TASK_MANAGER_H__
 
 #include <map>
+#include <set>
 #include <vector>
+#include <deque>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include "search_index.h"
 #include "messages.h"
 
+class Snapshot;
+
+// Deletes remembered for delta sync, clients further behind than this get a full board
+const size_t MAX_TOMBSTONES = 10000;
+
+// Ranks order the tasks of a column: strings of base-62 digits (0-9, A-Z, a-z) compared
+// byte-wise, with ties broken by task id. A rank never ends in '0', so there is always
+// another one between two different ranks and a move only rewrites the moved task's rank.
+// Returns a rank strictly between low and high, where an empty low is the top of the
+// column and an empty high the bottom. Ranks below the bottom step through their first
+// RANK_STEP_DIGITS digits, so appending keeps them short
+const size_t RANK_STEP_DIGITS = 4;
+std::string RankBetween(const std::string &low, const std::string &high);
+
 class TaskManager
 {
 private:
-    int id_counter;
+    std::atomic<int> id_counter;  // Next fresh id, taken with one atomic increment
     std::map<int, Task> tasks;
-    std::mutex task_lock;
-    std::vector<VectorClock *> clocks;
+    mutable std::mutex task_lock;
+    std::map<int, int> applied_entries;  // task_id -> last log entry applied to it (kept across deletes)
+
+    // Delta sync: every change bumps board_version and stamps the task with it
+    int version_origin;                       // Random id of this version history
+    int board_version;
+    std::map<int, int> task_versions;         // task_id -> version of its last change
+    std::map<int, int> changes;               // version -> task_id, ordered for range scans
+    std::deque<std::pair<int, int>> tombstones;  // (version, task_id) of deletes, oldest first
+    int tombstone_floor;                      // Deltas from before this version are incomplete
+
+    void touch_locked(int task_id);
+    void tombstone_locked(int task_id);
+
+    // QUERY indexes, refiled by touch_locked and dropped by tombstone_locked. Each task's
+    // keys as last indexed, so a move or update can find its old position
+    struct IndexKeys {
+        Column column;
+        std::string created_by;
+        long long updated_at;
+        std::string rank;
+    };
+    std::map<int, IndexKeys> index_keys;               // task_id -> keys, also the id order
+    std::map<Column, std::set<int>> by_column;
+    std::map<Column, std::set<std::pair<std::string, int>>> by_rank;  // (rank, task_id), board order
+    std::map<std::string, std::set<int>> by_creator;
+    std::set<std::pair<long long, int>> by_updated;    // (updated_at, task_id)
+
+    SearchIndex search_index;      // SEARCH, fed by the same hooks
+    bool indexed;                  // Off in parallel replay shards, absorb_shard refiles their tasks
+
+    // GET_BOARD_JSON: the last board rendered, valid while origin and version are unchanged
+    // (clearing or loading the board drops it, those don't bump the version)
+    std::shared_ptr<const std::string> board_json;
+    std::string board_json_id;
+    int board_json_origin;
+    int board_json_version;
+
+    void index_locked(int task_id);
+    void file_locked(int task_id, const Task &task);  // index_locked for a task not in the map
+    void unindex_locked(int task_id);
+    bool collect_locked(int task_id, const TaskQuery &query, size_t limit, TaskPage &page);
+    // Rank for the bottom of column, or for right below after_task_id skipping task_id itself
+    std::string end_rank_locked(Column column);
+    std::string rank_below_locked(Column column, int after_task_id, int task_id);
+
+    // Tasks loaded from a snapshot stay in the mapped file until a write touches them,
+    // reads decode the records they return into copies
+    std::shared_ptr<Snapshot> snapshot;
+    std::vector<char> snapshot_taken;  // Per snapshot record, set once materialized (or deleted)
+    size_t snapshot_untouched;
+    bool snapshot_indexed;             // Untouched snapshot tasks are filed in the indexes too
+
+    Task* find_locked(int task_id);  // Map lookup, falling back to the snapshot
+    bool copy_task_locked(int task_id, Task &out);
+    // Every task with an id above after_task_id in id order, the map merged with the untouched
+    // snapshot records. Stops once fn returns false
+    void for_each_task_locked(int after_task_id, const std::function<bool(const Task &)> &fn);
+    void index_snapshot_locked();
+    int applied_entry_locked(int task_id);
+    void raise_id_counter(int task_id);  // Keep fresh ids above an id assigned elsewhere
+
+    // Mutations with task_lock already held, shared by the single-op calls and apply_batch
+    int create_task_locked(const std::string &title, const std::string &description, const std::string &board_id,
+                           const std::string &created_by, Column column, int client_id);
+    OperationResponse update_task_locked(int task_id, const std::string &title, const std::string &description, const VectorClock &vc);
+    OperationResponse move_task_locked(int task_id, Column column, const VectorClock &vc, const std::string &rank = "");
+    OperationResponse place_task_locked(int task_id, Column column, const std::string &rank, const VectorClock &vc);
+    bool delete_task_locked(int task_id);
 
 public:
     TaskManager();
-    // New signature with all fields including column
-    bool create_task(std::string title, std::string description, std::string board_id, 
-                     std::string created_by, Column column, int client_id);
+    // New signature with all fields including column, returns the id the task was given
+    int create_task(std::string title, std::string description, std::string board_id, 
+                    std::string created_by, Column column, int client_id);
     // Backward compatible signature for tests
-    bool create_task(std::string description, int client_id);
+    int create_task(std::string description, int client_id);
+    // Create with an explicit id (log replay), returns false if the id is already taken.
+    // An empty rank puts the task at the bottom of its column
+    bool create_task_with_id(int task_id, std::string title, std::string description, std::string board_id,
+                             std::string created_by, Column column, int client_id, std::string rank = "");
     
     OperationResponse update_task_with_conflict_detection(int task_id, const std::string &title, const std::string &description, const VectorClock &vc);
     OperationResponse move_task_with_conflict_detection(int task_id, Column column, const VectorClock &vc);
+    // REORDER_TASK: move into column right below after_task_id (-1 for the top). An anchor
+    // that is gone or in another column puts the task at the bottom instead
+    OperationResponse reorder_task_with_conflict_detection(int task_id, Column column, int after_task_id, const VectorClock &vc);
     bool update_task(int task_id, const std::string &title, const std::string &description, const VectorClock &vc);
-    bool move_task(int task_id, Column column, const VectorClock &vc);
+    // Log replay passes the rank the entry recorded, empty picks the bottom of the column
+    bool move_task(int task_id, Column column, const VectorClock &vc, const std::string &rank = "");
+    bool place_task(int task_id, Column column, const std::string &rank, const VectorClock &vc);
     bool delete_task(int task_id);
+    // BATCH: apply ops in order under one lock, one response per op (create reports the new id)
+    std::vector<OperationResponse> apply_batch(const std::vector<BatchOperation> &ops,
+                                               const std::vector<VectorClock> &clocks);
     Task get_task(int id);
+    bool try_get_task(int id, Task &out);
     std::vector<Task> get_all_tasks();
+    BoardDelta get_changes_since(int origin, int since_version);
+    // QUERY: one page of the tasks matching the filters, walked through the narrowest index
+    TaskPage query_tasks(const TaskQuery &query);
+    // SEARCH: up to limit (at most MAX_SEARCH_RESULTS) task ids matching the text, best first
+    SearchResults search_tasks(const std::string &query, int limit);
+    int get_board_version();
+    // GET_BOARD_JSON: board_id's tasks as {"board_id", "origin", "version", "tasks": [...]},
+    // rendered at most once per board version and shared by every request until the next change
+    std::shared_ptr<const std::string> get_board_json(const std::string &board_id);
 
     // SMR methods
     void append_to_log(const LogEntry &entry);
@@ -38,12 +147,35 @@ public:
     void merge_logs(const std::vector<LogEntry> &remote_log);
 
     size_t get_task_count() const;
+    size_t get_snapshot_task_count() const;  // Tasks still only in the snapshot file
+
+    // Idempotent replay bookkeeping, an entry is applied to a task at most once
+    bool mark_entry_applied(int task_id, int entry_id);  // False if entry_id was already applied
+    int get_applied_entry_id(int task_id);  // -1 if nothing applied yet
+
+    // Parallel replay: copy the given tasks into a shard, then fold the shard's result back
+    void seed_shard(TaskManager &shard, const std::vector<int> &task_ids);
+    void absorb_shard(TaskManager &shard, const std::vector<int> &task_ids);
     
     // State transfer methods for master rejoin
     void clear_all_tasks();  // Clear all tasks (for receiving state transfer)
     void set_id_counter(int id);  // Set next task ID
     int get_id_counter() const;  // Get current ID counter
     void add_task_direct(const Task& task);  // Add task without incrementing counter
+    void add_tasks_direct(const std::vector<Task>& tasks);  // Same for a whole list under one lock
+
+    // Chunked state transfer: up to max_tasks tasks with ids above after_task_id in id order,
+    // with their applied entry ids, and the receiving side, which replaces any local copy
+    std::vector<Task> get_tasks_after(int after_task_id, size_t max_tasks, std::vector<int>& applied_ids);
+    void add_tasks_direct(const std::vector<Task>& tasks, const std::vector<int>& applied_ids);
+
+    // Snapshots: replace all state with a mapped snapshot (tasks materialize lazily), or write one
+    void load_snapshot(const std::shared_ptr<Snapshot>& snap);
+    bool save_snapshot(const std::string& path, const std::vector<LogEntry>& log);
+
+    // Bulk import: give tasks consecutive fresh ids and ranks at the bottom of their columns
+    // (written back into the list) and install them under one lock. Returns the first id
+    int import_tasks(std::vector<Task>& tasks);
 };
 
 #endif
\ No newline at end of file
@@ -1,7 +1,17 @@
 #include <iostream>
 #include <cassert>
 #include <stdexcept>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iterator>
 #include "task_manager.h"
+#include "task_import.h"
+#include "snapshot.h"
 #include "messages.h"
 
 // Test counter
@@ -148,8 +158,9 @@ TEST(test_task_vector_clock_access)
 TEST(test_task_manager_create_task)
 {
     TaskManager tm;
-    ASSERT_TRUE(tm.create_task("First task", 1));
-    ASSERT_EQUAL(tm.get_task_count(), 1);
+    ASSERT_EQUAL(tm.create_task("First task", 1), 0);
+    ASSERT_EQUAL(tm.create_task("Second task", 1), 1);
+    ASSERT_EQUAL(tm.get_task_count(), 2);
 }
 
 TEST(test_task_manager_create_multiple_tasks)
@@ -162,6 +173,39 @@ TEST(test_task_manager_create_multiple_tasks)
     ASSERT_EQUAL(tm.get_task_count(), 3);
 }
 
+TEST(test_task_manager_concurrent_creates_report_own_ids)
+{
+    TaskManager tm;
+    const int threads = 8;
+    const int creates_each = 500;
+    std::vector<std::vector<int>> ids(threads);
+
+    std::vector<std::thread> creators;
+    for (int t = 0; t < threads; t++) {
+        creators.emplace_back([&tm, &ids, t]() {
+            for (int i = 0; i < creates_each; i++) {
+                std::string title = "T" + std::to_string(t) + "-" + std::to_string(i);
+                ids[t].push_back(tm.create_task(title, "", "board-1", "user", Column::TODO, t));
+            }
+        });
+    }
+    for (auto& creator : creators) {
+        creator.join();
+    }
+
+    // Every create got its own id, and the id it reported is the task it made
+    std::set<int> seen;
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < creates_each; i++) {
+            ASSERT_TRUE(seen.insert(ids[t][i]).second);
+            ASSERT_EQUAL(tm.get_task(ids[t][i]).get_title(), "T" + std::to_string(t) + "-" + std::to_string(i));
+        }
+    }
+    ASSERT_EQUAL(tm.get_task_count(), static_cast<size_t>(threads * creates_each));
+    ASSERT_EQUAL(*seen.rbegin(), threads * creates_each - 1);
+    ASSERT_EQUAL(tm.get_id_counter(), threads * creates_each);
+}
+
 TEST(test_task_manager_get_task)
 {
     TaskManager tm;
@@ -303,6 +347,545 @@ TEST(test_task_manager_workflow)
     ASSERT_EQUAL(tm.get_task_count(), 2);
 }
 
+/* ============ Delta Sync Tests ============ */
+
+TEST(test_task_manager_changes_since)
+{
+    TaskManager tm;
+    VectorClock vc(1);
+
+    tm.create_task("Task 0", 1);
+    tm.create_task("Task 1", 1);
+    tm.create_task("Task 2", 1);
+
+    BoardDelta initial = tm.get_changes_since(0, -1);
+    ASSERT_TRUE(initial.full_sync);
+    ASSERT_EQUAL(initial.tasks.size(), 3);
+    ASSERT_EQUAL(initial.version, tm.get_board_version());
+
+    vc.increment();
+    tm.move_task(1, Column::DONE, vc);
+    tm.delete_task(2);
+
+    BoardDelta delta = tm.get_changes_since(initial.origin, initial.version);
+    ASSERT_FALSE(delta.full_sync);
+    ASSERT_EQUAL(delta.tasks.size(), 1);
+    ASSERT_EQUAL(delta.tasks[0].get_task_id(), 1);
+    ASSERT_EQUAL(delta.tasks[0].get_column(), Column::DONE);
+    ASSERT_EQUAL(delta.deleted_task_ids.size(), 1);
+    ASSERT_EQUAL(delta.deleted_task_ids[0], 2);
+
+    // Nothing changed since the last delta
+    BoardDelta empty = tm.get_changes_since(delta.origin, delta.version);
+    ASSERT_FALSE(empty.full_sync);
+    ASSERT_TRUE(empty.tasks.empty());
+    ASSERT_TRUE(empty.deleted_task_ids.empty());
+}
+
+TEST(test_task_manager_changes_since_falls_back_to_full_sync)
+{
+    TaskManager tm;
+    tm.create_task("Task 0", 1);
+    BoardDelta initial = tm.get_changes_since(0, -1);
+
+    // A version from another node's history cannot be trusted
+    BoardDelta other_origin = tm.get_changes_since(initial.origin + 1, initial.version);
+    ASSERT_TRUE(other_origin.full_sync);
+
+    // Once the tombstone of a delete is evicted, older clients must reload
+    for (size_t i = 0; i <= MAX_TOMBSTONES; i++) {
+        tm.delete_task(tm.create_task("Temp", 1));
+    }
+    BoardDelta stale = tm.get_changes_since(initial.origin, initial.version);
+    ASSERT_TRUE(stale.full_sync);
+    ASSERT_EQUAL(stale.tasks.size(), 1);
+}
+
+/* ============ Query Tests ============ */
+
+TEST(test_task_manager_query_filters_and_pages)
+{
+    TaskManager tm;
+    // 30 tasks: every third by bob, columns cycling TODO/IN_PROGRESS/DONE by id
+    for (int i = 0; i < 30; i++) {
+        tm.create_task("Task " + std::to_string(i), "", "board-1", i % 3 == 0 ? "bob" : "alice",
+                       static_cast<Column>(i % 3), 1);
+    }
+
+    // One column, paged four at a time in id order
+    TaskQuery query;
+    query.column = static_cast<int>(Column::IN_PROGRESS);
+    query.limit = 4;
+    std::vector<int> ids;
+    for (int pages = 1; ; pages++) {
+        TaskPage page = tm.query_tasks(query);
+        for (const Task& task : page.tasks) {
+            ids.push_back(task.get_task_id());
+        }
+        if (!page.has_more) {
+            ASSERT_EQUAL(pages, 3);
+            break;
+        }
+        query.after = page.next;
+    }
+    ASSERT_EQUAL(ids.size(), 10);
+    for (size_t i = 0; i < ids.size(); i++) {
+        ASSERT_EQUAL(ids[i], static_cast<int>(i) * 3 + 1);
+    }
+
+    // Filters combine; bob's tasks are all in TODO
+    TaskQuery bob;
+    bob.created_by = "bob";
+    ASSERT_EQUAL(tm.query_tasks(bob).tasks.size(), 10);
+    bob.column = static_cast<int>(Column::DONE);
+    ASSERT_TRUE(tm.query_tasks(bob).tasks.empty());
+    TaskQuery nobody;
+    nobody.created_by = "carol";
+    ASSERT_TRUE(tm.query_tasks(nobody).tasks.empty());
+
+    // A move refiles the task, a delete drops it
+    VectorClock vc(1);
+    vc.increment();
+    ASSERT_TRUE(tm.move_task(0, Column::DONE, vc));
+    ASSERT_TRUE(tm.delete_task(3));
+    ASSERT_EQUAL(tm.query_tasks(bob).tasks.size(), 1);
+    ASSERT_EQUAL(tm.query_tasks(bob).tasks[0].get_task_id(), 0);
+    TaskQuery todo;
+    todo.column = static_cast<int>(Column::TODO);
+    ASSERT_EQUAL(tm.query_tasks(todo).tasks.size(), 8);
+}
+
+TEST(test_task_manager_query_by_updated_at)
+{
+    TaskManager tm;
+    for (int i = 0; i < 20; i++) {
+        tm.create_task("Task " + std::to_string(i), 1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    VectorClock vc(1);
+    vc.increment();
+    ASSERT_TRUE(tm.update_task(7, "Touched", "", vc));
+    long long touched_at = tm.get_task(7).get_updated_at();
+
+    // Ascending pages cover every task once, in (updated_at, id) order, the update last
+    TaskQuery query;
+    query.sort = QuerySort::UPDATED_ASC;
+    query.limit = 6;
+    std::vector<Task> seen;
+    while (true) {
+        TaskPage page = tm.query_tasks(query);
+        seen.insert(seen.end(), page.tasks.begin(), page.tasks.end());
+        if (!page.has_more) {
+            break;
+        }
+        query.after = page.next;
+    }
+    ASSERT_EQUAL(seen.size(), 20);
+    for (size_t i = 1; i < seen.size(); i++) {
+        ASSERT_TRUE(seen[i - 1].get_updated_at() < seen[i].get_updated_at() ||
+                    (seen[i - 1].get_updated_at() == seen[i].get_updated_at() &&
+                     seen[i - 1].get_task_id() < seen[i].get_task_id()));
+    }
+    ASSERT_EQUAL(seen.back().get_task_id(), 7);
+
+    // Newest first, and updated_since leaves only the update
+    TaskQuery newest;
+    newest.sort = QuerySort::UPDATED_DESC;
+    newest.limit = 1;
+    TaskPage first = tm.query_tasks(newest);
+    ASSERT_EQUAL(first.tasks[0].get_task_id(), 7);
+    ASSERT_TRUE(first.has_more);
+    newest.updated_since = touched_at;
+    newest.limit = 0;
+    TaskPage recent = tm.query_tasks(newest);
+    ASSERT_EQUAL(recent.tasks.size(), 1);
+    ASSERT_FALSE(recent.has_more);
+}
+
+/* ============ Search Tests ============ */
+
+TEST(test_posting_list_blocks)
+{
+    // Enough ids for many blocks, inserted out of order with a few repeats and erases
+    std::mt19937 rng(42);
+    std::vector<int> ids;
+    for (int i = 0; i < 5000; i++) {
+        ids.push_back(i * 3);
+    }
+    std::shuffle(ids.begin(), ids.end(), rng);
+
+    PostingList list;
+    std::set<int> expected;
+    for (int id : ids) {
+        ASSERT_EQUAL(list.insert(id), expected.insert(id).second);
+    }
+    ASSERT_FALSE(list.insert(ids[0]));
+    for (int i = 0; i < 1000; i++) {
+        int id = ids[i];
+        ASSERT_EQUAL(list.erase(id), expected.erase(id) > 0);
+    }
+    ASSERT_FALSE(list.erase(1));
+    ASSERT_EQUAL(list.size(), expected.size());
+
+    std::vector<int> all;
+    list.append_to(all);
+    ASSERT_TRUE(std::equal(all.begin(), all.end(), expected.begin()));
+    // Gaps of 3 take a byte each
+    ASSERT_TRUE(list.memory_bytes() < expected.size() * sizeof(int));
+
+    // Intersection agrees with a plain merge, sparse and dense
+    for (int step : {1, 7, 997}) {
+        std::vector<int> candidates;
+        for (int id = 0; id < 15000; id += step) {
+            candidates.push_back(id);
+        }
+        std::vector<int> merged;
+        std::set_intersection(candidates.begin(), candidates.end(), expected.begin(), expected.end(),
+                              std::back_inserter(merged));
+        list.intersect(candidates);
+        ASSERT_TRUE(candidates == merged);
+    }
+}
+
+TEST(test_task_manager_search)
+{
+    TaskManager tm;
+    tm.create_task("Fix login bug", "Users cannot log in after reset", "board-1", "alice", Column::TODO, 1);
+    tm.create_task("Deploy release", "Deploy the login service to staging", "board-1", "bob", Column::TODO, 1);
+    tm.create_task("Write docs", "Document the deployment steps", "board-1", "bob", Column::DONE, 1);
+
+    // All tokens must match, the last as a prefix, case ignored
+    SearchResults login = tm.search_tasks("LOGIN", 10);
+    ASSERT_EQUAL(login.total_matches, 2);
+    SearchResults fix_login = tm.search_tasks("fix login", 10);
+    ASSERT_EQUAL(fix_login.total_matches, 1);
+    ASSERT_EQUAL(fix_login.hits[0].task_id, 0);
+    SearchResults dep = tm.search_tasks("dep", 10);
+    ASSERT_EQUAL(dep.total_matches, 2);
+    ASSERT_TRUE(tm.search_tasks("login zebra", 10).hits.empty());
+    ASSERT_TRUE(tm.search_tasks("  ", 10).hits.empty());
+
+    // Title hits outrank description hits
+    ASSERT_EQUAL(dep.hits[0].task_id, 1);
+    ASSERT_TRUE(dep.hits[0].score > dep.hits[1].score);
+
+    // Updates replace the old text, deletes drop the task, limits cut the hits not the count
+    VectorClock vc(1);
+    vc.increment();
+    ASSERT_TRUE(tm.update_task(0, "Fix signup bug", "Users cannot register", vc));
+    ASSERT_EQUAL(tm.search_tasks("login", 10).total_matches, 1);
+    ASSERT_EQUAL(tm.search_tasks("signup", 10).hits[0].task_id, 0);
+    ASSERT_TRUE(tm.delete_task(1));
+    ASSERT_TRUE(tm.search_tasks("login", 10).hits.empty());
+    ASSERT_EQUAL(tm.search_tasks("d", 1).total_matches, 1);
+    tm.create_task("Design review", "", "board-1", "bob", Column::TODO, 1);
+    SearchResults limited = tm.search_tasks("d", 1);
+    ASSERT_EQUAL(limited.total_matches, 2);
+    ASSERT_EQUAL(limited.hits.size(), 1);
+}
+
+/* ============ Ordering Tests ============ */
+
+// Ids of a column's tasks in board order
+static std::vector<int> ColumnOrder(TaskManager &tm, Column column)
+{
+    std::vector<std::pair<std::string, int>> ranked;
+    for (Task &task : tm.get_all_tasks()) {
+        if (task.get_column() == column) {
+            ranked.emplace_back(task.get_rank(), task.get_task_id());
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+    std::vector<int> ids;
+    for (const auto &pair : ranked) {
+        ids.push_back(pair.second);
+    }
+    return ids;
+}
+
+TEST(test_rank_between)
+{
+    // Random drops between neighbours, at the top and at the bottom always fit strictly between
+    std::mt19937 rng(7);
+    std::vector<std::string> ranks;
+    for (int i = 0; i < 3000; i++) {
+        size_t gap = rng() % (ranks.size() + 1);
+        std::string low = gap > 0 ? ranks[gap - 1] : "";
+        std::string high = gap < ranks.size() ? ranks[gap] : "";
+        std::string rank = RankBetween(low, high);
+        ASSERT_TRUE(rank > low);
+        ASSERT_TRUE(high.empty() || rank < high);
+        ASSERT_TRUE(rank.back() != '0');
+        ranks.insert(ranks.begin() + gap, rank);
+    }
+
+    // Appending steps the leading digits instead of growing the rank
+    std::string last;
+    for (int i = 0; i < 20000; i++) {
+        std::string next = RankBetween(last, "");
+        ASSERT_TRUE(next > last);
+        ASSERT_TRUE(next.size() <= RANK_STEP_DIGITS);
+        last = next;
+    }
+}
+
+TEST(test_task_manager_reorder)
+{
+    TaskManager tm;
+    for (int i = 0; i < 4; i++) {
+        tm.create_task("Task " + std::to_string(i), 1);
+    }
+    ASSERT_TRUE((ColumnOrder(tm, Column::TODO) == std::vector<int>{0, 1, 2, 3}));
+
+    // Dropping a card between two others changes that card only
+    BoardDelta before = tm.get_changes_since(0, 0);
+    VectorClock vc(1);
+    vc.increment();
+    ASSERT_TRUE(tm.reorder_task_with_conflict_detection(3, Column::TODO, 0, vc).success);
+    ASSERT_TRUE((ColumnOrder(tm, Column::TODO) == std::vector<int>{0, 3, 1, 2}));
+    BoardDelta delta = tm.get_changes_since(before.origin, before.version);
+    ASSERT_EQUAL(delta.tasks.size(), 1);
+    ASSERT_EQUAL(delta.tasks[0].get_task_id(), 3);
+
+    // To the top, into another column below a card there, and below an anchor that isn't
+    // in the column (the bottom)
+    vc.increment();
+    ASSERT_TRUE(tm.reorder_task_with_conflict_detection(2, Column::TODO, -1, vc).success);
+    ASSERT_TRUE((ColumnOrder(tm, Column::TODO) == std::vector<int>{2, 0, 3, 1}));
+    vc.increment();
+    ASSERT_TRUE(tm.move_task(0, Column::DONE, vc));
+    vc.increment();
+    ASSERT_TRUE(tm.move_task(1, Column::DONE, vc));
+    vc.increment();
+    ASSERT_TRUE(tm.reorder_task_with_conflict_detection(3, Column::DONE, 0, vc).success);
+    ASSERT_TRUE((ColumnOrder(tm, Column::DONE) == std::vector<int>{0, 3, 1}));
+    vc.increment();
+    ASSERT_TRUE(tm.reorder_task_with_conflict_detection(2, Column::DONE, 42, vc).success);
+    ASSERT_TRUE((ColumnOrder(tm, Column::DONE) == std::vector<int>{0, 3, 1, 2}));
+
+    // A stale clock is rejected, a replica given the recorded ranks ends up in the same order
+    VectorClock stale(1);
+    ASSERT_TRUE(tm.reorder_task_with_conflict_detection(2, Column::DONE, -1, stale).rejected);
+    TaskManager replica;
+    for (Task &task : tm.get_all_tasks()) {
+        ASSERT_TRUE(replica.create_task_with_id(task.get_task_id(), task.get_title(), "", "board-1", "user",
+                                                Column::TODO, 1));
+        ASSERT_TRUE(replica.place_task(task.get_task_id(), task.get_column(), task.get_rank(), vc));
+    }
+    ASSERT_TRUE(ColumnOrder(replica, Column::DONE) == ColumnOrder(tm, Column::DONE));
+}
+
+/* ============ Batch Tests ============ */
+
+TEST(test_task_manager_apply_batch)
+{
+    TaskManager tm;
+    tm.create_task("Task 0", 1);
+    tm.create_task("Task 1", 1);
+
+    VectorClock vc(1);
+    vc.increment();
+    std::vector<BatchOperation> ops;
+    std::vector<VectorClock> clocks;
+    ops.push_back(BatchOperation(OpType::MOVE_TASK, Task(0, "", "", "board-1", "user", Column::DONE, 1)));
+    ops.push_back(BatchOperation(OpType::CREATE_TASK, Task(0, "New", "Desc", "board-1", "user", Column::IN_PROGRESS, 1)));
+    ops.push_back(BatchOperation(OpType::DELETE_TASK, Task(1, "", "", "board-1", "user", Column::TODO, 1)));
+    ops.push_back(BatchOperation(OpType::DELETE_TASK, Task(1, "", "", "board-1", "user", Column::TODO, 1)));
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        clocks.push_back(vc);
+    }
+
+    std::vector<OperationResponse> responses = tm.apply_batch(ops, clocks);
+    ASSERT_EQUAL(responses.size(), 4);
+    ASSERT_TRUE(responses[0].success);
+    ASSERT_TRUE(responses[1].success);
+    ASSERT_EQUAL(responses[1].updated_task_id, 2);
+    ASSERT_TRUE(responses[2].success);
+    // Operations apply in order, the second delete finds nothing
+    ASSERT_FALSE(responses[3].success);
+
+    ASSERT_EQUAL(tm.get_task(0).get_column(), Column::DONE);
+    ASSERT_EQUAL(tm.get_task(2).get_title(), "New");
+    ASSERT_EQUAL(tm.get_task_count(), 2);
+}
+
+/* ============ Bulk Import Tests ============ */
+
+TEST(test_task_manager_import_tasks)
+{
+    TaskManager tm;
+    tm.create_task("Existing", 1);
+
+    std::vector<Task> tasks;
+    tasks.push_back(Task(0, "A", "", "board-1", "import", Column::TODO, 0));
+    tasks.push_back(Task(0, "B", "", "board-1", "import", Column::DONE, 0));
+
+    int first_id = tm.import_tasks(tasks);
+    ASSERT_EQUAL(first_id, 1);
+    ASSERT_EQUAL(tasks[1].get_task_id(), 2);
+    ASSERT_EQUAL(tm.get_task(2).get_column(), Column::DONE);
+    ASSERT_EQUAL(tm.get_id_counter(), 3);
+
+    // A replica installs the same list under the ids the primary assigned
+    TaskManager replica;
+    replica.add_tasks_direct(tasks);
+    ASSERT_EQUAL(replica.get_task(1).get_title(), "A");
+    ASSERT_EQUAL(replica.get_id_counter(), 3);
+}
+
+TEST(test_parse_task_records)
+{
+    Task task;
+    ASSERT_TRUE(ParseJsonlTask("{\"title\": \"Fix \\\"login\\\"\", \"column\": \"IN_PROGRESS\", \"client_id\": 7, \"extra\": true}", task));
+    ASSERT_EQUAL(task.get_title(), "Fix \"login\"");
+    ASSERT_EQUAL(task.get_column(), Column::IN_PROGRESS);
+    ASSERT_EQUAL(task.get_client_id(), 7);
+    ASSERT_FALSE(ParseJsonlTask("{\"title\": \"unterminated}", task));
+    ASSERT_FALSE(ParseJsonlTask("{\"column\": 5}", task));
+
+    ASSERT_TRUE(ParseCsvTask("\"Write docs, tests\",\"Say \"\"hi\"\"\",2,alice", task));
+    ASSERT_EQUAL(task.get_title(), "Write docs, tests");
+    ASSERT_EQUAL(task.get_description(), "Say \"hi\"");
+    ASSERT_EQUAL(task.get_column(), Column::DONE);
+    ASSERT_EQUAL(task.get_created_by(), "alice");
+
+    // Parallel parsing keeps input order and counts malformed lines
+    std::vector<std::string> lines;
+    for (int i = 0; i < 5000; i++)
+    {
+        lines.push_back(i == 10 ? "not json" : "{\"title\": \"T" + std::to_string(i) + "\"}");
+    }
+    lines.push_back("");
+    size_t skipped = 0;
+    std::vector<Task> tasks = ParseTaskLines(lines, ImportFormat::JSONL, skipped);
+    ASSERT_EQUAL(tasks.size(), 4999);
+    ASSERT_EQUAL(skipped, 1);
+    ASSERT_EQUAL(tasks[10].get_title(), "T11");
+    ASSERT_EQUAL(tasks[4998].get_title(), "T4999");
+}
+
+/* ============ Snapshot Tests ============ */
+
+TEST(test_task_manager_snapshot_round_trip)
+{
+    const std::string path = "task_test.snap";
+    TaskManager tm;
+    VectorClock vc(1);
+    tm.create_task("Task 0", 1);
+    tm.create_task("Task 1", 1);
+    tm.create_task("Task 2", 1);
+    tm.delete_task(1);
+    vc.increment();
+    tm.move_task(2, Column::DONE, vc);
+    tm.mark_entry_applied(2, 5);
+
+    std::vector<LogEntry> log;
+    log.push_back(LogEntry(5, OpType::MOVE_TASK, vc, 2, "", "", "", Column::DONE, 1));
+    ASSERT_TRUE(tm.save_snapshot(path, log));
+
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    ASSERT_TRUE(snapshot->Open(path));
+    std::vector<LogEntry> loaded_log;
+    ASSERT_TRUE(snapshot->ReadLog(loaded_log));
+    ASSERT_EQUAL(loaded_log.size(), 1);
+    ASSERT_EQUAL(loaded_log[0].get_task_id(), 2);
+
+    TaskManager restored;
+    restored.load_snapshot(snapshot);
+    ASSERT_EQUAL(restored.get_task_count(), 2);
+    ASSERT_EQUAL(restored.get_id_counter(), 3);
+
+    // Tasks come out of the snapshot on first touch
+    ASSERT_EQUAL(restored.get_task(2).get_column(), Column::DONE);
+    ASSERT_FALSE(restored.mark_entry_applied(2, 5));
+    ASSERT_TRUE(restored.delete_task(0));
+    ASSERT_FALSE(restored.delete_task(0));
+    ASSERT_EQUAL(restored.get_task_count(), 1);
+    ASSERT_EQUAL(restored.get_all_tasks().size(), 1);
+
+    std::remove(path.c_str());
+}
+
+TEST(test_task_manager_snapshot_reads_leave_tasks_mapped)
+{
+    const std::string path = "task_test_reads.snap";
+    TaskManager tm;
+    for (int i = 0; i < 6; i++) {
+        tm.create_task("Snap " + std::to_string(i), "about kiwis", i % 2 ? "board-2" : "board-1",
+                       i < 3 ? "alice" : "bob", i < 4 ? Column::TODO : Column::DONE, 1);
+    }
+    ASSERT_TRUE(tm.save_snapshot(path, std::vector<LogEntry>()));
+
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    ASSERT_TRUE(snapshot->Open(path));
+    TaskManager restored;
+    restored.load_snapshot(snapshot);
+
+    // Reads decode what they return and leave every task in the file
+    ASSERT_EQUAL(restored.get_all_tasks().size(), 6);
+    ASSERT_TRUE(restored.get_board_json("board-2")->find("Snap 5") != std::string::npos);
+    ASSERT_EQUAL(restored.get_changes_since(0, 0).tasks.size(), 6);
+    TaskQuery bob;
+    bob.created_by = "bob";
+    ASSERT_EQUAL(restored.query_tasks(bob).tasks.size(), 3);
+    ASSERT_EQUAL(restored.search_tasks("kiwis", 10).total_matches, 6);
+    ASSERT_EQUAL(restored.get_task(4).get_title(), "Snap 4");
+    std::vector<int> applied_ids;
+    ASSERT_EQUAL(restored.get_tasks_after(3, 10, applied_ids).size(), 2);
+    ASSERT_EQUAL(restored.get_snapshot_task_count(), 6);
+
+    // A create ranks below the snapshot tasks in its column without taking them out
+    int created = restored.create_task("New", "", "board-1", "carol", Column::TODO, 1);
+    ASSERT_TRUE(restored.get_task(created).get_rank() > restored.get_task(3).get_rank());
+    ASSERT_EQUAL(restored.get_snapshot_task_count(), 6);
+
+    // Only the tasks a write touches are materialized
+    VectorClock vc(1);
+    vc.increment();
+    ASSERT_TRUE(restored.move_task(0, Column::DONE, vc));
+    ASSERT_TRUE(restored.delete_task(1));
+    ASSERT_EQUAL(restored.get_snapshot_task_count(), 4);
+    ASSERT_EQUAL(restored.get_task_count(), 6);
+    ASSERT_EQUAL(restored.get_all_tasks().size(), 6);
+    ASSERT_EQUAL(restored.get_all_tasks()[0].get_column(), Column::DONE);
+
+    std::remove(path.c_str());
+}
+
+/* ============ Board JSON Tests ============ */
+
+TEST(test_task_manager_board_json)
+{
+    TaskManager tm;
+    tm.create_task("Say \"hi\"", "C:\\path\nnext\x01", "board-1", "alice", Column::TODO, 1);
+    tm.create_task("Other board", "", "board-2", "bob", Column::DONE, 2);
+
+    // Only the asked-for board, with quotes, backslashes and control characters escaped
+    std::shared_ptr<const std::string> json = tm.get_board_json("board-1");
+    ASSERT_EQUAL(json->compare(0, 14, "{\"board_id\":\"b"), 0);
+    ASSERT_TRUE(json->find("\"title\":\"Say \\\"hi\\\"\"") != std::string::npos);
+    ASSERT_TRUE(json->find("\"description\":\"C:\\\\path\\nnext\\u0001\"") != std::string::npos);
+    ASSERT_TRUE(json->find("\"vector_clock\":{\"1\":0}") != std::string::npos);
+    ASSERT_TRUE(json->find("Other board") == std::string::npos);
+    ASSERT_EQUAL(json->back(), '}');
+
+    // Served from the cache until the board changes
+    ASSERT_TRUE(tm.get_board_json("board-1") == json);
+    VectorClock vc(1);
+    vc.increment();
+    ASSERT_TRUE(tm.move_task(0, Column::DONE, vc));
+    std::shared_ptr<const std::string> moved = tm.get_board_json("board-1");
+    ASSERT_TRUE(moved != json);
+    ASSERT_TRUE(moved->find("\"vector_clock\":{\"1\":0}") == std::string::npos);
+
+    // Another board id, or a cleared board, renders again
+    ASSERT_TRUE(tm.get_board_json("board-2")->find("Other board") != std::string::npos);
+    ASSERT_TRUE(tm.get_board_json("board-1") != moved);
+    tm.clear_all_tasks();
+    ASSERT_TRUE(tm.get_board_json("board-1")->find("\"tasks\":[]") != std::string::npos);
+}
+
 /* ============ Integration Tests ============ */
 
 TEST(test_task_vector_clock_increments)
@@ -347,6 +930,7 @@ int main()
     std::cout << "--- TaskManager Tests ---" << std::endl;
     RUN_TEST(test_task_manager_create_task);
     RUN_TEST(test_task_manager_create_multiple_tasks);
+    RUN_TEST(test_task_manager_concurrent_creates_report_own_ids);
     RUN_TEST(test_task_manager_get_task);
     RUN_TEST(test_task_manager_get_nonexistent_task);
     RUN_TEST(test_task_manager_update_task);
@@ -360,6 +944,44 @@ int main()
     RUN_TEST(test_task_manager_workflow);
     std::cout << std::endl;
 
+    std::cout << "--- Delta Sync Tests ---" << std::endl;
+    RUN_TEST(test_task_manager_changes_since);
+    RUN_TEST(test_task_manager_changes_since_falls_back_to_full_sync);
+    std::cout << std::endl;
+
+    std::cout << "--- Query Tests ---" << std::endl;
+    RUN_TEST(test_task_manager_query_filters_and_pages);
+    RUN_TEST(test_task_manager_query_by_updated_at);
+    std::cout << std::endl;
+
+    std::cout << "--- Search Tests ---" << std::endl;
+    RUN_TEST(test_posting_list_blocks);
+    RUN_TEST(test_task_manager_search);
+    std::cout << std::endl;
+
+    std::cout << "--- Ordering Tests ---" << std::endl;
+    RUN_TEST(test_rank_between);
+    RUN_TEST(test_task_manager_reorder);
+    std::cout << std::endl;
+
+        std::cout << "--- Batch Tests ---" << std::endl;
+    RUN_TEST(test_task_manager_apply_batch);
+    std::cout << std::endl;
+
+    std::cout << "--- Bulk Import Tests ---" << std::endl;
+    RUN_TEST(test_task_manager_import_tasks);
+    RUN_TEST(test_parse_task_records);
+    std::cout << std::endl;
+
+    std::cout << "--- Snapshot Tests ---" << std::endl;
+    RUN_TEST(test_task_manager_snapshot_round_trip);
+    RUN_TEST(test_task_manager_snapshot_reads_leave_tasks_mapped);
+    std::cout << std::endl;
+
+    std::cout << "--- Board JSON Tests ---" << std::endl;
+    RUN_TEST(test_task_manager_board_json);
+    std::cout << std::endl;
+
     std::cout << "--- Integration Tests ---" << std::endl;
     RUN_TEST(test_task_vector_clock_increments);
     std::cout << std::endl;
@@ -6,16 +6,20 @@
 #include "messages.h"
 #include "Socket.h"
 
-// Helper to receive OperationResponse (4 ints: success, conflict, rejected, task_id)
+// Helper to receive OperationResponse (7 ints: success, conflict, rejected, task_id, entry_id,
+// busy, retry_after_ms)
 struct OperationResponseData {
     bool success;
     bool conflict;
     bool rejected;
     int task_id;
+    int entry_id;
+    bool busy;
+    int retry_after_ms;
 };
 
 bool ReceiveOperationResponse(Socket* socket, OperationResponseData& response) {
-    int buffer[4];
+    int buffer[7];
     if (!socket->Receive(buffer, sizeof(buffer))) {
         return false;
     }
@@ -23,6 +27,9 @@ bool ReceiveOperationResponse(Socket* socket, OperationResponseData& response) {
     response.conflict = (ntohl(buffer[1]) == 1);
     response.rejected = (ntohl(buffer[2]) == 1);
     response.task_id = ntohl(buffer[3]);
+    response.entry_id = ntohl(buffer[4]);
+    response.busy = (ntohl(buffer[5]) == 1);
+    response.retry_after_ms = ntohl(buffer[6]);
     return true;
 }
 
@@ -77,7 +84,7 @@ int main() {
     
     std::cout << "Waiting for response...\n";
     
-    // Receive OperationResponse (16 bytes: 4 ints)
+    // Receive OperationResponse (28 bytes: 7 ints)
     OperationResponseData response;
     if (!ReceiveOperationResponse(&socket, response)) {
         std::cerr << "Failed to receive response\n";
@@ -0,0 +1,320 @@
+#ifndef __WIRE_SCHEMA_H__
+#define __WIRE_SCHEMA_H__
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <arpa/inet.h>
+
+// Records (Task, LogEntry) list their fields once, in wire order, as a WireSchema. Size,
+// Marshal and Unmarshal are all generated from that list, so a new field can't be counted
+// in one and forgotten in another. Two encodings:
+//   WIRE_V1   network order, ints as 4 bytes, long longs as 8, strings as a 4 byte length
+//             and the bytes. Every connection starts in it, the gateway never leaves it
+//   WIRE_V2   compact: ints, long longs and lengths as zigzag varints, enums as one byte,
+//             vector clock process ids as deltas. Picked by a WIRE_HELLO exchange
+const int WIRE_V1 = 1;
+const int WIRE_V2 = 2;
+const int SUPPORTED_WIRE_VERSION = WIRE_V2;
+
+// Largest varint, a 64 bit value in 7 bit groups
+const size_t MAX_VARINT_BYTES = 10;
+
+inline uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// Appends to the end of a buffer, which grows as fields are written. A record is encoded
+// in one walk of its fields, without sizing it first
+class WireWriter {
+private:
+    std::vector<char>& out;
+
+public:
+    explicit WireWriter(std::vector<char>& buffer) : out(buffer) {}
+
+    void put32(uint32_t value) {
+        value = htonl(value);
+        put_bytes(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    void put64(uint64_t value) {
+        put32(static_cast<uint32_t>(value >> 32));
+        put32(static_cast<uint32_t>(value));
+    }
+    void put_bytes(const char* data, size_t size) {
+        out.insert(out.end(), data, data + size);
+    }
+    void put_varint(uint64_t value) {
+        char bytes[MAX_VARINT_BYTES];
+        size_t size = 0;
+        while (value >= 0x80) {
+            bytes[size++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        bytes[size++] = static_cast<char>(value);
+        put_bytes(bytes, size);
+    }
+};
+
+// Reads from [pos, end). Fixed-width reads don't check, the schema makes sure up front that
+// the bytes every fixed-width field needs are there. Varint reads do
+class WireReader {
+private:
+    const char* pos;
+    const char* end;
+
+public:
+    WireReader(const char* buffer, size_t size) : pos(buffer), end(buffer + size) {}
+
+    size_t remaining() const { return end - pos; }
+
+    uint32_t get32() {
+        uint32_t value;
+        memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return ntohl(value);
+    }
+    uint64_t get64() {
+        uint64_t high = get32();
+        return (high << 32) | get32();
+    }
+    void get_bytes(std::string& out, size_t size) {
+        out.assign(pos, size);
+        pos += size;
+    }
+    // False if the buffer ends first or the varint runs past MAX_VARINT_BYTES
+    bool get_varint(uint64_t& value) {
+        value = 0;
+        for (size_t i = 0; i < MAX_VARINT_BYTES && pos < end; i++) {
+            uint8_t byte = static_cast<uint8_t>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool get_zigzag(int64_t& value) {
+        uint64_t raw;
+        if (!get_varint(raw)) {
+            return false;
+        }
+        value = UnZigZag(raw);
+        return true;
+    }
+};
+
+// How one field type is encoded:
+//   FIXED                       bytes it always takes in WIRE_V1
+//   extra(value)                bytes beyond FIXED this value takes
+//   write(value, out)
+//   read(value, in, reserved)   the last reserved bytes belong to the fixed parts of later
+//                               fields; false if a length would run into them
+//   compact_size(value), write_compact(value, out), read_compact(value, in)   WIRE_V2
+template <typename T, typename Enable = void>
+struct WireCodec;
+
+template <>
+struct WireCodec<int> {
+    static const size_t FIXED = sizeof(uint32_t);
+    static size_t extra(int) { return 0; }
+    static void write(int value, WireWriter& out) { out.put32(static_cast<uint32_t>(value)); }
+    static bool read(int& value, WireReader& in, size_t) {
+        value = static_cast<int>(in.get32());
+        return true;
+    }
+
+    static size_t compact_size(int value) { return VarintSize(ZigZag(value)); }
+    static void write_compact(int value, WireWriter& out) { out.put_varint(ZigZag(value)); }
+    static bool read_compact(int& value, WireReader& in) {
+        int64_t raw;
+        if (!in.get_zigzag(raw) || raw < INT32_MIN || raw > INT32_MAX) {
+            return false;
+        }
+        value = static_cast<int>(raw);
+        return true;
+    }
+};
+
+template <>
+struct WireCodec<long long> {
+    static const size_t FIXED = sizeof(uint64_t);
+    static size_t extra(long long) { return 0; }
+    static void write(long long value, WireWriter& out) { out.put64(static_cast<uint64_t>(value)); }
+    static bool read(long long& value, WireReader& in, size_t) {
+        value = static_cast<long long>(in.get64());
+        return true;
+    }
+
+    // Millisecond timestamps take 6 bytes
+    static size_t compact_size(long long value) { return VarintSize(ZigZag(value)); }
+    static void write_compact(long long value, WireWriter& out) { out.put_varint(ZigZag(value)); }
+    static bool read_compact(long long& value, WireReader& in) {
+        int64_t raw;
+        if (!in.get_zigzag(raw)) {
+            return false;
+        }
+        value = raw;
+        return true;
+    }
+};
+
+template <>
+struct WireCodec<std::string> {
+    static const size_t FIXED = sizeof(uint32_t);
+    static size_t extra(const std::string& value) { return value.size(); }
+    static void write(const std::string& value, WireWriter& out) {
+        out.put32(static_cast<uint32_t>(value.size()));
+        out.put_bytes(value.data(), value.size());
+    }
+    static bool read(std::string& value, WireReader& in, size_t reserved) {
+        uint32_t size = in.get32();  // A negative length reads as huge and fails below
+        if (size > in.remaining() - reserved) {
+            return false;
+        }
+        in.get_bytes(value, size);
+        return true;
+    }
+
+    static size_t compact_size(const std::string& value) { return VarintSize(value.size()) + value.size(); }
+    static void write_compact(const std::string& value, WireWriter& out) {
+        out.put_varint(value.size());
+        out.put_bytes(value.data(), value.size());
+    }
+    static bool read_compact(std::string& value, WireReader& in) {
+        uint64_t size;
+        if (!in.get_varint(size) || size > in.remaining()) {
+            return false;
+        }
+        in.get_bytes(value, static_cast<size_t>(size));
+        return true;
+    }
+};
+
+// Largest valid value of an enum, decoding rejects anything outside [0, LAST]
+template <typename T>
+struct WireEnumLast;
+
+// Enums travel as ints, in WIRE_V2 as a varint (one byte below 128 values)
+template <typename T>
+struct WireCodec<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static const size_t FIXED = sizeof(uint32_t);
+    static size_t extra(T) { return 0; }
+    static void write(T value, WireWriter& out) { out.put32(static_cast<uint32_t>(value)); }
+    static bool read(T& value, WireReader& in, size_t) {
+        return check(static_cast<int>(in.get32()), value);
+    }
+
+    static size_t compact_size(T value) { return VarintSize(static_cast<uint32_t>(value)); }
+    static void write_compact(T value, WireWriter& out) { out.put_varint(static_cast<uint32_t>(value)); }
+    static bool read_compact(T& value, WireReader& in) {
+        uint64_t raw;
+        return in.get_varint(raw) && raw <= INT32_MAX && check(static_cast<int>(raw), value);
+    }
+
+    static bool check(int raw, T& value) {
+        if (raw < 0 || raw > static_cast<int>(WireEnumLast<T>::VALUE)) {
+            return false;
+        }
+        value = static_cast<T>(raw);
+        return true;
+    }
+};
+
+// One member of Owner. Declare it where the member is accessible, see WIRE_FIELD
+template <typename Owner, typename T, T Owner::*Member>
+struct WireField {
+    typedef WireCodec<T> Codec;
+    static const T& get(const Owner& owner) { return owner.*Member; }
+    static T& get(Owner& owner) { return owner.*Member; }
+};
+
+#define WIRE_FIELD(Owner, member) WireField<Owner, decltype(Owner::member), &Owner::member>
+
+// Owner's fields in wire order. FIXED is the size of a record with every variable-length
+// field empty, a compile-time constant
+template <typename Owner, typename... Fields>
+struct WireSchema;
+
+template <typename Owner>
+struct WireSchema<Owner> {
+    static const size_t FIXED = 0;
+    static size_t Extra(const Owner&) { return 0; }
+    static void Write(const Owner&, WireWriter&) {}
+    static bool Read(Owner&, WireReader&) { return true; }
+    static size_t CompactSize(const Owner&) { return 0; }
+    static void WriteCompact(const Owner&, WireWriter&) {}
+    static bool ReadCompact(Owner&, WireReader&) { return true; }
+};
+
+template <typename Owner, typename Field, typename... Rest>
+struct WireSchema<Owner, Field, Rest...> {
+    typedef WireSchema<Owner, Rest...> Tail;
+    static const size_t FIXED = Field::Codec::FIXED + Tail::FIXED;
+
+    static size_t Extra(const Owner& owner) {
+        return Field::Codec::extra(Field::get(owner)) + Tail::Extra(owner);
+    }
+    static void Write(const Owner& owner, WireWriter& out) {
+        Field::Codec::write(Field::get(owner), out);
+        Tail::Write(owner, out);
+    }
+    static bool Read(Owner& owner, WireReader& in) {
+        return Field::Codec::read(Field::get(owner), in, Tail::FIXED) && Tail::Read(owner, in);
+    }
+    static size_t CompactSize(const Owner& owner) {
+        return Field::Codec::compact_size(Field::get(owner)) + Tail::CompactSize(owner);
+    }
+    static void WriteCompact(const Owner& owner, WireWriter& out) {
+        Field::Codec::write_compact(Field::get(owner), out);
+        Tail::WriteCompact(owner, out);
+    }
+    static bool ReadCompact(Owner& owner, WireReader& in) {
+        return Field::Codec::read_compact(Field::get(owner), in) && Tail::ReadCompact(owner, in);
+    }
+
+    // Without encoding, for callers that only need the length
+    static size_t Size(const Owner& owner, int version) {
+        return version == WIRE_V2 ? CompactSize(owner) : FIXED + Extra(owner);
+    }
+    // Appends owner to out in the one pass, returns the bytes it took
+    static size_t Encode(const Owner& owner, std::vector<char>& out, int version) {
+        size_t start = out.size();
+        WireWriter writer(out);
+        if (version == WIRE_V2) {
+            WriteCompact(owner, writer);
+        } else {
+            Write(owner, writer);
+        }
+        return out.size() - start;
+    }
+    // False if the fields don't fill exactly size bytes, owner may then be partly decoded
+    static bool Decode(Owner& owner, const char* buffer, size_t size, int version) {
+        WireReader in(buffer, size);
+        if (version == WIRE_V2) {
+            return ReadCompact(owner, in) && in.remaining() == 0;
+        }
+        if (size < FIXED) {
+            return false;
+        }
+        return Read(owner, in) && in.remaining() == 0;
+    }
+};
+
+#endif
@@ -239,9 +239,16 @@ export function Board() {
     }
   };
 
-  const todoTasks = tasks.filter(t => t.column === ColumnType.TODO);
-  const inProgressTasks = tasks.filter(t => t.column === ColumnType.IN_PROGRESS);
-  const doneTasks = tasks.filter(t => t.column === ColumnType.DONE);
+  // Within a column tasks follow their rank, ties (and tasks without one) by id
+  const byRank = (a: Task, b: Task) => {
+    const rankA = a.rank ?? '';
+    const rankB = b.rank ?? '';
+    if (rankA !== rankB) return rankA < rankB ? -1 : 1;
+    return a.task_id - b.task_id;
+  };
+  const todoTasks = tasks.filter(t => t.column === ColumnType.TODO).sort(byRank);
+  const inProgressTasks = tasks.filter(t => t.column === ColumnType.IN_PROGRESS).sort(byRank);
+  const doneTasks = tasks.filter(t => t.column === ColumnType.DONE).sort(byRank);
 
   if (isLoading) {
     return (
@@ -25,6 +25,7 @@ export interface Task {
   vector_clock: Record<string, number>;
   created_at: number;
   updated_at: number;
+  rank?: string;
 }
 
 /**
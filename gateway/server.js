@@ -20,34 +20,78 @@ let currentBackendHost = MASTER_HOST;
 let currentBackendPort = MASTER_PORT;
 let failedOverToBackup = false;
 
-// Health check: Try to reconnect to master periodically after failover
-function checkMasterHealth() {
-  if (!failedOverToBackup) return; // Only check if we've failed over
-  
-  const client = new net.Socket();
-  
-  client.setTimeout(1000); // Quick 1 second timeout
-  
-  client.connect(MASTER_PORT, MASTER_HOST, () => {
-    console.log('[HEALTH CHECK] Master is back online! Switching back to master.');
-    currentBackendHost = MASTER_HOST;
-    currentBackendPort = MASTER_PORT;
-    failedOverToBackup = false;
-    client.destroy();
+// Leader discovery: both nodes answer LEADER_QUERY with role, epoch and last entry_id.
+// Requests go to the primary with the highest epoch, so a failover (or a master that
+// rejoined and took over again) becomes a routing change at the next poll instead of
+// a request timing out against the old leader
+const LEADER_POLL_MS = 500;
+const LEADER_QUERY_TIMEOUT_MS = 300;
+const NodeRole = {
+  STANDBY: 0,
+  PRIMARY: 1
+};
+
+// Highest entry_id known committed (leader reports, write responses), the freshness
+// floor for hedged reads served by the other node
+let knownEntryId = -1;
+
+function queryLeader(host, port) {
+  return new Promise((resolve) => {
+    const client = new net.Socket();
+    let responseData = Buffer.alloc(0);
+    
+    const done = (info) => {
+      client.destroy();
+      resolve(info);
+    };
+    
+    client.connect(port, host, () => {
+      const request = Buffer.alloc(4);
+      request.writeInt32BE(OpType.LEADER_QUERY, 0);
+      client.write(request);
+    });
+    
+    client.on('data', (data) => {
+      responseData = Buffer.concat([responseData, data]);
+      if (responseData.length >= 12) {
+        done({
+          host,
+          port,
+          role: responseData.readInt32BE(0),
+          epoch: responseData.readInt32BE(4),
+          lastEntryId: responseData.readInt32BE(8)
+        });
+      }
+    });
+    
+    client.on('error', () => done(null));
+    client.on('close', () => done(null));
+    client.setTimeout(LEADER_QUERY_TIMEOUT_MS, () => done(null));
   });
+}
+
+async function discoverLeader() {
+  const nodes = await Promise.all([
+    queryLeader(MASTER_HOST, MASTER_PORT),
+    queryLeader(BACKUP_HOST, BACKUP_PORT)
+  ]);
   
-  client.on('error', () => {
-    // Master still down, stay with backup
-    client.destroy();
-  });
+  let leader = null;
+  for (const node of nodes) {
+    if (!node || node.role !== NodeRole.PRIMARY) continue;
+    knownEntryId = Math.max(knownEntryId, node.lastEntryId);
+    if (!leader || node.epoch > leader.epoch) leader = node;
+  }
   
-  client.on('timeout', () => {
-    client.destroy();
-  });
+  if (leader && (leader.host !== currentBackendHost || leader.port !== currentBackendPort)) {
+    console.log(`[LEADER] ${leader.host}:${leader.port} is primary at epoch ${leader.epoch}, routing to it`);
+    currentBackendHost = leader.host;
+    currentBackendPort = leader.port;
+    failedOverToBackup = leader.port === BACKUP_PORT && leader.host === BACKUP_HOST;
+  }
 }
 
-// Check master health every 5 seconds after failover
-setInterval(checkMasterHealth, 5000);
+setInterval(discoverLeader, LEADER_POLL_MS);
 
 // Create Express app
 const app = express();
@@ -67,7 +111,23 @@ const OpType = {
   UPDATE_TASK: 1,
   MOVE_TASK: 2,
   DELETE_TASK: 3,
-  GET_BOARD: 4
+  GET_BOARD: 4,
+  GET_BOARD_SINCE: 12,
+  SUBSCRIBE: 13,
+  BATCH: 14,
+  FOLLOWER_READ: 16,
+  LEADER_QUERY: 19,
+  QUERY: 20,
+  SEARCH: 21,
+  REORDER_TASK: 22,
+  GET_BOARD_JSON: 24
+};
+
+// QuerySort enum, query parameter names
+const QuerySort = {
+  id: 0,
+  updated_asc: 1,
+  updated_desc: 2
 };
 
 // Column enum
@@ -77,12 +137,16 @@ const Column = {
   DONE: 2
 };
 
+// Status slot of an operation response (WIRE_V1)
+const RESPONSE_STATUS_BUSY = 1;
+const RESPONSE_STATUS_UNCONFIRMED = 2;
+
 // Helper: Send request to C++ backend (master or backup after failover)
 // retryCount tracks how many retries we've done (max 2: original + 1 failover)
 async function sendToBackend(opType, taskData, retryCount = 0) {
   return new Promise((resolve, reject) => {
     const client = new net.Socket();
-    let responseData = Buffer.alloc(0);
+    const response = createFrameReader();
     
     const host = currentBackendHost;
     const port = currentBackendPort;
@@ -111,6 +175,13 @@ async function sendToBackend(opType, taskData, retryCount = 0) {
         client.write(taskBuffer);
         console.log('[DEBUG] Sent task data');
         
+        // A reorder names the task it goes below (-1 for the top of the column)
+        if (opType === OpType.REORDER_TASK) {
+          const afterBuffer = Buffer.alloc(4);
+          afterBuffer.writeInt32BE(taskData.after_task_id, 0);
+          client.write(afterBuffer);
+        }
+        
         // End the write stream to signal completion
         client.end();
         console.log('[DEBUG] Connection ended, waiting for response...');
@@ -122,21 +193,28 @@ async function sendToBackend(opType, taskData, retryCount = 0) {
     
     client.on('data', (data) => {
       console.log('[DEBUG] Received data chunk:', data.length, 'bytes');
-      responseData = Buffer.concat([responseData, data]);
+      response.push(data);
     });
     
     client.on('end', () => {
-      console.log('[DEBUG] Connection ended, total response:', responseData.length, 'bytes');
+      console.log('[DEBUG] Connection ended, total response:', response.length, 'bytes');
+      const responseData = response.take(response.length);
       try {
-        // Response is now 4 integers: success, conflict, rejected, task_id
-        if (responseData.length >= 16) {
+        // Response is 7 integers: success, conflict, rejected, task_id, entry_id, status, retry_after_ms.
+        // status is 1 for busy (not applied), 2 for unconfirmed (applied, backup quorum not reached)
+        if (responseData.length >= 28) {
           const success = responseData.readInt32BE(0) === 1;
           const conflict = responseData.readInt32BE(4) === 1;
           const rejected = responseData.readInt32BE(8) === 1;
           const taskId = responseData.readInt32BE(12);
+          const entryId = responseData.readInt32BE(16);
+          const busy = responseData.readInt32BE(20) === RESPONSE_STATUS_BUSY;
+          const unconfirmed = responseData.readInt32BE(20) === RESPONSE_STATUS_UNCONFIRMED;
+          const retryAfterMs = responseData.readInt32BE(24);
+          knownEntryId = Math.max(knownEntryId, entryId);
           
-          console.log('[DEBUG] Response - success:', success, 'conflict:', conflict, 'rejected:', rejected);
-          resolve({ success, conflict, rejected, taskId });
+          console.log('[DEBUG] Response - success:', success, 'conflict:', conflict, 'rejected:', rejected, 'busy:', busy, 'unconfirmed:', unconfirmed);
+          resolve({ success, conflict, rejected, taskId, entryId, busy, unconfirmed, retryAfterMs });
         } else if (responseData.length >= 4) {
           // just success boolean
           const success = responseData.readInt32BE(0) === 1;
@@ -265,6 +343,10 @@ function serializeTask(task) {
   buffer.writeInt32BE(0, offset);
   offset += 4;
   
+  // rank length (0), the backend decides where tasks go
+  buffer.writeInt32BE(0, offset);
+  offset += 4;
+  
   return buffer.slice(0, offset);
 }
 
@@ -323,6 +405,12 @@ function deserializeTask(buffer, offset = 0) {
   // skip vector clock data for now
   pos += clockSize * 8; // each entry: process_id (4) + count (4)
   
+  // rank length + rank, tasks in a column sort by (rank, task_id)
+  const rankLen = buffer.readInt32BE(pos);
+  pos += 4;
+  const rank = buffer.toString('ascii', pos, pos + rankLen);
+  pos += rankLen;
+  
   return {
     task: {
       task_id,
@@ -333,148 +421,822 @@ function deserializeTask(buffer, offset = 0) {
       created_by,
       vector_clock: {},
       created_at,
-      updated_at
+      updated_at,
+      rank
     },
     bytesRead: pos - offset
   };
 }
 
-// Get all tasks from backend (with failover/fail-back support)
-async function getBoardFromBackend(retryCount = 0) {
-  return new Promise((resolve, reject) => {
-    const client = new net.Socket();
-    let responseData = Buffer.alloc(0);
+// Bytes received from a backend, kept as the chunks they arrived in. Values are read off
+// the front and only a value that straddles chunks is copied, so a large response is never
+// re-concatenated on every 'data' event
+function createFrameReader() {
+  const chunks = [];
+  
+  // Merge leading chunks until the first holds size bytes (callers check has first)
+  const coalesce = (size) => {
+    if (chunks[0].length >= size) return;
+    let merged = 0;
+    let count = 0;
+    while (merged < size) {
+      merged += chunks[count++].length;
+    }
+    chunks.splice(0, count, Buffer.concat(chunks.slice(0, count), merged));
+  };
+  
+  const reader = {
+    length: 0,
     
-    const host = currentBackendHost;
-    const port = currentBackendPort;
+    push(data) {
+      chunks.push(data);
+      reader.length += data.length;
+    },
     
-    client.connect(port, host, () => {
-      try {
-        console.log('[GET_BOARD] Requesting all tasks from backend at', host + ':' + port);
-        
-        // Send GET_BOARD operation type
-        const opBuffer = Buffer.alloc(4);
-        opBuffer.writeInt32BE(OpType.GET_BOARD, 0);
-        client.write(opBuffer);
-        
-        // Send empty task (required by protocol but unused)
-        const emptyTask = serializeTask({ task_id: 0, description: '', column: 0, client_id: 0 });
-        const sizeBuffer = Buffer.alloc(4);
-        sizeBuffer.writeInt32BE(emptyTask.length, 0);
-        client.write(sizeBuffer);
-        client.write(emptyTask);
-        
-        client.end();
-      } catch (err) {
-        client.destroy();
-        reject(err);
+    has(size) {
+      return reader.length >= size;
+    },
+    
+    peekInt32() {
+      coalesce(4);
+      return chunks[0].readInt32BE(0);
+    },
+    
+    take(size) {
+      if (size === 0) return Buffer.alloc(0);
+      coalesce(size);
+      const data = chunks[0].subarray(0, size);
+      if (chunks[0].length === size) {
+        chunks.shift();
+      } else {
+        chunks[0] = chunks[0].subarray(size);
       }
-    });
+      reader.length -= size;
+      return data;
+    },
     
-    client.on('data', (data) => {
-      responseData = Buffer.concat([responseData, data]);
-    });
+    readInt32() {
+      return reader.take(4).readInt32BE(0);
+    }
+  };
+  return reader;
+}
+
+// True once a count- or size-prefixed frame (prefix * elementSize bytes) is fully in
+function hasFrame(reader, elementSize = 1) {
+  if (!reader.has(4)) return false;
+  const size = reader.peekInt32();
+  if (size < 0) {
+    throw new Error(`Negative frame size ${size}`);
+  }
+  return reader.has(4 + size * elementSize);
+}
+
+// Decoders take what has arrived so far and return null until their response is complete.
+// A task list (count + size-prefixed tasks) decodes each task as soon as its bytes are in
+function taskListDecoder() {
+  let count = -1;
+  const tasks = [];
+  return (reader) => {
+    if (count < 0) {
+      if (!reader.has(4)) return null;
+      count = reader.readInt32();
+      if (count < 0) {
+        throw new Error(`Negative task count ${count}`);
+      }
+    }
+    while (tasks.length < count) {
+      if (!hasFrame(reader)) return null;
+      const size = reader.readInt32();
+      tasks.push(deserializeTask(reader.take(size)).task);
+    }
+    return tasks;
+  };
+}
+
+// GET_BOARD_SINCE: origin, version, full sync flag, changed tasks, deleted ids
+function boardDeltaDecoder() {
+  let delta = null;
+  const decodeTasks = taskListDecoder();
+  return (reader) => {
+    if (!delta) {
+      if (!reader.has(12)) return null;
+      delta = { origin: reader.readInt32(), version: reader.readInt32(), fullSync: reader.readInt32() === 1 };
+    }
+    if (!delta.tasks && !(delta.tasks = decodeTasks(reader))) return null;
+    if (!hasFrame(reader, 4)) return null;
     
-    client.on('end', () => {
-      try {
-        console.log('[GET_BOARD] Received response:', responseData.length, 'bytes');
-        
-        // Check for valid response (at least 4 bytes for count)
-        if (responseData.length < 4) {
-          throw new Error('Invalid response from backend');
-        }
-        
-        // Read count (4 bytes)
-        const count = responseData.readInt32BE(0);
-        console.log('[GET_BOARD] Task count:', count);
-        
-        const tasks = [];
-        let offset = 4;
-        
-        // Read each task
-        for (let i = 0; i < count; i++) {
-          // Read size
-          const size = responseData.readInt32BE(offset);
-          offset += 4;
-          
-          // Deserialize task
-          const result = deserializeTask(responseData, offset);
-          tasks.push(result.task);
-          offset += result.bytesRead;
-        }
-        
-        console.log('[GET_BOARD] Parsed', tasks.length, 'tasks');
-        resolve(tasks);
-      } catch (err) {
-        console.error('[GET_BOARD] Error parsing response:', err);
-        // Try failover on parse error
-        if (retryCount < 1) {
-          tryGetBoardFailover(retryCount, host, resolve, reject);
-        } else {
-          reject(err);
+    const ids = reader.take(4 * reader.readInt32());
+    delta.deletedTaskIds = [];
+    for (let offset = 0; offset < ids.length; offset += 4) {
+      delta.deletedTaskIds.push(ids.readInt32BE(offset));
+    }
+    return delta;
+  };
+}
+
+// GET_BOARD_JSON: length and the JSON bytes
+function boardJsonDecoder() {
+  return (reader) => {
+    if (!hasFrame(reader)) return null;
+    return reader.take(reader.readInt32());
+  };
+}
+
+// Board reads share one long-lived connection per backend instead of a connect (and a
+// backend thread) per read. The master serves requests on a connection until it closes;
+// answers are decoded as they stream in. One request is on the wire at a time: a promoted
+// backup answers one request and closes, and requests it never read would turn that close
+// into a reset. Queued requests move to a new connection when one drops, and a request
+// that was sent but got no bytes back is sent again, once
+const BOARD_READ_TIMEOUT_MS = 5000;
+const boardConnections = new Map();
+
+function boardConnection(host, port) {
+  const key = `${host}:${port}`;
+  const existing = boardConnections.get(key);
+  if (existing) return existing;
+  
+  const socket = new net.Socket();
+  const reader = createFrameReader();
+  const conn = { queue: [], closed: false };
+  boardConnections.set(key, conn);
+  
+  const writeNext = () => {
+    const request = conn.queue[0];
+    if (request && !request.written) {
+      request.written = true;
+      socket.write(request.payload);
+    }
+  };
+  
+  conn.send = (request) => {
+    conn.queue.push(request);
+    writeNext();
+  };
+  
+  conn.fail = (err) => {
+    if (conn.closed) return;
+    conn.closed = true;
+    if (boardConnections.get(key) === conn) {
+      boardConnections.delete(key);
+    }
+    socket.destroy();
+    for (const request of conn.queue.splice(0)) {
+      if (!request.expired && (!request.written || (!request.started && !request.retried))) {
+        request.retried = request.retried || request.written;
+        dispatchBoardRequest(host, port, request);
+      } else {
+        clearTimeout(request.timer);
+        request.reject(err);
+      }
+    }
+  };
+  
+  socket.setNoDelay(true);
+  socket.connect(port, host);
+  
+  socket.on('data', (data) => {
+    reader.push(data);
+    try {
+      while (reader.length > 0) {
+        const request = conn.queue[0];
+        if (!request || !request.written) {
+          throw new Error('Unrequested data from backend');
         }
+        request.started = true;
+        const result = request.decode(reader);
+        if (result === null) break;
+        conn.queue.shift();
+        clearTimeout(request.timer);
+        request.resolve(result);
       }
-    });
-    
-    client.on('error', (err) => {
-      console.error('[GET_BOARD] Socket error:', err.message);
-      
-      // Try failover (either direction)
-      if (retryCount < 1) {
-        tryGetBoardFailover(retryCount, host, resolve, reject);
+      writeNext();
+    } catch (err) {
+      conn.fail(err);
+    }
+  });
+  
+  socket.on('error', (err) => conn.fail(err));
+  socket.on('close', () => conn.fail(new Error(`${key} closed the connection`)));
+  
+  return conn;
+}
+
+function dispatchBoardRequest(host, port, request) {
+  request.conn = boardConnection(host, port);
+  request.written = false;
+  request.started = false;
+  request.conn.send(request);
+}
+
+// Resolves with what decode returns once the whole answer to payload is in
+function boardRequest(host, port, payload, decode) {
+  return new Promise((resolve, reject) => {
+    const request = { payload, decode, resolve, reject, retried: false, expired: false };
+    request.timer = setTimeout(() => {
+      const err = new Error('Board read timeout');
+      request.expired = true;
+      if (request.written) {
+        request.conn.fail(err);
       } else {
+        request.conn.queue.splice(request.conn.queue.indexOf(request), 1);
         reject(err);
       }
-    });
+    }, BOARD_READ_TIMEOUT_MS);
+    dispatchBoardRequest(host, port, request);
+  });
+}
+
+// One request on a connection of its own, for answers that aren't board reads. Resolves
+// with what decode returns once the whole answer is in, decoding as it streams in like
+// boardRequest; rejects on the first error, a timeout or a close before it is complete
+function backendRequest(host, port, payload, decode, tag) {
+  return new Promise((resolve, reject) => {
+    const client = new net.Socket();
+    const reader = createFrameReader();
+    let settled = false;
     
-    client.setTimeout(5000, () => {
+    const settle = (err, result) => {
+      if (settled) return;
+      settled = true;
       client.destroy();
-      
-      // Try failover on timeout
-      if (retryCount < 1) {
-        tryGetBoardFailover(retryCount, host, resolve, reject);
+      if (err) {
+        reject(err);
       } else {
-        reject(new Error('GET_BOARD timeout'));
+        resolve(result);
+      }
+    };
+    
+    client.connect(port, host, () => client.end(payload));
+    
+    client.on('data', (data) => {
+      reader.push(data);
+      try {
+        const result = decode(reader);
+        if (result !== null) settle(null, result);
+      } catch (err) {
+        settle(err);
       }
     });
+    
+    client.on('end', () => settle(new Error(`Truncated ${tag} response from backend`)));
+    client.on('error', (err) => settle(err));
+    client.setTimeout(5000, () => settle(new Error(`${tag} timeout`)));
   });
 }
 
-// Helper function for GET_BOARD failover logic
-function tryGetBoardFailover(retryCount, failedHost, resolve, reject) {
+// Get tasks changed after sinceVersion (GET_BOARD_SINCE). The backend answers with a full
+// board (fullSync) when origin doesn't match its version history or the version is too old
+async function getBoardChangesFromBackend(origin, sinceVersion, retryCount = 0) {
+  const host = currentBackendHost;
+  const port = currentBackendPort;
+  
+  const request = Buffer.alloc(12);
+  request.writeInt32BE(OpType.GET_BOARD_SINCE, 0);
+  request.writeInt32BE(origin, 4);
+  request.writeInt32BE(sinceVersion, 8);
+  
+  try {
+    const delta = await boardRequest(host, port, request, boardDeltaDecoder());
+    console.log('[GET_BOARD_SINCE]', sinceVersion, '->', delta.version, ':', delta.tasks.length, 'changed,',
+                delta.deletedTaskIds.length, 'deleted', delta.fullSync ? '(full sync)' : '');
+    return delta;
+  } catch (err) {
+    console.error('[GET_BOARD_SINCE] Error:', err.message);
+    if (retryCount >= 1) {
+      throw err;
+    }
+    switchBackend(host, '[GET_BOARD_SINCE]');
+    return getBoardChangesFromBackend(origin, sinceVersion, retryCount + 1);
+  }
+}
+
+// The board as JSON text the backend renders and caches per board version (GET_BOARD_JSON).
+// Handed to the browser as-is, nothing here decodes or re-serializes the tasks
+function getBoardJsonFromBackend(host, port, boardId) {
+  const boardIdBuffer = Buffer.from(boardId, 'utf8');
+  const request = Buffer.alloc(8 + boardIdBuffer.length);
+  request.writeInt32BE(OpType.GET_BOARD_JSON, 0);
+  request.writeInt32BE(boardIdBuffer.length, 4);
+  boardIdBuffer.copy(request, 8);
+  return boardRequest(host, port, request, boardJsonDecoder());
+}
+
+// GET_BOARD_JSON from the routed node. If it fails, ask LEADER_QUERY where writes go now
+// and read from there once, rather than guessing the other node is the leader
+async function getBoardJsonRouted(boardId) {
+  const host = currentBackendHost;
+  const port = currentBackendPort;
+  try {
+    return await getBoardJsonFromBackend(host, port, boardId);
+  } catch (err) {
+    console.error('[GET_BOARD_JSON] Error:', err.message);
+    await discoverLeader();
+    if (currentBackendHost === host && currentBackendPort === port) {
+      throw err;
+    }
+    return getBoardJsonFromBackend(currentBackendHost, currentBackendPort, boardId);
+  }
+}
+
+// One page of tasks matching the query's filters (QUERY). The backend filters through its
+// column, creator and updated_at indexes, so a large board never crosses the wire whole
+async function queryTasksFromBackend(query, retryCount = 0) {
+  const host = currentBackendHost;
+  const port = currentBackendPort;
+  
+  // column, created_by, updated_since, sort, limit, cursor (updated_at, task_id)
+  const createdBy = Buffer.from(query.createdBy, 'utf8');
+  const request = Buffer.alloc(8 + 4 * 4 + createdBy.length + 8 + 12);
+  let offset = 0;
+  request.writeInt32BE(OpType.QUERY, offset); offset += 4;
+  request.writeInt32BE(request.length - 8, offset); offset += 4;
+  request.writeInt32BE(query.column, offset); offset += 4;
+  request.writeInt32BE(createdBy.length, offset); offset += 4;
+  createdBy.copy(request, offset); offset += createdBy.length;
+  request.writeBigInt64BE(BigInt(query.updatedSince), offset); offset += 8;
+  request.writeInt32BE(query.sort, offset); offset += 4;
+  request.writeInt32BE(query.limit, offset); offset += 4;
+  request.writeBigInt64BE(BigInt(query.cursor.updatedAt), offset); offset += 8;
+  request.writeInt32BE(query.cursor.taskId, offset);
+  
+  try {
+    const page = await backendRequest(host, port, request, queryPageDecoder(), 'QUERY');
+    console.log('[QUERY]', page.tasks.length, 'tasks', page.hasMore ? '(more)' : '');
+    return page;
+  } catch (err) {
+    console.error('[QUERY] Error:', err.message);
+    if (retryCount >= 1) {
+      throw err;
+    }
+    switchBackend(host, '[QUERY]');
+    return queryTasksFromBackend(query, retryCount + 1);
+  }
+}
+
+// QUERY: the page's task list, has more flag and the cursor (updated_at, task_id) after it
+function queryPageDecoder() {
+  let tasks = null;
+  const decodeTasks = taskListDecoder();
+  return (reader) => {
+    if (!tasks && !(tasks = decodeTasks(reader))) return null;
+    if (!reader.has(16)) return null;
+    const hasMore = reader.readInt32() === 1;
+    const updatedAt = Number(reader.take(8).readBigInt64BE(0));
+    return { tasks, hasMore, next: { updatedAt, taskId: reader.readInt32() } };
+  };
+}
+
+// Ids and scores of the best matches for text (SEARCH), best first
+async function searchTasksFromBackend(text, limit, retryCount = 0) {
+  const host = currentBackendHost;
+  const port = currentBackendPort;
+  
+  const query = Buffer.from(text, 'utf8');
+  const request = Buffer.alloc(4 + 4 + query.length + 4);
+  request.writeInt32BE(OpType.SEARCH, 0);
+  request.writeInt32BE(query.length, 4);
+  query.copy(request, 8);
+  request.writeInt32BE(limit, 8 + query.length);
+  
+  try {
+    const result = await backendRequest(host, port, request, searchResultDecoder(), 'SEARCH');
+    console.log('[SEARCH]', JSON.stringify(text), '-', result.totalMatches, 'matches');
+    return result;
+  } catch (err) {
+    console.error('[SEARCH] Error:', err.message);
+    if (retryCount >= 1) {
+      throw err;
+    }
+    switchBackend(host, '[SEARCH]');
+    return searchTasksFromBackend(text, limit, retryCount + 1);
+  }
+}
+
+// SEARCH: total matches, then a count of (task id, score) hits
+function searchResultDecoder() {
+  let totalMatches = -1;
+  return (reader) => {
+    if (totalMatches < 0) {
+      if (!reader.has(4)) return null;
+      totalMatches = reader.readInt32();
+    }
+    if (!hasFrame(reader, 8)) return null;
+    const count = reader.readInt32();
+    const hits = [];
+    for (let i = 0; i < count; i++) {
+      hits.push({ taskId: reader.readInt32(), score: reader.readInt32() });
+    }
+    return { totalMatches, hits };
+  };
+}
+
+// Send many operations as one BATCH request, resolves to one response per operation
+async function sendBatchToBackend(operations, retryCount = 0) {
+  const host = currentBackendHost;
+  const port = currentBackendPort;
+  
+  // op type, count, then per operation its op type and size-prefixed task
+  const parts = [];
+  const header = Buffer.alloc(8);
+  header.writeInt32BE(OpType.BATCH, 0);
+  header.writeInt32BE(operations.length, 4);
+  parts.push(header);
+  for (const op of operations) {
+    const taskBuffer = serializeTask(op.taskData);
+    const opHeader = Buffer.alloc(8);
+    opHeader.writeInt32BE(op.opType, 0);
+    opHeader.writeInt32BE(taskBuffer.length, 4);
+    parts.push(opHeader, taskBuffer);
+  }
+  
+  try {
+    return await backendRequest(host, port, Buffer.concat(parts), batchResponseDecoder(), 'BATCH');
+  } catch (err) {
+    console.error(`[BATCH] Error from ${host}:${port}:`, err.message);
+    if (retryCount >= 1) {
+      throw err;
+    }
+    switchBackend(host, '[BATCH]');
+    return sendBatchToBackend(operations, retryCount + 1);
+  }
+}
+
+// BATCH: a count of operation responses, 7 integers each
+function batchResponseDecoder() {
+  return (reader) => {
+    if (!hasFrame(reader, 28)) return null;
+    const count = reader.readInt32();
+    const results = [];
+    for (let i = 0; i < count; i++) {
+      const response = reader.take(28);
+      results.push({
+        success: response.readInt32BE(0) === 1,
+        conflict: response.readInt32BE(4) === 1,
+        rejected: response.readInt32BE(8) === 1,
+        taskId: response.readInt32BE(12),
+        entryId: response.readInt32BE(16),
+        busy: response.readInt32BE(20) === RESPONSE_STATUS_BUSY,
+        unconfirmed: response.readInt32BE(20) === RESPONSE_STATUS_UNCONFIRMED,
+        retryAfterMs: response.readInt32BE(24)
+      });
+    }
+    return results;
+  };
+}
+
+// Switch between master and backup after a failed request
+function switchBackend(failedHost, tag) {
   if (failedHost === MASTER_HOST || currentBackendHost === MASTER_HOST) {
-    // Master failed, try backup
-    console.log('[GET_BOARD FAILOVER] Master failed, switching to backup...');
+    console.log(`${tag} Master failed, switching to backup...`);
     currentBackendHost = BACKUP_HOST;
     currentBackendPort = BACKUP_PORT;
     failedOverToBackup = true;
   } else {
-    // Backup failed, try master (fail-back)
-    console.log('[GET_BOARD FAIL-BACK] Backup failed, switching back to master...');
+    console.log(`${tag} Backup failed, switching back to master...`);
     currentBackendHost = MASTER_HOST;
     currentBackendPort = MASTER_PORT;
     failedOverToBackup = false;
   }
+}
+
+// Whole board from host as of at least minEntryId (FOLLOWER_READ, which any role answers).
+// Rejects if the node hasn't caught up, its board would be older than what we reported
+function followerReadFromBackend(host, port, minEntryId) {
+  const request = Buffer.alloc(12);
+  request.writeInt32BE(OpType.FOLLOWER_READ, 0);
+  request.writeInt32BE(-1, 4);
+  request.writeInt32BE(minEntryId, 8);
+  return backendRequest(host, port, request, followerReadDecoder(minEntryId), 'FOLLOWER_READ');
+}
+
+// FOLLOWER_READ: applied entry id, fresh flag, task list. A stale answer is an error
+function followerReadDecoder(minEntryId) {
+  let checked = false;
+  const decodeTasks = taskListDecoder();
+  return (reader) => {
+    if (!checked) {
+      if (!reader.has(8)) return null;
+      const appliedEntryId = reader.readInt32();
+      if (reader.readInt32() !== 1) {
+        throw new Error(`Follower at entry ${appliedEntryId}, wanted ${minEntryId}`);
+      }
+      checked = true;
+    }
+    return decodeTasks(reader);
+  };
+}
+
+// Hedged read: if the routed node hasn't answered within HEDGE_DELAY_MS (a leader that
+// is dying but not yet detected), ask the other node too and take whichever answers
+// first. The hedge is a full board with no version, so the next refresh is a full sync
+const HEDGE_DELAY_MS = 150;
+
+function otherBackend() {
+  if (currentBackendHost === MASTER_HOST && currentBackendPort === MASTER_PORT) {
+    return { host: BACKUP_HOST, port: BACKUP_PORT };
+  }
+  return { host: MASTER_HOST, port: MASTER_PORT };
+}
+
+// Settles with read() unless it is still out after HEDGE_DELAY_MS, from then on with
+// whichever of read() and a follower read of the other node answers first. fromTasks
+// turns the follower's board into what read() resolves with
+function hedgedBoardRead(read, fromTasks) {
+  return new Promise((resolve, reject) => {
+    let settled = false;
+    let pending = 1;
+    let hedgeTimer = null;
+    
+    const win = (result) => {
+      if (settled) return;
+      settled = true;
+      clearTimeout(hedgeTimer);
+      resolve(result);
+    };
+    const lose = (err) => {
+      if (settled || --pending > 0) return;
+      settled = true;
+      clearTimeout(hedgeTimer);
+      reject(err);
+    };
+    
+    read().then(win, lose);
+    
+    hedgeTimer = setTimeout(() => {
+      const other = otherBackend();
+      pending++;
+      console.log(`[HEDGE] No answer after ${HEDGE_DELAY_MS} ms, also reading from ${other.host}:${other.port}`);
+      followerReadFromBackend(other.host, other.port, Math.max(knownEntryId, lastFeedEntryId))
+        .then((tasks) => win(fromTasks(tasks)), lose);
+    }, HEDGE_DELAY_MS);
+  });
+}
+
+function getBoardChangesHedged(origin, sinceVersion) {
+  return hedgedBoardRead(() => getBoardChangesFromBackend(origin, sinceVersion),
+                         (tasks) => ({ origin: 0, version: -1, fullSync: true, tasks, deletedTaskIds: [] }));
+}
+
+// A hedged board is rendered here in the backend's shape, with no version (so the
+// browser's next changes request is a full sync) and without vector clock entries
+function getBoardJsonHedged(boardId) {
+  return hedgedBoardRead(() => getBoardJsonRouted(boardId), (tasks) => Buffer.from(JSON.stringify({
+    board_id: boardId,
+    origin: 0,
+    version: -1,
+    tasks: tasks.filter(task => task.board_id === boardId)
+  })));
+}
+
+// Gateway copy of the board, kept current with deltas so refreshes (including the one
+// after a failover) only transfer what changed
+const boardCache = {
+  origin: 0,
+  version: -1,
+  tasks: new Map()
+};
+
+async function refreshBoardCache() {
+  const delta = await getBoardChangesHedged(boardCache.origin, boardCache.version);
   
-  // Retry with the other backend
-  getBoardFromBackend(retryCount + 1)
-    .then(resolve)
-    .catch(reject);
+  if (delta.fullSync) {
+    boardCache.tasks.clear();
+  }
+  for (const task of delta.tasks) {
+    boardCache.tasks.set(task.task_id, task);
+  }
+  for (const taskId of delta.deletedTaskIds) {
+    boardCache.tasks.delete(taskId);
+  }
+  boardCache.origin = delta.origin;
+  boardCache.version = delta.version;
+  
+  return delta;
+}
+
+// Change feed: one long-lived SUBSCRIBE connection streams every committed log entry
+// (with the task's resolved state) so broadcasts reflect what the backend actually applied
+const CHANGE_FEED_RECONNECT_MS = 1000;
+let changeFeedConnected = false;
+let lastFeedEntryId = -1;
+
+// SUBSCRIBE streams change batches: a count, then per entry its size-prefixed LogEntry, a
+// has-task flag and, with it, the size-prefixed resolved task. Returns each batch once it
+// is in, then starts on the next
+function changeBatchDecoder() {
+  let count = -1;
+  let events = [];
+  let event = null;
+  return (reader) => {
+    if (count < 0) {
+      if (!reader.has(4)) return null;
+      count = reader.readInt32();
+      if (count < 0) {
+        throw new Error(`Negative change count ${count}`);
+      }
+    }
+    while (events.length < count) {
+      if (!event) {
+        // The entry and the has-task flag after it
+        if (!hasFrame(reader) || !reader.has(8 + reader.peekInt32())) return null;
+        const entry = reader.take(reader.readInt32());
+        
+        // LogEntry starts with entry_id, op_type, task_id
+        event = {
+          entryId: entry.readInt32BE(0),
+          opType: entry.readInt32BE(4),
+          taskId: entry.readInt32BE(8),
+          task: null,
+          hasTask: reader.readInt32() !== 0
+        };
+      }
+      if (event.hasTask) {
+        if (!hasFrame(reader)) return null;
+        event.task = deserializeTask(reader.take(reader.readInt32())).task;
+      }
+      events.push({ entryId: event.entryId, opType: event.opType, taskId: event.taskId, task: event.task });
+      event = null;
+    }
+    
+    const batch = events;
+    count = -1;
+    events = [];
+    return batch;
+  };
+}
+
+function broadcastChange(event) {
+  switch (event.opType) {
+    case OpType.CREATE_TASK:
+      if (event.task) io.emit('TASK_CREATED', { task: event.task });
+      break;
+    case OpType.UPDATE_TASK:
+      if (event.task) io.emit('TASK_UPDATED', { task: event.task });
+      break;
+    case OpType.MOVE_TASK:
+    case OpType.REORDER_TASK:
+      if (event.task) io.emit('TASK_MOVED', { task: event.task });
+      break;
+    case OpType.DELETE_TASK:
+      io.emit('TASK_DELETED', { task_id: event.taskId });
+      break;
+  }
+}
+
+function startChangeFeed() {
+  const client = new net.Socket();
+  const host = currentBackendHost;
+  const port = currentBackendPort;
+  const reader = createFrameReader();
+  const decodeBatch = changeBatchDecoder();
+  
+  client.connect(port, host, () => {
+    const request = Buffer.alloc(8);
+    request.writeInt32BE(OpType.SUBSCRIBE, 0);
+    request.writeInt32BE(lastFeedEntryId, 4);
+    client.write(request);
+    changeFeedConnected = true;
+    console.log(`[FEED] Subscribed to ${host}:${port} after entry ${lastFeedEntryId}`);
+  });
+  
+  client.on('data', (data) => {
+    reader.push(data);
+    
+    try {
+      let events;
+      while ((events = decodeBatch(reader)) !== null) {
+        for (const event of events) {
+          // A replayed entry after reconnecting was already broadcast
+          if (event.entryId <= lastFeedEntryId) continue;
+          lastFeedEntryId = event.entryId;
+          broadcastChange(event);
+        }
+      }
+    } catch (err) {
+      // Out of step with the stream, resubscribe after the last entry broadcast
+      console.error(`[FEED] ${host}:${port} sent a bad batch: ${err.message}`);
+      client.destroy();
+    }
+  });
+  
+  client.on('error', (err) => {
+    console.error(`[FEED] ${host}:${port} error: ${err.message}`);
+  });
+  
+  // Reconnect to whichever backend requests are currently using
+  client.on('close', () => {
+    changeFeedConnected = false;
+    setTimeout(startChangeFeed, CHANGE_FEED_RECONNECT_MS);
+  });
 }
 
 // REST API Endpoints
 
+// A write the master shed under load (BUSY) was not applied: 503 with the backend's hint as
+// Retry-After, so clients back off instead of piling onto the queue
+function sendBusy(res, result) {
+  res.set('Retry-After', String(Math.max(1, Math.ceil(result.retryAfterMs / 1000))));
+  return res.status(503).json({ error: 'Backend busy, retry later', retry_after_ms: result.retryAfterMs });
+}
+
+// A write applied on the master whose backups didn't ack it is not a failure: it is on the
+// board, and retrying it would apply it twice. Flag it so clients know it could still be
+// lost if the master fails before a backup catches up
+function markUnconfirmed(res, result) {
+  if (result.unconfirmed) {
+    res.set('X-Write-Unconfirmed', '1');
+  }
+}
+
 // GET /api/boards/:id - Get all tasks for a board
 app.get('/api/boards/:id', async (req, res) => {
   try {
-    const tasks = await getBoardFromBackend();
+    const body = await getBoardJsonHedged(req.params.id);
+    res.type('application/json').send(body);
+  } catch (err) {
+    console.error('Error fetching board:', err);
+    res.status(500).json({ error: 'Failed to fetch board' });
+  }
+});
+
+// GET /api/boards/:id/changes?origin=O&since=V - Tasks changed after version V
+// Reconnecting browsers send back the origin/version of their last response
+app.get('/api/boards/:id/changes', async (req, res) => {
+  try {
+    const origin = parseInt(req.query.origin) || 0;
+    const since = req.query.since !== undefined ? parseInt(req.query.since) : -1;
+    const delta = await getBoardChangesFromBackend(origin, isNaN(since) ? -1 : since);
     res.json({
       board_id: req.params.id,
-      tasks: tasks
+      origin: delta.origin,
+      version: delta.version,
+      full_sync: delta.fullSync,
+      tasks: delta.tasks,
+      deleted_task_ids: delta.deletedTaskIds
     });
   } catch (err) {
-    console.error('Error fetching board:', err);
-    res.status(500).json({ error: 'Failed to fetch board' });
+    console.error('Error fetching board changes:', err);
+    res.status(500).json({ error: 'Failed to fetch board changes' });
+  }
+});
+
+// GET /api/boards/:id/query?column=C&created_by=U&updated_since=MS&sort=S&limit=N&cursor=K
+// One page of matching tasks; sort is id, updated_asc or updated_desc. Pass back the
+// next_cursor of a response to get the page after it, it is null on the last page
+app.get('/api/boards/:id/query', async (req, res) => {
+  const sort = QuerySort[req.query.sort || 'id'];
+  const column = req.query.column !== undefined ? parseInt(req.query.column) : -1;
+  const cursorMatch = /^(\d+):(\d+)$/.exec(req.query.cursor || '');
+  if (sort === undefined || isNaN(column) || (req.query.cursor && !cursorMatch)) {
+    return res.status(400).json({ error: 'Invalid query parameters' });
+  }
+  
+  try {
+    const page = await queryTasksFromBackend({
+      column,
+      createdBy: req.query.created_by || '',
+      updatedSince: parseInt(req.query.updated_since) || 0,
+      sort,
+      limit: parseInt(req.query.limit) || 0,
+      cursor: cursorMatch
+        ? { updatedAt: parseInt(cursorMatch[1]), taskId: parseInt(cursorMatch[2]) }
+        : { updatedAt: 0, taskId: -1 }
+    });
+    res.json({
+      board_id: req.params.id,
+      tasks: page.tasks,
+      next_cursor: page.hasMore ? `${page.next.updatedAt}:${page.next.taskId}` : null
+    });
+  } catch (err) {
+    console.error('Error querying tasks:', err);
+    res.status(500).json({ error: 'Failed to query tasks' });
+  }
+});
+
+// GET /api/boards/:id/search?q=TEXT&limit=N - Tasks whose title or description hold the
+// words of TEXT (the last one may be partial), best match first
+app.get('/api/boards/:id/search', async (req, res) => {
+  const text = req.query.q || '';
+  if (!text.trim()) {
+    return res.status(400).json({ error: 'Missing search text' });
+  }
+  
+  try {
+    const result = await searchTasksFromBackend(text, parseInt(req.query.limit) || 0);
+    // Hits carry ids, the tasks themselves come from the cache the delta refresh keeps
+    await refreshBoardCache();
+    res.json({
+      board_id: req.params.id,
+      total_matches: result.totalMatches,
+      tasks: result.hits
+        .filter((hit) => boardCache.tasks.has(hit.taskId))
+        .map((hit) => Object.assign({ score: hit.score }, boardCache.tasks.get(hit.taskId)))
+    });
+  } catch (err) {
+    console.error('Error searching tasks:', err);
+    res.status(500).json({ error: 'Failed to search tasks' });
   }
 });
 
@@ -494,6 +1256,10 @@ app.post('/api/tasks', async (req, res) => {
     };
     
     const result = await sendToBackend(OpType.CREATE_TASK, taskData);
+    if (result.busy) {
+      return sendBusy(res, result);
+    }
+    markUnconfirmed(res, result);
     
     if (result.success) {
       // Use task ID from backend response
@@ -510,7 +1276,9 @@ app.post('/api/tasks', async (req, res) => {
         updated_at: Date.now()
       };
       
-      io.emit('TASK_CREATED', { task: createdTask });
+      if (!changeFeedConnected) {
+        io.emit('TASK_CREATED', { task: createdTask });
+      }
       res.status(201).json(createdTask);
     } else {
       res.status(500).json({ error: 'Failed to create task' });
@@ -521,6 +1289,70 @@ app.post('/api/tasks', async (req, res) => {
   }
 });
 
+// POST /api/tasks/batch - Apply many operations in one backend round trip
+// Body: { operations: [{ type: 'create' | 'update' | 'move' | 'delete', task_id, title, description, column }] }
+app.post('/api/tasks/batch', async (req, res) => {
+  const batchOpTypes = {
+    create: OpType.CREATE_TASK,
+    update: OpType.UPDATE_TASK,
+    move: OpType.MOVE_TASK,
+    delete: OpType.DELETE_TASK
+  };
+  
+  try {
+    const requested = Array.isArray(req.body.operations) ? req.body.operations : [];
+    if (requested.length === 0 || requested.some(op => batchOpTypes[op.type] === undefined)) {
+      return res.status(400).json({ error: 'operations must be a non-empty list of create/update/move/delete' });
+    }
+    
+    const operations = requested.map(op => ({
+      opType: batchOpTypes[op.type],
+      taskData: {
+        task_id: op.task_id || 0,
+        title: op.title || '',
+        description: op.description || '',
+        board_id: op.board_id || 'board-1',
+        created_by: op.created_by || 'user',
+        column: op.column || Column.TODO,
+        client_id: 1
+      }
+    }));
+    
+    const results = await sendBatchToBackend(operations);
+    const shed = results.find(result => result.busy);
+    if (shed) {
+      return sendBusy(res, shed);
+    }
+    
+    // Without the change feed, broadcast what succeeded from the request itself
+    if (!changeFeedConnected) {
+      results.forEach((result, i) => {
+        if (!result.success) return;
+        const task = { ...operations[i].taskData, task_id: result.taskId, updated_at: Date.now() };
+        switch (requested[i].type) {
+          case 'create': io.emit('TASK_CREATED', { task }); break;
+          case 'update': io.emit('TASK_UPDATED', { task }); break;
+          case 'move': io.emit('TASK_MOVED', { task }); break;
+          case 'delete': io.emit('TASK_DELETED', { task_id: result.taskId }); break;
+        }
+      });
+    }
+    
+    res.json({
+      results: results.map(result => ({
+        task_id: result.taskId,
+        success: result.success,
+        conflict: result.conflict,
+        rejected: result.rejected,
+        unconfirmed: result.unconfirmed
+      }))
+    });
+  } catch (err) {
+    console.error('Error applying batch:', err);
+    res.status(500).json({ error: 'Failed to apply batch' });
+  }
+});
+
 // PATCH /api/tasks/:id, this will Update a task
 app.patch('/api/tasks/:id', async (req, res) => {
   try {
@@ -565,15 +1397,22 @@ app.patch('/api/tasks/:id', async (req, res) => {
     }
     
     const result = await sendToBackend(opType, taskData);
+    if (result.busy) {
+      return sendBusy(res, result);
+    }
+    markUnconfirmed(res, result);
     
     if (result.success) {
-      // Fetch actual state from backend to ensure correct broadcast after conflicts
+      // Fetch actual state from backend to ensure correct broadcast after conflicts.
+      // The change feed already carries the resolved task when it is connected
       let actualTask = null;
-      try {
-        const tasks = await getBoardFromBackend();
-        actualTask = tasks.find(t => t.task_id === taskId);
-      } catch (fetchErr) {
-        console.error('[PATCH] Failed to fetch actual state:', fetchErr);
+      if (!changeFeedConnected) {
+        try {
+          await refreshBoardCache();
+          actualTask = boardCache.tasks.get(taskId) || null;
+        } catch (fetchErr) {
+          console.error('[PATCH] Failed to fetch actual state:', fetchErr);
+        }
       }
       
       // Use actual backend state if available, otherwise fall back to request data
@@ -589,10 +1428,13 @@ app.patch('/api/tasks/:id', async (req, res) => {
         rejected: result.rejected || false
       };
       
-      if (column !== undefined) {
-        io.emit('TASK_MOVED', { task: updatedTask });
-      } else {
-        io.emit('TASK_UPDATED', { task: updatedTask });
+      // With the change feed connected the broadcast arrives through it
+      if (!changeFeedConnected) {
+        if (column !== undefined) {
+          io.emit('TASK_MOVED', { task: updatedTask });
+        } else {
+          io.emit('TASK_UPDATED', { task: updatedTask });
+        }
       }
       
       // Add conflict warning to response if detected
@@ -616,6 +1458,49 @@ app.patch('/api/tasks/:id', async (req, res) => {
   }
 });
 
+// PUT /api/tasks/:id/position - Drop a task into column right below after_task_id
+// (null or omitted for the top). Only the dropped task changes, it gets a new rank
+app.put('/api/tasks/:id/position', async (req, res) => {
+  const taskId = parseInt(req.params.id);
+  const { column } = req.body;
+  const afterTaskId = req.body.after_task_id === undefined || req.body.after_task_id === null
+    ? -1 : parseInt(req.body.after_task_id);
+  if (isNaN(taskId) || !Object.values(Column).includes(column) || isNaN(afterTaskId)) {
+    return res.status(400).json({ error: 'Invalid position' });
+  }
+  
+  try {
+    const result = await sendToBackend(OpType.REORDER_TASK, {
+      task_id: taskId,
+      board_id: 'board-1',
+      column,
+      client_id: 1,
+      after_task_id: afterTaskId
+    });
+    
+    if (result.busy) {
+      return sendBusy(res, result);
+    }
+    markUnconfirmed(res, result);
+    if (result.rejected) {
+      return res.status(409).json({ error: 'Reorder rejected - operation was outdated' });
+    }
+    if (!result.success) {
+      return res.status(404).json({ error: 'Task not found' });
+    }
+    
+    await refreshBoardCache();
+    const task = boardCache.tasks.get(taskId);
+    if (!changeFeedConnected && task) {
+      io.emit('TASK_MOVED', { task });
+    }
+    res.json(task || { task_id: taskId, column });
+  } catch (err) {
+    console.error('Error reordering task:', err);
+    res.status(500).json({ error: 'Failed to reorder task' });
+  }
+});
+
 // DELETE /api/tasks/:id, this will Delete a task
 app.delete('/api/tasks/:id', async (req, res) => {
   try {
@@ -632,9 +1517,15 @@ app.delete('/api/tasks/:id', async (req, res) => {
     };
     
     const result = await sendToBackend(OpType.DELETE_TASK, taskData);
+    if (result.busy) {
+      return sendBusy(res, result);
+    }
+    markUnconfirmed(res, result);
     
     if (result.success) {
-      io.emit('TASK_DELETED', { task_id: taskId });
+      if (!changeFeedConnected) {
+        io.emit('TASK_DELETED', { task_id: taskId });
+      }
       res.status(204).send();
     } else {
       res.status(404).json({ error: 'Task not found' });
@@ -664,5 +1555,6 @@ server.listen(PORT, () => {
   console.log(`API Gateway listening on port ${PORT}`);
   console.log(`Master backend: ${MASTER_HOST}:${MASTER_PORT}`);
   console.log(`Backup backend: ${BACKUP_HOST}:${BACKUP_PORT}`);
+  startChangeFeed();
   console.log(`WebSocket server ready`);
 });